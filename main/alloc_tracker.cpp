@@ -0,0 +1,86 @@
+#include "alloc_tracker.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include <cstdlib>
+
+static auto TAG = "ALLOC_TRACKER";
+
+std::atomic<TaskHandle_t> AllocTracker::watched_[MAX_WATCHED]{};
+std::atomic<uint32_t> AllocTracker::allocations_{0};
+std::atomic<uint32_t> AllocTracker::last_size_{0};
+std::atomic<TaskHandle_t> AllocTracker::last_task_{nullptr};
+uint32_t AllocTracker::reported_{0};
+
+void AllocTracker::watch_current_task() {
+    if (!enabled()) {
+        return;
+    }
+    const TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (std::atomic<TaskHandle_t> &slot: watched_) {
+        TaskHandle_t expected = nullptr;
+        if (slot.load() == task || slot.compare_exchange_strong(expected, task)) {
+            ESP_LOGI(TAG, "Watching %s for heap allocations", pcTaskGetName(task));
+            return;
+        }
+    }
+    ESP_LOGW(TAG, "No slot left to watch %s", pcTaskGetName(task));
+}
+
+AllocTracker::Pause::Pause() : slot_(-1) {
+    const TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (int i = 0; enabled() && i < MAX_WATCHED; i++) {
+        if (TaskHandle_t expected = task; watched_[i].compare_exchange_strong(expected, nullptr)) {
+            slot_ = i;
+            break;
+        }
+    }
+}
+
+AllocTracker::Pause::~Pause() {
+    if (slot_ >= 0) {
+        watched_[slot_].store(xTaskGetCurrentTaskHandle());
+    }
+}
+
+IRAM_ATTR void AllocTracker::on_alloc(const size_t size) {
+    const TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (const std::atomic<TaskHandle_t> &slot: watched_) {
+        if (slot.load(std::memory_order_relaxed) != task) {
+            continue;
+        }
+#if CONFIG_ANTENNA_SWITCH_ALLOC_TRACKER_ABORT
+        abort();
+#endif
+        allocations_.fetch_add(1, std::memory_order_relaxed);
+        last_size_.store(size, std::memory_order_relaxed);
+        last_task_.store(task, std::memory_order_relaxed);
+        return;
+    }
+}
+
+AllocTracker::Report AllocTracker::get_report() {
+    const TaskHandle_t task = last_task_.load();
+    return {allocations_.load(), last_size_.load(), task != nullptr ? pcTaskGetName(task) : nullptr};
+}
+
+void AllocTracker::check() {
+    const Report report = get_report();
+    if (report.allocations == reported_) {
+        return;
+    }
+    ESP_LOGE(TAG, "%lu heap allocation(s) on real-time tasks, last %lu bytes by %s",
+             static_cast<unsigned long>(report.allocations - reported_), static_cast<unsigned long>(report.last_size),
+             report.last_task != nullptr ? report.last_task : "?");
+    reported_ = report.allocations;
+}
+
+#if CONFIG_ANTENNA_SWITCH_ALLOC_TRACKER
+// Heap hooks, enabled by CONFIG_HEAP_USE_HOOKS
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void *ptr, const size_t size, uint32_t caps) {
+    AllocTracker::on_alloc(size);
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void *ptr) {
+}
+#endif
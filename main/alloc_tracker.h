@@ -0,0 +1,62 @@
+#pragma once
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Counts heap allocations made by real-time tasks after they enter their main
+// loop, through the heap hooks (CONFIG_ANTENNA_SWITCH_ALLOC_TRACKER). CAT
+// decoding and relay dispatch are meant to be allocation-free, so anything
+// counted here is a bug; with CONFIG_ANTENNA_SWITCH_ALLOC_TRACKER_ABORT the
+// allocator aborts instead, and the backtrace shows the call.
+class AllocTracker {
+public:
+    struct Report {
+        uint32_t allocations;
+        uint32_t last_size;
+        const char *last_task; // Name of the task behind the last one, nullptr if none
+    };
+
+    // Stops counting the calling task's allocations while in scope, for rare work
+    // such as saving settings to NVS
+    class Pause {
+    public:
+        Pause();
+
+        ~Pause();
+
+    private:
+        int slot_;
+    };
+
+    static constexpr int MAX_WATCHED = 6;
+
+    static constexpr bool enabled() {
+#if CONFIG_ANTENNA_SWITCH_ALLOC_TRACKER
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Count allocations by the calling task from now on; no-op unless enabled
+    static void watch_current_task();
+
+    static Report get_report();
+
+    // Log allocations counted since the last call; called from the main loop
+    static void check();
+
+    // From the heap hook, possibly with interrupts disabled: no logging, no allocation
+    static void on_alloc(size_t size);
+
+private:
+    static std::atomic<TaskHandle_t> watched_[MAX_WATCHED];
+    static std::atomic<uint32_t> allocations_;
+    static std::atomic<uint32_t> last_size_;
+    static std::atomic<TaskHandle_t> last_task_;
+    static uint32_t reported_;
+};
@@ -0,0 +1,207 @@
+#include "antenna_arbiter.h"
+#include "esp_log.h"
+
+static auto TAG = "ANTENNA_ARBITER";
+
+AntennaArbiter::Result AntennaArbiter::request(const int radio, const int band, const antenna_switch_config_t &config) {
+    Result result{};
+    uint64_t expected = state_.load();
+    uint64_t next;
+    do {
+        next = expected;
+        result.preempted_radio = -1;
+
+        // Staying on the same band keeps the antenna already held
+        if (radio_band(expected, radio) != band || held_candidate(expected, radio) == NO_CANDIDATE) {
+            next = with_radio(expected, radio, band, NO_CANDIDATE);
+            result.preempted_radio = resolve_radio(&next, radio, true, config);
+        }
+
+        // An antenna this radio released may be what a blocked radio is waiting for
+        for (int r = 0; r < MAX_RADIOS; r++) {
+            if (r != radio && held_candidate(next, r) == NO_CANDIDATE && radio_band(next, r) >= 0) {
+                resolve_radio(&next, r, false, config);
+            }
+        }
+
+        result.granted = held_candidate(next, radio) != NO_CANDIDATE;
+        result.state = next;
+    } while (!state_.compare_exchange_weak(expected, next));
+
+    return result;
+}
+
+AntennaArbiter::Result AntennaArbiter::refresh(const antenna_switch_config_t &config) {
+    Result result{};
+    uint64_t expected = state_.load();
+    uint64_t next;
+    do {
+        next = expected;
+        result.preempted_radio = -1;
+        for (int r = 0; r < MAX_RADIOS; r++) {
+            if (held_candidate(next, r) == NO_CANDIDATE && radio_band(next, r) >= 0) {
+                if (const int preempted = resolve_radio(&next, r, true, config); preempted >= 0) {
+                    result.preempted_radio = preempted;
+                }
+            }
+        }
+        result.granted = next != expected;
+        result.state = next;
+    } while (!state_.compare_exchange_weak(expected, next));
+
+    return result;
+}
+
+void AntennaArbiter::set_transmitting(const int radio, const bool transmitting) {
+    if (transmitting) {
+        transmitting_.fetch_or(1 << radio);
+    } else {
+        transmitting_.fetch_and(~(1 << radio));
+    }
+}
+
+LogicalOutputMask AntennaArbiter::outputs(const uint64_t state, const antenna_switch_config_t &config) {
+    LogicalOutputMask outputs;
+    for (int r = 0; r < MAX_RADIOS; r++) {
+        outputs |= radio_outputs(state, r, config);
+    }
+    return outputs;
+}
+
+LogicalOutputMask AntennaArbiter::radio_outputs(const uint64_t state, const int radio,
+                                                const antenna_switch_config_t &config) {
+    const int candidate = held_candidate(state, radio);
+    if (candidate == NO_CANDIDATE) {
+        return {};
+    }
+    return candidate_outputs(config, radio_band(state, radio), candidate);
+}
+
+int AntennaArbiter::radio_band(const uint64_t state, const int radio) {
+    return static_cast<int>((state >> (radio * RADIO_BITS + 8)) & 0xff) - 1;
+}
+
+int AntennaArbiter::port_output(const antenna_switch_config_t &config, const int port_index) {
+    const int channel = config.port_channel[port_index] ? config.port_channel[port_index] : port_index + 1;
+    return RelayBoardRegistry::logical_output(config.port_board[port_index], channel);
+}
+
+int AntennaArbiter::candidate_count(const antenna_switch_config_t &config, const int band) {
+    if (band < 0 || band >= config.num_bands) {
+        return 0;
+    }
+    return RelayBoardRegistry::mask_from_bytes(config.band_outputs[band]).any() ? 1 : config.num_antenna_ports;
+}
+
+LogicalOutputMask AntennaArbiter::candidate_outputs(const antenna_switch_config_t &config, const int band,
+                                                    const int index) {
+    if (band < 0 || band >= config.num_bands || index < 0 || index >= MAX_ANTENNA_PORTS) {
+        return {};
+    }
+    if (const LogicalOutputMask outputs = RelayBoardRegistry::mask_from_bytes(config.band_outputs[band]);
+        outputs.any()) {
+        return index == 0 ? outputs : LogicalOutputMask();
+    }
+    if (!config.bands[band].antenna_ports[index]) {
+        return {};
+    }
+    const int output = port_output(config, index);
+    if (output < 1 || output > MAX_LOGICAL_OUTPUTS) {
+        return {};
+    }
+    return LogicalOutputMask().set(output - 1);
+}
+
+int AntennaArbiter::held_candidate(const uint64_t state, const int radio) {
+    return static_cast<int>((state >> (radio * RADIO_BITS)) & 0xff) - 1;
+}
+
+uint64_t AntennaArbiter::with_radio(const uint64_t state, const int radio, const int band, const int candidate) {
+    const int shift = radio * RADIO_BITS;
+    const uint64_t field = static_cast<uint64_t>(band + 1) << 8 | static_cast<uint64_t>(candidate + 1);
+    return (state & ~(0xffffULL << shift)) | field << shift;
+}
+
+bool AntennaArbiter::outranks(const int radio, const int holder, const antenna_switch_config_t &config) const {
+    const uint8_t transmitting = transmitting_.load();
+    // Switching a radio's antenna while it transmits would hot-switch the relays
+    if (transmitting & (1 << holder)) {
+        return false;
+    }
+    if (transmitting & (1 << radio)) {
+        return true;
+    }
+    return radio == config.priority_radio;
+}
+
+int AntennaArbiter::resolve_radio(uint64_t *state, const int radio, const bool allow_preempt,
+                                  const antenna_switch_config_t &config) const {
+    const int band = radio_band(*state, radio);
+    const int count = candidate_count(config, band);
+    *state = with_radio(*state, radio, band, NO_CANDIDATE);
+
+    LogicalOutputMask others;
+    for (int r = 0; r < MAX_RADIOS; r++) {
+        if (r != radio) {
+            others |= radio_outputs(*state, r, config);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const LogicalOutputMask wanted = candidate_outputs(config, band, i);
+        if (wanted.any() && (wanted & others).none() &&
+            antenna_switch_check_outputs(config, wanted | others) == ESP_OK) {
+            *state = with_radio(*state, radio, band, i);
+            return -1;
+        }
+    }
+
+    if (!allow_preempt) {
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        const LogicalOutputMask wanted = candidate_outputs(config, band, i);
+        if (wanted.none()) {
+            continue;
+        }
+
+        uint8_t holders = 0;
+        LogicalOutputMask remaining;
+        for (int r = 0; r < MAX_RADIOS; r++) {
+            if (r == radio) {
+                continue;
+            }
+            if (const LogicalOutputMask held = radio_outputs(*state, r, config); (held & wanted).any()) {
+                holders |= 1 << r;
+            } else {
+                remaining |= held;
+            }
+        }
+
+        bool outranks_all = holders != 0;
+        for (int r = 0; r < MAX_RADIOS && outranks_all; r++) {
+            outranks_all = !(holders & (1 << r)) || outranks(radio, r, config);
+        }
+        if (!outranks_all || antenna_switch_check_outputs(config, wanted | remaining) != ESP_OK) {
+            continue;
+        }
+
+        for (int r = 0; r < MAX_RADIOS; r++) {
+            if (holders & (1 << r)) {
+                *state = with_radio(*state, r, radio_band(*state, r), NO_CANDIDATE);
+            }
+        }
+        *state = with_radio(*state, radio, band, i);
+        // Losing radios move to another free antenna of their band if there is one
+        for (int r = 0; r < MAX_RADIOS; r++) {
+            if (holders & (1 << r)) {
+                resolve_radio(state, r, false, config);
+            }
+        }
+        ESP_LOGD(TAG, "Radio %d preempts radios 0x%x on band %d", radio + 1, holders, band);
+        return __builtin_ctz(holders);
+    }
+
+    return -1;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "antenna_switch.h"
+#include <atomic>
+#include <cstdint>
+
+// Shares the antenna matrix between radios (SO2R). Each radio asks for the
+// antennas of its band; the arbiter grants the first candidate no other radio
+// holds, so two radios never end up on the same antenna. All state lives in one
+// atomic word updated by compare-and-swap, so the CAT tasks of different radios
+// never block each other.
+//
+// Candidates for a band are its band_outputs mask if set, otherwise each enabled
+// antenna port in order. A contested candidate goes to the radio that outranks
+// the holder: a transmitting radio is never preempted, otherwise priority_radio wins.
+class AntennaArbiter {
+public:
+    struct Result {
+        bool granted;
+        int preempted_radio; // Radio that lost its antenna to this request, -1 if none
+        uint64_t state; // Snapshot to dispatch
+    };
+
+    AntennaArbiter() : state_(0), transmitting_(0) {
+    }
+
+    // Record that radio is on band and resolve antennas for every radio
+    Result request(int radio, int band, const antenna_switch_config_t &config);
+
+    // Retry radios left without an antenna, e.g. after a transmitting holder drops back to receive.
+    // granted is true if anything changed.
+    Result refresh(const antenna_switch_config_t &config);
+
+    void set_transmitting(int radio, bool transmitting);
+
+    uint64_t snapshot() const { return state_.load(); }
+
+    // Union of the outputs every radio holds in state
+    static LogicalOutputMask outputs(uint64_t state, const antenna_switch_config_t &config);
+
+    // Outputs radio holds in state; empty if it has no antenna
+    static LogicalOutputMask radio_outputs(uint64_t state, int radio, const antenna_switch_config_t &config);
+
+    static int radio_band(uint64_t state, int radio);
+
+    // Logical relay output wired to antenna port port_index (0-based)
+    static int port_output(const antenna_switch_config_t &config, int port_index);
+
+private:
+    // Per radio, 16 bits: wanted band + 1 (high byte), held candidate + 1 (low byte)
+    static constexpr int RADIO_BITS = 16;
+    static constexpr int NO_CANDIDATE = -1;
+    static_assert(MAX_RADIOS * RADIO_BITS <= 64, "radio state must fit one atomic word");
+    static_assert(MAX_RADIOS <= 8, "transmit flags are one byte");
+
+    std::atomic<uint64_t> state_;
+    std::atomic<uint8_t> transmitting_; // Bit per radio
+
+    static int candidate_count(const antenna_switch_config_t &config, int band);
+
+    // Outputs of candidate index for band; empty if that port isn't enabled for the band
+    static LogicalOutputMask candidate_outputs(const antenna_switch_config_t &config, int band, int index);
+
+    static int held_candidate(uint64_t state, int radio);
+
+    static uint64_t with_radio(uint64_t state, int radio, int band, int candidate);
+
+    bool outranks(int radio, int holder, const antenna_switch_config_t &config) const;
+
+    // Give radio the first usable candidate of its band, preempting lower ranked
+    // holders if allowed. Returns the preempted radio or -1.
+    int resolve_radio(uint64_t *state, int radio, bool allow_preempt, const antenna_switch_config_t &config) const;
+};
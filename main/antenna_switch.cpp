@@ -1,23 +1,34 @@
 #include "antenna_switch.h"
+#include "antenna_arbiter.h"
+#include "boot_timeline.h"
 #include "config_manager.h"
+#include "frequency_arbiter.h"
+#include "esp_timer.h"
 #include "esp_log.h"
 #include "relay_controller.h"
-#include "wifi_manager.hpp"
+#include "relay_dispatcher.h"
+#include <cstring>
 #include <memory>
+#include <mutex>
 #include <nvs.h>
 #include "esp_wifi.h"
 #include "esp_system.h"
 
 static auto TAG = "ANTENNA_SWITCH";
-static std::unique_ptr<RelayController> relay_controller;
+static RelayBoardRegistry relay_boards;
+static std::unique_ptr<RelayDispatcher> relay_dispatcher;
+static AntennaArbiter antenna_arbiter;
+static FrequencyArbiter frequency_arbiter;
+// Serialises reports from the CAT and network tasks, so decisions are applied in the order they were made
+static std::mutex frequency_mutex;
 
-[[maybe_unused]] static esp_err_t get_ip_address(char *ip_addr, const size_t max_len) {
-    if (!ip_addr || max_len < 16) {
-        // IPv4 address max length is 15 chars + null terminator
-        return ESP_ERR_INVALID_ARG;
-    }
+static_assert(RelayController::MAX_TRACKED_BANDS >= MAX_BANDS, "RelayController can't remember every band");
 
-    return WifiManager::instance().get_ip_info(ip_addr, max_len);
+static void rebuild_band_index(const antenna_switch_config_t &config);
+
+// The primary board, configured through tcp_host/tcp_port
+static RelayController *primary_board() {
+    return relay_boards.board(0);
 }
 
 esp_err_t antenna_switch_set_tcp_host(const char *host) {
@@ -25,23 +36,11 @@ esp_err_t antenna_switch_set_tcp_host(const char *host) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    auto config = ConfigManager::instance().get_config();
-
-    strncpy(config.tcp_host, host, sizeof(config.tcp_host) - 1);
-    config.tcp_host[sizeof(config.tcp_host) - 1] = '\0';
-
-    // Update the TCP host in the RelayController
-    if (relay_controller) {
-        relay_controller->set_tcp_host(host);
-        // wait a little before reconnecting
-        vTaskDelay(pdMS_TO_TICKS(100));
-        if (const esp_err_t ret = relay_controller->init(); ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to reconnect after host change: %s", esp_err_to_name(ret));
-            return ret;
-        }
-    }
-
-    return ConfigManager::instance().update_config(config);
+    // The primary board follows CONFIG_FIELD_RELAY_LINK and reconnects on its own task, only if the host changed
+    return ConfigManager::instance().modify([host](antenna_switch_config_t &config) {
+        strncpy(config.tcp_host, host, sizeof(config.tcp_host) - 1);
+        config.tcp_host[sizeof(config.tcp_host) - 1] = '\0';
+    });
 }
 
 
@@ -54,13 +53,86 @@ esp_err_t antenna_switch_init() {
         return err;
     }
 
+    // Band edits re-map the frequencies already heard; other saves leave the arbiter alone
+    ConfigManager::instance().add_observer(CONFIG_FIELD_BANDS, rebuild_band_index);
+
+    // A statically initialised pthread mutex is allocated on its first lock; take it here, not on a CAT task
+    std::lock_guard lock(frequency_mutex);
+
     // Don't create or initialize the relay controller here
     // It will be initialized by SystemInitializer
     return ESP_OK;
 }
 
 void antenna_switch_set_relay_controller(std::unique_ptr<RelayController> controller) {
-    relay_controller = std::move(controller);
+    if (relay_boards.size() == 0) {
+        relay_boards.add_board(std::move(controller));
+    } else {
+        ESP_LOGE(TAG, "Primary relay board already registered");
+    }
+}
+
+esp_err_t antenna_switch_add_relay_board(std::unique_ptr<RelayController> controller) {
+    if (relay_dispatcher) {
+        ESP_LOGE(TAG, "Relay boards must be added before dispatch starts");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const int index = relay_boards.add_board(std::move(controller));
+    if (index < 0) {
+        ESP_LOGE(TAG, "Cannot register more than %d relay boards", MAX_RELAY_BOARDS);
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Registered relay board %d", index);
+    return ESP_OK;
+}
+
+esp_err_t antenna_switch_start_relay_dispatch() {
+    if (relay_boards.size() == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!relay_dispatcher) {
+        relay_dispatcher = std::make_unique<RelayDispatcher>(relay_boards);
+    }
+    return relay_dispatcher->start();
+}
+
+bool antenna_switch_outputs_settled() {
+    return !relay_dispatcher || relay_dispatcher->is_settled();
+}
+
+bool antenna_switch_dispatch_stats(RelayDispatcher::Stats *stats) {
+    if (!relay_dispatcher) {
+        return false;
+    }
+    *stats = relay_dispatcher->get_stats();
+    return true;
+}
+
+uint32_t antenna_switch_relay_backlog() {
+    uint32_t backlog = 0;
+    for (size_t b = 0; b < relay_boards.size(); b++) {
+        backlog += relay_boards.board(b)->get_request_backlog();
+    }
+    return backlog;
+}
+
+esp_err_t antenna_switch_start_rtt_probe(const int slot, const uint16_t samples) {
+    RelayController *relay_controller = primary_board();
+    if (relay_controller == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return relay_controller->start_rtt_probe(slot, samples);
+}
+
+esp_err_t antenna_switch_get_rtt_probe(const int slot, RelayRttProbe *probe) {
+    const RelayController *relay_controller = primary_board();
+    if (relay_controller == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *probe = relay_controller->get_rtt_probe(slot);
+    return ESP_OK;
 }
 
 esp_err_t antenna_switch_set_config(const antenna_switch_config_t *config) {
@@ -74,12 +146,36 @@ esp_err_t antenna_switch_get_config(antenna_switch_config_t *config) {
     if (config == nullptr) {
         return ESP_ERR_INVALID_ARG;
     }
-    *config = ConfigManager::instance().get_config();
+    ConfigManager::instance().copy_config(config);
     return ESP_OK;
 }
 
 esp_err_t antenna_switch_set_frequency(const uint32_t frequency) {
-    ESP_LOGV(TAG, "Setting antenna for frequency: %lu Hz", frequency);
+    return antenna_switch_set_radio_frequency(0, frequency);
+}
+
+// Send the arbiter's outputs to the boards. Another radio may have changed the
+// arbiter in the meantime, so repeat until the latest state is the one dispatched.
+static esp_err_t dispatch_radio_outputs(uint64_t state, const int band, const antenna_switch_config_t &config) {
+    while (true) {
+        if (const esp_err_t ret = relay_dispatcher->select_outputs(AntennaArbiter::outputs(state, config), band);
+            ret != ESP_OK) {
+            return ret;
+        }
+        const uint64_t latest = antenna_arbiter.snapshot();
+        if (latest == state) {
+            return ESP_OK;
+        }
+        state = latest;
+    }
+}
+
+esp_err_t antenna_switch_set_radio_frequency(const int radio, const uint32_t frequency) {
+    ESP_LOGV(TAG, "Setting antenna for radio %d frequency: %lu Hz", radio + 1, frequency);
+
+    if (radio < 0 || radio >= MAX_RADIOS) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
     // we only need a reference to config here as we won't mutate it
     const auto &config = ConfigManager::instance().get_config();
@@ -91,17 +187,38 @@ esp_err_t antenna_switch_set_frequency(const uint32_t frequency) {
     for (int i = 0; i < config.num_bands; i++) {
         if (frequency >= config.bands[i].start_freq &&
             frequency <= config.bands[i].end_freq) {
-            // Find the first available antenna port for this band
-            for (int j = 0; j < config.num_antenna_ports; j++) {
-                if (config.bands[i].antenna_ports[j]) {
-                    ESP_LOGI(TAG, "Selecting relay %d for band %d", j + 1, i);
-                    // Use the RelayController to set the appropriate relay
-                    return relay_controller->set_relay_for_antenna(j + 1, i);
-                }
+            if (!relay_dispatcher) {
+                return ESP_ERR_INVALID_STATE;
             }
 
-            ESP_LOGW(TAG, "No available antenna port found for band %d", i);
-            return ESP_OK;
+            const LogicalOutputMask band_outputs = RelayBoardRegistry::mask_from_bytes(config.band_outputs[i]);
+            if (band_outputs.any() && antenna_switch_check_outputs(config, band_outputs) != ESP_OK) {
+                ESP_LOGE(TAG, "Outputs for band %d break an exclusion group", i);
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            bool has_port = band_outputs.any();
+            for (int j = 0; j < config.num_antenna_ports && !has_port; j++) {
+                has_port = config.bands[i].antenna_ports[j];
+            }
+            if (!has_port) {
+                ESP_LOGW(TAG, "No available antenna port found for band %d", i);
+                return ESP_OK;
+            }
+
+            // Picks an antenna no other radio holds; never blocks on the other radio
+            const AntennaArbiter::Result result = antenna_arbiter.request(radio, i, config);
+            if (!result.granted) {
+                ESP_LOGW(TAG, "Radio %d: every antenna for band %d is in use by another radio", radio + 1, i);
+            } else if (result.preempted_radio >= 0) {
+                ESP_LOGW(TAG, "Radio %d took an antenna from radio %d for band %d",
+                         radio + 1, result.preempted_radio + 1, i);
+            } else {
+                ESP_LOGI(TAG, "Radio %d: selecting %u output(s) for band %d", radio + 1,
+                         static_cast<unsigned>(AntennaArbiter::radio_outputs(result.state, radio, config).count()), i);
+            }
+            // Switches every board that is affected in parallel
+            return dispatch_radio_outputs(result.state, i, config);
         }
     }
 
@@ -109,6 +226,91 @@ esp_err_t antenna_switch_set_frequency(const uint32_t frequency) {
     return ESP_OK;
 }
 
+static int band_for_frequency(const antenna_switch_config_t &config, const uint32_t frequency) {
+    for (int i = 0; i < config.num_bands; i++) {
+        if (frequency >= config.bands[i].start_freq && frequency <= config.bands[i].end_freq) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void rebuild_band_index(const antenna_switch_config_t &config) {
+    std::lock_guard lock(frequency_mutex);
+    frequency_arbiter.rebuild_bands(config, band_for_frequency);
+}
+
+esp_err_t antenna_switch_report_frequency(const int radio, const int source, const uint32_t frequency) {
+    if (radio < 0 || radio >= MAX_RADIOS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    BootTimeline::mark(BootStage::FIRST_FREQUENCY);
+    const auto &config = ConfigManager::instance().get_config();
+
+    // Decided and dispatched under one lock: antenna_arbiter.request() is last-writer-wins, so a
+    // decision applied after a newer one would leave the relays on the stale band. Cheap to hold,
+    // since select_outputs() only posts to the dispatcher and never waits on a board.
+    std::lock_guard lock(frequency_mutex);
+    const FrequencyArbiter::Decision decision = frequency_arbiter.report(
+        radio, source, frequency, band_for_frequency(config, frequency), esp_timer_get_time(), config);
+    if (!decision.changed) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "Radio %d: band %d from %s (%lu Hz)", radio + 1, decision.band,
+             FrequencyArbiter::source_name(decision.source), decision.frequency);
+    const esp_err_t ret = antenna_switch_set_radio_frequency(radio, decision.frequency);
+    if (ret != ESP_OK) {
+        // Try again on the next report rather than waiting for another band change
+        frequency_arbiter.retry(radio);
+    }
+    return ret;
+}
+
+int antenna_switch_frequency_source(const int radio) {
+    std::lock_guard lock(frequency_mutex);
+    return frequency_arbiter.active_source(radio);
+}
+
+int64_t antenna_switch_manual_hold_remaining_ms() {
+    std::lock_guard lock(frequency_mutex);
+    return frequency_arbiter.manual_hold_remaining_us(esp_timer_get_time()) / 1000;
+}
+
+esp_err_t antenna_switch_set_radio_transmitting(const int radio, const bool transmitting) {
+    if (radio < 0 || radio >= MAX_RADIOS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    antenna_arbiter.set_transmitting(radio, transmitting);
+    if (transmitting || !relay_dispatcher) {
+        return ESP_OK;
+    }
+
+    // A radio held off by this one's transmission may take its antenna now
+    const auto &config = ConfigManager::instance().get_config();
+    if (const AntennaArbiter::Result result = antenna_arbiter.refresh(config); result.granted) {
+        return dispatch_radio_outputs(result.state, AntennaArbiter::radio_band(result.state, radio), config);
+    }
+    return ESP_OK;
+}
+
+LogicalOutputMask antenna_switch_radio_outputs(const int radio) {
+    return AntennaArbiter::radio_outputs(antenna_arbiter.snapshot(), radio, ConfigManager::instance().get_config());
+}
+
+esp_err_t antenna_switch_check_outputs(const antenna_switch_config_t &config, const LogicalOutputMask &outputs) {
+    for (int g = 0; g < MAX_EXCLUSION_GROUPS; g++) {
+        if (const LogicalOutputMask on = outputs & RelayBoardRegistry::mask_from_bytes(config.exclusion_groups[g]);
+            on.count() > 1) {
+            ESP_LOGD(TAG, "%u outputs of exclusion group %d would be on together",
+                     static_cast<unsigned>(on.count()), g + 1);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
 /**
  * Whether automatic band switching should be used
  * @param auto_mode
@@ -117,34 +319,42 @@ esp_err_t antenna_switch_set_frequency(const uint32_t frequency) {
 esp_err_t antenna_switch_set_auto_mode(const bool auto_mode) {
     ESP_LOGD(TAG, "Setting auto mode: %s", auto_mode ? "ON" : "OFF");
 
-    auto config = ConfigManager::instance().get_config();
-    config.auto_mode = auto_mode;
-
-    return ConfigManager::instance().update_config(config);
+    return ConfigManager::instance().modify([auto_mode](antenna_switch_config_t &config) {
+        config.auto_mode = auto_mode;
+    });
 }
 
 esp_err_t antenna_switch_set_relay(const int relay_id, const bool state) {
     ESP_LOGI(TAG, "Setting relay %d to %s", relay_id, state ? "ON" : "OFF");
-    return relay_controller->set_relay(relay_id, state);
+    RelayBoardRegistry::Location location{};
+    if (!relay_boards.locate(relay_id, &location)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    {
+        // A hand-picked relay sticks for a while instead of being undone by the next CAT report
+        std::lock_guard lock(frequency_mutex);
+        frequency_arbiter.hold_manual(esp_timer_get_time(), ConfigManager::instance().get_config());
+        if (relay_dispatcher) {
+            relay_dispatcher->invalidate_selection();
+        }
+    }
+    return relay_boards.board(location.board)->set_relay(location.channel, state);
 }
 
 esp_err_t antenna_switch_set_tcp_port(const uint16_t port) {
-    auto config = ConfigManager::instance().get_config();
-    config.tcp_port = port;
-
-    // Update the TCP port in the RelayController
-    if (relay_controller) {
-        relay_controller->set_tcp_port(port);
-    }
-
-    return ConfigManager::instance().update_config(config);
+    // Applied by the primary board's CONFIG_FIELD_RELAY_LINK observer
+    return ConfigManager::instance().modify([port](antenna_switch_config_t &config) { config.tcp_port = port; });
 }
 
 esp_err_t antenna_switch_get_relay_state(const int relay_id, bool *state) {
     if (state == nullptr) {
         return ESP_ERR_INVALID_ARG;
     }
-    *state = relay_controller->get_relay_state(relay_id);
+    RelayBoardRegistry::Location location{};
+    if (!relay_boards.locate(relay_id, &location)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *state = relay_boards.board(location.board)->get_relay_state(location.channel);
     return ESP_OK;
 }
 
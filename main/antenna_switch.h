@@ -2,11 +2,15 @@
 #define ANTENNA_SWITCH_H
 
 #include "esp_err.h"
-#include "relay_controller.h"
+#include "relay_dispatcher.h"
 
 // Constants and structs (these can be used from both C and C++)
 #define MAX_BANDS 10
-#define MAX_ANTENNA_PORTS 8
+// Half the board's outputs, which keeps the saved config layout unchanged for the 16-output A16
+#define MAX_ANTENNA_PORTS (RELAY_BOARD_OUTPUTS / 2)
+#define MAX_EXCLUSION_GROUPS 4
+// Radios with their own CAT port (SO2R)
+#define MAX_RADIOS 2
 
 typedef struct band_config {
     char description[32];
@@ -26,6 +30,51 @@ typedef struct {
     uint8_t uart_parity;
     uint8_t uart_stop_bits;
     uint8_t uart_flow_ctrl;
+    // New fields go at the end so configs saved by older firmware still load (zero = default)
+    uint8_t relay_transport;
+    uint8_t modbus_address; // RS485 transport only
+    int rs485_baud_rate;
+    // Relay boards after the primary one at tcp_host; they use the primary's network transport
+    uint8_t num_extra_boards;
+    char extra_board_hosts[MAX_RELAY_BOARDS - 1][16];
+    uint16_t extra_board_ports[MAX_RELAY_BOARDS - 1];
+    // Board (0 = primary) and channel (0 = port number) each antenna port is wired to
+    uint8_t port_board[MAX_ANTENNA_PORTS];
+    uint8_t port_channel[MAX_ANTENNA_PORTS];
+    // Logical outputs switched on together for each band (filters, amplifier paths...);
+    // an all-zero mask falls back to the band's first antenna port
+    uint8_t band_outputs[MAX_BANDS][OUTPUT_MASK_BYTES];
+    // Outputs of which at most one may be on at any time, e.g. ports of the same antenna relay
+    uint8_t exclusion_groups[MAX_EXCLUSION_GROUPS][OUTPUT_MASK_BYTES];
+    // Second radio on its own CAT port (0 or 1 = single radio)
+    uint8_t num_radios;
+    // Radio (0-based) that wins a contested antenna when neither is transmitting
+    uint8_t priority_radio;
+    int cat2_baud_rate; // 0 = same as uart_baud_rate
+    uint8_t cat_protocols[MAX_RADIOS]; // CAT_PROTOCOL_* per radio
+    bool cat_fixed_link; // Skip baud rate / protocol detection
+    bool cat_polling; // Query radios that don't send auto-information
+    bool cat_pc_bridge; // Share radio 1's CAT port with a PC logger on UART0 (console off)
+    // Network frequency sources, see network_frequency_source.h
+    uint16_t n1mm_udp_port; // RadioInfo listener, 0 = off
+    char rigctld_host[16]; // Empty = off
+    uint16_t rigctld_port; // 0 = RIGCTLD_DEFAULT_PORT
+    // Frequency source arbitration, see frequency_arbiter.h
+    uint8_t frequency_priority; // FREQ_PRIORITY_*
+    uint16_t source_fresh_s; // Preferred source counts as current this long, 0 = FREQ_FRESH_DEFAULT_S
+    uint16_t manual_hold_s; // Automatic switching pauses this long after a manual relay change, 0 = default
+    uint16_t rigctl_server_port; // rigctld-compatible server for radio 1, radio N on port + N - 1; 0 = off
+    char static_ip[16]; // Station address, empty = DHCP
+    char static_netmask[16];
+    char static_gateway[16];
+    char static_dns[16]; // Empty = the gateway
+    uint8_t network_profile; // NETWORK_PROFILE_*, see network_profile.h
+    // Access point the relay board joins directly, SOFTAP_MODE_* in wifi_manager.hpp; applies after restart
+    uint8_t softap_mode;
+    char softap_ssid[33]; // Empty = "AntennaSwitch-" and the end of the MAC address
+    char softap_password[65]; // WPA2, 8 to 63 characters
+    uint8_t softap_channel; // 0 = default; follows the house network when concurrent
+    uint8_t relay_board_mac[6]; // Station whose lease becomes tcp_host, all zero = the first to join
 } antenna_switch_config_t;
 
 // C interface
@@ -37,18 +86,42 @@ esp_err_t antenna_switch_init();
 esp_err_t antenna_switch_set_config(const antenna_switch_config_t *config);
 esp_err_t antenna_switch_get_config(antenna_switch_config_t *config);
 esp_err_t antenna_switch_set_frequency(uint32_t frequency);
+esp_err_t antenna_switch_set_radio_frequency(int radio, uint32_t frequency);
+// Frequency heard from source (FREQ_SOURCE_*); switches only when the arbitrated band changes
+esp_err_t antenna_switch_report_frequency(int radio, int source, uint32_t frequency);
+esp_err_t antenna_switch_set_radio_transmitting(int radio, bool transmitting);
 esp_err_t antenna_switch_set_auto_mode(bool auto_mode);
 esp_err_t antenna_switch_set_relay(int relay_id, bool state);
 esp_err_t antenna_switch_get_relay_state(int relay_id, bool *state);
 esp_err_t antenna_switch_set_tcp_host(const char *host);
 esp_err_t antenna_switch_set_tcp_port(uint16_t port);
 esp_err_t antenna_switch_restart();
+bool antenna_switch_outputs_settled();
 
 #ifdef __cplusplus
 }
 
 // C++ specific declarations
 void antenna_switch_set_relay_controller(std::unique_ptr<RelayController> controller);
+esp_err_t antenna_switch_add_relay_board(std::unique_ptr<RelayController> controller);
+// Start fanning band changes out to the registered boards
+esp_err_t antenna_switch_start_relay_dispatch();
+// False until relay dispatch has started
+bool antenna_switch_dispatch_stats(RelayDispatcher::Stats *stats);
+// Relay requests not yet applied, summed over the boards
+uint32_t antenna_switch_relay_backlog();
+// Time round trips to the primary board into slot, see RelayController::start_rtt_probe()
+esp_err_t antenna_switch_start_rtt_probe(int slot, uint16_t samples);
+// ESP_ERR_INVALID_STATE without a primary board
+esp_err_t antenna_switch_get_rtt_probe(int slot, RelayRttProbe *probe);
+// ESP_ERR_INVALID_ARG if outputs would turn on more than one output of an exclusion group
+esp_err_t antenna_switch_check_outputs(const antenna_switch_config_t &config, const LogicalOutputMask &outputs);
+// Outputs currently granted to radio; empty if it has no antenna
+LogicalOutputMask antenna_switch_radio_outputs(int radio);
+// Frequency source currently in charge of radio (FREQ_SOURCE_*), -1 if none
+int antenna_switch_frequency_source(int radio);
+// Time left before automatic switching resumes after a manual relay change
+int64_t antenna_switch_manual_hold_remaining_ms();
 #endif
 
 #endif // ANTENNA_SWITCH_H
@@ -0,0 +1,62 @@
+#include "boot_timeline.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static auto TAG = "BOOT";
+
+EventGroupHandle_t BootTimeline::events_{nullptr};
+StaticEventGroup_t BootTimeline::events_storage_;
+int64_t BootTimeline::times_us_[static_cast<int>(BootStage::COUNT)]{};
+
+void BootTimeline::init() {
+    if (events_ == nullptr) {
+        events_ = xEventGroupCreateStatic(&events_storage_);
+    }
+}
+
+void BootTimeline::mark(const BootStage stage) {
+    if (events_ == nullptr || reached(stage)) {
+        return;
+    }
+    // Two tasks may race to the same first mark; either time will do
+    const int64_t now = esp_timer_get_time();
+    times_us_[static_cast<int>(stage)] = now;
+    // Setting the bit publishes the time to readers
+    xEventGroupSetBits(events_, bit(stage));
+    ESP_LOGI(TAG, "%s at %lld ms", name(stage), now / 1000);
+}
+
+bool BootTimeline::reached(const BootStage stage) {
+    return events_ != nullptr && (xEventGroupGetBits(events_) & bit(stage)) != 0;
+}
+
+esp_err_t BootTimeline::wait(const BootStage stage, const uint32_t timeout_ms) {
+    if (events_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const EventBits_t bits = xEventGroupWaitBits(events_, bit(stage), pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+    return (bits & bit(stage)) != 0 ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+int64_t BootTimeline::time_us(const BootStage stage) {
+    return reached(stage) ? times_us_[static_cast<int>(stage)] : -1;
+}
+
+const char *BootTimeline::name(const BootStage stage) {
+    switch (stage) {
+        case BootStage::NVS_READY: return "nvs_ready";
+        case BootStage::CONFIG_LOADED: return "config_loaded";
+        case BootStage::CAT_STARTED: return "cat_started";
+        case BootStage::DISPATCH_STARTED: return "dispatch_started";
+        case BootStage::WIFI_STARTED: return "wifi_started";
+        case BootStage::SOFTAP_STARTED: return "softap_started";
+        case BootStage::WIFI_ASSOCIATED: return "wifi_associated";
+        case BootStage::IP_ACQUIRED: return "ip_acquired";
+        case BootStage::WEBSERVER_STARTED: return "webserver_started";
+        case BootStage::NETWORK_SERVICES_STARTED: return "network_services_started";
+        case BootStage::RELAY_LINK_VERIFIED: return "relay_link_verified";
+        case BootStage::FIRST_FREQUENCY: return "first_frequency";
+        case BootStage::FIRST_BAND_SWITCH: return "first_band_switch";
+        default: return "unknown";
+    }
+}
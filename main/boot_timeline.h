@@ -0,0 +1,55 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <cstdint>
+
+// Boot milestones, in the order they usually happen
+enum class BootStage : uint8_t {
+    NVS_READY,
+    CONFIG_LOADED,
+    CAT_STARTED,
+    DISPATCH_STARTED,
+    WIFI_STARTED,
+    SOFTAP_STARTED,
+    WIFI_ASSOCIATED,
+    IP_ACQUIRED,
+    WEBSERVER_STARTED,
+    NETWORK_SERVICES_STARTED,
+    RELAY_LINK_VERIFIED, // A relay board answered and its outputs were read back
+    FIRST_FREQUENCY, // From CAT or a network source
+    FIRST_BAND_SWITCH, // Relay outputs first written to a board
+    COUNT
+};
+
+// When each boot stage was first reached, for /debug/boot, and an event group
+// so initialization steps can wait for the stages they depend on instead of
+// sleeping. Stages are marked once; later marks are ignored, so the hot paths
+// that report the first frequency or relay write can call mark() every time.
+class BootTimeline {
+public:
+    // Before any mark(); marks made earlier are dropped
+    static void init();
+
+    static void mark(BootStage stage);
+
+    static bool reached(BootStage stage);
+
+    // ESP_ERR_TIMEOUT if stage isn't reached within timeout_ms
+    static esp_err_t wait(BootStage stage, uint32_t timeout_ms);
+
+    // Microseconds from boot to the stage, -1 if not reached yet
+    static int64_t time_us(BootStage stage);
+
+    static const char *name(BootStage stage);
+
+private:
+    static constexpr EventBits_t bit(BootStage stage) { return EventBits_t{1} << static_cast<int>(stage); }
+
+    static EventGroupHandle_t events_;
+    static StaticEventGroup_t events_storage_;
+    static int64_t times_us_[static_cast<int>(BootStage::COUNT)];
+};
+
+static_assert(static_cast<int>(BootStage::COUNT) <= 24, "Event groups hold 24 bits");
@@ -0,0 +1,188 @@
+#include "cat_decoder.h"
+#include <cstdint>
+
+// Whole payload must be decimal digits; 0 Hz would read as "not in frame"
+static bool parse_frequency(const std::string_view digits, uint32_t *frequency) {
+    if (digits.empty() || digits.length() > 11) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (const char c: digits) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    if (value == 0 || value > UINT32_MAX) {
+        return false;
+    }
+    *frequency = static_cast<uint32_t>(value);
+    return true;
+}
+
+static const char *kenwood_mode(const char mode) {
+    switch (mode) {
+        case '1': return "LSB";
+        case '2': return "USB";
+        case '3': return "CW-U";
+        case '4': return "FM";
+        case '5': return "AM";
+        case '6': return "DIG-L";
+        case '7': return "CW-L";
+        case '9': return "DIG-U";
+        default: return "UNKNOWN";
+    }
+}
+
+static const char *yaesu_mode(const char mode) {
+    switch (mode) {
+        case '1': return "LSB";
+        case '2': return "USB";
+        case '3': return "CW-U";
+        case '4': return "FM";
+        case '5': return "AM";
+        case '6': return "RTTY-L";
+        case '7': return "CW-L";
+        case '8': return "DIG-L";
+        case '9': return "RTTY-U";
+        case 'A': return "DIG-FM";
+        case 'B': return "FM-N";
+        case 'C': return "DIG-U";
+        case 'D': return "AM-N";
+        case 'E': return "C4FM";
+        default: return "UNKNOWN";
+    }
+}
+
+static const char *civ_mode(const uint8_t mode) {
+    switch (mode) {
+        case 0x00: return "LSB";
+        case 0x01: return "USB";
+        case 0x02: return "AM";
+        case 0x03: return "CW-U";
+        case 0x04: return "RTTY-L";
+        case 0x05: return "FM";
+        case 0x06: return "WFM";
+        case 0x07: return "CW-L";
+        case 0x08: return "RTTY-U";
+        case 0x17: return "DV";
+        default: return "UNKNOWN";
+    }
+}
+
+const char *cat_protocol_name(const uint8_t protocol) {
+    switch (protocol) {
+        case CAT_PROTOCOL_KENWOOD: return "Kenwood";
+        case CAT_PROTOCOL_CIV: return "CI-V";
+        case CAT_PROTOCOL_YAESU: return "Yaesu";
+        default: return "unknown";
+    }
+}
+
+bool KenwoodDialect::parse(const std::string_view frame, CatUpdate *update) {
+    if (frame.substr(0, 2) == "FA") {
+        return parse_fa(frame.substr(2), update);
+    }
+    if (frame.substr(0, 2) == "IF") {
+        return parse_if(frame.substr(2), update);
+    }
+    return false;
+}
+
+bool KenwoodDialect::parse_fa(const std::string_view payload, CatUpdate *update) {
+    // Always 11 digits; this is also what tells Kenwood and Yaesu replies apart during detection
+    return payload.length() == 11 && parse_frequency(payload, &update->frequency);
+}
+
+bool KenwoodDialect::parse_if(const std::string_view payload, CatUpdate *update) {
+    // P1 frequency (11), P2 step (4), P3 RIT offset (6), P4-P7 (4), P8 TX/RX at 26, P9 mode at 27
+    if (payload.length() < 35 || !parse_frequency(payload.substr(0, 11), &update->frequency)) {
+        return false;
+    }
+    update->transmitting = payload[26] == '1';
+    update->mode = kenwood_mode(payload[27]);
+    return true;
+}
+
+bool YaesuDialect::parse(const std::string_view frame, CatUpdate *update) {
+    const std::string_view command = frame.substr(0, 2);
+    const std::string_view payload = frame.substr(2);
+
+    if (command == "FA") {
+        return payload.length() == 9 && parse_frequency(payload, &update->frequency);
+    }
+    if (command == "IF") {
+        // P1 memory channel (3), P2 frequency (9), P3 clarifier (5), P4-P5 (2), P6 mode at 19
+        if (payload.length() < 20 || !parse_frequency(payload.substr(3, 9), &update->frequency)) {
+            return false;
+        }
+        update->mode = yaesu_mode(payload[19]);
+        return true;
+    }
+    if (command == "TX" && payload.length() == 1) {
+        // 0 = receive, 1 = CAT transmit, 2 = PTT transmit
+        update->transmitting = payload[0] != '0';
+        return true;
+    }
+    if (command == "MD" && payload.length() == 2) {
+        update->mode = yaesu_mode(payload[1]);
+        return true;
+    }
+    return false;
+}
+
+bool CivDecoder::bcd_to_frequency(const uint8_t *bcd, const size_t length, uint32_t *frequency) {
+    uint64_t value = 0;
+    uint64_t scale = 1;
+    for (size_t i = 0; i < length; i++) {
+        const uint8_t low = bcd[i] & 0x0f;
+        const uint8_t high = bcd[i] >> 4;
+        if (low > 9 || high > 9) {
+            return false;
+        }
+        value += (low + high * 10) * scale;
+        scale *= 100;
+    }
+    if (value == 0 || value > UINT32_MAX) {
+        return false;
+    }
+    *frequency = static_cast<uint32_t>(value);
+    return true;
+}
+
+bool CivDecoder::parse(const uint8_t *frame, const size_t length, CatUpdate *update) {
+    // <to> <from> <cmd> [data]
+    if (length < 3) {
+        return false;
+    }
+    const uint8_t command = frame[2];
+    const uint8_t *data = frame + 3;
+    const size_t data_length = length - 3;
+
+    switch (command) {
+        case 0x00: // Transceive frequency broadcast
+        case 0x03: // Read frequency reply
+        case 0x05: // Set frequency
+            // 4 bytes on older rigs, 5 on most, 6 above 10 GHz; a bare 0x03 is a read request
+            return data_length >= 4 && data_length <= 6 && bcd_to_frequency(data, data_length, &update->frequency);
+
+        case 0x01: // Transceive mode broadcast
+        case 0x04: // Read mode reply
+        case 0x06: // Set mode
+            if (data_length < 1) {
+                return false;
+            }
+            update->mode = civ_mode(data[0]);
+            return true;
+
+        case 0x1C: // Transceiver status; sub-command 0x00 is TX/RX
+            if (data_length != 2 || data[0] != 0x00) {
+                return false;
+            }
+            update->transmitting = data[1] != 0;
+            return true;
+
+        default:
+            return false;
+    }
+}
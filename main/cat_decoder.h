@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// CAT dialect a radio speaks (antenna_switch_config_t::cat_protocols)
+#define CAT_PROTOCOL_KENWOOD 0 // Kenwood / Elecraft ASCII, also the default
+#define CAT_PROTOCOL_CIV 1 // Icom CI-V binary
+#define CAT_PROTOCOL_YAESU 2 // Yaesu "new" ASCII CAT (FT-991, FTDX10, ...)
+#define CAT_PROTOCOL_COUNT 3
+
+const char *cat_protocol_name(uint8_t protocol);
+
+// Fields decoded from one frame; anything the frame didn't carry is left unset
+struct CatUpdate {
+    uint32_t frequency{0}; // Hz, 0 = not in frame
+    int8_t transmitting{-1}; // 0 / 1, -1 = not in frame
+    const char *mode{nullptr}; // Static string, nullptr = not in frame
+};
+
+// Decoders turn a raw byte stream into CatUpdates. They are plain classes used
+// through templates, so CatParser's receive loop has no virtual calls:
+//
+//     decoder.feed(data, len, [&](const CatUpdate &update) { ... });
+
+// ';'-terminated ASCII frames; Dialect::parse() decodes one frame without the ';'
+template<typename Dialect>
+class AsciiCatDecoder {
+public:
+    static constexpr size_t MAX_FRAME_LENGTH = 64;
+
+    template<typename Sink>
+    void feed(const uint8_t *data, const size_t len, Sink &&sink) {
+        for (size_t i = 0; i < len; i++) {
+            const char c = static_cast<char>(data[i]);
+            if (c == ';') {
+                if (!overflow_ && length_ >= 2) {
+                    if (CatUpdate update; Dialect::parse(std::string_view(frame_, length_), &update)) {
+                        sink(update);
+                    }
+                }
+                length_ = 0;
+                overflow_ = false;
+            } else if (length_ < MAX_FRAME_LENGTH) {
+                frame_[length_++] = c;
+            } else {
+                // Drop everything up to the next terminator
+                overflow_ = true;
+            }
+        }
+    }
+
+    void reset() {
+        length_ = 0;
+        overflow_ = false;
+    }
+
+private:
+    char frame_[MAX_FRAME_LENGTH]{};
+    size_t length_{0};
+    bool overflow_{false};
+};
+
+// FA<11 digits>, IF<35+ chars> as sent by Kenwood and Elecraft rigs
+struct KenwoodDialect {
+    static bool parse(std::string_view frame, CatUpdate *update);
+
+    // Payload after "FA" / "IF"
+    static bool parse_fa(std::string_view payload, CatUpdate *update);
+
+    static bool parse_if(std::string_view payload, CatUpdate *update);
+};
+
+// FA<9 digits>, IF, TX<n>, MD0<m> as sent by current Yaesu rigs
+struct YaesuDialect {
+    static bool parse(std::string_view frame, CatUpdate *update);
+};
+
+using KenwoodDecoder = AsciiCatDecoder<KenwoodDialect>;
+using YaesuDecoder = AsciiCatDecoder<YaesuDialect>;
+
+// Icom CI-V: FE FE <to> <from> <cmd> [data] FD, frequencies as little-endian BCD.
+// Both directions of the bus are decoded, so set-frequency commands from a
+// logger count as well as the rig's own transceive broadcasts.
+class CivDecoder {
+public:
+    static constexpr size_t MAX_FRAME_LENGTH = 16;
+
+    template<typename Sink>
+    void feed(const uint8_t *data, const size_t len, Sink &&sink) {
+        for (size_t i = 0; i < len; i++) {
+            const uint8_t b = data[i];
+            if (b == PREAMBLE) {
+                // Any number of preamble bytes starts a new frame
+                length_ = 0;
+                preambles_++;
+                continue;
+            }
+            if (preambles_ < 2) {
+                continue;
+            }
+            if (b == END_OF_MESSAGE) {
+                // Replies to a controller and transceive broadcasts come from the rig. On a
+                // single-wire bus our own probe (FE FE 00 E0 03 FD) echoes back: never learn
+                // a controller as the rig, nor from a broadcast without data, which is a request
+                if (length_ >= 2 && frame_[1] != CONTROLLER_ADDRESS &&
+                    (frame_[0] == CONTROLLER_ADDRESS || (frame_[0] == BROADCAST_ADDRESS && length_ > 3))) {
+                    rig_address_ = frame_[1];
+                }
+                if (CatUpdate update; parse(frame_, length_, &update)) {
+                    sink(update);
+                }
+                reset();
+            } else if (b == COLLISION || length_ >= MAX_FRAME_LENGTH) {
+                reset();
+            } else {
+                frame_[length_++] = b;
+            }
+        }
+    }
+
+    void reset() {
+        length_ = 0;
+        preambles_ = 0;
+    }
+
+    // Address the rig last sent from; broadcast until it has been heard
+    uint8_t rig_address() const { return rig_address_; }
+
+    // Address, command and data bytes between the preamble and FD
+    static bool parse(const uint8_t *frame, size_t length, CatUpdate *update);
+
+    // Little-endian packed BCD, two digits per byte; false on a non-decimal nibble or 0 Hz
+    static bool bcd_to_frequency(const uint8_t *bcd, size_t length, uint32_t *frequency);
+
+private:
+    static constexpr uint8_t PREAMBLE = 0xFE;
+    static constexpr uint8_t END_OF_MESSAGE = 0xFD;
+    static constexpr uint8_t COLLISION = 0xFC;
+    static constexpr uint8_t CONTROLLER_ADDRESS = 0xE0;
+    static constexpr uint8_t BROADCAST_ADDRESS = 0x00;
+
+    uint8_t frame_[MAX_FRAME_LENGTH]{};
+    size_t length_{0};
+    int preambles_{0};
+    uint8_t rig_address_{BROADCAST_ADDRESS};
+};
@@ -0,0 +1,70 @@
+#include "cat_mux.h"
+#include <cstring>
+
+void CatMux::set_protocol(const uint8_t protocol) {
+    protocol_.store(protocol);
+    reply_owed_ = false;
+    echo_owed_ = false;
+    at_frame_start_ = true;
+    holding_ = false;
+    held_len_ = 0;
+}
+
+void CatMux::on_pc_bytes(const uint8_t *data, const size_t len, const int64_t now_us) {
+    if (len == 0) {
+        return;
+    }
+    const uint8_t end = terminator();
+    last_pc_us_.store(now_us);
+    bytes_to_radio_ += len;
+    if (memchr(data, end, len) != nullptr) {
+        pc_awaiting_reply_.store(true);
+    }
+    pc_mid_command_.store(data[len - 1] != end);
+}
+
+bool CatMux::can_inject(const int64_t now_us) const {
+    if (reply_owed_) {
+        return false;
+    }
+    // A logger that stopped mid-command or whose command has no reply frees the line after the timeout
+    if (now_us - last_pc_us_.load() >= REPLY_TIMEOUT_MS * 1000LL) {
+        return true;
+    }
+    return !pc_mid_command_.load() && !pc_awaiting_reply_.load();
+}
+
+void CatMux::on_poll_sent(const int64_t now_us) {
+    reply_owed_ = true;
+    echo_owed_ = protocol_.load() == CAT_PROTOCOL_CIV;
+    poll_sent_us_ = now_us;
+}
+
+bool CatMux::pc_active(const int64_t now_us) const {
+    const int64_t last_us = last_pc_us_.load();
+    return last_us != 0 && now_us - last_us < PC_ACTIVE_MS * 1000LL;
+}
+
+uint8_t CatMux::terminator() const {
+    return protocol_.load() == CAT_PROTOCOL_CIV ? 0xFD : ';';
+}
+
+bool CatMux::is_poll_reply() const {
+    if (protocol_.load() == CAT_PROTOCOL_CIV) {
+        // FE FE E0 <rig> 03 <4+ BCD bytes> FD; the bare request echoed on the bus doesn't match
+        return head_len_ == 3 && head_[0] == CIV_CONTROLLER && head_[2] == 0x03 && body_len_ >= 3 + 4 + 1;
+    }
+    return head_len_ >= 2 && head_[0] == 'I' && head_[1] == 'F';
+}
+
+bool CatMux::is_poll_echo() const {
+    // FE FE <rig> E0 03 FD
+    return head_len_ == 3 && head_[1] == CIV_CONTROLLER && head_[2] == 0x03 && body_len_ == 3 + 1;
+}
+
+bool CatMux::from_radio() const {
+    if (protocol_.load() == CAT_PROTOCOL_CIV) {
+        return head_len_ >= 2 && head_[1] != CIV_CONTROLLER;
+    }
+    return true;
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "cat_decoder.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Shares one radio CAT port between a PC logger and the switch's own polls.
+// PC bytes go straight to the radio and radio bytes straight back to the PC, so
+// the PC sees no added latency. Only the reply to one of our polls is held back
+// and dropped, along with the poll itself where a CI-V bus echoes it; the PC never
+// sees a question it didn't ask or its answer. Polls are injected only between PC
+// transactions, never inside one.
+//
+// The PC side (on_pc_bytes) runs in the bridge task, everything else in the
+// radio's CAT task.
+class CatMux {
+public:
+    // How long a command may go unanswered before the line counts as free again
+    static constexpr int REPLY_TIMEOUT_MS = 200;
+    static constexpr size_t MAX_HELD_FRAME = 64;
+    // How long after its last byte the PC still counts as using the port
+    static constexpr int PC_ACTIVE_MS = 5000;
+
+    // Resets the radio-side framing; call from the CAT task
+    void set_protocol(uint8_t protocol);
+
+    // Bytes the PC sent, already written to the radio
+    void on_pc_bytes(const uint8_t *data, size_t len, int64_t now_us);
+
+    // True if a poll can go out without splitting or overtaking a PC transaction
+    bool can_inject(int64_t now_us) const;
+
+    void on_poll_sent(int64_t now_us);
+
+    // The PC sent something lately; baud rate detection would cut it off
+    bool pc_active(int64_t now_us) const;
+
+    // Pass radio bytes on to the PC through forward(data, len), minus our poll's reply.
+    // Bytes are forwarded in place except while a poll reply is expected.
+    template<typename Forward>
+    void route_radio(const uint8_t *data, const size_t len, const int64_t now_us, Forward &&forward) {
+        expire(now_us, forward);
+
+        const uint8_t end = terminator();
+        size_t span_start = 0;
+        for (size_t i = 0; i < len; i++) {
+            const uint8_t b = data[i];
+            if (at_frame_start_) {
+                at_frame_start_ = false;
+                head_len_ = 0;
+                body_len_ = 0;
+                if (reply_owed_) {
+                    // Hold the frame until we know whose reply it is
+                    emit(forward, data + span_start, i - span_start);
+                    holding_ = true;
+                    held_len_ = 0;
+                }
+            }
+            if (b != CIV_PREAMBLE || protocol_.load() != CAT_PROTOCOL_CIV) {
+                if (head_len_ < sizeof(head_)) {
+                    head_[head_len_++] = b;
+                }
+                body_len_++;
+            }
+            if (holding_) {
+                if (held_len_ < MAX_HELD_FRAME) {
+                    held_[held_len_++] = b;
+                    span_start = i + 1;
+                } else {
+                    // Too long to be our reply: give up on it
+                    emit(forward, held_, held_len_);
+                    holding_ = false;
+                    span_start = i;
+                }
+            }
+            if (b == end) {
+                // A held frame is entirely in held_; anything else is still in the span
+                end_frame(forward);
+            }
+        }
+        emit(forward, data + span_start, len - span_start);
+    }
+
+    // Give up on an unanswered poll and release anything held for it
+    template<typename Forward>
+    void expire(const int64_t now_us, Forward &&forward) {
+        if (!reply_owed_ || now_us - poll_sent_us_ < REPLY_TIMEOUT_MS * 1000LL) {
+            return;
+        }
+        reply_owed_ = false;
+        echo_owed_ = false;
+        if (holding_) {
+            emit(forward, held_, held_len_);
+            holding_ = false;
+        }
+    }
+
+    uint32_t replies_dropped() const { return replies_dropped_; }
+    uint32_t bytes_to_pc() const { return bytes_to_pc_; }
+    uint32_t bytes_to_radio() const { return bytes_to_radio_.load(); }
+
+private:
+    static constexpr uint8_t CIV_PREAMBLE = 0xFE;
+    static constexpr uint8_t CIV_CONTROLLER = 0xE0;
+
+    template<typename Forward>
+    void emit(Forward &forward, const uint8_t *data, const size_t len) {
+        if (len > 0) {
+            forward(data, len);
+            bytes_to_pc_ += len;
+        }
+    }
+
+    template<typename Forward>
+    void end_frame(Forward &forward) {
+        if (from_radio()) {
+            pc_awaiting_reply_.store(false);
+        }
+        if (holding_) {
+            if (echo_owed_ && is_poll_echo()) {
+                // Our own request looped back by the bus; the reply is still to come
+                echo_owed_ = false;
+            } else if (is_poll_reply()) {
+                reply_owed_ = false;
+                echo_owed_ = false;
+                replies_dropped_++;
+            } else {
+                emit(forward, held_, held_len_);
+            }
+            holding_ = false;
+        }
+        at_frame_start_ = true;
+    }
+
+    uint8_t terminator() const;
+
+    // Current frame, by its first bytes, answers our frequency query
+    bool is_poll_reply() const;
+
+    // Current frame is our CI-V frequency query as echoed on the bus
+    bool is_poll_echo() const;
+
+    // Current frame was sent by the radio rather than echoed from a controller
+    bool from_radio() const;
+
+    std::atomic<uint8_t> protocol_{CAT_PROTOCOL_KENWOOD};
+
+    // PC side, written by the bridge task
+    std::atomic<bool> pc_mid_command_{false};
+    std::atomic<bool> pc_awaiting_reply_{false};
+    std::atomic<int64_t> last_pc_us_{0};
+    std::atomic<uint32_t> bytes_to_radio_{0};
+
+    // Radio side, CAT task only
+    bool reply_owed_{false};
+    bool echo_owed_{false}; // CI-V only; interfaces without echo leave it to the reply to clear
+    int64_t poll_sent_us_{0};
+    bool at_frame_start_{true};
+    bool holding_{false};
+    uint8_t held_[MAX_HELD_FRAME]{};
+    size_t held_len_{0};
+    uint8_t head_[3]{}; // First bytes of the frame, CI-V preamble skipped
+    size_t head_len_{0};
+    size_t body_len_{0};
+    uint32_t replies_dropped_{0};
+    uint32_t bytes_to_pc_{0};
+};
@@ -4,7 +4,16 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "esp_timer.h"
+#include "task_layout.h"
+#include "alloc_tracker.h"
+#include "config_manager.h"
+#include <cstdio>
+#include <algorithm>
 #include <cstring>
+#include <memory>
+#include <charconv>
+#include <new>
 #include <string>
 #include <string_view>
 #include <sys/param.h>
@@ -12,21 +21,21 @@
 // Initialize static member
 CatParser *CatParser::instance_ = nullptr;
 
-CatParser::CatParser()
-    : uart2_queue(nullptr), uart0_queue(nullptr),
+CatParser::CatParser(const int radio)
+    : radio_(radio), uart_num_(radio == 0 ? UART_NUM : CAT2_UART_NUM), tx_pin_(radio == 0 ? UART_TX_PIN : CAT2_TX_PIN),
+      rx_pin_(radio == 0 ? UART_RX_PIN : CAT2_RX_PIN), uart2_queue(nullptr), uart0_queue(nullptr),
       shutdown_requested(false) {
     if (instance_ == nullptr) {
         instance_ = this;
     }
-
-    // Initialize command handlers
-    command_handlers = {
-        {('F' << 8) | 'A', &CatParser::process_fa_command},
-        {('A' << 8) | 'P', &CatParser::process_ap_command},
-        {('I' << 8) | 'F', &CatParser::process_if_command}
-    };
 }
 
+const CatParser::CommandHandlerEntry CatParser::COMMAND_HANDLERS[] = {
+    {('F' << 8) | 'A', &CatParser::process_fa_command},
+    {('A' << 8) | 'P', &CatParser::process_ap_command},
+    {('I' << 8) | 'F', &CatParser::process_if_command},
+};
+
 CatParser::~CatParser() {
     // Request shutdown of UART tasks
     shutdown_requested.store(true);
@@ -40,26 +49,46 @@ CatParser::~CatParser() {
 
     // Cleanup UART resources
     if (uart2_queue != nullptr) {
-        uart_driver_delete(UART_NUM_2);
+        uart_driver_delete(uart_num_);
         uart2_queue = nullptr;
     }
     if (uart0_queue != nullptr) {
-        uart_driver_delete(UART_NUM_0);
+        uart_driver_delete(PC_UART_NUM);
         uart0_queue = nullptr;
     }
 }
 
 CatParser &CatParser::instance() {
-    static CatParser instance;
-    return instance;
+    return radio(0);
 }
 
+CatParser &CatParser::radio(const int index) {
+    // Static storage, constructed on first use: a radio touched late (e.g. by a config
+    // update) never takes its object, and with static allocation its stacks, from the heap
+    alignas(CatParser) static uint8_t storage[MAX_RADIOS][sizeof(CatParser)];
+    static CatParser *radios[MAX_RADIOS];
+    const int i = index >= 0 && index < MAX_RADIOS ? index : 0;
+    if (radios[i] == nullptr) {
+        radios[i] = new(storage[i]) CatParser(i);
+    }
+    return *radios[i];
+}
 
-#define UART_TASK_STACK_SIZE 8192
 #define UART_QUEUE_SIZE 3
 
+// Tried after the configured rate, most common first
+static constexpr int DETECT_BAUD_RATES[] = {9600, 38400, 19200, 4800, 57600, 115200, 2400, 1200};
+static constexpr int DETECT_WINDOW_MS = 250;
+// A frequency scores 2, any other valid frame 1
+static constexpr int DETECT_MIN_SCORE = 2;
+// Line errors within ERROR_WINDOW_MS, with nothing decoded, that mean the settings are wrong
+static constexpr int ERROR_SPIKE = 8;
+static constexpr int ERROR_WINDOW_MS = 2000;
+// How often to retry detection while nothing has decoded yet
+static constexpr int DETECT_RETRY_MS = 30000;
+
 esp_err_t CatParser::init() {
-    ESP_LOGI(TAG, "Initializing CAT parser");
+    ESP_LOGI(TAG, "Initializing CAT parser for radio %d on UART%d", radio_ + 1, uart_num_);
 
     // Get current configuration from antenna switch
     esp_err_t ret = antenna_switch_get_config(&current_config);
@@ -69,26 +98,41 @@ esp_err_t CatParser::init() {
     }
 
     // Validate baud rate and set default if invalid
-    if (current_config.uart_baud_rate <= 0) {
+    if (radio_ == 0 && current_config.uart_baud_rate <= 0) {
         ESP_LOGW(TAG, "Invalid baud rate %d, using default 9600", current_config.uart_baud_rate);
         current_config.uart_baud_rate = 9600;
-        ret = antenna_switch_set_config(&current_config);
+        ret = ConfigManager::instance().modify([](antenna_switch_config_t &config) {
+            if (config.uart_baud_rate <= 0) {
+                config.uart_baud_rate = 9600;
+            }
+        });
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to save default baud rate: %s", esp_err_to_name(ret));
             return ret;
         }
     }
 
-    // Add delay to ensure peripheral initialization is complete
-    vTaskDelay(pdMS_TO_TICKS(100));
+    protocol_.store(current_config.cat_protocols[radio_]);
+    fixed_link_.store(current_config.cat_fixed_link);
+    polling_.store(current_config.cat_polling);
+    {
+        std::lock_guard lock(settings_mutex_);
+        configured_baud_ = radio_ == 0 ? current_config.uart_baud_rate : current_config.cat2_baud_rate;
+        configured_protocol_ = current_config.cat_protocols[radio_];
+    }
 
     // Reset UART state
     uart2_queue = nullptr;
     uart0_queue = nullptr;
 
+    const int baud_rate = radio_ > 0 && current_config.cat2_baud_rate > 0
+                              ? current_config.cat2_baud_rate
+                              : current_config.uart_baud_rate;
+    baud_rate_ = baud_rate;
+
     // Start with very basic UART2 configuration using validated baud rate
     uart_config_t uart2_config = {
-        .baud_rate = current_config.uart_baud_rate,
+        .baud_rate = baud_rate,
         .data_bits = UART_DATA_8_BITS,
         .parity = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
@@ -99,15 +143,13 @@ esp_err_t CatParser::init() {
     ESP_LOGV(TAG, "Starting basic UART2 configuration");
 
     // Configure UART2 with minimal settings
-    ESP_ERROR_CHECK(uart_param_config(UART_NUM_2, &uart2_config));
-    vTaskDelay(pdMS_TO_TICKS(10));
+    ESP_ERROR_CHECK(uart_param_config(uart_num_, &uart2_config));
 
     // Set pins before driver installation
-    ESP_ERROR_CHECK(uart_set_pin(UART_NUM_2, UART_TX_PIN, UART_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
-    vTaskDelay(pdMS_TO_TICKS(50));
+    ESP_ERROR_CHECK(uart_set_pin(uart_num_, tx_pin_, rx_pin_, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
 
     // If basic configuration succeeds, try updating to desired settings
-    uart2_config.baud_rate = current_config.uart_baud_rate;
+    uart2_config.baud_rate = baud_rate;
     uart2_config.parity = static_cast<uart_parity_t>(current_config.uart_parity);
     uart2_config.stop_bits = static_cast<uart_stop_bits_t>(current_config.uart_stop_bits);
     uart2_config.flow_ctrl = static_cast<uart_hw_flowcontrol_t>(current_config.uart_flow_ctrl);
@@ -116,24 +158,31 @@ esp_err_t CatParser::init() {
              uart2_config.baud_rate, uart2_config.parity, uart2_config.stop_bits, uart2_config.flow_ctrl);
 
     // Update configuration
-    ESP_ERROR_CHECK(uart_param_config(UART_NUM_2, &uart2_config));
-    vTaskDelay(pdMS_TO_TICKS(50));
+    ESP_ERROR_CHECK(uart_param_config(uart_num_, &uart2_config));
 
     // Create event queue
     QueueHandle_t event_queue;
-    ESP_ERROR_CHECK(uart_driver_install(UART_NUM_2, BUF_SIZE * 2, BUF_SIZE * 2, UART_QUEUE_SIZE, &event_queue, 0));
+    ESP_ERROR_CHECK(uart_driver_install(uart_num_, CAT_RX_BUF_SIZE, BUF_SIZE * 2, CAT_EVENT_QUEUE_SIZE, &event_queue, 0));
     uart2_queue = event_queue;
 
     ESP_LOGV(TAG, "UART2 configuration complete");
 
-    // Create UART task with minimal priority
-    const BaseType_t xReturned = xTaskCreate(
+    // Only one PC port, so only the first radio can be bridged
+    if (radio_ == 0 && current_config.cat_pc_bridge) {
+        if (const esp_err_t bridge_ret = start_pc_bridge(); bridge_ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start PC bridge: %s", esp_err_to_name(bridge_ret));
+        }
+    }
+
+    // Every radio decodes on the real-time core, clear of Wi-Fi and the web server
+    char task_name[configMAX_TASK_NAME_LEN];
+    snprintf(task_name, sizeof(task_name), "cat_radio%d", radio_ + 1);
+    const BaseType_t xReturned = uart_task_.create(
         uart_task_trampoline,
-        "cat_parser_uart_task",
-        UART_TASK_STACK_SIZE,
+        task_name,
         this,
-        tskIDLE_PRIORITY + 1,
-        nullptr
+        TASK_PRIORITY_CAT,
+        TASK_CORE_REALTIME
     );
 
     if (xReturned != pdPASS) {
@@ -145,138 +194,303 @@ esp_err_t CatParser::init() {
     return ESP_OK;
 }
 
+esp_err_t CatParser::start_pc_bridge() {
+    // The PC port doubles as the console; log lines would corrupt the logger's CAT stream
+    ESP_LOGW(TAG, "Bridging UART%d to radio 1 at %d baud, console logging turned off", PC_UART_NUM, baud_rate_);
+    esp_log_level_set("*", ESP_LOG_NONE);
+
+    const uart_config_t pc_config = {
+        .baud_rate = baud_rate_,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = static_cast<uart_parity_t>(current_config.uart_parity),
+        .stop_bits = static_cast<uart_stop_bits_t>(current_config.uart_stop_bits),
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_APB,
+    };
+    esp_err_t ret = uart_param_config(PC_UART_NUM, &pc_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    QueueHandle_t event_queue;
+    ret = uart_driver_install(PC_UART_NUM, BUF_SIZE * 2, BUF_SIZE * 2, UART_QUEUE_SIZE, &event_queue, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uart0_queue = event_queue;
+    pc_bridge_ = true;
+
+    // Same core as the radio's task, so forwarding in either direction never waits on the other core
+    if (pc_bridge_task_.create(uart0_task_trampoline, "cat_pc_bridge", this, TASK_PRIORITY_PC_BRIDGE,
+                               TASK_CORE_REALTIME) != pdPASS) {
+        pc_bridge_ = false;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 void CatParser::uart_task() {
     uart_event_t event;
-    size_t buffered_size;
-    static char temp_buffer[128];
+    uint8_t rx_buffer[CAT_RX_CHUNK]; // Not static: every radio runs its own uart_task
     constexpr TickType_t xTicksToWait = pdMS_TO_TICKS(10);
     int events_processed = 0;
-    std::string command_accumulator;
+    const auto apply = [this](const CatUpdate &update) {
+        valid_frames_++;
+        link_locked_ = true;
+        if (update.frequency != 0) {
+            poller_.on_frequency(update.frequency, esp_timer_get_time());
+        }
+        apply_update(update);
+    };
 
+    if (!fixed_link_.load()) {
+        detect_link();
+    }
+    uint8_t active_protocol = protocol_.load();
+    mux_.set_protocol(active_protocol);
+    enable_framing(active_protocol);
+    // Radio bytes go to the PC before they are decoded, so bridging adds no latency
+    const auto forward_to_pc = [](const uint8_t *data, const size_t len) {
+        uart_write_bytes(PC_UART_NUM, data, len);
+    };
+
+    // Read len buffered bytes and hand them to the PC bridge and the decoder
+    const auto consume = [&](size_t len) {
+        while (len > 0) {
+            const int read = uart_read_bytes(uart_num_, rx_buffer, std::min(len, sizeof(rx_buffer)), 0);
+            if (read <= 0) {
+                break;
+            }
+            len -= read;
+            rx_stats_.bytes += read;
+            if (pc_bridge_) {
+                mux_.route_radio(rx_buffer, read, esp_timer_get_time(), forward_to_pc);
+            }
+            // Decoders are picked here, per chunk, so the per-byte loop is fully inlined
+            switch (active_protocol) {
+                case CAT_PROTOCOL_CIV:
+                    civ_decoder_.feed(rx_buffer, read, apply);
+                    break;
+                case CAT_PROTOCOL_YAESU:
+                    yaesu_decoder_.feed(rx_buffer, read, apply);
+                    break;
+                default:
+                    kenwood_decoder_.feed(rx_buffer, read, apply);
+                    break;
+            }
+        }
+    };
+    const auto buffered = [this] {
+        size_t len = 0;
+        return uart_get_buffered_data_len(uart_num_, &len) == ESP_OK ? len : 0;
+    };
+
+    int64_t error_window_start_us = esp_timer_get_time();
+    int64_t last_detect_us = error_window_start_us;
+    uint32_t window_frames = valid_frames_;
+    int window_errors = 0;
+
+    // Decoding and dispatching from here on never allocates
+    AllocTracker::watch_current_task();
     while (!shutdown_requested.load()) {
-        constexpr int MAX_EVENTS_PER_ITERATION = 5;
+        constexpr int MAX_EVENTS_PER_ITERATION = 16;
         events_processed = 0;
 
+        if (const int64_t now_us = esp_timer_get_time(); now_us - error_window_start_us >= ERROR_WINDOW_MS * 1000LL) {
+            // Sweeping baud rates under a logger would cut it off; wait until the PC goes quiet
+            const bool auto_detect = !fixed_link_.load() && !(pc_bridge_ && mux_.pc_active(now_us));
+            const bool silent = valid_frames_ == window_frames;
+            bool detected = false;
+            if (auto_detect && silent && window_errors >= ERROR_SPIKE) {
+                // Typically the radio was swapped or its CAT rate changed
+                ESP_LOGW(TAG, "Radio %d: %d line errors in %d ms, re-detecting CAT settings",
+                         radio_ + 1, window_errors, ERROR_WINDOW_MS);
+                link_locked_ = false;
+                detect_link();
+                detected = true;
+            } else if (auto_detect && !link_locked_ && now_us - last_detect_us >= DETECT_RETRY_MS * 1000LL) {
+                detect_link();
+                detected = true;
+            }
+            if (detected) {
+                // Detection read the line directly; terminator positions no longer match the buffer
+                uart_pattern_queue_reset(uart_num_, CAT_PATTERN_QUEUE_SIZE);
+                last_detect_us = esp_timer_get_time();
+            }
+            error_window_start_us = esp_timer_get_time();
+            window_frames = valid_frames_;
+            window_errors = 0;
+        }
+
+        // A rate saved from the web UI; detection may still move it if the radio is elsewhere
+        if (const int baud = requested_baud_.exchange(0); baud > 0 && baud != baud_rate_) {
+            ESP_LOGI(TAG, "Radio %d CAT baud rate changed to %d", radio_ + 1, baud);
+            uart_set_baudrate(uart_num_, baud);
+            if (pc_bridge_) {
+                uart_set_baudrate(PC_UART_NUM, baud);
+            }
+            // Bytes received at the old rate are noise at the new one
+            uart_flush_input(uart_num_);
+            xQueueReset(uart2_queue);
+            uart_pattern_queue_reset(uart_num_, CAT_PATTERN_QUEUE_SIZE);
+            reset_decoders();
+            baud_rate_ = baud;
+            link_locked_ = false;
+        }
+
+        // A protocol change from the web UI must not resume a half-decoded frame
+        if (const uint8_t protocol = protocol_.load(); protocol != active_protocol) {
+            ESP_LOGI(TAG, "Radio %d CAT protocol changed to %d", radio_ + 1, protocol);
+            reset_decoders();
+            mux_.set_protocol(protocol);
+            enable_framing(protocol);
+            active_protocol = protocol;
+        }
+
         while (events_processed < MAX_EVENTS_PER_ITERATION &&
                xQueueReceive(uart2_queue, &event, xTicksToWait) == pdTRUE) {
             events_processed++;
 
             switch (event.type) {
+                case UART_PATTERN_DET: {
+                    // One event per terminator: read exactly up to and including it. A short
+                    // frame may raise this alone, without a UART_DATA, so it counts as activity too
+                    poller_.on_activity(esp_timer_get_time());
+                    const int pos = uart_pattern_pop_pos(uart_num_);
+                    const size_t available = buffered();
+                    if (pos < 0) {
+                        // More terminators than the position queue holds; catch up on everything
+                        rx_stats_.pattern_overflows++;
+                        consume(available);
+                        uart_pattern_queue_reset(uart_num_, CAT_PATTERN_QUEUE_SIZE);
+                    } else {
+                        rx_stats_.frames++;
+                        consume(std::min(static_cast<size_t>(pos) + 1, available));
+                    }
+                    break;
+                }
+
                 case UART_DATA: {
-                    if (uart_get_buffered_data_len(UART_NUM, &buffered_size) == ESP_OK) {
-                        const int len = uart_read_bytes(UART_NUM, temp_buffer,
-                                                        std::min(buffered_size, sizeof(temp_buffer) - 1),
-                                                        pdMS_TO_TICKS(1));
-                        if (len > 0) {
-                            temp_buffer[len] = '\0';
-                            command_accumulator += temp_buffer;
-
-                            // Process complete commands
-                            size_t pos;
-                            while ((pos = command_accumulator.find(';')) != std::string::npos) {
-                                std::string cmd = command_accumulator.substr(0, pos);
-                                command_accumulator = command_accumulator.substr(pos + 1);
-                                ESP_LOGV(TAG, "Received:%s",cmd.c_str());
-
-                                // Only process FA and IF commands
-                                if (cmd.length() >= 2) {
-                                    if (cmd.substr(0, 2) == "FA") {
-                                        process_fa_command(cmd.substr(2));
-                                    } else if (cmd.substr(0, 2) == "IF") {
-                                        process_if_command(cmd.substr(2));
-                                    }
-                                    // Ignore all other commands
-                                }
-                            }
-                        }
+                    // Partial frames wait for their terminator; a line that never sends one
+                    // (wrong protocol, noise) is drained before it can fill the buffer
+                    poller_.on_activity(esp_timer_get_time());
+                    if (const size_t available = buffered(); available >= CAT_RX_BUF_SIZE / 2) {
+                        consume(available);
+                        uart_pattern_queue_reset(uart_num_, CAT_PATTERN_QUEUE_SIZE);
                     }
                     break;
                 }
 
                 case UART_FIFO_OVF:
                 case UART_BUFFER_FULL:
-                    ESP_LOGW(TAG, "Buffer issue detected, flushing UART");
-                    uart_flush_input(UART_NUM);
-                    xQueueReset(uart2_queue);
-                    command_accumulator.clear(); // Clear accumulated data
+                    // Bytes were lost: drop the frame they belonged to, but keep everything still buffered
+                    rx_stats_.overflows++;
+                    ESP_LOGW(TAG, "Radio %d: UART %s, draining", radio_ + 1,
+                             event.type == UART_FIFO_OVF ? "FIFO overflow" : "buffer full");
+                    reset_decoders();
+                    consume(buffered());
+                    uart_pattern_queue_reset(uart_num_, CAT_PATTERN_QUEUE_SIZE);
+                    break;
+
+                case UART_FRAME_ERR:
+                case UART_PARITY_ERR:
+                    // Usually a baud rate or framing mismatch; enough of them trigger detection
+                    rx_stats_.line_errors++;
+                    window_errors++;
                     break;
 
                 default:
                     break;
             }
         }
+
+        if (pc_bridge_) {
+            mux_.expire(esp_timer_get_time(), forward_to_pc);
+        }
+        if (polling_.load()) {
+            poll_radio(esp_timer_get_time(), active_protocol);
+        }
+
         // Always yield after processing events or timeout
         taskYIELD();
     }
 }
 
-esp_err_t CatParser::update_config() {
-    ESP_LOGD(TAG, "Updating CAT parser configuration");
-
-    if (const esp_err_t ret = antenna_switch_get_config(&current_config); ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get antenna switch configuration: %s", esp_err_to_name(ret));
-        return ret;
+void CatParser::enable_framing(const uint8_t protocol) {
+    // The driver raises UART_PATTERN_DET per terminator, so frames arrive whole
+    const char terminator = protocol == CAT_PROTOCOL_CIV ? static_cast<char>(0xFD) : ';';
+    uart_disable_pattern_det_intr(uart_num_);
+    if (const esp_err_t ret = uart_enable_pattern_det_baud_intr(uart_num_, terminator, 1, 9, 0, 0); ret != ESP_OK) {
+        ESP_LOGW(TAG, "Radio %d: pattern detection unavailable: %s", radio_ + 1, esp_err_to_name(ret));
     }
-
-    ESP_LOGD(TAG, "CAT parser configuration updated successfully");
-    return ESP_OK;
+    uart_pattern_queue_reset(uart_num_, CAT_PATTERN_QUEUE_SIZE);
 }
 
-esp_err_t CatParser::handle_frequency_change(const uint32_t frequency) {
-    // Early return if frequency hasn't changed
-    if (frequency == current_frequency) {
-        return ESP_OK;
+void CatParser::poll_radio(const int64_t now_us, const uint8_t protocol) {
+    if ((pc_bridge_ && !mux_.can_inject(now_us)) || !poller_.poll_due(now_us)) {
+        return;
+    }
+    uint8_t query[8];
+    if (const size_t len = CatPoller::query(protocol, civ_decoder_.rig_address(), query, sizeof(query)); len > 0) {
+        uart_write_bytes(uart_num_, query, len);
+        if (pc_bridge_) {
+            mux_.on_poll_sent(now_us);
+        }
+        polls_sent_++;
+        ESP_LOGV(TAG, "Radio %d polled, next in %d ms", radio_ + 1, poller_.interval_ms());
     }
+}
 
-    // Get new frequency's band index
-    const int new_band_index = get_band_index(frequency);
+esp_err_t CatParser::update_config(const antenna_switch_config_t &config) {
+    ESP_LOGD(TAG, "Updating CAT parser configuration");
+    fixed_link_.store(config.cat_fixed_link);
+    polling_.store(config.cat_polling);
+
+    // Only this radio's own fields: radio 2 left at "same as radio 1" would otherwise
+    // drop its lock whenever radio 1's detection saves a new rate
+    const int baud = radio_ == 0 ? config.uart_baud_rate : config.cat2_baud_rate;
+    const uint8_t protocol = config.cat_protocols[radio_];
+    std::lock_guard lock(settings_mutex_);
+    // Picked up by uart_task between reads
+    if (baud != configured_baud_) {
+        configured_baud_ = baud;
+        if (baud > 0) {
+            requested_baud_.store(baud);
+        }
+    }
+    if (protocol != configured_protocol_) {
+        configured_protocol_ = protocol;
+        protocol_.store(protocol);
+    }
 
-    // Switch antenna if band changed or no valid band was set
-    if (current_band_index != new_band_index) {
-        ESP_LOGV(TAG, "Frequency requires band change, setting new antenna");
+    ESP_LOGD(TAG, "CAT parser configuration updated successfully");
+    return ESP_OK;
+}
 
-        if (const esp_err_t ret = antenna_switch_set_frequency(frequency); ret != ESP_OK) {
-            if (ret == ESP_ERR_NOT_FOUND) {
-                ESP_LOGW(TAG, "Frequency %lu Hz not supported by any configured band", frequency);
-            } else {
-                ESP_LOGE(TAG, "Failed to set frequency: %s", esp_err_to_name(ret));
-            }
-            return ret;
-        }
-    } else {
-        ESP_LOGV(TAG, "Frequency is in the same band, skipping antenna switch");
+esp_err_t CatParser::handle_frequency_change(const uint32_t frequency, const int source) {
+    // Repeats are reported too: they keep the source fresh, and the arbiter only acts on band changes
+    if (const esp_err_t ret = antenna_switch_report_frequency(radio_, source, frequency); ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set frequency: %s", esp_err_to_name(ret));
+        return ret;
     }
 
-    // Update cached values
     current_frequency = frequency;
-    current_band_index = new_band_index;
     return ESP_OK;
 }
 
 esp_err_t CatParser::process_ap_command(const std::string_view command) {
-    char *endptr;
-
-    // Convert string_view to C string for strtoul
-    const std::string ports_str(command);
-    const unsigned long ports = strtoul(ports_str.c_str(), &endptr, 10);
-
-    if (*endptr != '\0') {
+    // Parsed in place; the view isn't NUL-terminated
+    unsigned long ports = 0;
+    const char *end = command.data() + command.length();
+    if (const auto [ptr, ec] = std::from_chars(command.data(), end, ports); ec != std::errc() || ptr != end) {
         ESP_LOGE(TAG, "Invalid ports format in command: %.*s",
                  static_cast<int>(command.length()), command.data());
         return ESP_ERR_INVALID_ARG;
     }
 
     ESP_LOGD(TAG, "Setting antenna ports: %lu", ports);
-    antenna_switch_config_t config;
-    esp_err_t ret = antenna_switch_get_config(&config);
-
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to get config: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    config.num_antenna_ports = ports;
-    ret = antenna_switch_set_config(&config);
+    const esp_err_t ret = ConfigManager::instance().modify([ports](antenna_switch_config_t &config) {
+        config.num_antenna_ports = ports;
+    });
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set config: %s", esp_err_to_name(ret));
         return ret;
@@ -307,14 +521,15 @@ esp_err_t CatParser::process_command(const char *command) {
             std::string_view cmd_view = cmd_str.substr(start, end - start);
             uint16_t cmd_code = (static_cast<uint16_t>(cmd_view[0]) << 8) | cmd_view[1];
 
-            if (auto handler_it = command_handlers.find(cmd_code); handler_it != command_handlers.end()) {
-                std::string_view param = (cmd_view.length() > 2) ? cmd_view.substr(2) : std::string_view();
-                if (handler_it->second) {
-                    const CommandHandler handler = handler_it->second;
-                    if (const esp_err_t ret = (this->*handler)(std::string(param)); ret != ESP_OK) {
-                        return ret;
-                    }
+            for (const auto &[code, handler]: COMMAND_HANDLERS) {
+                if (code != cmd_code) {
+                    continue;
                 }
+                const std::string_view param = cmd_view.length() > 2 ? cmd_view.substr(2) : std::string_view();
+                if (const esp_err_t ret = (this->*handler)(param); ret != ESP_OK) {
+                    return ret;
+                }
+                break;
             }
             commands_processed++;
         }
@@ -324,19 +539,20 @@ esp_err_t CatParser::process_command(const char *command) {
     return ESP_OK;
 }
 
-void CatParser::uart0_to_uart2_task() const {
+void CatParser::uart0_to_uart2_task() {
     constexpr TickType_t xMaxBlockTime = pdMS_TO_TICKS(100);
     constexpr size_t CHUNK_SIZE = 64;
 
-    const std::unique_ptr<uint8_t[]> chunk_buffer(new uint8_t[CHUNK_SIZE]);
+    uint8_t chunk_buffer[CHUNK_SIZE];
     uart_event_t event;
     size_t buffered_size;
 
+    AllocTracker::watch_current_task();
     while (!shutdown_requested.load()) {
         if (xQueueReceive(uart0_queue, &event, xMaxBlockTime) == pdTRUE) {
             switch (event.type) {
                 case UART_DATA: {
-                    esp_err_t err = uart_get_buffered_data_len(UART_NUM_0, &buffered_size);
+                    esp_err_t err = uart_get_buffered_data_len(PC_UART_NUM, &buffered_size);
                     if (err != ESP_OK) {
                         ESP_LOGE(TAG, "Failed to get buffered data length: %s", esp_err_to_name(err));
                         continue;
@@ -344,20 +560,21 @@ void CatParser::uart0_to_uart2_task() const {
 
                     while (buffered_size > 0 && !shutdown_requested.load()) {
                         const size_t chunk_len = std::min(buffered_size, CHUNK_SIZE);
-                        const int read_len = uart_read_bytes(UART_NUM_0, chunk_buffer.get(),
+                        const int read_len = uart_read_bytes(PC_UART_NUM, chunk_buffer,
                                                              chunk_len, pdMS_TO_TICKS(20));
 
                         if (read_len > 0) {
-                            // Forward directly to UART2
-                            err = uart_write_bytes(UART_NUM_2, chunk_buffer.get(), read_len);
+                            // Forward directly to the radio's UART
+                            err = uart_write_bytes(uart_num_, chunk_buffer, read_len);
                             if (err < 0) {
                                 ESP_LOGE(TAG, "Failed to write to UART2: %s", esp_err_to_name(err));
                                 break;
                             }
+                            mux_.on_pc_bytes(chunk_buffer, read_len, esp_timer_get_time());
                             ESP_LOGV(TAG, "Forwarded %d bytes to UART2", read_len);
                         }
 
-                        err = uart_get_buffered_data_len(UART_NUM_0, &buffered_size);
+                        err = uart_get_buffered_data_len(PC_UART_NUM, &buffered_size);
                         if (err != ESP_OK) {
                             ESP_LOGE(TAG, "Failed to update buffered size: %s", esp_err_to_name(err));
                             break;
@@ -370,7 +587,7 @@ void CatParser::uart0_to_uart2_task() const {
                 case UART_BUFFER_FULL:
                     ESP_LOGW(TAG, "UART0 buffer issue: %s",
                              event.type == UART_FIFO_OVF ? "FIFO overflow" : "Buffer full");
-                    uart_flush_input(UART_NUM_0);
+                    uart_flush_input(PC_UART_NUM);
                     xQueueReset(uart0_queue);
                     break;
 
@@ -397,109 +614,160 @@ void CatParser::uart0_to_uart2_task() const {
     ESP_LOGV(TAG, "UART0 to UART2 task shutting down");
 }
 
-int CatParser::get_band_index(const uint32_t freq) const {
-    // Use cached band index if frequency is current
-    if (freq == current_frequency && current_band_index != -1) {
-        return current_band_index;
+size_t CatParser::get_rx_buffered() const {
+    size_t buffered = 0;
+    if (uart2_queue == nullptr || uart_get_buffered_data_len(uart_num_, &buffered) != ESP_OK) {
+        return 0;
     }
+    return buffered;
+}
 
-    // Find which band the frequency belongs to
-    for (int i = 0; i < current_config.num_bands; i++) {
-        if (freq >= current_config.bands[i].start_freq &&
-            freq <= current_config.bands[i].end_freq) {
-            return i;
+uint32_t CatParser::get_event_queue_depth() const {
+    return uart2_queue != nullptr ? uxQueueMessagesWaiting(uart2_queue) : 0;
+}
+
+bool CatParser::detect_link() {
+    const int64_t start_us = esp_timer_get_time();
+    const int configured_baud = baud_rate_;
+
+    // The configured rate goes first so a correct config locks within one window
+    int candidates[1 + sizeof(DETECT_BAUD_RATES) / sizeof(DETECT_BAUD_RATES[0])];
+    size_t num_candidates = 0;
+    candidates[num_candidates++] = configured_baud;
+    for (const int baud: DETECT_BAUD_RATES) {
+        if (baud != configured_baud) {
+            candidates[num_candidates++] = baud;
         }
     }
-    return -1;
+
+    ESP_LOGI(TAG, "Radio %d: detecting CAT baud rate and protocol", radio_ + 1);
+    for (size_t c = 0; c < num_candidates && !shutdown_requested.load(); c++) {
+        const int baud = candidates[c];
+        if (uart_set_baudrate(uart_num_, baud) != ESP_OK) {
+            continue;
+        }
+        uart_flush_input(uart_num_);
+        xQueueReset(uart2_queue);
+
+        // Every decoder sees the same bytes; only the right one finds frames in them
+        KenwoodDecoder kenwood;
+        CivDecoder civ;
+        YaesuDecoder yaesu;
+        int scores[CAT_PROTOCOL_COUNT] = {};
+        const auto scorer = [&scores](const int protocol) {
+            return [&scores, protocol](const CatUpdate &update) { scores[protocol] += update.frequency ? 2 : 1; };
+        };
+
+        send_probes();
+        const int64_t window_end_us = esp_timer_get_time() + DETECT_WINDOW_MS * 1000LL;
+        uint8_t buffer[64];
+        for (int64_t remaining_us; (remaining_us = window_end_us - esp_timer_get_time()) > 0;) {
+            const int len = uart_read_bytes(uart_num_, buffer, sizeof(buffer),
+                                            pdMS_TO_TICKS(std::min<int64_t>(remaining_us / 1000 + 1, 20)));
+            if (len <= 0) {
+                continue;
+            }
+            kenwood.feed(buffer, len, scorer(CAT_PROTOCOL_KENWOOD));
+            civ.feed(buffer, len, scorer(CAT_PROTOCOL_CIV));
+            yaesu.feed(buffer, len, scorer(CAT_PROTOCOL_YAESU));
+        }
+
+        const int best = static_cast<int>(std::max_element(scores, scores + CAT_PROTOCOL_COUNT) - scores);
+        if (scores[best] < DETECT_MIN_SCORE) {
+            continue;
+        }
+
+        xQueueReset(uart2_queue);
+        baud_rate_ = baud;
+        protocol_.store(best);
+        link_locked_ = true;
+        ESP_LOGI(TAG, "Radio %d: locked onto %s at %d baud in %lld ms", radio_ + 1, cat_protocol_name(best), baud,
+                 (esp_timer_get_time() - start_us) / 1000);
+        if (pc_bridge_) {
+            // The logger is set up for the radio's rate
+            uart_set_baudrate(PC_UART_NUM, baud);
+        }
+        save_detected_link(baud, best);
+        return true;
+    }
+
+    // Nothing decoded: stay on the configured settings
+    uart_set_baudrate(uart_num_, configured_baud);
+    xQueueReset(uart2_queue);
+    ESP_LOGW(TAG, "Radio %d: no CAT traffic recognised in %lld ms, keeping %d baud", radio_ + 1,
+             (esp_timer_get_time() - start_us) / 1000, configured_baud);
+    return false;
 }
 
-bool CatParser::is_same_band(const uint32_t freq1, const uint32_t freq2) const {
-    const int band1 = get_band_index(freq1);
-    const int band2 = get_band_index(freq2);
-    return (band1 != -1) && (band1 == band2);
+void CatParser::send_probes() const {
+    // "FA;" is answered by Kenwood, Elecraft and Yaesu rigs alike; the CI-V
+    // read-frequency request goes to the broadcast address
+    static constexpr char ASCII_PROBE[] = "FA;";
+    static constexpr uint8_t CIV_PROBE[] = {0xFE, 0xFE, 0x00, 0xE0, 0x03, 0xFD};
+    uart_write_bytes(uart_num_, ASCII_PROBE, sizeof(ASCII_PROBE) - 1);
+    uart_write_bytes(uart_num_, CIV_PROBE, sizeof(CIV_PROBE));
 }
 
-esp_err_t CatParser::process_if_command(const std::string_view command) {
-    if (command.length() < 35) {
-        ESP_LOGW(TAG, "IF command too short: %.*s",
-                 static_cast<int>(command.length()), command.data());
-        return ESP_OK;
+void CatParser::save_detected_link(const int baud_rate, const uint8_t protocol) {
+    // Writing NVS allocates; detection is rare enough to be exempt
+    const AllocTracker::Pause pause;
+    // Only this radio's fields, edited in place, so a web save or the other radio's detection isn't undone
+    const esp_err_t ret = ConfigManager::instance().modify([this, baud_rate, protocol](antenna_switch_config_t &config) {
+        // Next boot starts with what worked
+        (radio_ == 0 ? config.uart_baud_rate : config.cat2_baud_rate) = baud_rate;
+        config.cat_protocols[radio_] = protocol;
+    });
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save detected CAT settings: %s", esp_err_to_name(ret));
+    }
+}
+
+void CatParser::reset_decoders() {
+    kenwood_decoder_.reset();
+    civ_decoder_.reset();
+    yaesu_decoder_.reset();
+}
+
+esp_err_t CatParser::apply_update(const CatUpdate &update, const int source) {
+    if (update.transmitting >= 0) {
+        if (const bool new_tx_state = update.transmitting != 0; new_tx_state != transmitting) {
+            ESP_LOGI(TAG, "Radio %d %s", radio_ + 1, new_tx_state ? "started transmitting" : "stopped transmitting");
+            transmitting = new_tx_state;
+            // Keeps the other radio from taking this one's antenna mid-transmission
+            antenna_switch_set_radio_transmitting(radio_, new_tx_state);
+        }
+    }
+
+    if (update.mode != nullptr && strcmp(current_mode, update.mode) != 0) {
+        ESP_LOGV(TAG, "Mode changed to %s", update.mode);
+        current_mode = update.mode;
     }
 
-    char *endptr;
-    // Parse frequency (first 11 chars after "IF")
-    const std::string freq_str(command.substr(0, 11));
-    const auto frequency = strtoul(freq_str.c_str(), &endptr, 10);
-    if (*endptr != '\0') {
-        ESP_LOGW(TAG, "Invalid frequency in IF command: %s", freq_str.c_str());
+    if (update.frequency == 0) {
         return ESP_OK;
     }
+    ESP_LOGV(TAG, "Radio %d: freq=%lu Hz, mode=%s, tx=%d", radio_ + 1, update.frequency, current_mode,
+             transmitting);
+    return handle_frequency_change(update.frequency, source);
+}
 
-    const auto new_tx_state = (command[26] == '1');
-
-    // Parse mode
-    const char mode_char = command[27];
-    std::string new_mode;
-    switch (mode_char) {
-        case '1':
-            new_mode = "LSB";
-            break;
-        case '2':
-            new_mode = "USB";
-            break;
-        case '3':
-            new_mode = "CW-U";
-            break;
-        case '4':
-            new_mode = "FM";
-            break;
-        case '5':
-            new_mode = "AM";
-            break;
-        case '6':
-            new_mode = "DIG-L";
-            break;
-        case '7':
-            new_mode = "CW-L";
-            break;
-        case '9':
-            new_mode = "DIG-U";
-            break;
-        default:
-            new_mode = "UNKNOWN";
-    }
-
-    if (new_tx_state != transmitting) {
-        ESP_LOGI(TAG, "Radio %s", new_tx_state ? "started transmitting" : "stopped transmitting");
-    }
-
-    if (new_mode != current_mode) {
-        ESP_LOGV(TAG, "Mode changed to %s", new_mode.c_str());
-    }
-
-    // Update states
-    transmitting = new_tx_state;
-    current_mode = new_mode;
-
-    ESP_LOGV(TAG, "IF command: freq=%lu Hz, mode=%s, tx=%d", frequency, current_mode.c_str(), transmitting);
-
-    return handle_frequency_change(frequency);
+esp_err_t CatParser::process_if_command(const std::string_view command) {
+    CatUpdate update;
+    if (!KenwoodDialect::parse_if(command, &update)) {
+        ESP_LOGW(TAG, "Invalid IF command: %.*s", static_cast<int>(command.length()), command.data());
+        return ESP_OK;
+    }
+    return apply_update(update);
 }
 
 esp_err_t CatParser::process_fa_command(const std::string_view command) {
-    char *endptr;
-
-    const std::string freq_str(command);
-    const auto frequency = strtoul(freq_str.c_str(), &endptr, 10);
-
-    if (*endptr != '\0') {
+    CatUpdate update;
+    if (!KenwoodDialect::parse_fa(command, &update)) {
         ESP_LOGE(TAG, "Invalid frequency format in command: %.*s",
                  static_cast<int>(command.length()), command.data());
         return ESP_OK;
     }
-
-    ESP_LOGV(TAG, "FA command frequency: %lu Hz", frequency);
-    return handle_frequency_change(frequency);
+    return apply_update(update);
 }
 
 void CatParser::uart_task_trampoline(void *arg) {
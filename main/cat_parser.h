@@ -4,20 +4,48 @@
 #include "esp_err.h"
 #include "driver/uart.h"
 #include "antenna_switch.h"
+#include "cat_decoder.h"
+#include "cat_poller.h"
+#include "cat_mux.h"
+#include "frequency_arbiter.h"
+#include "static_task.h"
 #include <string_view>
-#include <unordered_map>
 #include <atomic>
+#include <mutex>
 #define MAX_CAT_COMMAND_LENGTH 32
 #define UART_NUM UART_NUM_2
 #define UART_TX_PIN 17
 #define UART_RX_PIN 16
+// Second radio (SO2R); shares UART1 with the RS485 relay link, so the two are exclusive
+#define CAT2_UART_NUM UART_NUM_1
+#define CAT2_TX_PIN 4
+#define CAT2_RX_PIN 5
+// PC logger port bridged to the first radio (cat_pc_bridge); also the console
+#define PC_UART_NUM UART_NUM_0
 #define UART_BAUD_RATE 9600
 #define BUF_SIZE 256  // Reduced buffer size
+// Radio receive path: 2 KB holds ~180 ms at 115200 baud, events come one per frame
+#define CAT_RX_BUF_SIZE 2048
+#define CAT_EVENT_QUEUE_SIZE 32
+#define CAT_PATTERN_QUEUE_SIZE 32
+#define CAT_RX_CHUNK 256
 #define MAX_EVENTS_PER_LOOP 3  // Limit events processed per loop
+#define UART_TASK_STACK_SIZE 8192
+
+// Receive path counters of one radio
+struct CatRxStats {
+    uint32_t bytes;
+    uint32_t frames; // Terminators delivered by pattern detection
+    uint32_t overflows; // FIFO or ring buffer overruns; bytes were lost
+    uint32_t pattern_overflows; // Terminators the position queue couldn't hold; no bytes lost
+    uint32_t line_errors; // Framing and parity errors
+};
 
+// Decodes the CAT stream of one radio. Each radio gets its own instance,
+// UART and task, pinned to the real-time core (task_layout.h).
 class CatParser {
 public:
-    CatParser();
+    explicit CatParser(int radio = 0);
 
     ~CatParser();
 
@@ -25,31 +53,66 @@ public:
 
     esp_err_t process_command(const char *command);
 
-    esp_err_t update_config();
+    // Apply a saved config's changes to this radio's own CAT settings
+    esp_err_t update_config(const antenna_switch_config_t &config);
 
     uint32_t get_frequency() const { return current_frequency; }
     bool is_transmitting() const { return transmitting; }
     bool is_rit_on() const { return rit_on; }
     bool is_xit_on() const { return xit_on; }
     bool is_split_on() const { return split_on; }
-    const char *get_mode() const { return current_mode.c_str(); }
+    const char *get_mode() const { return current_mode; }
     int32_t get_rit_offset() const { return rit_offset; }
 
-    esp_err_t handle_frequency_change(uint32_t frequency);
+    // Report frequency to the frequency arbiter as coming from source (FREQ_SOURCE_*)
+    esp_err_t handle_frequency_change(uint32_t frequency, int source = FREQ_SOURCE_CAT);
+
+    // Fold a decoded frame into the radio state and switch antennas on a band change.
+    // Network frequency sources feed their updates through here as well.
+    esp_err_t apply_update(const CatUpdate &update, int source = FREQ_SOURCE_CAT);
+
+    int get_radio() const { return radio_; }
+
+    int get_baud_rate() const { return baud_rate_; }
+
+    uint8_t get_protocol() const { return protocol_.load(); }
+
+    // False until a valid frame has been decoded at the current settings
+    bool is_link_locked() const { return link_locked_; }
+
+    // Current query interval; only meaningful while cat_polling is on
+    int get_poll_interval_ms() const { return poller_.interval_ms(); }
+
+    uint32_t get_polls_sent() const { return polls_sent_; }
+
+    CatRxStats get_rx_stats() const { return rx_stats_; }
+
+    bool is_pc_bridged() const { return pc_bridge_; }
+
+    // Bytes the UART driver holds for uart_task, 0 before start
+    size_t get_rx_buffered() const;
+
+    // UART events waiting for uart_task, 0 before start
+    uint32_t get_event_queue_depth() const;
 
-    // Legacy C-style interface for backward compatibility
+    const CatMux &get_mux() const { return mux_; }
+
+    // Legacy C-style interface for backward compatibility; the first radio
     static CatParser &instance();
 
+    // Parser for radio index (0-based, < MAX_RADIOS)
+    static CatParser &radio(int index);
+
 private:
     using CommandHandler = esp_err_t (CatParser::*)(std::string_view);
 
     void uart_task();
 
-    void uart0_to_uart2_task() const;
-
-    int get_band_index(uint32_t freq) const;
+    // Forwards the PC port to the radio; replies come back through uart_task
+    void uart0_to_uart2_task();
 
-    bool is_same_band(uint32_t freq1, uint32_t freq2) const;
+    // Install the PC port driver and start the bridge task
+    esp_err_t start_pc_bridge();
 
     esp_err_t process_fa_command(std::string_view command);
 
@@ -57,23 +120,71 @@ private:
 
     esp_err_t process_ap_command(std::string_view command);
 
+    void reset_decoders();
+
+    // Sample the line at each common baud rate with every decoder and lock onto
+    // the combination that decodes; false if nothing did
+    bool detect_link();
+
+    // Queries that make a rig with auto-information off answer during detection
+    void send_probes() const;
+
+    void save_detected_link(int baud_rate, uint8_t protocol);
+
+    // Arm pattern detection on the protocol's frame terminator
+    void enable_framing(uint8_t protocol);
+
+    // Send a frequency query if the poller says one is due
+    void poll_radio(int64_t now_us, uint8_t protocol);
+
     static void uart_task_trampoline(void *arg);
 
     static void uart0_task_trampoline(void *arg);
 
     uint32_t get_current_frequency() const { return current_frequency; }
 
-    std::unordered_map<uint16_t, CommandHandler> command_handlers;
+    struct CommandHandlerEntry {
+        uint16_t code; // Two command letters, first in the high byte
+        CommandHandler handler;
+    };
+
+    static const CommandHandlerEntry COMMAND_HANDLERS[];
+
+    StaticTask<UART_TASK_STACK_SIZE> uart_task_;
+    StaticTask<UART_TASK_STACK_SIZE / 2> pc_bridge_task_;
+    int radio_;
+    uart_port_t uart_num_;
+    int tx_pin_;
+    int rx_pin_;
+    int baud_rate_{0};
+    std::atomic<uint8_t> protocol_{CAT_PROTOCOL_KENWOOD};
+    std::atomic<int> requested_baud_{0}; // Saved rate for uart_task to switch to, 0 = none
+    // This radio's settings as last saved, so update_config() only acts on its own changes
+    std::mutex settings_mutex_;
+    int configured_baud_{0};
+    uint8_t configured_protocol_{CAT_PROTOCOL_KENWOOD};
+    uint32_t valid_frames_{0};
+    bool link_locked_{false};
+    KenwoodDecoder kenwood_decoder_;
+    CivDecoder civ_decoder_;
+    YaesuDecoder yaesu_decoder_;
+    CatPoller poller_;
+    uint32_t polls_sent_{0};
+    CatMux mux_;
+    CatRxStats rx_stats_{};
+    bool pc_bridge_{false};
     QueueHandle_t uart2_queue;
     QueueHandle_t uart0_queue;
-    antenna_switch_config_t current_config{};
+    antenna_switch_config_t current_config{}; // As read by init(); later edits arrive through update_config()
+    // Written by the config observer, read by uart_task
+    std::atomic<bool> fixed_link_{false};
+    std::atomic<bool> polling_{false};
     uint32_t current_frequency{0};
-    int current_band_index{-1}; // Cache for current frequency's band
     bool transmitting{false}; // Tracks if radio is transmitting
     bool rit_on{false}; // RIT status
     bool xit_on{false}; // XIT status
     bool split_on{false}; // Split operation status
-    std::string current_mode; // Current operating mode
+    const char *current_mode{""}; // Current operating mode; decoders hand out static strings
     int32_t rit_offset{0}; // RIT offset in Hz
     static constexpr auto TAG = "CAT_PARSER";
 
@@ -88,7 +199,15 @@ inline esp_err_t cat_parser_process_command(const char *command) {
     return CatParser::instance().process_command(command);
 }
 
-inline esp_err_t cat_parser_update_config() { return CatParser::instance().update_config(); }
+inline esp_err_t cat_parser_update_config(const antenna_switch_config_t &config) {
+    for (int i = 0; i < MAX_RADIOS; i++) {
+        if (const esp_err_t ret = CatParser::radio(i).update_config(config); ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
 inline uint32_t cat_parser_get_frequency() { return CatParser::instance().get_frequency(); }
 
 #endif // CAT_PARSER_H
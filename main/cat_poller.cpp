@@ -0,0 +1,55 @@
+#include "cat_poller.h"
+#include "cat_decoder.h"
+#include <algorithm>
+#include <cstring>
+
+void CatPoller::on_frequency(const uint32_t frequency, const int64_t now_us) {
+    unanswered_ = 0;
+    last_update_us_ = now_us;
+    if (frequency != last_frequency_) {
+        // Tuning: keep up with the knob
+        interval_ms_ = FAST_INTERVAL_MS;
+        last_frequency_ = frequency;
+    } else {
+        interval_ms_ = std::min(interval_ms_ * 2, SLOW_INTERVAL_MS);
+    }
+}
+
+bool CatPoller::poll_due(const int64_t now_us) {
+    if (now_us - last_activity_us_ < QUIET_MS * 1000LL) {
+        return false;
+    }
+    // A frame that arrived on its own counts as a poll answered
+    if (now_us - std::max(last_poll_us_, last_update_us_) < interval_ms_ * 1000LL) {
+        return false;
+    }
+
+    if (unanswered_ >= MAX_UNANSWERED) {
+        // Radio off or disconnected: just check in now and then
+        interval_ms_ = SLOW_INTERVAL_MS;
+    } else {
+        unanswered_++;
+    }
+    last_poll_us_ = now_us;
+    return true;
+}
+
+size_t CatPoller::query(const uint8_t protocol, const uint8_t civ_address, uint8_t *buf, const size_t size) {
+    if (protocol == CAT_PROTOCOL_CIV) {
+        // Read operating frequency (0x03) from the controller address E0
+        const uint8_t civ_query[] = {0xFE, 0xFE, civ_address, 0xE0, 0x03, 0xFD};
+        if (size < sizeof(civ_query)) {
+            return 0;
+        }
+        memcpy(buf, civ_query, sizeof(civ_query));
+        return sizeof(civ_query);
+    }
+
+    // IF carries frequency, mode and (on Kenwood) TX state in one reply
+    static constexpr char ASCII_QUERY[] = "IF;";
+    if (size < sizeof(ASCII_QUERY) - 1) {
+        return 0;
+    }
+    memcpy(buf, ASCII_QUERY, sizeof(ASCII_QUERY) - 1);
+    return sizeof(ASCII_QUERY) - 1;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Decides when to query a radio that doesn't send auto-information. Polls
+// quickly while the frequency is moving and backs off to a heartbeat once it
+// settles. It never talks while the line is busy and skips polls while frames
+// arrive anyway (auto-information or a PC polling the same radio), so the
+// radio's CAT port isn't flooded.
+class CatPoller {
+public:
+    static constexpr int FAST_INTERVAL_MS = 50;
+    static constexpr int SLOW_INTERVAL_MS = 1000;
+    // The line must have been idle this long before a query is sent
+    static constexpr int QUIET_MS = 30;
+    // Unanswered queries before dropping straight to the heartbeat
+    static constexpr int MAX_UNANSWERED = 3;
+
+    // Bytes were received from the line
+    void on_activity(int64_t now_us) { last_activity_us_ = now_us; }
+
+    // A frequency was decoded, whoever asked for it
+    void on_frequency(uint32_t frequency, int64_t now_us);
+
+    // True if a query should go out now; the caller then sends query()
+    bool poll_due(int64_t now_us);
+
+    int interval_ms() const { return interval_ms_; }
+
+    // Frequency query for protocol (CAT_PROTOCOL_*); returns its length
+    static size_t query(uint8_t protocol, uint8_t civ_address, uint8_t *buf, size_t size);
+
+private:
+    int interval_ms_{FAST_INTERVAL_MS};
+    int64_t last_poll_us_{0};
+    int64_t last_update_us_{0};
+    int64_t last_activity_us_{0};
+    uint32_t last_frequency_{0};
+    int unanswered_{0};
+};
@@ -13,6 +13,8 @@ ConfigManager *ConfigManager::instance_ = nullptr;
 
 ConfigManager::ConfigManager() {
     current_config_ = new antenna_switch_config_t();
+    edit_config_ = new antenna_switch_config_t();
+    notify_config_ = new antenna_switch_config_t();
     if (instance_ == nullptr) {
         instance_ = this;
     }
@@ -20,6 +22,8 @@ ConfigManager::ConfigManager() {
 
 ConfigManager::~ConfigManager() {
     delete current_config_;
+    delete edit_config_;
+    delete notify_config_;
 }
 
 ConfigManager &ConfigManager::instance() {
@@ -29,6 +33,7 @@ ConfigManager &ConfigManager::instance() {
 
 esp_err_t ConfigManager::init() const {
     ESP_LOGI(TAG, "Initializing configuration manager");
+    std::lock_guard lock(mutex_);
 
     // Try to load from NVS first
     esp_err_t ret = load_from_nvs();
@@ -75,37 +80,189 @@ esp_err_t ConfigManager::init() const {
     return ESP_OK;
 }
 
-esp_err_t ConfigManager::update_config(const antenna_switch_config_t &new_config) {
-    ESP_LOGI(TAG, "Updating configuration");
-
-    // Validate configuration
-    if (new_config.num_bands <= 0 || new_config.num_bands > MAX_BANDS) {
-        ESP_LOGE(TAG, "Invalid number of bands: %d", new_config.num_bands);
+esp_err_t ConfigManager::validate(const antenna_switch_config_t &config) {
+    if (config.num_bands <= 0 || config.num_bands > MAX_BANDS) {
+        ESP_LOGE(TAG, "Invalid number of bands: %d", config.num_bands);
         return ESP_ERR_INVALID_ARG;
     }
 
-    if (new_config.num_antenna_ports <= 0 || new_config.num_antenna_ports > MAX_ANTENNA_PORTS) {
-        ESP_LOGE(TAG, "Invalid number of antenna ports: %d", new_config.num_antenna_ports);
+    if (config.num_antenna_ports <= 0 || config.num_antenna_ports > MAX_ANTENNA_PORTS) {
+        ESP_LOGE(TAG, "Invalid number of antenna ports: %d", config.num_antenna_ports);
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Update configuration
-    *current_config_ = new_config;
+    for (int i = 0; i < config.num_bands; i++) {
+        const LogicalOutputMask outputs = RelayBoardRegistry::mask_from_bytes(config.band_outputs[i]);
+        if (antenna_switch_check_outputs(config, outputs) != ESP_OK) {
+            ESP_LOGE(TAG, "Outputs for band %d break an exclusion group", i);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ConfigManager::commit(const antenna_switch_config_t &config, ConfigFieldMask *changed) {
+    *changed = 0;
+    if (const esp_err_t ret = validate(config); ret != ESP_OK) {
+        return ret;
+    }
+
+    // Notify observers of what changed only, so e.g. renaming a band touches neither the UART nor the relay link
+    const ConfigFieldMask fields = diff(*current_config_, config);
+    if (fields == 0) {
+        ESP_LOGD(TAG, "Configuration unchanged");
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Updating configuration, changed field groups: 0x%02lx", static_cast<unsigned long>(fields));
+
+    *current_config_ = config;
+    version_++;
 
     // Save new configuration to NVS
     if (const esp_err_t ret = save_to_nvs(); ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to save configuration: %s", esp_err_to_name(ret));
         return ret;
     }
+    *changed = fields;
+    return ESP_OK;
+}
 
-    // Notify observers
-    for (const auto &observer: observers_) {
-        observer(*current_config_);
+void ConfigManager::notify(const ConfigFieldMask changed) {
+    if (changed == 0) {
+        return;
     }
 
+    // Outside mutex_, so a slow observer never holds up another writer, but one save at a
+    // time and always with the latest config: when saves overlap, the last observer call
+    // carries what NVS holds rather than whichever save happened to notify last
+    std::lock_guard notify_lock(notify_mutex_);
+    std::vector<Observer> notify;
+    {
+        std::lock_guard lock(mutex_);
+        *notify_config_ = *current_config_;
+        for (const auto &observer: observers_) {
+            if (observer.fields & changed) {
+                notify.push_back(observer);
+            }
+        }
+    }
+
+    for (const auto &observer: notify) {
+        observer.notify(*notify_config_);
+    }
+}
+
+esp_err_t ConfigManager::update_config(const antenna_switch_config_t &new_config) {
+    ConfigFieldMask changed = 0;
+    {
+        std::lock_guard lock(mutex_);
+        if (const esp_err_t ret = commit(new_config, &changed); ret != ESP_OK) {
+            return ret;
+        }
+    }
+    notify(changed);
     return ESP_OK;
 }
 
+esp_err_t ConfigManager::update_config(const antenna_switch_config_t &new_config, const uint32_t based_on) {
+    ConfigFieldMask changed = 0;
+    {
+        std::lock_guard lock(mutex_);
+        if (version_ != based_on) {
+            ESP_LOGW(TAG, "Configuration changed since it was read, not saving");
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (const esp_err_t ret = commit(new_config, &changed); ret != ESP_OK) {
+            return ret;
+        }
+    }
+    notify(changed);
+    return ESP_OK;
+}
+
+void ConfigManager::copy_config(antenna_switch_config_t *config, uint32_t *version) const {
+    std::lock_guard lock(mutex_);
+    *config = *current_config_;
+    if (version != nullptr) {
+        *version = version_;
+    }
+}
+
+template<typename T>
+static bool differs(const T &before, const T &after) {
+    return memcmp(&before, &after, sizeof(T)) != 0;
+}
+
+// Bytes after the terminator don't count
+template<size_t N>
+static bool differs(const char (&before)[N], const char (&after)[N]) {
+    return strncmp(before, after, N) != 0;
+}
+
+ConfigFieldMask ConfigManager::diff(const antenna_switch_config_t &before, const antenna_switch_config_t &after) {
+    ConfigFieldMask changed = 0;
+    const auto check = [&changed](const bool differ, const ConfigFieldMask field) {
+        if (differ) {
+            changed |= field;
+        }
+    };
+
+    // Field by field: the structs have padding
+    check(differs(before.num_bands, after.num_bands) || differs(before.num_antenna_ports, after.num_antenna_ports) ||
+          differs(before.band_outputs, after.band_outputs) || differs(before.port_board, after.port_board) ||
+          differs(before.port_channel, after.port_channel) ||
+          differs(before.exclusion_groups, after.exclusion_groups), CONFIG_FIELD_BANDS);
+    for (int i = 0; i < MAX_BANDS; i++) {
+        const band_config_t &a = before.bands[i];
+        const band_config_t &b = after.bands[i];
+        check(differs(a.start_freq, b.start_freq) || differs(a.end_freq, b.end_freq) ||
+              differs(a.antenna_ports, b.antenna_ports), CONFIG_FIELD_BANDS);
+        check(differs(a.description, b.description), CONFIG_FIELD_BAND_LABELS);
+    }
+
+    check(differs(before.uart_baud_rate, after.uart_baud_rate) || differs(before.uart_parity, after.uart_parity) ||
+          differs(before.uart_stop_bits, after.uart_stop_bits) ||
+          differs(before.uart_flow_ctrl, after.uart_flow_ctrl) || differs(before.num_radios, after.num_radios) ||
+          differs(before.cat2_baud_rate, after.cat2_baud_rate) || differs(before.cat_protocols, after.cat_protocols) ||
+          differs(before.cat_fixed_link, after.cat_fixed_link) || differs(before.cat_polling, after.cat_polling) ||
+          differs(before.cat_pc_bridge, after.cat_pc_bridge), CONFIG_FIELD_SERIAL);
+
+    check(differs(before.tcp_host, after.tcp_host) || differs(before.tcp_port, after.tcp_port),
+          CONFIG_FIELD_RELAY_LINK);
+
+    check(differs(before.auto_mode, after.auto_mode) || differs(before.priority_radio, after.priority_radio) ||
+          differs(before.frequency_priority, after.frequency_priority) ||
+          differs(before.source_fresh_s, after.source_fresh_s) || differs(before.manual_hold_s, after.manual_hold_s),
+          CONFIG_FIELD_SWITCHING);
+
+    check(differs(before.n1mm_udp_port, after.n1mm_udp_port) || differs(before.rigctld_host, after.rigctld_host) ||
+          differs(before.rigctld_port, after.rigctld_port) ||
+          differs(before.rigctl_server_port, after.rigctl_server_port), CONFIG_FIELD_NETWORK_SOURCES);
+
+    check(differs(before.network_profile, after.network_profile), CONFIG_FIELD_NETWORK_PROFILE);
+
+    bool extra_boards = differs(before.num_extra_boards, after.num_extra_boards) ||
+                        differs(before.extra_board_ports, after.extra_board_ports);
+    for (int i = 0; i < MAX_RELAY_BOARDS - 1; i++) {
+        extra_boards = extra_boards || differs(before.extra_board_hosts[i], after.extra_board_hosts[i]);
+    }
+    check(extra_boards || differs(before.relay_transport, after.relay_transport) ||
+          differs(before.modbus_address, after.modbus_address) ||
+          differs(before.rs485_baud_rate, after.rs485_baud_rate) || differs(before.static_ip, after.static_ip) ||
+          differs(before.static_netmask, after.static_netmask) ||
+          differs(before.static_gateway, after.static_gateway) || differs(before.static_dns, after.static_dns) ||
+          differs(before.softap_mode, after.softap_mode) || differs(before.softap_ssid, after.softap_ssid) ||
+          differs(before.softap_password, after.softap_password) ||
+          differs(before.softap_channel, after.softap_channel) ||
+          differs(before.relay_board_mac, after.relay_board_mac), CONFIG_FIELD_BOOT);
+
+    // A field not listed above is still saved
+    if (changed == 0 && memcmp(&before, &after, sizeof(before)) != 0) {
+        changed = CONFIG_FIELD_BOOT;
+    }
+    return changed;
+}
+
 esp_err_t ConfigManager::save_to_nvs() const {
     nvs_handle_t nvs_handle;
     esp_err_t ret = nvs_open("antenna_switch", NVS_READWRITE, &nvs_handle);
@@ -145,8 +302,15 @@ esp_err_t ConfigManager::load_from_nvs() const {
     return ret;
 }
 
-void ConfigManager::add_observer(const std::function<void(const antenna_switch_config_t &)> &observer) {
-    observers_.push_back(observer);
+void ConfigManager::add_observer(const ConfigFieldMask fields,
+                                 const std::function<void(const antenna_switch_config_t &)> &observer) {
+    // Same order as notify(): no save's observers can run between registering and the first call
+    std::lock_guard notify_lock(notify_mutex_);
+    {
+        std::lock_guard lock(mutex_);
+        observers_.push_back({fields, observer});
+        *notify_config_ = *current_config_;
+    }
     // Immediately notify the new observer of current config
-    observer(*current_config_);
+    observer(*notify_config_);
 }
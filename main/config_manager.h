@@ -1,19 +1,53 @@
 #pragma once
 
 #include <functional>
+#include <mutex>
 #include <vector>
 #include "esp_err.h"
 
 #include "antenna_switch.h"
 
+// Groups of antenna_switch_config_t fields, so an observer only runs when something it uses changed
+using ConfigFieldMask = uint32_t;
+#define CONFIG_FIELD_BANDS (1u << 0) // Band ranges, ports and outputs, output wiring, exclusion groups
+#define CONFIG_FIELD_BAND_LABELS (1u << 1) // Band descriptions, display only
+#define CONFIG_FIELD_SERIAL (1u << 2) // CAT ports: rates, framing, protocols, detection, polling
+#define CONFIG_FIELD_RELAY_LINK (1u << 3) // Primary relay board host and port
+#define CONFIG_FIELD_SWITCHING (1u << 4) // Auto mode, radio priority, frequency arbitration
+#define CONFIG_FIELD_NETWORK_SOURCES (1u << 5) // N1MM listener, rigctld client, rigctl server
+#define CONFIG_FIELD_NETWORK_PROFILE (1u << 6)
+#define CONFIG_FIELD_BOOT (1u << 7) // Only read at startup: relay transport and extra boards, static IP, SoftAP
+#define CONFIG_FIELDS_ALL 0xFFFFFFFFu
+
 class ConfigManager {
+    struct Observer {
+        ConfigFieldMask fields;
+        std::function<void(const antenna_switch_config_t &)> notify;
+    };
+
     static ConfigManager *instance_;
     antenna_switch_config_t *current_config_;
-    std::vector<std::function<void(const antenna_switch_config_t &)> > observers_;
+    antenna_switch_config_t *edit_config_; // modify()'s working copy, under mutex_
+    antenna_switch_config_t *notify_config_; // What observers are given, under notify_mutex_
+    uint32_t version_{1}; // Bumped by every save
+    std::vector<Observer> observers_;
+    // Writers come from the web server, CAT and connectivity tasks. Recursive, so an
+    // edit passed to modify() may still read the config through copy_config().
+    mutable std::recursive_mutex mutex_;
+    // Observers run one save at a time, outside mutex_; recursive, so an observer may itself save
+    std::recursive_mutex notify_mutex_;
 
     // Private constructor for singleton
     ConfigManager();
 
+    static esp_err_t validate(const antenna_switch_config_t &config);
+
+    // Validate and save config as the current one; mutex_ held
+    esp_err_t commit(const antenna_switch_config_t &config, ConfigFieldMask *changed);
+
+    // Run the observers of changed with the config as saved last
+    void notify(ConfigFieldMask changed);
+
 public:
     static ConfigManager &instance();
 
@@ -25,16 +59,46 @@ public:
     // Get current config (const to prevent unauthorized modifications)
     const antenna_switch_config_t &get_config() const { return *current_config_; }
 
-    // Update config and notify all observers
+    // Copy of the current config, never one being written, and the version it has
+    void copy_config(antenna_switch_config_t *config, uint32_t *version = nullptr) const;
+
+    // Update config and notify the observers of the fields that changed; saving an unchanged config does nothing
     esp_err_t update_config(const antenna_switch_config_t &new_config);
 
+    // As above, but ESP_ERR_INVALID_STATE if anything was saved since copy_config() returned based_on
+    esp_err_t update_config(const antenna_switch_config_t &new_config, uint32_t based_on);
+
+    // Change some fields of the current config and save it in one step, so writers on other
+    // tasks can't undo each other's fields. edit runs under the lock and must not save.
+    template<typename Edit>
+    esp_err_t modify(Edit &&edit) {
+        ConfigFieldMask changed = 0;
+        {
+            std::lock_guard lock(mutex_);
+            *edit_config_ = *current_config_;
+            edit(*edit_config_);
+            if (const esp_err_t ret = commit(*edit_config_, &changed); ret != ESP_OK) {
+                return ret;
+            }
+        }
+        notify(changed);
+        return ESP_OK;
+    }
+
+    // CONFIG_FIELD_* groups with a field that differs between before and after
+    static ConfigFieldMask diff(const antenna_switch_config_t &before, const antenna_switch_config_t &after);
+
     // Save to / load from NVS
     esp_err_t save_to_nvs() const;
 
     esp_err_t load_from_nvs() const;
 
-    // Observer pattern
-    void add_observer(const std::function<void(const antenna_switch_config_t &)> &observer);
+    // Observer pattern: called now, then after every update that changes one of fields
+    void add_observer(ConfigFieldMask fields, const std::function<void(const antenna_switch_config_t &)> &observer);
+
+    void add_observer(const std::function<void(const antenna_switch_config_t &)> &observer) {
+        add_observer(CONFIG_FIELDS_ALL, observer);
+    }
 
     // Initialize with default config if needed
     esp_err_t init() const;
@@ -0,0 +1,182 @@
+#include "connectivity_manager.h"
+#include "wifi_manager.hpp"
+#include "task_layout.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include <algorithm>
+
+static auto TAG = "CONNECTIVITY";
+
+ConnectivityManager &ConnectivityManager::instance() {
+    static ConnectivityManager instance;
+    return instance;
+}
+
+esp_err_t ConnectivityManager::start() {
+    if (queue_ != nullptr) {
+        return ESP_OK;
+    }
+    queue_ = xQueueCreateStatic(QUEUE_LENGTH, sizeof(ConnectivityEvent), queue_buffer_, &queue_storage_);
+    if (queue_ == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (task_.create(task_trampoline, "connectivity", this, TASK_PRIORITY_CONNECTIVITY, TASK_CORE_NETWORK) !=
+        pdPASS) {
+        ESP_LOGE(TAG, "Failed to create connectivity task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void ConnectivityManager::post(const ConnectivityEvent &event) {
+    if (queue_ == nullptr || xQueueSend(queue_, &event, 0) != pdTRUE) {
+        dropped_++;
+        return;
+    }
+    events_++;
+}
+
+void ConnectivityManager::add_dependent(const char *name, std::function<esp_err_t()> start,
+                                        std::function<void()> stop) {
+    {
+        std::lock_guard<std::mutex> lock(dependents_mutex_);
+        dependents_.push_back({name, std::move(start), std::move(stop), false});
+    }
+    // Started on the task, like every other dependent
+    ConnectivityEvent event = {};
+    event.type = ConnectivityEvent::Type::DEPENDENTS_CHANGED;
+    post(event);
+}
+
+ConnectivityManager::Stats ConnectivityManager::get_stats() const {
+    return {events_.load(), dropped_.load(), reconnects_.load(), last_backoff_ms_.load(), network_up_.load()};
+}
+
+void ConnectivityManager::task_trampoline(void *arg) {
+    static_cast<ConnectivityManager *>(arg)->task();
+}
+
+void ConnectivityManager::task() {
+    uint32_t dropped_seen = 0;
+    while (true) {
+        TickType_t wait = portMAX_DELAY;
+        if (reconnect_at_us_ >= 0) {
+            const int64_t remaining_us = reconnect_at_us_ - esp_timer_get_time();
+            wait = remaining_us > 0 ? pdMS_TO_TICKS(remaining_us / 1000) + 1 : 0;
+        }
+
+        if (ConnectivityEvent event; xQueueReceive(queue_, &event, wait) == pdTRUE) {
+            handle(event);
+        }
+
+        if (reconnect_at_us_ >= 0 && esp_timer_get_time() >= reconnect_at_us_) {
+            reconnect_at_us_ = -1;
+            reconnects_++;
+            WifiManager::instance().start_connect();
+        }
+
+        // A lost disconnect would leave the station down for good: go by the flags the handler keeps instead
+        if (const uint32_t dropped = dropped_.load(); dropped != dropped_seen) {
+            dropped_seen = dropped;
+            auto &wifi = WifiManager::instance();
+            ESP_LOGW(TAG, "%lu Wi-Fi event(s) dropped, resynchronising", static_cast<unsigned long>(dropped));
+            sta_up_ = wifi.m_ip_obtained;
+            ap_up_ = wifi.m_softap_running;
+            if (sta_started_ && !wifi.m_wifi_connected && reconnect_at_us_ < 0) {
+                schedule_reconnect(0);
+            }
+            sync_dependents();
+        }
+    }
+}
+
+void ConnectivityManager::handle(const ConnectivityEvent &event) {
+    auto &wifi = WifiManager::instance();
+    switch (event.type) {
+        case ConnectivityEvent::Type::STA_CONNECTED:
+            sta_started_ = true;
+            wifi.on_associated(event.mac, event.channel);
+            break;
+        case ConnectivityEvent::Type::STA_DISCONNECTED:
+            sta_started_ = true;
+            sta_up_ = false;
+            wifi.on_disconnected(event.reason);
+            schedule_reconnect(event.reason);
+            break;
+        case ConnectivityEvent::Type::GOT_IP:
+            sta_up_ = true;
+            backoff_attempt_ = 0;
+            reconnect_at_us_ = -1;
+            wifi.on_got_ip();
+            break;
+        case ConnectivityEvent::Type::LOST_IP:
+            sta_up_ = false;
+            break;
+        case ConnectivityEvent::Type::AP_START:
+            ap_up_ = true;
+            break;
+        case ConnectivityEvent::Type::AP_STOP:
+            ap_up_ = false;
+            break;
+        case ConnectivityEvent::Type::STATION_IP:
+            wifi.on_station_ip(event.mac, event.ip);
+            break;
+        case ConnectivityEvent::Type::SMARTCONFIG_CREDENTIALS:
+            // A new network: connect now rather than after the old one's backoff
+            backoff_attempt_ = 0;
+            reconnect_at_us_ = -1;
+            wifi.apply_smartconfig_credentials();
+            break;
+        case ConnectivityEvent::Type::DEPENDENTS_CHANGED:
+            break;
+    }
+    sync_dependents();
+}
+
+void ConnectivityManager::schedule_reconnect(const uint8_t reason) {
+    // Equal jitter, as on the relay link: half the capped delay is fixed, so retries
+    // never come back to back, and the other half spreads devices rejoining one AP
+    const uint32_t cap_ms = std::min(BACKOFF_BASE_MS << std::min(backoff_attempt_, 6), BACKOFF_MAX_MS);
+    uint32_t delay_ms = cap_ms / 2 + esp_random() % (cap_ms / 2 + 1);
+    if (WifiManager::instance().softap_enabled() && reason == WIFI_REASON_NO_AP_FOUND) {
+        delay_ms = std::max(delay_ms, SOFTAP_STA_RETRY_MS);
+    }
+    backoff_attempt_++;
+    reconnect_at_us_ = esp_timer_get_time() + delay_ms * 1000LL;
+    last_backoff_ms_ = delay_ms;
+    ESP_LOGI(TAG, "WiFi disconnected (reason %d), reconnecting in %lu ms", reason,
+             static_cast<unsigned long>(delay_ms));
+}
+
+void ConnectivityManager::sync_dependents() {
+    const bool up = sta_up_ || ap_up_;
+    if (up != network_up_.load()) {
+        ESP_LOGI(TAG, "Network %s", up ? "up" : "down");
+        network_up_ = up;
+    }
+
+    std::lock_guard<std::mutex> lock(dependents_mutex_);
+    if (up) {
+        for (auto &dependent: dependents_) {
+            if (dependent.running) {
+                continue;
+            }
+            if (const esp_err_t ret = dependent.start(); ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to start %s: %s", dependent.name, esp_err_to_name(ret));
+                continue;
+            }
+            dependent.running = true;
+            ESP_LOGI(TAG, "Started %s", dependent.name);
+        }
+    } else {
+        // Without a stop they keep running, e.g. sockets bound to any address that work again later
+        for (auto it = dependents_.rbegin(); it != dependents_.rend(); ++it) {
+            if (it->running && it->stop) {
+                it->stop();
+                it->running = false;
+                ESP_LOGI(TAG, "Stopped %s", it->name);
+            }
+        }
+    }
+}
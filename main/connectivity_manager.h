@@ -0,0 +1,109 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "static_task.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Wi-Fi and IP events as posted by WifiManager's event handler
+struct ConnectivityEvent {
+    enum class Type : uint8_t {
+        STA_CONNECTED,
+        STA_DISCONNECTED,
+        GOT_IP,
+        LOST_IP,
+        AP_START,
+        AP_STOP,
+        STATION_IP, // A SoftAP station got a DHCP lease
+        SMARTCONFIG_CREDENTIALS,
+        DEPENDENTS_CHANGED
+    };
+
+    Type type;
+    uint8_t reason; // STA_DISCONNECTED
+    uint8_t channel; // STA_CONNECTED
+    uint8_t mac[6]; // STA_CONNECTED: the AP; STATION_IP: the station
+    esp_ip4_addr_t ip; // STATION_IP
+};
+
+// Does the slow part of reacting to Wi-Fi events on its own task, so the
+// default event loop never blocks: saving the AP, setting a static IP,
+// reconnecting with jittered backoff, and starting the services that need the
+// network in the order they were added once it is up, stopping them in
+// reverse once neither the station nor the SoftAP has an address.
+class ConnectivityManager {
+public:
+    struct Stats {
+        uint32_t events;
+        uint32_t dropped; // Posted with the queue full
+        uint32_t reconnects; // Connection attempts after a disconnect
+        uint32_t last_backoff_ms;
+        bool network_up;
+    };
+
+    static ConnectivityManager &instance();
+
+    // Before Wi-Fi starts, so no event is missed
+    esp_err_t start();
+
+    // From the event loop; never blocks
+    void post(const ConnectivityEvent &event);
+
+    // start runs once the network is up, straight away if it already is; stop, if set, once it is down.
+    // A failed start is retried on the next event.
+    void add_dependent(const char *name, std::function<esp_err_t()> start, std::function<void()> stop);
+
+    Stats get_stats() const;
+
+private:
+    struct Dependent {
+        const char *name;
+        std::function<esp_err_t()> start;
+        std::function<void()> stop;
+        bool running;
+    };
+
+    static constexpr int QUEUE_LENGTH = 16;
+    static constexpr uint32_t BACKOFF_BASE_MS = 500;
+    static constexpr uint32_t BACKOFF_MAX_MS = 30000;
+    // Without the house network, scanning for it keeps taking the radio off the SoftAP channel
+    static constexpr uint32_t SOFTAP_STA_RETRY_MS = 30000;
+
+    ConnectivityManager() = default;
+
+    static void task_trampoline(void *arg);
+
+    [[noreturn]] void task();
+
+    void handle(const ConnectivityEvent &event);
+
+    // Start or stop dependents to match the network state
+    void sync_dependents();
+
+    void schedule_reconnect(uint8_t reason);
+
+    StaticTask<4096> task_;
+    StaticQueue_t queue_storage_{};
+    uint8_t queue_buffer_[QUEUE_LENGTH * sizeof(ConnectivityEvent)]{};
+    QueueHandle_t queue_{nullptr};
+    std::mutex dependents_mutex_;
+    std::vector<Dependent> dependents_;
+    // Task only
+    bool sta_up_{false};
+    bool ap_up_{false};
+    bool sta_started_{false}; // The station has tried to connect, so it should keep trying
+    int64_t reconnect_at_us_{-1}; // -1 = none pending
+    int backoff_attempt_{0};
+    // Read by get_stats() from other tasks
+    std::atomic<uint32_t> events_{0};
+    std::atomic<uint32_t> dropped_{0};
+    std::atomic<uint32_t> reconnects_{0};
+    std::atomic<uint32_t> last_backoff_ms_{0};
+    std::atomic<bool> network_up_{false};
+};
@@ -0,0 +1,97 @@
+#include "frequency_arbiter.h"
+#include <algorithm>
+
+FrequencyArbiter::FrequencyArbiter() {
+    for (RadioState &radio: radios_) {
+        radio = RadioState{};
+        radio.decided_band = NO_DECISION;
+        radio.active_source = -1;
+    }
+}
+
+const char *FrequencyArbiter::source_name(const int source) {
+    switch (source) {
+        case FREQ_SOURCE_CAT: return "cat";
+        case FREQ_SOURCE_NETWORK: return "network";
+        default: return "none";
+    }
+}
+
+int FrequencyArbiter::pick(const RadioState &radio, const int64_t now_us, const antenna_switch_config_t &config) {
+    const int preferred = config.frequency_priority == FREQ_PRIORITY_NETWORK_FIRST
+                              ? FREQ_SOURCE_NETWORK
+                              : FREQ_SOURCE_CAT;
+    const int64_t fresh_us = (config.source_fresh_s ? config.source_fresh_s : FREQ_FRESH_DEFAULT_S) * 1000000LL;
+    if (const SourceState &p = radio.sources[preferred]; p.valid && now_us - p.updated_us < fresh_us) {
+        return preferred;
+    }
+
+    int latest = -1;
+    for (int s = 0; s < FREQ_SOURCE_COUNT; s++) {
+        if (radio.sources[s].valid && (latest < 0 || radio.sources[s].updated_us > radio.sources[latest].updated_us)) {
+            latest = s;
+        }
+    }
+    return latest;
+}
+
+FrequencyArbiter::Decision FrequencyArbiter::report(const int radio, const int source, const uint32_t frequency,
+                                                    const int band, const int64_t now_us,
+                                                    const antenna_switch_config_t &config) {
+    if (radio < 0 || radio >= MAX_RADIOS || source < 0 || source >= FREQ_SOURCE_COUNT) {
+        return {false, -1, 0, -1};
+    }
+    stats_.reports++;
+    RadioState &state = radios_[radio];
+    state.sources[source] = {frequency, band, now_us, true};
+
+    if (now_us < manual_until_us_) {
+        stats_.held++;
+        return {false, state.active_source, frequency, band};
+    }
+
+    const int winner = pick(state, now_us, config);
+    state.active_source = winner;
+    const SourceState &chosen = state.sources[winner];
+    if (chosen.band == state.decided_band) {
+        return {false, winner, chosen.frequency, chosen.band};
+    }
+    state.decided_band = chosen.band;
+    stats_.decisions++;
+    return {true, winner, chosen.frequency, chosen.band};
+}
+
+void FrequencyArbiter::hold_manual(const int64_t now_us, const antenna_switch_config_t &config) {
+    const int hold_s = config.manual_hold_s ? config.manual_hold_s : FREQ_MANUAL_HOLD_DEFAULT_S;
+    manual_until_us_ = now_us + hold_s * 1000000LL;
+    // The relays no longer match any decision; the first report after the hold re-applies
+    for (RadioState &radio: radios_) {
+        radio.decided_band = NO_DECISION;
+    }
+}
+
+int64_t FrequencyArbiter::manual_hold_remaining_us(const int64_t now_us) const {
+    return std::max<int64_t>(manual_until_us_ - now_us, 0);
+}
+
+void FrequencyArbiter::retry(const int radio) {
+    if (radio >= 0 && radio < MAX_RADIOS) {
+        radios_[radio].decided_band = NO_DECISION;
+    }
+}
+
+void FrequencyArbiter::rebuild_bands(const antenna_switch_config_t &config,
+                                     int (*band_of)(const antenna_switch_config_t &config, uint32_t frequency)) {
+    for (RadioState &radio: radios_) {
+        for (SourceState &source: radio.sources) {
+            if (source.valid) {
+                source.band = band_of(config, source.frequency);
+            }
+        }
+        radio.decided_band = NO_DECISION;
+    }
+}
+
+int FrequencyArbiter::active_source(const int radio) const {
+    return radio >= 0 && radio < MAX_RADIOS ? radios_[radio].active_source : -1;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "antenna_switch.h"
+#include <cstdint>
+
+// Where a reported frequency came from
+#define FREQ_SOURCE_CAT 0 // Radio's CAT port
+#define FREQ_SOURCE_NETWORK 1 // Logger RadioInfo or rigctld
+#define FREQ_SOURCE_COUNT 2
+
+// antenna_switch_config_t::frequency_priority
+#define FREQ_PRIORITY_CAT_FIRST 0
+#define FREQ_PRIORITY_NETWORK_FIRST 1
+
+#define FREQ_MANUAL_HOLD_DEFAULT_S 300
+#define FREQ_FRESH_DEFAULT_S 10
+
+// Turns frequency reports from every source into one stream of band decisions
+// per radio. The preferred source wins while it is fresh, otherwise the most
+// recently heard one does. A relay set by hand holds all automatic decisions
+// off for a while. Repeats and moves within a band produce no decision, so
+// sources that disagree can't make the relays thrash.
+//
+// Not thread-safe; antenna_switch serialises callers.
+class FrequencyArbiter {
+public:
+    struct Decision {
+        bool changed; // Band differs from the last decision: apply frequency
+        int source; // Source in charge, -1 if none
+        uint32_t frequency;
+        int band; // -1 = outside every band
+    };
+
+    struct Stats {
+        uint32_t reports;
+        uint32_t decisions;
+        uint32_t held; // Reports ignored during a manual hold
+    };
+
+    FrequencyArbiter();
+
+    Decision report(int radio, int source, uint32_t frequency, int band, int64_t now_us,
+                    const antenna_switch_config_t &config);
+
+    // Relays were set by hand: make no automatic decision for manual_hold_s
+    void hold_manual(int64_t now_us, const antenna_switch_config_t &config);
+
+    int64_t manual_hold_remaining_us(int64_t now_us) const;
+
+    // The last decision couldn't be applied; repeat it on the next report
+    void retry(int radio);
+
+    // Bands were edited: look up every source's last frequency again with band_of, and
+    // apply the next report even if its band number is unchanged, as its outputs may not be
+    void rebuild_bands(const antenna_switch_config_t &config,
+                       int (*band_of)(const antenna_switch_config_t &config, uint32_t frequency));
+
+    int active_source(int radio) const;
+
+    const Stats &get_stats() const { return stats_; }
+
+    static const char *source_name(int source);
+
+private:
+    static constexpr int NO_DECISION = -2;
+
+    struct SourceState {
+        uint32_t frequency;
+        int band;
+        int64_t updated_us;
+        bool valid;
+    };
+
+    struct RadioState {
+        SourceState sources[FREQ_SOURCE_COUNT];
+        int decided_band;
+        int active_source;
+    };
+
+    // Preferred source if fresh, otherwise the most recently heard; -1 if none yet
+    static int pick(const RadioState &radio, int64_t now_us, const antenna_switch_config_t &config);
+
+    RadioState radios_[MAX_RADIOS];
+    int64_t manual_until_us_{0};
+    Stats stats_{};
+};
@@ -1,4 +1,11 @@
 #include "html_content.h"
+#include "modbus_relay_backend.h"
+#include "cat_decoder.h"
+#include "network_frequency_source.h"
+#include "frequency_arbiter.h"
+#include "network_profile.h"
+#include "wifi_manager.hpp"
+#include <algorithm>
 #include <sstream>
 #include <esp_log.h>
 
@@ -173,6 +180,18 @@ const std::map<std::string, BandInfo> band_info = {
     // {"70cm", {"70cm", 420000000, 450000000}}
 };
 
+// "1, 9, 12" for a stored output mask
+static std::string output_list(const uint8_t *bytes) {
+    const LogicalOutputMask outputs = RelayBoardRegistry::mask_from_bytes(bytes);
+    std::string list;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (outputs[i]) {
+            list += (list.empty() ? "" : ", ") + std::to_string(i + 1);
+        }
+    }
+    return list;
+}
+
 std::string generate_root_html(const antenna_switch_config_t &config, const char *ip_addr, const char *mac_addr) {
     std::stringstream ss;
     ss << HTML_HEADER;
@@ -294,6 +313,30 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
     ss << "<label for='tcp_port'>TCP Port:</label>";
     ss << "<input type='number' id='tcp_port' name='tcp_port' value='" << config.tcp_port << "' min='1' max='65535'>";
     ss << "</div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='relay_transport'>Transport:</label>";
+    ss << "<select id='relay_transport' name='relay_transport'>";
+    ss << "<option value='" << RELAY_TRANSPORT_TCP << "' "
+            << (config.relay_transport == RELAY_TRANSPORT_TCP ? "selected" : "") << ">TCP</option>";
+    ss << "<option value='" << RELAY_TRANSPORT_UDP << "' "
+            << (config.relay_transport == RELAY_TRANSPORT_UDP ? "selected" : "") << ">UDP</option>";
+    ss << "<option value='" << RELAY_TRANSPORT_RS485 << "' "
+            << (config.relay_transport == RELAY_TRANSPORT_RS485 ? "selected" : "") << ">RS485 (Modbus-RTU)</option>";
+    ss << "</select></div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='modbus_address'>Modbus Address:</label>";
+    ss << "<input type='number' id='modbus_address' name='modbus_address' value='"
+            << static_cast<int>(config.modbus_address ? config.modbus_address : MODBUS_DEFAULT_ADDRESS)
+            << "' min='1' max='247'>";
+    ss << "</div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='rs485_baud_rate'>RS485 Baud Rate:</label>";
+    ss << "<select id='rs485_baud_rate' name='rs485_baud_rate'>";
+    const int rs485_baud = config.rs485_baud_rate > 0 ? config.rs485_baud_rate : RS485_DEFAULT_BAUD_RATE;
+    for (const int baud_rates[] = {4800, 9600, 19200, 38400, 57600, 115200}; const int rate: baud_rates) {
+        ss << "<option value='" << rate << "' " << (rs485_baud == rate ? "selected" : "") << ">" << rate << "</option>";
+    }
+    ss << "</select></div>";
 
     ss << "<h3>UART Configuration</h3>";
     ss << "<div class='form-group'>";
@@ -306,6 +349,158 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
     }
     ss << "</select></div>";
 
+    // Second radio (SO2R) on UART1; not available with the RS485 relay link
+    ss << "<div class='form-group'>";
+    ss << "<label for='num_radios'>Radios:</label>";
+    ss << "<select id='num_radios' name='num_radios'>";
+    ss << "<option value='1' " << (config.num_radios <= 1 ? "selected" : "") << ">1</option>";
+    ss << "<option value='2' " << (config.num_radios == 2 ? "selected" : "") << ">2 (SO2R)</option>";
+    ss << "</select></div>";
+
+    ss << "<div class='form-group'>";
+    ss << "<label><input type='checkbox' name='cat_auto_detect' " << (config.cat_fixed_link ? "" : "checked")
+            << "> Detect CAT baud rate and protocol automatically</label>";
+    ss << "</div>";
+
+    ss << "<div class='form-group'>";
+    ss << "<label><input type='checkbox' name='cat_polling' " << (config.cat_polling ? "checked" : "")
+            << "> Poll radios without auto-information</label>";
+    ss << "</div>";
+
+    ss << "<div class='form-group'>";
+    ss << "<label><input type='checkbox' name='cat_pc_bridge' " << (config.cat_pc_bridge ? "checked" : "")
+            << "> Share radio 1 CAT with a PC on the USB port (disables the console, applies after restart)</label>";
+    ss << "</div>";
+
+    // Follow the radio from the logger instead of a CAT cable; applies after restart
+    ss << "<div class='form-group'>";
+    ss << "<h3>Network Frequency Sources</h3>";
+    ss << "<label for='n1mm_udp_port'>N1MM / DXLog RadioInfo UDP port (0 = off):</label>";
+    ss << "<input type='number' id='n1mm_udp_port' name='n1mm_udp_port' value='" << config.n1mm_udp_port
+            << "' min='0' max='65535' placeholder='" << N1MM_DEFAULT_UDP_PORT << "'>";
+    ss << "</div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='rigctld_host'>rigctld host (empty = off):</label>";
+    ss << "<input type='text' id='rigctld_host' name='rigctld_host' value='" << config.rigctld_host << "'>";
+    ss << "</div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='rigctld_port'>rigctld port:</label>";
+    ss << "<input type='number' id='rigctld_port' name='rigctld_port' value='"
+            << (config.rigctld_port ? config.rigctld_port : RIGCTLD_DEFAULT_PORT) << "' min='1' max='65535'>";
+    ss << "</div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='rigctl_server_port'>Serve radios as rigctld on TCP port (radio 2 on port + 1, 0 = off):</label>";
+    ss << "<input type='number' id='rigctl_server_port' name='rigctl_server_port' value='" << config.rigctl_server_port
+            << "' min='0' max='65535' placeholder='" << RIGCTLD_DEFAULT_PORT << "'>";
+    ss << "</div>";
+
+    // Skips DHCP on every (re)connect; applies after restart
+    ss << "<div class='form-group'>";
+    ss << "<h3>Static IP</h3>";
+    ss << "<label for='static_ip'>Address (empty = DHCP):</label>";
+    ss << "<input type='text' id='static_ip' name='static_ip' value='" << config.static_ip << "'>";
+    ss << "<label for='static_netmask'>Netmask:</label>";
+    ss << "<input type='text' id='static_netmask' name='static_netmask' value='" << config.static_netmask
+            << "' placeholder='255.255.255.0'>";
+    ss << "<label for='static_gateway'>Gateway:</label>";
+    ss << "<input type='text' id='static_gateway' name='static_gateway' value='" << config.static_gateway << "'>";
+    ss << "<label for='static_dns'>DNS server (empty = gateway):</label>";
+    ss << "<input type='text' id='static_dns' name='static_dns' value='" << config.static_dns << "'>";
+    ss << "</div>";
+
+    // Own access point for the relay board; applies after restart
+    ss << "<div class='form-group'>";
+    ss << "<h3>Relay board SoftAP</h3>";
+    ss << "<label for='softap_mode'>Mode:</label>";
+    ss << "<select id='softap_mode' name='softap_mode'>";
+    ss << "<option value='" << SOFTAP_MODE_OFF << "' " << (config.softap_mode == SOFTAP_MODE_OFF ? "selected" : "")
+            << ">Off</option>";
+    ss << "<option value='" << SOFTAP_MODE_WITH_STA << "' "
+            << (config.softap_mode == SOFTAP_MODE_WITH_STA ? "selected" : "") << ">With house network</option>";
+    ss << "<option value='" << SOFTAP_MODE_ONLY << "' " << (config.softap_mode == SOFTAP_MODE_ONLY ? "selected" : "")
+            << ">SoftAP only</option>";
+    ss << "</select>";
+    ss << "<label for='softap_ssid'>Network name (empty = AntennaSwitch-XXXX):</label>";
+    ss << "<input type='text' id='softap_ssid' name='softap_ssid' maxlength='32' value='" << config.softap_ssid << "'>";
+    ss << "<label for='softap_password'>Password (8 to 63 characters):</label>";
+    ss << "<input type='password' id='softap_password' name='softap_password' maxlength='63' value='"
+            << config.softap_password << "'>";
+    ss << "<label for='softap_channel'>Channel (0 = default):</label>";
+    ss << "<input type='number' id='softap_channel' name='softap_channel' value='"
+            << static_cast<int>(config.softap_channel) << "' min='0' max='13'>";
+    char board_mac[18] = "";
+    if (std::any_of(std::begin(config.relay_board_mac), std::end(config.relay_board_mac),
+                    [](const uint8_t b) { return b != 0; })) {
+        snprintf(board_mac, sizeof(board_mac), "%02X:%02X:%02X:%02X:%02X:%02X", config.relay_board_mac[0],
+                 config.relay_board_mac[1], config.relay_board_mac[2], config.relay_board_mac[3],
+                 config.relay_board_mac[4], config.relay_board_mac[5]);
+    }
+    ss << "<label for='relay_board_mac'>Relay board MAC (empty = first station to join):</label>";
+    ss << "<input type='text' id='relay_board_mac' name='relay_board_mac' value='" << board_mac << "'>";
+    ss << "</div>";
+
+    // Relay command latency against power draw; compare them with POST /debug/rtt
+    ss << "<div class='form-group'>";
+    ss << "<label for='network_profile'>Network profile:</label>";
+    ss << "<select id='network_profile' name='network_profile'>";
+    for (int p = 0; p < NETWORK_PROFILE_COUNT; p++) {
+        ss << "<option value='" << p << "' " << (config.network_profile == p ? "selected" : "") << ">"
+                << NetworkProfile::name(p) << "</option>";
+    }
+    ss << "</select></div>";
+
+    // Which source decides the band when the CAT cable and the network disagree
+    ss << "<div class='form-group'>";
+    ss << "<label for='frequency_priority'>Preferred frequency source:</label>";
+    ss << "<select id='frequency_priority' name='frequency_priority'>";
+    ss << "<option value='" << FREQ_PRIORITY_CAT_FIRST << "' "
+            << (config.frequency_priority == FREQ_PRIORITY_CAT_FIRST ? "selected" : "") << ">CAT</option>";
+    ss << "<option value='" << FREQ_PRIORITY_NETWORK_FIRST << "' "
+            << (config.frequency_priority == FREQ_PRIORITY_NETWORK_FIRST ? "selected" : "") << ">Network</option>";
+    ss << "</select></div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='source_fresh_s'>Preferred source counts as current for (s):</label>";
+    ss << "<input type='number' id='source_fresh_s' name='source_fresh_s' value='"
+            << (config.source_fresh_s ? config.source_fresh_s : FREQ_FRESH_DEFAULT_S) << "' min='1' max='65535'>";
+    ss << "</div>";
+    ss << "<div class='form-group'>";
+    ss << "<label for='manual_hold_s'>Manual relay change holds automatic switching for (s):</label>";
+    ss << "<input type='number' id='manual_hold_s' name='manual_hold_s' value='"
+            << (config.manual_hold_s ? config.manual_hold_s : FREQ_MANUAL_HOLD_DEFAULT_S) << "' min='1' max='65535'>";
+    ss << "</div>";
+
+    for (int r = 0; r < MAX_RADIOS; r++) {
+        ss << "<div class='form-group'>";
+        ss << "<label for='cat_protocol_" << r << "'>Radio " << (r + 1) << " CAT Protocol:</label>";
+        ss << "<select id='cat_protocol_" << r << "' name='cat_protocol_" << r << "'>";
+        for (const auto &[value, name]: {std::pair{CAT_PROTOCOL_KENWOOD, "Kenwood / Elecraft"},
+                                         std::pair{CAT_PROTOCOL_CIV, "Icom CI-V"},
+                                         std::pair{CAT_PROTOCOL_YAESU, "Yaesu"}}) {
+            ss << "<option value='" << value << "' " << (config.cat_protocols[r] == value ? "selected" : "") << ">"
+                    << name << "</option>";
+        }
+        ss << "</select></div>";
+    }
+
+    ss << "<div class='form-group'>";
+    ss << "<label for='priority_radio'>Radio winning a shared antenna:</label>";
+    ss << "<select id='priority_radio' name='priority_radio'>";
+    for (int r = 0; r < MAX_RADIOS; r++) {
+        ss << "<option value='" << r << "' " << (config.priority_radio == r ? "selected" : "") << ">Radio "
+                << (r + 1) << "</option>";
+    }
+    ss << "</select></div>";
+
+    ss << "<div class='form-group'>";
+    ss << "<label for='cat2_baud_rate'>Radio 2 Baud Rate:</label>";
+    ss << "<select id='cat2_baud_rate' name='cat2_baud_rate'>";
+    ss << "<option value='0' " << (config.cat2_baud_rate == 0 ? "selected" : "") << ">Same as radio 1</option>";
+    for (const int baud_rates[] = {1200, 2400, 4800, 9600, 19200, 38400, 57600, 115200}; const int rate: baud_rates) {
+        ss << "<option value='" << rate << "' " << (config.cat2_baud_rate == rate ? "selected" : "") << ">" << rate
+                << "</option>";
+    }
+    ss << "</select></div>";
+
     ss << "<div class='form-group'>";
     ss << "<label for='uart_parity'>Parity:</label>";
     ss << "<select id='uart_parity' name='uart_parity'>";
@@ -338,6 +533,7 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
     ss << "<th>Start Freq</th>";
     ss << "<th>End Freq</th>";
     ss << "<th>Antenna Ports</th>";
+    ss << "<th>Outputs</th>";
     ss << "</tr>";
     ss << "</thead>";
     ss << "<tbody>";
@@ -366,13 +562,24 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
                     << (config.bands[i].antenna_ports[j] ? "checked" : "") << ">" << (j + 1) << " ";
         }
 
-
-        ss << "</td></tr>";
+        // Outputs switched on together for the band; empty uses the first antenna port
+        ss << "</td><td><input type='text' name='outputs_" << i << "' size='12' value='"
+                << output_list(config.band_outputs[i]) << "'></td></tr>";
     }
 
     ss << "</tbody>";
     ss << "</table>";
 
+    ss << "<div class='form-group'>";
+    ss << "<label for='exclusion_groups'>Exclusive outputs (groups separated by ';'):</label>";
+    ss << "<input type='text' id='exclusion_groups' name='exclusion_groups' value='";
+    for (int g = 0, written = 0; g < MAX_EXCLUSION_GROUPS; g++) {
+        if (const std::string group = output_list(config.exclusion_groups[g]); !group.empty()) {
+            ss << (written++ ? "; " : "") << group;
+        }
+    }
+    ss << "'></div>";
+
     ss << "<div class='auto-mode-container'>";
     ss << "<h2>Auto Mode</h2>";
     ss << "<label>";
@@ -389,6 +596,10 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
     // Add JavaScript for form submission
     ss << R"(
     <script>
+    function parseOutputs(text) {
+        return (text || '').split(',').map(s => parseInt(s)).filter(n => !isNaN(n));
+    }
+
     async function submitConfig(event) {
         event.preventDefault();
         const form = document.getElementById('configForm');
@@ -401,10 +612,38 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
             num_antenna_ports: parseInt(formData.get('num_antenna_ports')),
             tcp_host: formData.get('tcp_host'),
             tcp_port: parseInt(formData.get('tcp_port')),
+            relay_transport: parseInt(formData.get('relay_transport')),
+            modbus_address: parseInt(formData.get('modbus_address')),
+            rs485_baud_rate: parseInt(formData.get('rs485_baud_rate')),
             uart_baud_rate: parseInt(formData.get('uart_baud_rate')),
+            num_radios: parseInt(formData.get('num_radios')),
+            priority_radio: parseInt(formData.get('priority_radio')),
+            cat2_baud_rate: parseInt(formData.get('cat2_baud_rate')),
+            cat_auto_detect: formData.get('cat_auto_detect') === 'on',
+            cat_polling: formData.get('cat_polling') === 'on',
+            cat_pc_bridge: formData.get('cat_pc_bridge') === 'on',
+            n1mm_udp_port: parseInt(formData.get('n1mm_udp_port')) || 0,
+            rigctld_host: formData.get('rigctld_host'),
+            rigctld_port: parseInt(formData.get('rigctld_port')) || 0,
+            rigctl_server_port: parseInt(formData.get('rigctl_server_port')) || 0,
+            static_ip: formData.get('static_ip').trim(),
+            static_netmask: formData.get('static_netmask').trim(),
+            static_gateway: formData.get('static_gateway').trim(),
+            static_dns: formData.get('static_dns').trim(),
+            network_profile: parseInt(formData.get('network_profile')),
+            softap_mode: parseInt(formData.get('softap_mode')),
+            softap_ssid: formData.get('softap_ssid').trim(),
+            softap_password: formData.get('softap_password'),
+            softap_channel: parseInt(formData.get('softap_channel')) || 0,
+            relay_board_mac: formData.get('relay_board_mac').trim(),
+            frequency_priority: parseInt(formData.get('frequency_priority')),
+            source_fresh_s: parseInt(formData.get('source_fresh_s')) || 0,
+            manual_hold_s: parseInt(formData.get('manual_hold_s')) || 0,
+            cat_protocols: [...Array()" << MAX_RADIOS << R"().keys()].map(r => parseInt(formData.get(`cat_protocol_${r}`))),
             uart_parity: parseInt(formData.get('uart_parity')),
             uart_stop_bits: parseInt(formData.get('uart_stop_bits')),
             uart_flow_ctrl: parseInt(formData.get('uart_flow_ctrl')),
+            exclusion_groups: formData.get('exclusion_groups').split(';').map(parseOutputs).filter(g => g.length),
             bands: []
         };
         
@@ -419,6 +658,7 @@ std::string generate_config_html(const antenna_switch_config_t &config) {
             for (let j = 0; j < config.num_antenna_ports; j++) {
                 band.antenna_ports[j] = formData.get(`a${i}_${j}`) === '1';
             }
+            band.outputs = parseOutputs(formData.get(`outputs_${i}`));
             config.bands.push(band);
         }
         
@@ -0,0 +1,175 @@
+#include "jitter_benchmark.h"
+#include "antenna_switch.h"
+#include "cat_parser.h"
+#include "config_manager.h"
+#include "html_content.h"
+#include "task_layout.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static auto TAG = "JITTER_BENCH";
+
+#define JITTER_TASK_STACK_SIZE 4096
+// Same as the web server, which renders the same page
+#define JITTER_LOAD_STACK_SIZE 8192
+
+JitterBenchmark &JitterBenchmark::instance() {
+    static JitterBenchmark benchmark;
+    return benchmark;
+}
+
+esp_err_t JitterBenchmark::start() {
+#if CONFIG_ANTENNA_SWITCH_JITTER_BENCHMARK
+    if (running_.exchange(true)) {
+        return ESP_OK;
+    }
+    // Lowest priority on the network core: it only writes frames and reads counters
+    if (xTaskCreatePinnedToCore(task_trampoline, "jitter_bench", JITTER_TASK_STACK_SIZE, this, tskIDLE_PRIORITY + 1,
+                                nullptr, TASK_CORE_NETWORK) != pdPASS) {
+        running_.store(false);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+size_t JitterBenchmark::frequency_frame(const uint8_t protocol, const uint32_t frequency, uint8_t *buf,
+                                        const size_t size) {
+    if (protocol == CAT_PROTOCOL_CIV) {
+        // Transceive broadcast from an IC-7300 (0x94) to the controller, 5 bytes of little-endian BCD
+        constexpr size_t length = 11;
+        if (size < length) {
+            return 0;
+        }
+        const uint8_t header[] = {0xFE, 0xFE, 0xE0, 0x94, 0x00};
+        memcpy(buf, header, sizeof(header));
+        uint32_t rest = frequency;
+        for (size_t i = 0; i < 5; i++) {
+            const uint8_t low = rest % 10;
+            rest /= 10;
+            buf[sizeof(header) + i] = static_cast<uint8_t>((rest % 10) << 4 | low);
+            rest /= 10;
+        }
+        buf[length - 1] = 0xFD;
+        return length;
+    }
+
+    // FA with 11 digits on Kenwood/Elecraft, 9 on Yaesu
+    const int digits = protocol == CAT_PROTOCOL_YAESU ? 9 : 11;
+    char frame[16];
+    const int length = snprintf(frame, sizeof(frame), "FA%0*lu;", digits, static_cast<unsigned long>(frequency));
+    if (length <= 0 || static_cast<size_t>(length) > size) {
+        return 0;
+    }
+    memcpy(buf, frame, length);
+    return length;
+}
+
+void JitterBenchmark::load_task(void *arg) {
+    auto *benchmark = static_cast<JitterBenchmark *>(arg);
+    const antenna_switch_config_t config = ConfigManager::instance().get_config();
+    while (benchmark->loading_.load()) {
+        // The heaviest thing the web server does; yield a tick so the idle task still feeds the watchdog
+        generate_config_html(config);
+        benchmark->renders_++;
+        vTaskDelay(1);
+    }
+    vTaskDelete(nullptr);
+}
+
+void JitterBenchmark::task() {
+    const CatParser &parser = CatParser::radio(0);
+    for (int waited = 0; !parser.is_link_locked() && waited < LINK_WAIT_MS; waited += 100) {
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+
+    const antenna_switch_config_t &config = ConfigManager::instance().get_config();
+    RelayDispatcher::Stats stats{};
+    if (!parser.is_link_locked() || config.num_bands < 2 || !config.auto_mode ||
+        !antenna_switch_dispatch_stats(&stats)) {
+        ESP_LOGW(TAG, "Jitter benchmark needs a locked CAT link on radio 1, two bands, auto mode and relay boards");
+        done_.store(true);
+        vTaskDelete(nullptr);
+        return;
+    }
+
+    const uint8_t protocol = parser.get_protocol();
+    const uint32_t frequencies[2] = {
+        config.bands[0].start_freq + (config.bands[0].end_freq - config.bands[0].start_freq) / 2,
+        config.bands[1].start_freq + (config.bands[1].end_freq - config.bands[1].start_freq) / 2,
+    };
+    // Start bit, 8 data bits, optional parity, 1 or 2 stop bits
+    const int bits_per_char = 10 + (config.uart_parity != 0 ? 1 : 0) +
+                              (config.uart_stop_bits == UART_STOP_BITS_2 ? 1 : 0);
+    const int baud_rate = std::max(parser.get_baud_rate(), 1);
+
+    ESP_LOGW(TAG, "Running %d samples at %d baud (%s), relays will switch between bands 1 and 2",
+             CONFIG_ANTENNA_SWITCH_JITTER_BENCHMARK_SAMPLES, baud_rate, cat_protocol_name(protocol));
+
+    loading_.store(true);
+    for (int i = 0; i < LOAD_TASKS; i++) {
+        xTaskCreatePinnedToCore(load_task, "jitter_load", JITTER_LOAD_STACK_SIZE, this, TASK_PRIORITY_HTTPD, nullptr,
+                                TASK_CORE_NETWORK);
+    }
+    uart_set_loop_back(UART_NUM, true);
+
+    Result result{};
+    result.min_us = INT64_MAX;
+    int64_t total_us = 0;
+    for (int i = 0; i < CONFIG_ANTENNA_SWITCH_JITTER_BENCHMARK_SAMPLES; i++) {
+        uint8_t frame[16];
+        const size_t length = frequency_frame(protocol, frequencies[i % 2], frame, sizeof(frame));
+        const int64_t wire_us = static_cast<int64_t>(length) * bits_per_char * 1000000LL / baud_rate;
+
+        antenna_switch_dispatch_stats(&stats);
+        const uint32_t dispatched = stats.dispatched;
+        const int64_t sent_us = esp_timer_get_time();
+        uart_write_bytes(UART_NUM, frame, length);
+
+        bool seen = false;
+        for (int waited = 0; waited < DISPATCH_TIMEOUT_MS && !seen; waited += portTICK_PERIOD_MS) {
+            vTaskDelay(1);
+            antenna_switch_dispatch_stats(&stats);
+            seen = stats.dispatched != dispatched;
+        }
+        if (!seen) {
+            result.missed++;
+            continue;
+        }
+
+        const int64_t latency_us = std::max<int64_t>(stats.last_dispatch_us - sent_us - wire_us, 0);
+        result.samples++;
+        result.min_us = std::min(result.min_us, latency_us);
+        result.max_us = std::max(result.max_us, latency_us);
+        total_us += latency_us;
+        vTaskDelay(pdMS_TO_TICKS(SAMPLE_INTERVAL_MS));
+    }
+
+    uart_set_loop_back(UART_NUM, false);
+    loading_.store(false);
+
+    if (result.samples == 0) {
+        result.min_us = 0;
+    } else {
+        result.avg_us = total_us / result.samples;
+    }
+    result.renders = renders_.load();
+    result_ = result;
+    done_.store(true);
+    ESP_LOGW(TAG, "CAT-to-dispatch latency over %lu samples: min %lld us, avg %lld us, max %lld us "
+             "(%lu missed, %lu pages rendered)", static_cast<unsigned long>(result.samples), result.min_us,
+             result.avg_us, result.max_us, static_cast<unsigned long>(result.missed),
+             static_cast<unsigned long>(result.renders));
+    vTaskDelete(nullptr);
+}
+
+void JitterBenchmark::task_trampoline(void *arg) {
+    static_cast<JitterBenchmark *>(arg)->task();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "esp_err.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// On-target measurement of CAT-to-dispatch latency under web load, built in
+// with CONFIG_ANTENNA_SWITCH_JITTER_BENCHMARK. Radio 1's UART is looped back
+// on itself and fed frequency frames alternating between the first two bands,
+// while load tasks render the config page on the web server's core. Latency
+// runs from a frame's last stop bit to RelayDispatcher posting the selection.
+class JitterBenchmark {
+public:
+    struct Result {
+        uint32_t samples;
+        uint32_t missed; // Frames that produced no dispatch within the timeout
+        uint32_t renders; // Config pages rendered by the load tasks meanwhile
+        int64_t min_us;
+        int64_t avg_us;
+        int64_t max_us;
+    };
+
+    static JitterBenchmark &instance();
+
+    // Run once in the background; ESP_ERR_NOT_SUPPORTED unless built in
+    esp_err_t start();
+
+    bool is_done() const { return done_.load(); }
+
+    Result get_result() const { return result_; }
+
+    // Frame reporting frequency in protocol, as the radio would send it; 0 if buf is too small
+    static size_t frequency_frame(uint8_t protocol, uint32_t frequency, uint8_t *buf, size_t size);
+
+private:
+    static constexpr int LOAD_TASKS = 2;
+    static constexpr int LINK_WAIT_MS = 30000;
+    static constexpr int DISPATCH_TIMEOUT_MS = 200;
+    static constexpr int SAMPLE_INTERVAL_MS = 20;
+
+    JitterBenchmark() = default;
+
+    void task();
+
+    static void task_trampoline(void *arg);
+
+    static void load_task(void *arg);
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> done_{false};
+    std::atomic<bool> loading_{false};
+    std::atomic<uint32_t> renders_{0};
+    Result result_{};
+};
@@ -0,0 +1,187 @@
+#include "kc868_backend.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+static auto TAG = "KC868_BACKEND";
+
+static constexpr auto OK_RESPONSE = ",OK";
+static constexpr int SET_ALL_TIMEOUT_MS = 1000;
+static constexpr int STATE_TIMEOUT_MS = 500;
+
+esp_err_t Kc868TextBackend::write_outputs(const RelayMask &mask, RelayMask *confirmed) {
+    char command[ActiveRelayBoard::MAX_COMMAND_LENGTH];
+    if (ActiveRelayBoard::format_set_all(mask, command, sizeof(command)) < 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (const esp_err_t ret = exchange(command, response_, sizeof(response_), SET_ALL_TIMEOUT_MS); ret != ESP_OK) {
+        return ret;
+    }
+
+    // For SET_ALL, we just need OK in the response
+    if (strstr(response_, OK_RESPONSE) == nullptr) {
+        ESP_LOGW(TAG, "SET_ALL command did not receive OK confirmation");
+        return ESP_FAIL;
+    }
+
+    // The board echoes the applied state; fall back to what we asked for if it can't be parsed
+    if (confirmed && ActiveRelayBoard::parse_state(response_, confirmed) != ESP_OK) {
+        *confirmed = mask;
+    }
+    return ESP_OK;
+}
+
+esp_err_t Kc868TextBackend::read_outputs(RelayMask *mask) {
+    if (const esp_err_t ret = exchange(ActiveRelayModel::STATE_CMD, response_, sizeof(response_), STATE_TIMEOUT_MS);
+        ret != ESP_OK) {
+        return ret;
+    }
+    return ActiveRelayBoard::parse_state(response_, mask);
+}
+
+TcpRelayBackend::TcpRelayBackend(std::string host, const uint16_t port)
+    : host_(std::move(host)), port_(port), prev_state_(TCPClient::LinkState::IDLE), last_check_ms_(0),
+      has_verified_state_(false) {
+}
+
+esp_err_t TcpRelayBackend::start() {
+    client_.set_timeouts(5, keepalive_idle_s_, keepalive_interval_s_, keepalive_count_);
+
+    // Connection is established in the background by poll(); relay states are
+    // synchronised from the verification response once the link is up
+    return client_.init(host_.c_str(), port_);
+}
+
+RelayLinkState TcpRelayBackend::poll(const int timeout_ms) {
+    const TCPClient::LinkState state = client_.poll(timeout_ms);
+
+    if (state == TCPClient::LinkState::READY) {
+        if (prev_state_ != TCPClient::LinkState::READY) {
+            // The verification probe already returned the board's relay state
+            has_verified_state_ =
+                    ActiveRelayBoard::parse_state(client_.get_verify_response(), &verified_state_) == ESP_OK;
+        }
+
+        // Cheap socket error check; a failure moves the link into backoff on the next poll
+        if (const int64_t now_ms = esp_timer_get_time() / 1000;
+            now_ms - last_check_ms_ >= CONNECTION_CHECK_INTERVAL_MS) {
+            client_.check_connection_status();
+            last_check_ms_ = now_ms;
+        }
+    }
+    prev_state_ = state;
+
+    switch (state) {
+        case TCPClient::LinkState::READY:
+            return RelayLinkState::READY;
+        case TCPClient::LinkState::CONNECTING:
+        case TCPClient::LinkState::VERIFYING:
+            return RelayLinkState::CONNECTING;
+        default:
+            return RelayLinkState::DOWN;
+    }
+}
+
+esp_err_t TcpRelayBackend::read_outputs(RelayMask *mask) {
+    if (has_verified_state_) {
+        has_verified_state_ = false;
+        *mask = verified_state_;
+        return ESP_OK;
+    }
+    return Kc868TextBackend::read_outputs(mask);
+}
+
+esp_err_t TcpRelayBackend::set_endpoint(const std::string &host, const uint16_t port) {
+    // Reconnection happens on the polling task; pending band changes are applied once the link is up
+    client_.request_reconnect(host, port);
+    return ESP_OK;
+}
+
+void TcpRelayBackend::set_keepalive(const int idle_s, const int interval_s, const int count) {
+    keepalive_idle_s_ = idle_s;
+    keepalive_interval_s_ = interval_s;
+    keepalive_count_ = count;
+}
+
+void TcpRelayBackend::recover() {
+    ESP_LOGW(TAG, "Relay board not responding, forcing reconnection");
+    reconnect();
+}
+
+void TcpRelayBackend::reconnect() {
+    client_.request_reconnect();
+}
+
+void TcpRelayBackend::log_stats() const {
+    ESP_LOGI(TAG, "TCP: link %s, standby %s, %lu failovers",
+             TCPClient::link_state_name(client_.get_link_state()),
+             TCPClient::link_state_name(client_.get_standby_state()),
+             static_cast<unsigned long>(client_.get_failover_count()));
+}
+
+esp_err_t TcpRelayBackend::exchange(const char *command, char *response, const size_t response_size,
+                                    const int timeout_ms) {
+    // Fail fast while the link is (re)connecting; the caller holds the request until it is ready
+    if (const esp_err_t status = client_.ensure_connected(); status != ESP_OK) {
+        ESP_LOGW(TAG, "Link %s, not sending: %s", TCPClient::link_state_name(client_.get_link_state()), command);
+        return status;
+    }
+
+    // Prepare command buffer with newline
+    char cmd_buffer[128];
+    const size_t cmd_len = std::min(strlen(command), sizeof(cmd_buffer) - 2);
+    memcpy(cmd_buffer, command, cmd_len);
+    cmd_buffer[cmd_len] = '\n';
+    cmd_buffer[cmd_len + 1] = '\0';
+
+    if (const esp_err_t status = client_.send_message(cmd_buffer); status != ESP_OK) {
+        ESP_LOGW(TAG, "Send failed: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    if (const esp_err_t status = client_.receive_message(response, response_size, timeout_ms); status != ESP_OK) {
+        ESP_LOGW(TAG, "Receive failed: %s", esp_err_to_name(status));
+        return status;
+    }
+    return ESP_OK;
+}
+
+UdpRelayBackend::UdpRelayBackend(std::string host, const uint16_t port) : host_(std::move(host)), port_(port) {
+}
+
+esp_err_t UdpRelayBackend::start() {
+    return client_.init(host_.c_str(), port_);
+}
+
+RelayLinkState UdpRelayBackend::poll(int) {
+    // Connectionless: usable as soon as the socket exists
+    return client_.get_sock() >= 0 ? RelayLinkState::READY : RelayLinkState::DOWN;
+}
+
+esp_err_t UdpRelayBackend::set_endpoint(const std::string &host, const uint16_t port) {
+    host_ = host;
+    port_ = port;
+    return client_.init(host_.c_str(), port_);
+}
+
+void UdpRelayBackend::log_stats() const {
+    const auto &stats = client_.get_stats();
+    ESP_LOGI(TAG, "UDP: %lu requests, %lu retransmits, %lu stale dropped, %lu failures, srtt %lu us",
+             static_cast<unsigned long>(stats.requests), static_cast<unsigned long>(stats.retransmits),
+             static_cast<unsigned long>(stats.stale_dropped), static_cast<unsigned long>(stats.failures),
+             static_cast<unsigned long>(stats.srtt_us));
+}
+
+esp_err_t UdpRelayBackend::exchange(const char *command, char *response, const size_t response_size,
+                                    const int timeout_ms) {
+    // One datagram per command; retransmission and reply matching happen in UDPClient
+    if (const esp_err_t status = client_.request(command, response, response_size, timeout_ms); status != ESP_OK) {
+        ESP_LOGW(TAG, "UDP request failed: %s", esp_err_to_name(status));
+        return status;
+    }
+    return ESP_OK;
+}
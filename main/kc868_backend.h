@@ -0,0 +1,87 @@
+#pragma once
+
+#include "relay_backend.h"
+#include "tcp_client.h"
+#include "udp_client.h"
+
+// KC868 text protocol (RELAY-SET_ALL-255,dN,...,d0 / RELAY-STATE-255), shared by the network transports
+class Kc868TextBackend : public RelayBackend {
+public:
+    esp_err_t write_outputs(const RelayMask &mask, RelayMask *confirmed) override;
+
+    esp_err_t read_outputs(RelayMask *mask) override;
+
+protected:
+    static constexpr size_t RESPONSE_BUFFER_SIZE = 256;
+
+    // Send one command and collect the board's reply
+    virtual esp_err_t exchange(const char *command, char *response, size_t response_size, int timeout_ms) = 0;
+
+    char response_[RESPONSE_BUFFER_SIZE]{};
+};
+
+class TcpRelayBackend final : public Kc868TextBackend {
+public:
+    TcpRelayBackend(std::string host, uint16_t port);
+
+    const char *name() const override { return "TCP"; }
+
+    esp_err_t start() override;
+
+    RelayLinkState poll(int timeout_ms) override;
+
+    esp_err_t read_outputs(RelayMask *mask) override;
+
+    esp_err_t set_endpoint(const std::string &host, uint16_t port) override;
+
+    void set_keepalive(int idle_s, int interval_s, int count) override;
+
+    void recover() override;
+
+    void reconnect() override;
+
+    void log_stats() const override;
+
+protected:
+    esp_err_t exchange(const char *command, char *response, size_t response_size, int timeout_ms) override;
+
+private:
+    TCPClient client_;
+    // Endpoint for start() only; the client owns it from there, set_endpoint() included
+    const std::string host_;
+    const uint16_t port_;
+    // Lenient keepalive by default: start probing after 20 s idle, 5 probes 5 s apart
+    int keepalive_idle_s_{20};
+    int keepalive_interval_s_{5};
+    int keepalive_count_{5};
+    TCPClient::LinkState prev_state_;
+    int64_t last_check_ms_;
+    // State reported by the verification probe, served to the first read after link-up
+    RelayMask verified_state_;
+    bool has_verified_state_;
+
+    static constexpr int CONNECTION_CHECK_INTERVAL_MS = 5000;
+};
+
+class UdpRelayBackend final : public Kc868TextBackend {
+public:
+    UdpRelayBackend(std::string host, uint16_t port);
+
+    const char *name() const override { return "UDP"; }
+
+    esp_err_t start() override;
+
+    RelayLinkState poll(int timeout_ms) override;
+
+    esp_err_t set_endpoint(const std::string &host, uint16_t port) override;
+
+    void log_stats() const override;
+
+protected:
+    esp_err_t exchange(const char *command, char *response, size_t response_size, int timeout_ms) override;
+
+private:
+    UDPClient client_;
+    std::string host_;
+    uint16_t port_;
+};
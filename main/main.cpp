@@ -10,6 +10,7 @@
 #include "restart_manager.h"
 #include "system_initializer.h"
 #include "relay_controller.h"
+#include "alloc_tracker.h"
 #include "wifi_manager.hpp"
 
 #define UART_NUM UART_NUM_2
@@ -42,48 +43,28 @@ extern "C" [[noreturn]] void app_main(void) {
         goto error_handler;
     }
 
-    if (!WifiManager::instance().is_connected()) {
-        // Only wait for WiFi if we're not in SmartConfig mode
-        if (!WifiManager::instance().is_in_smartconfig_mode()) {
-            int elapsed_ms = 0;
-            ESP_LOGI(TAG, "Waiting for WiFi connection...");
-
-            while (elapsed_ms < MAX_WIFI_WAIT_MS) {
-                constexpr int WIFI_CONNECT_CHECK_INTERVAL_MS = 100;
-                if (WifiManager::instance().is_connected()) {
-                    ESP_LOGI(TAG, "WiFi connected successfully");
-                    break;
-                }
-
-                if (elapsed_ms % 1000 == 0) {
-                    // Log only every second
-                    ESP_LOGI(TAG, "Waiting for WiFi configuration... (%d/%d)",
-                             elapsed_ms/1000 + 1, MAX_WIFI_WAIT_SECONDS);
-                }
-
-                vTaskDelay(pdMS_TO_TICKS(WIFI_CONNECT_CHECK_INTERVAL_MS));
-                elapsed_ms += WIFI_CONNECT_CHECK_INTERVAL_MS;
-            }
-
-            if (!WifiManager::instance().is_connected()) {
-                ESP_LOGE(TAG, "Failed to connect to WiFi within timeout period");
-                ret = ESP_ERR_TIMEOUT;
-                goto error_handler;
-            }
-        } else {
-            ESP_LOGI(TAG, "System is in SmartConfig mode, waiting for configuration");
-            // Don't treat SmartConfig mode as an error, go directly to SmartConfig handling
-            goto smartconfig_handler;
-        }
+    if (!WifiManager::instance().is_connected() && WifiManager::instance().is_in_smartconfig_mode()) {
+        ESP_LOGI(TAG, "System is in SmartConfig mode, waiting for configuration");
+        // Don't treat SmartConfig mode as an error, go directly to SmartConfig handling
+        goto smartconfig_handler;
     }
 
-    // Only proceed with full initialization after WiFi is connected
-    ESP_LOGI(TAG, "WiFi connected, initializing full system...");
+    // CAT decoding and relay dispatch come up while WiFi is still connecting
+    ESP_LOGI(TAG, "Initializing full system...");
     ret = SystemInitializer::initialize_full(&relay_controller);
     if (ret != ESP_OK) {
         goto error_handler;
     }
 
+    ret = SystemInitializer::initialize_network(MAX_WIFI_WAIT_MS);
+    if (ret == ESP_ERR_TIMEOUT) {
+        // CAT decoding and the RS485 link work without it; the connectivity task starts
+        // the web server, relay link and network services once there is an address
+        ESP_LOGW(TAG, "No network yet, continuing without it");
+    } else if (ret != ESP_OK) {
+        goto error_handler;
+    }
+
     g_relay_controller = relay_controller;
     ESP_LOGI(TAG, "Antenna Switch Controller initialized successfully");
 
@@ -102,6 +83,8 @@ extern "C" [[noreturn]] void app_main(void) {
             esp_task_wdt_add(xTaskGetCurrentTaskHandle());
         }
         
+        AllocTracker::check();
+
         // Increased delay to reduce system load
         vTaskDelay(pdMS_TO_TICKS(500));
     }
@@ -133,12 +116,10 @@ error_handler:
     ESP_LOGE(TAG, "Fatal error occurred: %s", esp_err_to_name(ret));
     RestartManager::store_error_state(ret);
 
-    // Clean up all resources
-    if (relay_controller) {
-        delete relay_controller;
-        relay_controller = nullptr;
-        g_relay_controller = nullptr;
-    }
+    // The relay controller belongs to antenna_switch, and CAT and dispatch may already be using it;
+    // the restart below releases it
+    relay_controller = nullptr;
+    g_relay_controller = nullptr;
 
     // Check if we've exceeded max restart attempts
     if (RestartManager::check_restart_count() == ESP_FAIL) {
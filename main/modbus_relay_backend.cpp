@@ -0,0 +1,236 @@
+#include "modbus_relay_backend.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+
+static auto TAG = "MODBUS_BACKEND";
+
+// Modbus-RTU frames are 11 bits per character (start, 8 data, parity or 2nd stop, stop)
+static constexpr uint32_t BITS_PER_CHAR = 11;
+// Above 19200 baud the spec fixes t3.5 at 1.75 ms instead of scaling it
+static constexpr int FIXED_TIMING_BAUD = 19200;
+static constexpr uint32_t FIXED_T35_US = 1750;
+static constexpr size_t EXCEPTION_FRAME_SIZE = 5;
+static constexpr int RX_BUFFER_SIZE = 256;
+
+ModbusRelayBackend::ModbusRelayBackend(const uint8_t address, const int baud_rate)
+    : address_(address == 0 ? MODBUS_DEFAULT_ADDRESS : address),
+      baud_rate_(baud_rate <= 0 ? RS485_DEFAULT_BAUD_RATE : baud_rate), installed_(false), last_activity_us_(0) {
+    const uint32_t char_us = BITS_PER_CHAR * 1000000UL / baud_rate_;
+    t35_us_ = baud_rate_ > FIXED_TIMING_BAUD ? FIXED_T35_US : (char_us * 7 + 1) / 2;
+}
+
+ModbusRelayBackend::~ModbusRelayBackend() {
+    if (installed_) {
+        uart_driver_delete(RS485_UART_NUM);
+    }
+}
+
+esp_err_t ModbusRelayBackend::start() {
+    if (installed_) {
+        return ESP_OK;
+    }
+
+    const uart_config_t uart_config = {
+        .baud_rate = baud_rate_,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_2, // No parity: two stop bits keep the 11-bit character
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_APB,
+    };
+
+    esp_err_t ret = uart_driver_install(RS485_UART_NUM, RX_BUFFER_SIZE, 0, 0, nullptr, 0);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to install UART driver: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    installed_ = true;
+
+    if ((ret = uart_param_config(RS485_UART_NUM, &uart_config)) != ESP_OK ||
+        (ret = uart_set_pin(RS485_UART_NUM, RS485_TX_PIN, RS485_RX_PIN, RS485_DE_PIN, UART_PIN_NO_CHANGE)) != ESP_OK ||
+        // Hardware toggles DE around each transmission, so turnaround doesn't depend on task scheduling
+        (ret = uart_set_mode(RS485_UART_NUM, UART_MODE_RS485_HALF_DUPLEX)) != ESP_OK ||
+        // Flush the RX FIFO after ~t3.5 of silence so a complete frame is delivered at once
+        (ret = uart_set_rx_timeout(RS485_UART_NUM, 4)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure RS485 UART: %s", esp_err_to_name(ret));
+        uart_driver_delete(RS485_UART_NUM);
+        installed_ = false;
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Modbus-RTU on UART%d at %d baud, slave %d, t3.5=%lu us",
+             RS485_UART_NUM, baud_rate_, address_, static_cast<unsigned long>(t35_us_));
+    return ESP_OK;
+}
+
+RelayLinkState ModbusRelayBackend::poll(const int timeout_ms) {
+    // No link to maintain; a dead bus shows up as command timeouts
+    return installed_ ? RelayLinkState::READY : RelayLinkState::DOWN;
+}
+
+esp_err_t ModbusRelayBackend::write_outputs(const RelayMask &mask, RelayMask *confirmed) {
+    uint8_t request[7 + NUM_COIL_BYTES + 2] = {
+        address_, FC_WRITE_MULTIPLE_COILS,
+        0x00, 0x00, // Starting coil
+        0x00, NUM_COILS, // Quantity
+        NUM_COIL_BYTES, // Byte count
+    };
+    // Coils are packed LSB first: byte 0 holds coils 0-7 (relays 1-8)
+    ActiveRelayBoard::to_bytes(mask, &request[7]);
+    uint8_t response[8];
+
+    if (const esp_err_t ret = transact(request, sizeof(request), response, sizeof(response)); ret != ESP_OK) {
+        return ret;
+    }
+
+    // The reply echoes start and quantity only
+    if (response[2] != 0x00 || response[3] != 0x00 || response[4] != 0x00 || response[5] != NUM_COILS) {
+        ESP_LOGW(TAG, "Unexpected write coils echo");
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (confirmed) {
+        *confirmed = mask;
+    }
+    return ESP_OK;
+}
+
+esp_err_t ModbusRelayBackend::read_outputs(RelayMask *mask) {
+    uint8_t request[8] = {address_, FC_READ_COILS, 0x00, 0x00, 0x00, NUM_COILS};
+    uint8_t response[3 + NUM_COIL_BYTES + 2];
+
+    if (const esp_err_t ret = transact(request, sizeof(request), response, sizeof(response)); ret != ESP_OK) {
+        return ret;
+    }
+
+    if (response[2] != NUM_COIL_BYTES) {
+        ESP_LOGW(TAG, "Unexpected read coils byte count: %d", response[2]);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    *mask = ActiveRelayBoard::from_bytes(&response[3]);
+    return ESP_OK;
+}
+
+void ModbusRelayBackend::recover() {
+    if (installed_) {
+        uart_flush_input(RS485_UART_NUM);
+    }
+}
+
+void ModbusRelayBackend::log_stats() const {
+    ESP_LOGI(TAG, "RS485: %lu requests, %lu retries, %lu timeouts, %lu CRC errors, %lu exceptions",
+             static_cast<unsigned long>(stats_.requests), static_cast<unsigned long>(stats_.retries),
+             static_cast<unsigned long>(stats_.timeouts), static_cast<unsigned long>(stats_.crc_errors),
+             static_cast<unsigned long>(stats_.exceptions));
+}
+
+uint16_t ModbusRelayBackend::crc16(const uint8_t *data, const size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+esp_err_t ModbusRelayBackend::transact(uint8_t *request, const size_t request_len, uint8_t *response,
+                                       const size_t expected_len) {
+    if (!installed_) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // CRC goes low byte first
+    const uint16_t crc = crc16(request, request_len - 2);
+    request[request_len - 2] = crc & 0xff;
+    request[request_len - 1] = crc >> 8;
+
+    stats_.requests++;
+    esp_err_t ret = ESP_FAIL;
+    for (int attempt = 0; attempt <= MAX_RETRIES; attempt++) {
+        if (attempt > 0) {
+            stats_.retries++;
+        }
+        ret = transact_once(request, request_len, response, expected_len);
+        // Exceptions are definitive answers; retrying won't change them
+        if (ret == ESP_OK || ret == ESP_ERR_NOT_SUPPORTED) {
+            break;
+        }
+    }
+    return ret;
+}
+
+esp_err_t ModbusRelayBackend::transact_once(const uint8_t *request, const size_t request_len, uint8_t *response,
+                                            const size_t expected_len) {
+    wait_bus_idle();
+
+    // Anything buffered now is a late reply to an earlier request
+    uart_flush_input(RS485_UART_NUM);
+
+    if (uart_write_bytes(RS485_UART_NUM, request, request_len) != static_cast<int>(request_len)) {
+        return ESP_FAIL;
+    }
+    // Returns once the last stop bit has left the shift register and DE has dropped
+    if (const esp_err_t ret = uart_wait_tx_done(RS485_UART_NUM, pdMS_TO_TICKS(RESPONSE_TIMEOUT_MS)); ret != ESP_OK) {
+        return ret;
+    }
+    last_activity_us_ = esp_timer_get_time();
+
+    // Read the fixed header first so an exception reply doesn't wait out the full timeout
+    size_t got = 0;
+    const int64_t deadline_us = last_activity_us_ + RESPONSE_TIMEOUT_MS * 1000LL;
+    size_t want = EXCEPTION_FRAME_SIZE;
+    while (got < want) {
+        const int64_t remaining_us = deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0) {
+            break;
+        }
+        const int n = uart_read_bytes(RS485_UART_NUM, response + got, want - got,
+                                      pdMS_TO_TICKS(remaining_us / 1000 + 1));
+        if (n < 0) {
+            return ESP_FAIL;
+        }
+        got += n;
+        if (got >= 2 && want == EXCEPTION_FRAME_SIZE && !(response[1] & 0x80)) {
+            want = expected_len;
+        }
+    }
+    last_activity_us_ = esp_timer_get_time();
+
+    if (got < want) {
+        stats_.timeouts++;
+        ESP_LOGW(TAG, "Response timeout (%u of %u bytes)", static_cast<unsigned>(got), static_cast<unsigned>(want));
+        return ESP_ERR_TIMEOUT;
+    }
+
+    const uint16_t crc = response[got - 2] | (response[got - 1] << 8);
+    if (crc16(response, got - 2) != crc) {
+        stats_.crc_errors++;
+        ESP_LOGW(TAG, "CRC mismatch in response");
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    if (response[0] != address_ || (response[1] & 0x7f) != request[1]) {
+        ESP_LOGW(TAG, "Reply from slave %d fn 0x%02x does not match request", response[0], response[1]);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (response[1] & 0x80) {
+        stats_.exceptions++;
+        ESP_LOGE(TAG, "Slave %d exception 0x%02x for function 0x%02x", address_, response[2], request[1]);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    return ESP_OK;
+}
+
+void ModbusRelayBackend::wait_bus_idle() const {
+    // Slaves only recognise a new frame after t3.5 of silence
+    if (const int64_t idle_us = esp_timer_get_time() - last_activity_us_; idle_us < t35_us_) {
+        esp_rom_delay_us(t35_us_ - idle_us);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "relay_backend.h"
+#include "driver/uart.h"
+
+// RS485 transceiver on the spare UART; DE/RE is driven by the UART's RTS line
+#define RS485_UART_NUM UART_NUM_1
+#define RS485_TX_PIN 26
+#define RS485_RX_PIN 25
+#define RS485_DE_PIN 27
+#define RS485_DEFAULT_BAUD_RATE 9600
+#define MODBUS_DEFAULT_ADDRESS 1
+
+// Modbus-RTU master driving the relay outputs as coils 0..N-1
+// (function 0x0F to write, 0x01 to read back)
+class ModbusRelayBackend final : public RelayBackend {
+public:
+    struct Stats {
+        uint32_t requests;
+        uint32_t retries;
+        uint32_t timeouts;
+        uint32_t crc_errors;
+        uint32_t exceptions;
+    };
+
+    ModbusRelayBackend(uint8_t address, int baud_rate);
+
+    ~ModbusRelayBackend() override;
+
+    const char *name() const override { return "RS485"; }
+
+    esp_err_t start() override;
+
+    RelayLinkState poll(int timeout_ms) override;
+
+    esp_err_t write_outputs(const RelayMask &mask, RelayMask *confirmed) override;
+
+    esp_err_t read_outputs(RelayMask *mask) override;
+
+    void recover() override;
+
+    void log_stats() const override;
+
+    const Stats &get_stats() const { return stats_; }
+
+    static uint16_t crc16(const uint8_t *data, size_t len);
+
+private:
+    static constexpr uint8_t FC_READ_COILS = 0x01;
+    static constexpr uint8_t FC_WRITE_MULTIPLE_COILS = 0x0F;
+    static constexpr uint8_t NUM_COILS = ActiveRelayBoard::NUM_OUTPUTS;
+    static constexpr uint8_t NUM_COIL_BYTES = ActiveRelayBoard::NUM_DATA_BYTES;
+    static constexpr int RESPONSE_TIMEOUT_MS = 100;
+    static constexpr int MAX_RETRIES = 2;
+
+    uint8_t address_;
+    int baud_rate_;
+    bool installed_;
+    uint32_t t35_us_; // Inter-frame silence (3.5 character times)
+    int64_t last_activity_us_; // End of the last frame seen on the bus
+    Stats stats_{};
+
+    // Send one request and read a reply of expected_len bytes (or a 5-byte exception)
+    esp_err_t transact(uint8_t *request, size_t request_len, uint8_t *response, size_t expected_len);
+
+    esp_err_t transact_once(const uint8_t *request, size_t request_len, uint8_t *response, size_t expected_len);
+
+    void wait_bus_idle() const;
+};
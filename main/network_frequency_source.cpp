@@ -0,0 +1,344 @@
+#include "network_frequency_source.h"
+#include "antenna_switch.h"
+#include "config_manager.h"
+#include "frequency_arbiter.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "task_layout.h"
+#include <arpa/inet.h>
+#include <algorithm>
+#include <cstring>
+
+static auto TAG = "NET_FREQ";
+
+NetworkFrequencySource &NetworkFrequencySource::instance() {
+    static NetworkFrequencySource source;
+    return source;
+}
+
+esp_err_t NetworkFrequencySource::start() {
+    if (running_.load()) {
+        return ESP_OK;
+    }
+    antenna_switch_config_t config;
+    if (const esp_err_t ret = antenna_switch_get_config(&config); ret != ESP_OK) {
+        return ret;
+    }
+    udp_port_ = config.n1mm_udp_port;
+    memcpy(host_, config.rigctld_host, sizeof(host_));
+    host_[sizeof(host_) - 1] = '\0';
+    rigctld_port_ = config.rigctld_port != 0 ? config.rigctld_port : RIGCTLD_DEFAULT_PORT;
+
+    if (udp_port_ == 0 && host_[0] == '\0') {
+        ESP_LOGD(TAG, "No network frequency source configured");
+        return ESP_OK;
+    }
+
+    running_.store(true);
+    if (task_.create(task_trampoline, "net_freq", this, TASK_PRIORITY_NETWORK_SERVICES, TASK_CORE_NETWORK) != pdPASS) {
+        running_.store(false);
+        ESP_LOGE(TAG, "Failed to create network frequency task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+bool NetworkFrequencySource::xml_field(const std::string_view xml, const std::string_view tag,
+                                       std::string_view *value) {
+    // <tag>value</tag>; tags are short, so both fit in small stack buffers
+    char open[32];
+    char close[33];
+    if (tag.length() + 3 > sizeof(open)) {
+        return false;
+    }
+    const int open_len = snprintf(open, sizeof(open), "<%.*s>", static_cast<int>(tag.length()), tag.data());
+    const int close_len = snprintf(close, sizeof(close), "</%.*s>", static_cast<int>(tag.length()), tag.data());
+
+    const size_t start = xml.find(std::string_view(open, open_len));
+    if (start == std::string_view::npos) {
+        return false;
+    }
+    const size_t value_start = start + open_len;
+    const size_t end = xml.find(std::string_view(close, close_len), value_start);
+    if (end == std::string_view::npos) {
+        return false;
+    }
+    *value = xml.substr(value_start, end - value_start);
+    return true;
+}
+
+// Leading decimal digits; false if there are none or they overflow
+static bool parse_decimal(const std::string_view text, uint64_t *value) {
+    uint64_t result = 0;
+    size_t digits = 0;
+    for (const char c: text) {
+        if (c < '0' || c > '9') {
+            break;
+        }
+        result = result * 10 + (c - '0');
+        if (++digits > 12) {
+            return false;
+        }
+    }
+    *value = result;
+    return digits > 0;
+}
+
+// Map a logger's mode name onto a static string, as CatUpdate requires
+static const char *network_mode(const std::string_view mode) {
+    static constexpr const char *MODES[] = {"LSB", "USB", "CW", "CWR", "AM", "FM", "RTTY", "PSK", "FT8", "FT4", "DIGI"};
+    for (const char *known: MODES) {
+        if (mode == known) {
+            return known;
+        }
+    }
+    return "UNKNOWN";
+}
+
+bool NetworkFrequencySource::parse_radio_info(const std::string_view xml, int *radio, CatUpdate *update) {
+    if (xml.find("<RadioInfo>") == std::string_view::npos) {
+        return false;
+    }
+
+    std::string_view field;
+    uint64_t value;
+    // RadioNr is 1-based; Freq is in units of 10 Hz
+    if (!xml_field(xml, "RadioNr", &field) || !parse_decimal(field, &value) || value < 1 || value > MAX_RADIOS) {
+        return false;
+    }
+    *radio = static_cast<int>(value) - 1;
+    if (!xml_field(xml, "Freq", &field) || !parse_decimal(field, &value) || value * 10 > UINT32_MAX) {
+        return false;
+    }
+    update->frequency = static_cast<uint32_t>(value * 10);
+
+    if (xml_field(xml, "IsTransmitting", &field)) {
+        update->transmitting = field == "True" ? 1 : 0;
+    }
+    if (xml_field(xml, "Mode", &field)) {
+        update->mode = network_mode(field);
+    }
+    return true;
+}
+
+bool NetworkFrequencySource::parse_rigctld_frequency(const std::string_view reply, uint32_t *frequency) {
+    // "14074000\n", older builds add ".000000"; errors come back as "RPRT -n"
+    uint64_t value;
+    if (!parse_decimal(reply, &value) || value == 0 || value > UINT32_MAX) {
+        return false;
+    }
+    *frequency = static_cast<uint32_t>(value);
+    return true;
+}
+
+void NetworkFrequencySource::apply(const int radio, const CatUpdate &update) {
+    // A second radio only exists in SO2R setups
+    if (radio < 0 || radio >= MAX_RADIOS || (radio > 0 && radio >= ConfigManager::instance().get_config().num_radios)) {
+        return;
+    }
+    RadioSlot &slot = radios_[radio];
+    if (update.transmitting >= 0) {
+        // Keeps the other radio from taking this one's antenna mid-transmission
+        if (const bool transmitting = update.transmitting != 0; slot.transmitting.exchange(transmitting) != transmitting) {
+            antenna_switch_set_radio_transmitting(radio, transmitting);
+        }
+    }
+    if (update.mode != nullptr) {
+        slot.mode.store(update.mode);
+    }
+    if (update.frequency == 0) {
+        return;
+    }
+    slot.frequency.store(update.frequency);
+    // The arbiter decides whether this or the CAT cable switches the antennas
+    if (const esp_err_t ret = antenna_switch_report_frequency(radio, FREQ_SOURCE_NETWORK, update.frequency);
+        ret != ESP_OK) {
+        ESP_LOGW(TAG, "Radio %d: failed to report frequency: %s", radio + 1, esp_err_to_name(ret));
+    }
+}
+
+NetworkFrequencySource::RadioState NetworkFrequencySource::get_radio_state(const int radio) const {
+    if (radio < 0 || radio >= MAX_RADIOS) {
+        return {0, false, ""};
+    }
+    const RadioSlot &slot = radios_[radio];
+    return {slot.frequency.load(), slot.transmitting.load(), slot.mode.load()};
+}
+
+int NetworkFrequencySource::open_udp(const uint16_t port) const {
+    const int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create UDP socket: errno %d", errno);
+        return -1;
+    }
+    // N1MM broadcasts; several listeners on one host share the port
+    constexpr int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "Unable to bind UDP port %u: errno %d", port, errno);
+        ::close(sock);
+        return -1;
+    }
+    ESP_LOGI(TAG, "Listening for RadioInfo on UDP port %u", port);
+    return sock;
+}
+
+int NetworkFrequencySource::connect_rigctld() const {
+    const int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        return -1;
+    }
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(host_);
+    addr.sin_port = htons(rigctld_port_);
+
+    // Connect without blocking the UDP listener for longer than the timeout
+    const int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    if (connect(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 && errno != EINPROGRESS) {
+        ::close(sock);
+        return -1;
+    }
+    fd_set writefds;
+    FD_ZERO(&writefds);
+    FD_SET(sock, &writefds);
+    timeval tv{};
+    tv.tv_usec = RIGCTLD_TIMEOUT_MS * 1000;
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (select(sock + 1, nullptr, &writefds, nullptr, &tv) <= 0 ||
+        getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+        ::close(sock);
+        return -1;
+    }
+    fcntl(sock, F_SETFL, flags);
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    // Polls are tiny; don't let Nagle hold them back
+    constexpr int no_delay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    ESP_LOGI(TAG, "Connected to rigctld at %s:%u", host_, rigctld_port_);
+    return sock;
+}
+
+bool NetworkFrequencySource::rigctld_query(const char *command, char *reply, const size_t reply_size) {
+    if (send(rigctld_sock_, command, strlen(command), 0) < 0) {
+        return false;
+    }
+    // Replies are a single line; read until the newline
+    size_t received = 0;
+    while (received < reply_size - 1) {
+        const int len = recv(rigctld_sock_, reply + received, reply_size - 1 - received, 0);
+        if (len <= 0) {
+            return false;
+        }
+        received += len;
+        if (memchr(reply, '\n', received) != nullptr) {
+            reply[received] = '\0';
+            return true;
+        }
+    }
+    return false;
+}
+
+void NetworkFrequencySource::poll_rigctld() {
+    const int64_t now_us = esp_timer_get_time();
+    if (now_us < next_rigctld_us_) {
+        return;
+    }
+    if (rigctld_sock_ < 0) {
+        rigctld_sock_ = connect_rigctld();
+        if (rigctld_sock_ < 0) {
+            ESP_LOGD(TAG, "rigctld at %s:%u unreachable, retrying in %d ms", host_, rigctld_port_, RIGCTLD_RETRY_MS);
+            next_rigctld_us_ = now_us + RIGCTLD_RETRY_MS * 1000LL;
+            return;
+        }
+    }
+    next_rigctld_us_ = now_us + RIGCTLD_POLL_MS * 1000LL;
+    stats_.rigctld_polls++;
+
+    char reply[32];
+    CatUpdate update;
+    if (!rigctld_query("f\n", reply, sizeof(reply)) || !parse_rigctld_frequency(reply, &update.frequency)) {
+        stats_.rigctld_errors++;
+        ESP_LOGW(TAG, "rigctld poll failed, reconnecting");
+        ::close(rigctld_sock_);
+        rigctld_sock_ = -1;
+        return;
+    }
+    // PTT is optional: rigs without CAT PTT answer with an error
+    if (rigctld_query("t\n", reply, sizeof(reply)) && (reply[0] == '0' || reply[0] == '1')) {
+        update.transmitting = reply[0] == '1' ? 1 : 0;
+    }
+    apply(0, update);
+}
+
+void NetworkFrequencySource::task() {
+    const int udp_sock = udp_port_ != 0 ? open_udp(udp_port_) : -1;
+    const bool use_rigctld = host_[0] != '\0';
+
+    while (running_.load()) {
+        if (use_rigctld) {
+            poll_rigctld();
+        }
+
+        // Sleep on the UDP socket until the next rigctld poll is due
+        const int64_t wait_us = use_rigctld
+                                    ? std::max<int64_t>(next_rigctld_us_ - esp_timer_get_time(), 1000)
+                                    : RIGCTLD_RETRY_MS * 1000LL;
+        if (udp_sock < 0) {
+            vTaskDelay(pdMS_TO_TICKS(wait_us / 1000));
+            continue;
+        }
+
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(udp_sock, &readfds);
+        timeval tv{};
+        tv.tv_sec = static_cast<time_t>(wait_us / 1000000);
+        tv.tv_usec = static_cast<suseconds_t>(wait_us % 1000000);
+        if (select(udp_sock + 1, &readfds, nullptr, nullptr, &tv) <= 0) {
+            continue;
+        }
+
+        const int len = recvfrom(udp_sock, datagram_, sizeof(datagram_), 0, nullptr, nullptr);
+        if (len <= 0) {
+            continue;
+        }
+        stats_.datagrams++;
+
+        // N1MM also sends contact and spot datagrams on the same port; only RadioInfo matters
+        int radio;
+        CatUpdate update;
+        const std::string_view xml(datagram_, len);
+        if (parse_radio_info(xml, &radio, &update)) {
+            stats_.radio_infos++;
+            apply(radio, update);
+        } else if (xml.find("<RadioInfo>") != std::string_view::npos) {
+            stats_.malformed++;
+            ESP_LOGD(TAG, "Malformed RadioInfo datagram (%d bytes)", len);
+        }
+    }
+
+    if (udp_sock >= 0) {
+        ::close(udp_sock);
+    }
+    if (rigctld_sock_ >= 0) {
+        ::close(rigctld_sock_);
+        rigctld_sock_ = -1;
+    }
+    vTaskDelete(nullptr);
+}
+
+void NetworkFrequencySource::task_trampoline(void *arg) {
+    static_cast<NetworkFrequencySource *>(arg)->task();
+}
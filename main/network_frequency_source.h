@@ -0,0 +1,98 @@
+#pragma once
+
+#include "esp_err.h"
+#include "static_task.h"
+#include "cat_decoder.h"
+#include "antenna_switch.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string_view>
+
+#define N1MM_DEFAULT_UDP_PORT 12060
+#define RIGCTLD_DEFAULT_PORT 4532
+
+// Follows radios over the network instead of a CAT cable: RadioInfo datagrams
+// broadcast by N1MM+ / DXLog, and a rigctld polled over TCP. Frequencies go to
+// the frequency arbiter as FREQ_SOURCE_NETWORK, next to the CAT cable's; the
+// radio state heard here is kept here, since CatParser belongs to its UART task.
+class NetworkFrequencySource {
+public:
+    struct Stats {
+        uint32_t datagrams;
+        uint32_t radio_infos; // Datagrams that updated a radio
+        uint32_t malformed;
+        uint32_t rigctld_polls;
+        uint32_t rigctld_errors;
+    };
+
+    static NetworkFrequencySource &instance();
+
+    // Start the listener task if either source is configured
+    esp_err_t start();
+
+    bool is_running() const { return running_.load(); }
+
+    Stats get_stats() const { return stats_; }
+
+    // Last state heard over the network for a radio; frequency 0 until then
+    struct RadioState {
+        uint32_t frequency;
+        bool transmitting;
+        const char *mode;
+    };
+
+    RadioState get_radio_state(int radio) const;
+
+    // Parse a RadioInfo datagram without allocating. radio is 0-based; false if it isn't RadioInfo.
+    static bool parse_radio_info(std::string_view xml, int *radio, CatUpdate *update);
+
+    // Text between <tag> and </tag>; false if either is missing
+    static bool xml_field(std::string_view xml, std::string_view tag, std::string_view *value);
+
+    // Reply to rigctld's "f" command: frequency in Hz on one line
+    static bool parse_rigctld_frequency(std::string_view reply, uint32_t *frequency);
+
+private:
+    static constexpr int RIGCTLD_POLL_MS = 200;
+    static constexpr int RIGCTLD_RETRY_MS = 5000;
+    static constexpr int RIGCTLD_TIMEOUT_MS = 500;
+    // RadioInfo is around 700 bytes; anything bigger isn't one
+    static constexpr size_t DATAGRAM_SIZE = 1472;
+
+    NetworkFrequencySource() = default;
+
+    void task();
+
+    static void task_trampoline(void *arg);
+
+    int open_udp(uint16_t port) const;
+
+    // Connect to rigctld; -1 on failure
+    int connect_rigctld() const;
+
+    // Send one command and read its one-line reply
+    bool rigctld_query(const char *command, char *reply, size_t reply_size);
+
+    void poll_rigctld();
+
+    void apply(int radio, const CatUpdate &update);
+
+    // Written by the listener task, read by the web server and rigctl clients
+    struct RadioSlot {
+        std::atomic<uint32_t> frequency{0};
+        std::atomic<bool> transmitting{false};
+        std::atomic<const char *> mode{""};
+    };
+
+    StaticTask<4096> task_;
+    std::atomic<bool> running_{false};
+    char host_[16]{};
+    uint16_t rigctld_port_{0};
+    uint16_t udp_port_{0};
+    int rigctld_sock_{-1};
+    int64_t next_rigctld_us_{0};
+    char datagram_[DATAGRAM_SIZE]{};
+    Stats stats_{};
+    std::array<RadioSlot, MAX_RADIOS> radios_;
+};
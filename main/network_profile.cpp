@@ -0,0 +1,14 @@
+#include "network_profile.h"
+
+static constexpr NetworkProfileSettings PROFILES[NETWORK_PROFILE_COUNT] = {
+    // Modem sleeps between DTIM beacons, so a reply can wait up to one DTIM period at the AP
+    {"balanced", WIFI_PS_MIN_MODEM, 3, 80, 20, 5, 5},
+    // Radio always on: replies are received as soon as the board sends them
+    {"latency", WIFI_PS_NONE, 1, 80, 5, 2, 3},
+    // Wakes every 10 beacons (about 1 s) at reduced power; band switches can take that long
+    {"low_power", WIFI_PS_MAX_MODEM, 10, 52, 60, 10, 3},
+};
+
+const NetworkProfileSettings &NetworkProfile::settings(const uint8_t profile) {
+    return PROFILES[profile < NETWORK_PROFILE_COUNT ? profile : NETWORK_PROFILE_BALANCED];
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "esp_wifi.h"
+#include <cstdint>
+
+// Trade-off between relay command latency and power draw (antenna_switch_config_t::network_profile)
+#define NETWORK_PROFILE_BALANCED 0
+#define NETWORK_PROFILE_LATENCY 1
+#define NETWORK_PROFILE_LOW_POWER 2
+#define NETWORK_PROFILE_COUNT 3
+
+// Radio and TCP settings of one profile. Balanced keeps the ESP-IDF defaults.
+struct NetworkProfileSettings {
+    const char *name;
+    wifi_ps_type_t power_save;
+    uint16_t listen_interval; // Beacon intervals between wakeups in WIFI_PS_MAX_MODEM
+    int8_t max_tx_power; // 0.25 dBm units
+    // Relay link keepalive; shorter finds a dead board sooner, longer lets the modem sleep
+    int keepalive_idle_s;
+    int keepalive_interval_s;
+    int keepalive_count;
+};
+
+class NetworkProfile {
+public:
+    // Settings for profile; unknown profiles get balanced
+    static const NetworkProfileSettings &settings(uint8_t profile);
+
+    static const char *name(uint8_t profile) { return settings(profile).name; }
+};
@@ -0,0 +1,218 @@
+#include "perf_monitor.h"
+#include "cat_parser.h"
+#include "config_manager.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "task_layout.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+
+static auto TAG = "PERF_MONITOR";
+
+PerfMonitor &PerfMonitor::instance() {
+    static PerfMonitor monitor;
+    return monitor;
+}
+
+esp_err_t PerfMonitor::start() {
+#if !CONFIG_FREERTOS_USE_TRACE_FACILITY || !CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    ESP_LOGW(TAG, "FreeRTOS run-time stats are disabled, no performance sampling");
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    if (running_) {
+        return ESP_OK;
+    }
+    running_ = true;
+    if (task_.create(task_trampoline, "perf_monitor", this, TASK_PRIORITY_PERF_MONITOR, TASK_CORE_NETWORK) != pdPASS) {
+        running_ = false;
+        ESP_LOGE(TAG, "Failed to create performance monitor task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+#endif
+}
+
+void PerfMonitor::task_trampoline(void *arg) {
+    static_cast<PerfMonitor *>(arg)->task();
+}
+
+void PerfMonitor::task() {
+    // The console is read a character at a time between samples
+    fcntl(fileno(stdin), F_SETFL, fcntl(fileno(stdin), F_GETFL) | O_NONBLOCK);
+
+    int64_t next_sample_us = 0;
+    while (true) {
+        if (const int64_t now = esp_timer_get_time(); now >= next_sample_us) {
+            sample();
+            next_sample_us = now + PERF_SAMPLE_INTERVAL_MS * 1000LL;
+        }
+        poll_console();
+        vTaskDelay(pdMS_TO_TICKS(CONSOLE_POLL_MS));
+    }
+}
+
+void PerfMonitor::sample() {
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY && CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint32_t total = 0;
+    const UBaseType_t count = uxTaskGetSystemState(status_, PERF_MAX_TASKS, &total);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, no task sample", PERF_MAX_TASKS);
+        return;
+    }
+    // The counter is shared by the cores, so each one contributes elapsed time
+    const uint32_t elapsed = total - previous_total_;
+    const bool have_previous = previous_total_ != 0 && elapsed != 0;
+
+    TaskHandle_t idle[portNUM_PROCESSORS];
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        idle[core] = xTaskGetIdleTaskHandleForCore(core);
+    }
+
+    Sample sample{};
+    sample.time_us = esp_timer_get_time();
+    sample.tightest_stack_free = UINT32_MAX;
+
+    TaskInfo tasks[PERF_MAX_TASKS]{};
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t &status = status_[i];
+        uint32_t ran = 0;
+        for (size_t p = 0; have_previous && p < previous_count_; p++) {
+            if (previous_[p].handle == status.xHandle) {
+                ran = status.ulRunTimeCounter - previous_[p].counter;
+                break;
+            }
+        }
+
+        TaskInfo &info = tasks[i];
+        strncpy(info.name, status.pcTaskName, sizeof(info.name) - 1);
+        const BaseType_t core = xTaskGetCoreID(status.xHandle);
+        info.core = core == tskNO_AFFINITY ? -1 : static_cast<int>(core);
+        info.priority = static_cast<int>(status.uxCurrentPriority);
+        info.cpu_permille = have_previous
+                                ? static_cast<uint16_t>(std::min<uint64_t>(
+                                        1000, ran * 1000ULL / (static_cast<uint64_t>(elapsed) * portNUM_PROCESSORS)))
+                                : 0;
+        // Filled in by uxTaskGetStackHighWaterMark; bytes, as StackType_t is a byte here
+        info.stack_free = status.usStackHighWaterMark;
+
+        const auto idle_core = std::find(idle, idle + portNUM_PROCESSORS, status.xHandle) - idle;
+        if (idle_core < portNUM_PROCESSORS) {
+            if (have_previous) {
+                sample.core_load_permille[idle_core] = static_cast<uint16_t>(
+                        1000 - std::min<uint64_t>(1000, ran * 1000ULL / elapsed));
+            }
+        } else if (info.cpu_permille >= sample.busiest_permille) {
+            strncpy(sample.busiest_task, info.name, sizeof(sample.busiest_task) - 1);
+            sample.busiest_permille = info.cpu_permille;
+        }
+        if (info.stack_free < sample.tightest_stack_free) {
+            strncpy(sample.tightest_task, info.name, sizeof(sample.tightest_task) - 1);
+            sample.tightest_stack_free = info.stack_free;
+        }
+
+        previous_[i] = {status.xHandle, status.ulRunTimeCounter};
+    }
+    previous_count_ = count;
+    previous_total_ = total;
+
+    sample.heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    sample.heap_min_free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    sample.heap_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    const int num_radios = std::clamp<int>(ConfigManager::instance().get_config().num_radios, 1, MAX_RADIOS);
+    for (int r = 0; r < num_radios; r++) {
+        const CatParser &parser = CatParser::radio(r);
+        sample.cat_buffered[r] = parser.get_rx_buffered();
+        sample.cat_events[r] = parser.get_event_queue_depth();
+    }
+    sample.relay_backlog = antenna_switch_relay_backlog();
+
+    std::lock_guard lock(mutex_);
+    std::copy_n(tasks, count, tasks_);
+    task_count_ = count;
+    ring_[ring_head_] = sample;
+    ring_head_ = (ring_head_ + 1) % PERF_HISTORY_SIZE;
+    ring_count_ = std::min<size_t>(ring_count_ + 1, PERF_HISTORY_SIZE);
+#endif
+}
+
+bool PerfMonitor::get_snapshot(Snapshot *snapshot) const {
+    std::lock_guard lock(mutex_);
+    if (ring_count_ == 0) {
+        return false;
+    }
+    const size_t oldest = (ring_head_ + PERF_HISTORY_SIZE - ring_count_) % PERF_HISTORY_SIZE;
+    for (size_t i = 0; i < ring_count_; i++) {
+        snapshot->history[i] = ring_[(oldest + i) % PERF_HISTORY_SIZE];
+    }
+    snapshot->history_count = ring_count_;
+    std::copy_n(tasks_, task_count_, snapshot->tasks);
+    snapshot->task_count = task_count_;
+    return true;
+}
+
+void PerfMonitor::print_report() const {
+    // Printed under the lock rather than copied: a snapshot doesn't fit this task's stack
+    std::lock_guard lock(mutex_);
+    if (ring_count_ == 0) {
+        printf("perf: no sample yet\n");
+        return;
+    }
+    const Sample &latest = ring_[(ring_head_ + PERF_HISTORY_SIZE - 1) % PERF_HISTORY_SIZE];
+
+    printf("%-16s %4s %4s %6s %8s\n", "task", "core", "prio", "cpu%", "stack");
+    for (size_t i = 0; i < task_count_; i++) {
+        const TaskInfo &info = tasks_[i];
+        printf("%-16s %4d %4d %3u.%u %8lu\n", info.name, info.core, info.priority, info.cpu_permille / 10,
+               info.cpu_permille % 10, static_cast<unsigned long>(info.stack_free));
+    }
+    printf("heap: %lu free, %lu min, %lu largest block\n", static_cast<unsigned long>(latest.heap_free),
+           static_cast<unsigned long>(latest.heap_min_free), static_cast<unsigned long>(latest.heap_largest_block));
+
+    printf("%8s", "age s");
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        printf("  cpu%d%%", core);
+    }
+    printf(" %8s %8s %6s %6s %4s  %s\n", "heap", "largest", "cat1", "cat2", "rly", "busiest");
+    const size_t oldest = (ring_head_ + PERF_HISTORY_SIZE - ring_count_) % PERF_HISTORY_SIZE;
+    for (size_t i = 0; i < ring_count_; i++) {
+        const Sample &sample = ring_[(oldest + i) % PERF_HISTORY_SIZE];
+        printf("%8lld", static_cast<long long>((latest.time_us - sample.time_us) / 1000000));
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            printf(" %6u", sample.core_load_permille[core] / 10);
+        }
+        printf(" %8lu %8lu %6lu %6lu %4lu  %s\n", static_cast<unsigned long>(sample.heap_free),
+               static_cast<unsigned long>(sample.heap_largest_block),
+               static_cast<unsigned long>(sample.cat_buffered[0] + sample.cat_events[0]),
+               static_cast<unsigned long>(MAX_RADIOS > 1 ? sample.cat_buffered[1] + sample.cat_events[1] : 0),
+               static_cast<unsigned long>(sample.relay_backlog), sample.busiest_task);
+    }
+}
+
+void PerfMonitor::poll_console() {
+    // With the PC bridge, UART0 carries logger traffic rather than typed commands
+    if (CatParser::instance().is_pc_bridged()) {
+        return;
+    }
+    for (int c = fgetc(stdin); c != EOF; c = fgetc(stdin)) {
+        if (c != '\r' && c != '\n') {
+            if (console_length_ < sizeof(console_line_) - 1) {
+                console_line_[console_length_] = static_cast<char>(c);
+            }
+            // Overlong lines are counted but never match
+            console_length_ = std::min(console_length_ + 1, sizeof(console_line_));
+            continue;
+        }
+        if (console_length_ < sizeof(console_line_)) {
+            console_line_[console_length_] = '\0';
+            if (strcmp(console_line_, "perf") == 0) {
+                print_report();
+            }
+        }
+        console_length_ = 0;
+    }
+    clearerr(stdin);
+}
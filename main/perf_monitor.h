@@ -0,0 +1,99 @@
+#pragma once
+
+#include "esp_err.h"
+#include "antenna_switch.h"
+#include "static_task.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#define PERF_SAMPLE_INTERVAL_MS 5000
+// Two minutes of history at the default interval
+#define PERF_HISTORY_SIZE 24
+#define PERF_MAX_TASKS 32
+
+// Periodic snapshots of where the CPU, stacks, heap and queues stand, kept in
+// a ring so the minutes before a stall or watchdog trip can be read back from
+// /debug/perf or the "perf" console command. One low-priority task takes the
+// snapshots; readers copy them out under a mutex.
+class PerfMonitor {
+public:
+    struct TaskInfo {
+        char name[configMAX_TASK_NAME_LEN];
+        int core; // -1 = not pinned
+        int priority;
+        uint16_t cpu_permille; // Share of all cores over the last interval
+        uint32_t stack_free; // Least free stack ever, in bytes
+    };
+
+    struct Sample {
+        int64_t time_us;
+        uint16_t core_load_permille[portNUM_PROCESSORS]; // Non-idle time per core
+        uint32_t heap_free;
+        uint32_t heap_min_free;
+        uint32_t heap_largest_block;
+        uint32_t cat_buffered[MAX_RADIOS]; // Bytes waiting in each radio's UART driver
+        uint32_t cat_events[MAX_RADIOS]; // Events waiting in each radio's UART queue
+        uint32_t relay_backlog; // Relay requests the boards have yet to apply
+        char busiest_task[configMAX_TASK_NAME_LEN];
+        uint16_t busiest_permille;
+        char tightest_task[configMAX_TASK_NAME_LEN]; // Closest to overflowing its stack
+        uint32_t tightest_stack_free;
+    };
+
+    struct Snapshot {
+        Sample history[PERF_HISTORY_SIZE]; // Oldest first
+        size_t history_count;
+        TaskInfo tasks[PERF_MAX_TASKS]; // As of the latest sample
+        size_t task_count;
+    };
+
+    static PerfMonitor &instance();
+
+    esp_err_t start();
+
+    bool is_running() const { return running_; }
+
+    // Copy of the ring and the latest task table; false before the first sample
+    bool get_snapshot(Snapshot *snapshot) const;
+
+    // Print the latest sample and the trend to the console
+    void print_report() const;
+
+private:
+    static constexpr int CONSOLE_POLL_MS = 100;
+
+    struct RunTime {
+        TaskHandle_t handle;
+        uint32_t counter;
+    };
+
+    PerfMonitor() = default;
+
+    void task();
+
+    static void task_trampoline(void *arg);
+
+    void sample();
+
+    // Handle "perf" typed on the console, unless UART0 carries the PC bridge
+    void poll_console();
+
+    StaticTask<4096> task_;
+    bool running_{false};
+    mutable std::mutex mutex_;
+    Sample ring_[PERF_HISTORY_SIZE]{};
+    size_t ring_head_{0};
+    size_t ring_count_{0};
+    TaskInfo tasks_[PERF_MAX_TASKS]{};
+    size_t task_count_{0};
+    // Only touched by the sampling task
+    TaskStatus_t status_[PERF_MAX_TASKS]{};
+    RunTime previous_[PERF_MAX_TASKS]{};
+    size_t previous_count_{0};
+    uint32_t previous_total_{0};
+    char console_line_[16]{};
+    size_t console_length_{0};
+};
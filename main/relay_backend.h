@@ -0,0 +1,52 @@
+#pragma once
+
+#include "esp_err.h"
+#include "relay_board.h"
+#include <cstdint>
+#include <string>
+
+// Link readiness as seen by RelayController::tcp_task
+enum class RelayLinkState : uint8_t {
+    DOWN, // Not usable; the backend is waiting to retry
+    CONNECTING, // An attempt is in flight; poll() already waited on it
+    READY
+};
+
+// Transport-independent access to the relay board outputs, sized for ActiveRelayBoard.
+// Implementations are driven from a single task.
+class RelayBackend {
+public:
+    virtual ~RelayBackend() = default;
+
+    virtual const char *name() const = 0;
+
+    // Open the transport; connecting may complete later in poll()
+    virtual esp_err_t start() = 0;
+
+    // Advance background work (reconnects, liveness checks), waiting at most timeout_ms
+    virtual RelayLinkState poll(int timeout_ms) = 0;
+
+    // Set every output in one write; confirmed receives the state the board reports back
+    virtual esp_err_t write_outputs(const RelayMask &mask, RelayMask *confirmed) = 0;
+
+    virtual esp_err_t read_outputs(RelayMask *mask) = 0;
+
+    // Point a network backend at a new board address
+    virtual esp_err_t set_endpoint(const std::string &host, uint16_t port) { return ESP_ERR_NOT_SUPPORTED; }
+
+    // TCP keepalive for connections opened by start() and later reconnects
+    virtual void set_keepalive(int idle_s, int interval_s, int count) {
+    }
+
+    // Called after a command timed out; rebuild the link if the backend has one
+    virtual void recover() {
+    }
+
+    // Connect again now, e.g. once the network is back; no-op for links without a connection
+    virtual void reconnect() {
+    }
+
+    // One-line counters for diagnostics logging
+    virtual void log_stats() const {
+    }
+};
@@ -0,0 +1,118 @@
+#include "relay_board.h"
+#include "esp_log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static auto TAG = "RELAY_BOARD";
+
+template<typename Model>
+void RelayBoard<Model>::to_bytes(const Mask &mask, uint8_t *bytes) {
+    const uint64_t bits = mask.to_ullong();
+    for (size_t i = 0; i < NUM_DATA_BYTES; i++) {
+        bytes[i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+}
+
+template<typename Model>
+typename RelayBoard<Model>::Mask RelayBoard<Model>::from_bytes(const uint8_t *bytes) {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < NUM_DATA_BYTES; i++) {
+        bits |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+    }
+    return Mask(bits);
+}
+
+template<typename Model>
+int RelayBoard<Model>::format_set_all(const Mask &mask, char *buf, const size_t size) {
+    int len = snprintf(buf, size, "%s", Model::SET_ALL_CMD);
+    for (size_t i = NUM_DATA_BYTES; i-- > 0 && len >= 0 && static_cast<size_t>(len) < size;) {
+        len += snprintf(buf + len, size - len, ",%d", data_byte(mask, i));
+    }
+    return len >= 0 && static_cast<size_t>(len) < size ? len : -1;
+}
+
+template<typename Model>
+esp_err_t RelayBoard<Model>::parse_state(const char *response, Mask *mask) {
+    if (!response || !mask) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Find the last occurrence of RELAY-STATE-255 or RELAY-SET_ALL-255
+    const char *ptr = nullptr;
+    for (const char *p = strstr(response, "RELAY-"); p != nullptr; p = strstr(p + 1, "RELAY-")) {
+        ptr = p;
+    }
+    if (ptr == nullptr) {
+        ESP_LOGW(TAG, "No valid relay command found in response");
+        return ESP_FAIL;
+    }
+
+    const char *const end_ptr = ptr + strlen(ptr);
+
+    // Quick check for minimum valid length
+    if ((end_ptr - ptr) < 18) {
+        // Minimum "RELAY-STATE-255,0,0,OK"
+        ESP_LOGW(TAG, "Response too short");
+        return ESP_FAIL;
+    }
+
+    // Fast header check - only check critical characters
+    if (ptr[0] != 'R' || ptr[5] != '-' ||
+        ptr[6] != 'S') {
+        // Matches both STATE and SET_ALL
+        ESP_LOGW(TAG, "Invalid header format");
+        return ESP_FAIL;
+    }
+
+    // Find the first comma after RELAY-STATE-255 or RELAY-SET_ALL-255
+    // Skip past any line feeds or other characters
+    ptr = strstr(ptr, "-255");
+    if (!ptr || (end_ptr - ptr) < 4) {
+        ESP_LOGW(TAG, "Missing -255 in response");
+        return ESP_FAIL;
+    }
+    ptr += 4; // Skip "-255"
+
+    // Skip any characters (including line feeds) until we find the first comma
+    while (ptr < end_ptr && *ptr != ',') ptr++;
+    if (static_cast<size_t>(end_ptr - ptr) < NUM_DATA_BYTES * 2) {
+        // Need at least ",0" per data byte
+        ESP_LOGW(TAG, "Invalid format after header");
+        return ESP_FAIL;
+    }
+
+    // Data bytes arrive most significant first: dN,...,d1,d0
+    uint64_t bits = 0;
+    char *next = const_cast<char *>(ptr);
+    for (size_t i = NUM_DATA_BYTES; i-- > 0;) {
+        if (*next != ',') {
+            ESP_LOGW(TAG, "Missing d%u value", static_cast<unsigned>(i));
+            return ESP_FAIL;
+        }
+        ptr = next + 1;
+        const long val = strtol(ptr, &next, 10);
+        if (next == ptr || val < 0 || val > 255) {
+            ESP_LOGW(TAG, "Invalid d%u value", static_cast<unsigned>(i));
+            return ESP_FAIL;
+        }
+        bits |= static_cast<uint64_t>(val) << (i * 8);
+    }
+
+    // Quick check for OK (just verify 'O' and 'K' are present)
+    ptr = next;
+    while (ptr < end_ptr && (*ptr == ',' || *ptr <= ' ')) ptr++;
+    if (ptr >= end_ptr - 1 || ptr[0] != 'O' || ptr[1] != 'K') {
+        ESP_LOGW(TAG, "Missing OK confirmation");
+        return ESP_FAIL;
+    }
+
+    *mask = Mask(bits);
+    ESP_LOGV(TAG, "Parsed relay states: 0x%llx", static_cast<unsigned long long>(bits));
+    return ESP_OK;
+}
+
+// Supported board models
+template class RelayBoard<Kc868A16>;
+template class RelayBoard<Kc868A32>;
+template class RelayBoard<Kc868A64>;
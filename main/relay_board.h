@@ -0,0 +1,66 @@
+#pragma once
+
+#include "esp_err.h"
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+// Outputs on the relay board; build with -DRELAY_BOARD_OUTPUTS=32 or 64 for the larger KC868 models
+#ifndef RELAY_BOARD_OUTPUTS
+#define RELAY_BOARD_OUTPUTS 16
+#endif
+
+// Geometry and text protocol of a Kincony KC868 board with Outputs relays
+template<size_t Outputs>
+struct Kc868Model {
+    static_assert(Outputs % 8 == 0 && Outputs > 0 && Outputs <= 64, "KC868 boards expose 1-8 whole output bytes");
+
+    static constexpr size_t NUM_OUTPUTS = Outputs;
+    static constexpr size_t NUM_DATA_BYTES = Outputs / 8; // Sent most significant first: ...,d1,d0
+    static constexpr auto SET_ALL_CMD = "RELAY-SET_ALL-255";
+    static constexpr auto STATE_CMD = "RELAY-STATE-255";
+};
+
+using Kc868A16 = Kc868Model<16>;
+using Kc868A32 = Kc868Model<32>;
+using Kc868A64 = Kc868Model<64>;
+
+// Output mask handling and command formatting for one board model. Everything is
+// sized at compile time; the per-model code is instantiated in relay_board.cpp.
+template<typename Model>
+class RelayBoard {
+public:
+    static constexpr size_t NUM_OUTPUTS = Model::NUM_OUTPUTS;
+    static constexpr size_t NUM_DATA_BYTES = Model::NUM_DATA_BYTES;
+    // Longest "RELAY-SET_ALL-255,255,...,255" plus terminator
+    static constexpr size_t MAX_COMMAND_LENGTH = 18 + NUM_DATA_BYTES * 4 + 1;
+
+    // Bit 0 = relay 1
+    using Mask = std::bitset<NUM_OUTPUTS>;
+
+    // Mask with only relay_id (1-based) on
+    static Mask single(const int relay_id) { return Mask().set(relay_id - 1); }
+
+    // 1-based index of the lowest relay that is on, 0 if none
+    static int first_set(const Mask &mask) { return __builtin_ffsll(static_cast<long long>(mask.to_ullong())); }
+
+    // Byte d<index>; d0 holds relays 1-8
+    static uint8_t data_byte(const Mask &mask, const size_t index) {
+        return static_cast<uint8_t>(mask.to_ullong() >> (index * 8));
+    }
+
+    // bytes[0] = d0 (relays 1-8), as used by Modbus coil frames
+    static void to_bytes(const Mask &mask, uint8_t *bytes);
+
+    static Mask from_bytes(const uint8_t *bytes);
+
+    // "RELAY-SET_ALL-255,dN,...,d0"; returns the length or -1 if buf is too small
+    static int format_set_all(const Mask &mask, char *buf, size_t size);
+
+    // Parse the last "RELAY-STATE-255,dN,...,d0,OK" or "RELAY-SET_ALL-255,...,OK" in response
+    static esp_err_t parse_state(const char *response, Mask *mask);
+};
+
+using ActiveRelayModel = Kc868Model<RELAY_BOARD_OUTPUTS>;
+using ActiveRelayBoard = RelayBoard<ActiveRelayModel>;
+using RelayMask = ActiveRelayBoard::Mask;
@@ -1,17 +1,29 @@
 #include "relay_controller.h"
+#include "boot_timeline.h"
+#include "kc868_backend.h"
+#include "modbus_relay_backend.h"
 #include "esp_log.h"
 #include "freertos/projdefs.h"
 #include "freertos/task.h"
 #include "esp_task_wdt.h"
-#include <sstream>
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "task_layout.h"
+#include <algorithm>
+#include <cmath>
 
 static auto TAG = "RELAY_CONTROLLER";
 
 RelayController::RelayController()
         : currently_selected_relay_(0), last_band_change_time_(std::chrono::steady_clock::now()), tcp_host_(""),
-          tcp_port_(0), relay_state_bitfield_(0), tcp_task_handle_(nullptr), last_band_number_(-1) {
-    tcp_client = std::make_unique<TCPClient>();
+          tcp_port_(0), tcp_task_handle_(nullptr), last_band_number_(-1), requested_outputs_(0), request_seq_(0), applied_seq_(0),
+          completion_group_(nullptr), completion_bit_(0) {
+    transport_ = RELAY_TRANSPORT_TCP;
+    modbus_address_ = MODBUS_DEFAULT_ADDRESS;
+    rs485_baud_rate_ = RS485_DEFAULT_BAUD_RATE;
+    keepalive_idle_s_ = 20;
+    keepalive_interval_s_ = 5;
+    keepalive_count_ = 5;
     latest_request_.store(RelayChangeRequest{0, -1});
 }
 
@@ -20,57 +32,42 @@ RelayController::~RelayController() = default;
 esp_err_t RelayController::init() {
     ESP_LOGI(TAG, "Initializing relay controller");
 
-    if (tcp_host_.empty()) {
+    std::unique_lock lock(command_mutex_);
+    if (tcp_host_.empty() && transport_ != RELAY_TRANSPORT_RS485) {
         ESP_LOGE(TAG, "TCP host not set. Please set the TCP host before initializing.");
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Initialize TCP client with connection retry
-    esp_err_t ret = tcp_client->init(tcp_host_.c_str(), tcp_port_);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "Error initializing TCP client: %s", esp_err_to_name(ret));
-        return ret;
-    }
-
-    // Configure TCP keepalive with more lenient values
-    int keepalive = 1;
-    int keepidle = 20; // Start probing after 20 seconds of idle
-    int keepintvl = 5; // Probe interval of 5 seconds
-    int keepcnt = 5; // Drop connection after 5 failed probes
-
-    if (setsockopt(tcp_client->get_sock(), SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive)) < 0) {
-        ESP_LOGW(TAG, "Failed to set SO_KEEPALIVE");
-    }
-    if (setsockopt(tcp_client->get_sock(), IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(keepidle)) < 0) {
-        ESP_LOGW(TAG, "Failed to set TCP_KEEPIDLE");
-    }
-    if (setsockopt(tcp_client->get_sock(), IPPROTO_TCP, TCP_KEEPINTVL, &keepintvl, sizeof(keepintvl)) < 0) {
-        ESP_LOGW(TAG, "Failed to set TCP_KEEPINTVL");
-    }
-    if (setsockopt(tcp_client->get_sock(), IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(keepcnt)) < 0) {
-        ESP_LOGW(TAG, "Failed to set TCP_KEEPCNT");
-    }
-
-    // Get initial relay states with retries
-    const int MAX_INIT_RETRIES = 3;
-    for (int i = 0; i < MAX_INIT_RETRIES; i++) {
-        ret = update_all_relay_states();
-        if (ret == ESP_OK) {
-            break;
+    // tcp_task keeps using the backend it started with, so it is only created once
+    if (backend_ == nullptr) {
+        switch (transport_) {
+            case RELAY_TRANSPORT_UDP:
+                backend_ = std::make_unique<UdpRelayBackend>(tcp_host_, tcp_port_);
+                break;
+            case RELAY_TRANSPORT_RS485:
+                backend_ = std::make_unique<ModbusRelayBackend>(modbus_address_, rs485_baud_rate_);
+                break;
+            default:
+                backend_ = std::make_unique<TcpRelayBackend>(tcp_host_, tcp_port_);
+                break;
         }
-        ESP_LOGW(TAG, "Retry %d/%d getting initial states", i + 1, MAX_INIT_RETRIES);
-        vTaskDelay(pdMS_TO_TICKS(100 * (i + 1))); // Increasing delay between retries
+        backend_->set_keepalive(keepalive_idle_s_, keepalive_interval_s_, keepalive_count_);
     }
+    lock.unlock();
 
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to get initial relay states after %d attempts", MAX_INIT_RETRIES);
-        // Continue anyway as this isn't fatal
+    // Network links come up in the background on tcp_task; relay states are
+    // synchronised there once the backend reports ready
+    if (const esp_err_t ret = backend_->start(); ret != ESP_OK) {
+        ESP_LOGE(TAG, "Error starting %s relay backend: %s", backend_->name(), esp_err_to_name(ret));
+        return ret;
     }
 
     // Create TCP task
-    xTaskCreate(tcp_task, "tcp_task", 4096, this, 5, &tcp_task_handle_);
+    if (tcp_task_handle_ == nullptr) {
+        tcp_task_.create(tcp_task, "tcp_task", this, TASK_PRIORITY_RELAY_LINK, TASK_CORE_NETWORK, &tcp_task_handle_);
+    }
 
-    ESP_LOGV(TAG, "Relay controller initialized with TCP host: %s, port: %d", tcp_host_.c_str(), tcp_port_);
+    ESP_LOGV(TAG, "Relay controller initialized with %s relay backend", backend_->name());
     return ESP_OK;
 }
 
@@ -93,24 +90,18 @@ esp_err_t RelayController::update_relay_states() {
 }
 
 esp_err_t RelayController::update_tcp_settings(const std::string &host, const uint16_t port) {
+    // Config observers call this from whichever task saved
+    std::lock_guard lock(command_mutex_);
     if (host != tcp_host_ || port != tcp_port_) {
         tcp_host_ = host;
         tcp_port_ = port;
 
-        if (tcp_client->check_connection_status()) {
-            tcp_client->close();
-        }
-
-        esp_err_t ret = tcp_client->ensure_connected();
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Error establishing TCP connection: %s", esp_err_to_name(ret));
-            return ret;
-        }
-
-        // Verify connection by getting relay states
-        ret = update_all_relay_states();
-        if (ret != ESP_OK) {
-            ESP_LOGW(TAG, "Failed to verify connection with relay state query");
+        if (backend_ != nullptr) {
+            if (const esp_err_t ret = backend_->set_endpoint(tcp_host_, tcp_port_);
+                ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+                ESP_LOGE(TAG, "Error updating %s relay endpoint: %s", backend_->name(), esp_err_to_name(ret));
+                return ret;
+            }
         }
 
         ESP_LOGI(TAG, "TCP settings updated. New host: %s, new port: %d", tcp_host_.c_str(), tcp_port_);
@@ -124,7 +115,24 @@ void RelayController::set_tcp_port(const uint16_t port) {
     tcp_port_ = port;
 }
 
+void RelayController::set_transport(const uint8_t transport) {
+    transport_ = transport <= RELAY_TRANSPORT_RS485 ? transport : RELAY_TRANSPORT_TCP;
+    ESP_LOGD(TAG, "Relay transport set to %d", transport_);
+}
+
+void RelayController::set_modbus_settings(const uint8_t address, const int baud_rate) {
+    modbus_address_ = address != 0 ? address : MODBUS_DEFAULT_ADDRESS;
+    rs485_baud_rate_ = baud_rate > 0 ? baud_rate : RS485_DEFAULT_BAUD_RATE;
+}
+
+void RelayController::set_keepalive(const int idle_s, const int interval_s, const int count) {
+    keepalive_idle_s_ = idle_s;
+    keepalive_interval_s_ = interval_s;
+    keepalive_count_ = count;
+}
+
 std::string RelayController::get_tcp_host() const {
+    std::lock_guard lock(command_mutex_);
     return tcp_host_;
 }
 
@@ -135,21 +143,11 @@ uint16_t RelayController::get_tcp_port() const {
 esp_err_t RelayController::turn_off_all_relays() {
     ESP_LOGD(TAG, "Turning off all relays");
 
-    std::string command = "RELAY-AOF-255,1,1";
-    std::string expected_response_suffix = "255,1,1,OK";
-
-    esp_err_t ret = send_command(command, expected_response_suffix);
-    if (ret != ESP_OK) {
+    if (const esp_err_t ret = write_outputs(RelayMask()); ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to turn off all relays: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    // Update local state
-    for (int i = 1; i <= NUM_RELAYS; ++i) {
-        relay_states_[i] = false;
-    }
-    currently_selected_relay_ = 0;
-
     return ESP_OK;
 }
 
@@ -160,7 +158,7 @@ esp_err_t RelayController::set_relay(const int relay_id, const bool state) {
     }
 
     // If the relay is already in the desired state, do nothing.
-    if (const bool current_state = (relay_state_bitfield_ & (1 << (relay_id - 1))) != 0; current_state == state) {
+    if (const bool current_state = relay_state_bitfield_.test(relay_id - 1); current_state == state) {
         ESP_LOGV(TAG, "Relay %d already in desired state", relay_id);
         return ESP_OK;
     }
@@ -175,32 +173,42 @@ bool RelayController::get_relay_state(const int relay_id) const {
         ESP_LOGE(TAG, "Invalid relay ID: %d", relay_id);
         return false;
     }
-    return relay_states_.at(relay_id);
+    return relay_state_bitfield_.test(relay_id - 1);
 }
 
 std::map<int, bool> RelayController::get_all_relay_states() const {
-    return relay_states_;
+    std::map<int, bool> states;
+    for (int i = 1; i <= NUM_RELAYS; ++i) {
+        states[i] = relay_state_bitfield_.test(i - 1);
+    }
+    return states;
 }
 
 esp_err_t RelayController::update_all_relay_states() {
     ESP_LOGD(TAG, "Getting state of all relays");
 
-    const std::string command = "RELAY-STATE-255";
-    const esp_err_t ret = send_command(command, "OK", 500);
+    if (backend_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    RelayMask mask;
+    esp_err_t ret;
+    {
+        std::lock_guard lock(command_mutex_);
+        const int64_t start_us = esp_timer_get_time();
+        ret = backend_->read_outputs(&mask);
+        if (ret == ESP_OK) {
+            record_latency(esp_timer_get_time() - start_us);
+            apply_relay_state(mask);
+        }
+    }
 
-   if (ret != ESP_OK) {
+    if (ret != ESP_OK) {
         ESP_LOGW(TAG, "Failed to get relay states: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    if (ret == ESP_OK) {
-        std::stringstream ss;
-        ss << "Current relay states: ";
-        for (int i = 1; i <= NUM_RELAYS; ++i) {
-            ss << i << ":" << (relay_states_[i] ? "ON" : "off") << " ";
-        }
-        ESP_LOGD(TAG, "%s", ss.str().c_str());
-    }
+    ESP_LOGD(TAG, "Current relay states: 0x%llx", static_cast<unsigned long long>(relay_state_bitfield_.to_ullong()));
 
     return ret;
 }
@@ -223,6 +231,26 @@ esp_err_t RelayController::set_relay_for_antenna(int relay_id, int band_number)
     return ESP_OK;
 }
 
+uint32_t RelayController::request_outputs(const RelayMask &outputs, const int band_number) {
+    // Mask first: tcp_task reads the request, then the mask, so it never pairs a new request with an old mask
+    requested_outputs_.store(outputs.to_ullong());
+    latest_request_.store(RelayChangeRequest{OUTPUT_MASK_REQUEST, band_number});
+    return ++request_seq_;
+}
+
+bool RelayController::has_outputs_on() const {
+    const RelayChangeRequest latest = latest_request_.load();
+    if (latest.relay_id == OUTPUT_MASK_REQUEST) {
+        return currently_selected_relay_ != 0 || requested_outputs_.load() != 0;
+    }
+    return currently_selected_relay_ != 0 || latest.relay_id > 0;
+}
+
+void RelayController::set_completion_event(EventGroupHandle_t group, const EventBits_t bit) {
+    completion_bit_ = bit;
+    completion_group_ = group;
+}
+
 void RelayController::log_network_diagnostics() const {
     // Log the current TCP settings
     ESP_LOGV(TAG, "Current TCP settings - Host: %s, Port: %d", tcp_host_.c_str(), tcp_port_);
@@ -249,43 +277,26 @@ esp_err_t RelayController::turn_off_all_relays_except(const int relay_to_keep_on
         return ESP_ERR_INVALID_ARG;
     }
 
-    uint8_t d1 = 0, d0 = 0;
-    if (relay_to_keep_on <= 8) {
-        // ReSharper disable once CppRedundantParentheses
-        d0 = 1 << (relay_to_keep_on - 1);
-    } else {
-        // ReSharper disable once CppRedundantParentheses
-        d1 = 1 << (relay_to_keep_on - 9);
-    }
-
-    std::stringstream ss;
-    ss << "RELAY-SET_ALL-255," << static_cast<int>(d1) << "," << static_cast<int>(d0);
-    const std::string command = ss.str();
-    // Change the expected response to match just the parameters
-    const std::string expected_response_suffix = std::to_string(d1) + "," + std::to_string(d0) + ",OK";
-
-    ESP_LOGV(TAG, "Sending command: %s", command.c_str());
-
-    if (const esp_err_t ret = send_command(command, expected_response_suffix); ret != ESP_OK) {
+    if (const esp_err_t ret = write_outputs(ActiveRelayBoard::single(relay_to_keep_on)); ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set all relays: %s", esp_err_to_name(ret));
         return ret;
     }
 
-    for (int i = 1; i <= NUM_RELAYS; ++i) {
-        relay_states_[i] = i == relay_to_keep_on;
-    }
-    currently_selected_relay_ = relay_to_keep_on;
-
     ESP_LOGI(TAG, "All relays turned off except relay %d", relay_to_keep_on);
     return ESP_OK;
 }
 
 int RelayController::get_last_selected_relay_for_band(int band_number) const {
-    auto it = last_selected_relay_for_band_.find(band_number);
-    if (it != last_selected_relay_for_band_.end()) {
-        return it->second;
+    if (band_number < 0 || band_number >= MAX_TRACKED_BANDS) {
+        return 0;
+    }
+    return last_selected_relay_for_band_[band_number];
+}
+
+void RelayController::remember_relay_for_band(const int band_number, const int relay_id) {
+    if (band_number >= 0 && band_number < MAX_TRACKED_BANDS) {
+        last_selected_relay_for_band_[band_number] = relay_id;
     }
-    return 0;
 }
 
 bool RelayController::is_correct_relay_set(int band_number) const {
@@ -309,7 +320,7 @@ esp_err_t RelayController::execute_relay_change(int relay_id, int band_number) {
     // If we're already on the correct relay, no need to change
     if (relay_id == currently_selected_relay_) {
         ESP_LOGD(TAG, "Relay %d already selected", relay_id);
-        last_selected_relay_for_band_[band_number] = relay_id;
+        remember_relay_for_band(band_number, relay_id);
         return ESP_OK;
     }
 
@@ -327,10 +338,10 @@ esp_err_t RelayController::execute_relay_change(int relay_id, int band_number) {
         return ret;
     }
 
-    // The SET_ALL command already returns the state, so we can use that
+    // The backend already reports the state the board applied, so we can use that
     // instead of doing an additional state query
     if (currently_selected_relay_ == relay_id) {
-        last_selected_relay_for_band_[band_number] = relay_id;
+        remember_relay_for_band(band_number, relay_id);
         last_band_change_time_ = std::chrono::steady_clock::now();
         ESP_LOGI(TAG, "Successfully changed to relay %d for band %d", relay_id, band_number);
         return ESP_OK;
@@ -339,6 +350,41 @@ esp_err_t RelayController::execute_relay_change(int relay_id, int band_number) {
     return ESP_FAIL;
 }
 
+esp_err_t RelayController::execute_output_change(const RelayMask &outputs, const int band_number) {
+    if (esp_task_wdt_status(xTaskGetCurrentTaskHandle()) == ESP_OK) {
+        esp_task_wdt_reset();
+    }
+
+    if (outputs == relay_state_bitfield_) {
+        ESP_LOGD(TAG, "Outputs for band %d already set", band_number);
+        remember_relay_for_band(band_number, currently_selected_relay_);
+        return ESP_OK;
+    }
+
+    if (currently_selected_relay_ != 0 && should_delay()) {
+        ESP_LOGV(TAG, "Applying cooldown before switching outputs for band %d", band_number);
+        vTaskDelay(pdMS_TO_TICKS(COOLDOWN_PERIOD_MS));
+    }
+
+    // One SET_ALL, so the board never passes through a state with only some of the band's outputs on
+    if (const esp_err_t ret = write_outputs(outputs); ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set outputs for band %d: %s", band_number, esp_err_to_name(ret));
+        return ret;
+    }
+
+    if (relay_state_bitfield_ != outputs) {
+        ESP_LOGE(TAG, "Board confirmed 0x%llx, expected 0x%llx",
+                 static_cast<unsigned long long>(relay_state_bitfield_.to_ullong()),
+                 static_cast<unsigned long long>(outputs.to_ullong()));
+        return ESP_FAIL;
+    }
+
+    remember_relay_for_band(band_number, currently_selected_relay_);
+    last_band_change_time_ = std::chrono::steady_clock::now();
+    ESP_LOGI(TAG, "Set %u output(s) for band %d", static_cast<unsigned>(outputs.count()), band_number);
+    return ESP_OK;
+}
+
 void RelayController::tcp_task(void *pvParameters) {
     // Get current task handle first
     TaskHandle_t currentTask = xTaskGetCurrentTaskHandle();
@@ -350,15 +396,16 @@ void RelayController::tcp_task(void *pvParameters) {
     }
     
     auto *controller = static_cast<RelayController *>(pvParameters);
+    RelayBackend &backend = *controller->backend_;
     RelayChangeRequest last_processed{0, -1};
+    RelayMask last_outputs;
     
     // Constants for timing
     const TickType_t TASK_DELAY = pdMS_TO_TICKS(20);
-    const TickType_t CONNECTION_CHECK_INTERVAL = pdMS_TO_TICKS(5000);
-    const TickType_t WDT_RESET_INTERVAL = pdMS_TO_TICKS(1000); // Reset every 1 second
-    
-    TickType_t last_connection_check = xTaskGetTickCount();
-    TickType_t last_wdt_reset = xTaskGetTickCount();
+    constexpr int LINK_POLL_MS = 20;
+
+    RelayLinkState prev_state = RelayLinkState::DOWN;
+    bool state_synced = false;
 
     while (true) {
         // Always reset watchdog at start of loop
@@ -367,179 +414,130 @@ void RelayController::tcp_task(void *pvParameters) {
             esp_task_wdt_reset();
         }
 
-        // Get current time once for this iteration
-        TickType_t current_tick = xTaskGetTickCount();
-        
-        // Connection check with timeout protection
-        if ((current_tick - last_connection_check) >= CONNECTION_CHECK_INTERVAL) {
-            // Set shorter watchdog timeout for connection check
-            if (esp_task_wdt_status(xTaskGetCurrentTaskHandle()) == ESP_OK) {
-                // Add watchdog feed
-                esp_task_wdt_reset();
-            }
-            esp_err_t conn_status = controller->tcp_client->ensure_connected();
-            if (conn_status != ESP_OK) {
-                ESP_LOGW(TAG, "Connection check failed: %s", esp_err_to_name(conn_status));
-                // Connection recovery with watchdog protection
-                controller->tcp_client->close();
-                if (esp_task_wdt_status(xTaskGetCurrentTaskHandle()) == ESP_OK) {
-                    // Add watchdog feed
-                    esp_task_wdt_reset();
-                }
-                vTaskDelay(pdMS_TO_TICKS(1000));
-                
-                conn_status = controller->tcp_client->ensure_connected();
-                if (conn_status != ESP_OK) {
-                    ESP_LOGE(TAG, "Connection recovery failed: %s", esp_err_to_name(conn_status));
+        // Nothing to reach without the network; requests stay pending until it is back
+        if (controller->link_suspended_.load()) {
+            vTaskDelay(TASK_DELAY);
+            continue;
+        }
+        if (controller->relink_requested_.exchange(false)) {
+            backend.reconnect();
+        }
+
+        // Advance the backend's link; blocks only on socket readiness while connecting
+        const RelayLinkState state = backend.poll(LINK_POLL_MS);
+        // Read the sequence first so a completion is never reported for a request not yet seen
+        const uint32_t seq = controller->request_seq_.load();
+        RelayChangeRequest current = controller->latest_request_.load();
+        // Loaded after the request, so it is at least as new as the mask that came with it
+        const RelayMask outputs(controller->requested_outputs_.load());
+        const bool is_mask_request = current.relay_id == OUTPUT_MASK_REQUEST;
+        // A new mask may reuse the previous request's band
+        auto is_pending = [&] {
+            return current.relay_id != 0 &&
+                   (current != last_processed || (is_mask_request && outputs != last_outputs));
+        };
+
+        if (state != prev_state) {
+            if (state == RelayLinkState::READY) {
+                ESP_LOGI(TAG, "%s relay link up", backend.name());
+                if (is_pending()) {
+                    ESP_LOGI(TAG, "Link up, applying held relay change: relay=%d, band=%d",
+                             current.relay_id, current.band_number);
                 }
+            } else if (prev_state == RelayLinkState::READY) {
+                ESP_LOGW(TAG, "Relay board link lost, holding relay changes until reconnected");
+                state_synced = false;
             }
-            last_connection_check = current_tick;
+            prev_state = state;
         }
 
-        // Process relay change requests with watchdog protection
-        RelayChangeRequest current = controller->latest_request_.load();
-        if (current != last_processed) {
-            if (current.relay_id > 0) {
-                // Reset watchdog before potentially long operation
-                esp_task_wdt_reset();
-                
-                esp_err_t ret = controller->execute_relay_change(current.relay_id, current.band_number);
+        if (state == RelayLinkState::READY) {
+            // Adopt the board's current outputs once per link-up
+            if (!state_synced) {
+                state_synced = controller->update_all_relay_states() == ESP_OK;
+                if (state_synced) {
+                    BootTimeline::mark(BootStage::RELAY_LINK_VERIFIED);
+                }
+            }
+
+            // Process relay change requests; failed requests stay pending and are retried
+            if (is_pending()) {
+                esp_err_t ret = is_mask_request
+                                    ? controller->execute_output_change(outputs, current.band_number)
+                                    : controller->execute_relay_change(current.relay_id, current.band_number);
                 if (ret == ESP_OK) {
                     last_processed = current;
+                    last_outputs = outputs;
+                    BootTimeline::mark(BootStage::FIRST_BAND_SWITCH);
                 } else {
                     ESP_LOGE(TAG, "Relay change failed: %s", esp_err_to_name(ret));
-                    if (ret == ESP_ERR_TIMEOUT || ret == ESP_ERR_INVALID_STATE) {
-                        ESP_LOGW(TAG, "Connection issue detected: %s, forcing reconnection", esp_err_to_name(ret));
-                        controller->tcp_client->close();
-                        vTaskDelay(pdMS_TO_TICKS(1000));
-                        esp_err_t conn_status = controller->tcp_client->ensure_connected();
-                        if (conn_status != ESP_OK) {
-                            ESP_LOGE(TAG, "Reconnection failed: %s", esp_err_to_name(conn_status));
-                        }
+                    if (ret == ESP_ERR_TIMEOUT) {
+                        backend.recover();
                     }
                 }
             }
-        }
 
-        // Reset watchdog before delay if enough time has passed
-        if ((current_tick - last_wdt_reset) >= WDT_RESET_INTERVAL) {
-            esp_task_wdt_reset();
-            last_wdt_reset = current_tick;
+            // Tell RelayDispatcher the board now holds the requested outputs
+            if (!is_pending() && controller->applied_seq_.load() != seq) {
+                controller->applied_seq_.store(seq);
+                if (controller->completion_group_ != nullptr) {
+                    xEventGroupSetBits(controller->completion_group_, controller->completion_bit_);
+                }
+            }
+
+            // Latency probe runs only while no relay change is waiting
+            if (!is_pending() && controller->probe_active_.load()) {
+                controller->probe_step();
+            }
         }
 
-        vTaskDelay(TASK_DELAY);
+        // poll() already waited on the socket while a connection attempt is in flight
+        if (state != RelayLinkState::CONNECTING) {
+            vTaskDelay(TASK_DELAY);
+        }
     }
 }
 
-esp_err_t RelayController::parse_relay_state_response(const std::string &response) {
-    // Find the last occurrence of RELAY-STATE-255 or RELAY-SET_ALL-255
-    size_t last_state_pos = response.rfind("RELAY-");
-    if (last_state_pos == std::string::npos) {
-        ESP_LOGW(TAG, "No valid relay command found in response");
-        return ESP_FAIL;
-    }
-
-    // Extract just the last response
-    std::string last_response = response.substr(last_state_pos);
-    const char *ptr = last_response.c_str();
-    const char *const end_ptr = ptr + last_response.length();
-
-    // Quick check for minimum valid length
-    if ((end_ptr - ptr) < 18) {
-        // Minimum "RELAY-STATE-255,0,0,OK"
-        ESP_LOGW(TAG, "Response too short");
-        return ESP_FAIL;
-    }
-
-    // Fast header check - only check critical characters
-    if (ptr[0] != 'R' || ptr[5] != '-' ||
-        ptr[6] != 'S') {
-        // Matches both STATE and SET_ALL
-        ESP_LOGW(TAG, "Invalid header format");
-        return ESP_FAIL;
-    }
-
-    // Find the first comma after RELAY-STATE-255 or RELAY-SET_ALL-255
-    // Skip past any line feeds or other characters
-    ptr = strstr(ptr, "-255");
-    if (!ptr || (end_ptr - ptr) < 4) {
-        ESP_LOGW(TAG, "Missing -255 in response");
-        return ESP_FAIL;
-    }
-    ptr += 4; // Skip "-255"
-
-    // Skip any characters (including line feeds) until we find the first comma
-    while (ptr < end_ptr && *ptr != ',') ptr++;
-    if (!ptr || (end_ptr - ptr) < 4) {
-        // Need at least ",0,0"
-        ESP_LOGW(TAG, "Invalid format after header");
-        return ESP_FAIL;
-    }
-    ptr++; // Skip the comma
-
-    // Parse both numbers in one pass
-    char *next;
-
-    // Parse d1
-    long val = strtol(ptr, &next, 10);
-    if (next == ptr || val < 0 || val > 255 || *next != ',') {
-        ESP_LOGW(TAG, "Invalid d1 value");
-        return ESP_FAIL;
+esp_err_t RelayController::write_outputs(const RelayMask &mask) {
+    if (backend_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    const uint8_t d1 = static_cast<uint8_t>(val);
+    std::lock_guard lock(command_mutex_);
+    ESP_LOGV(TAG, "Writing outputs %s via %s", mask.to_string().c_str(), backend_->name());
 
-    // Parse d0
-    ptr = next + 1;
-    val = strtol(ptr, &next, 10);
-    if (next == ptr || val < 0 || val > 255) {
-        ESP_LOGW(TAG, "Invalid d0 value");
-        return ESP_FAIL;
+    const int64_t start_us = esp_timer_get_time();
+    RelayMask confirmed = mask;
+    if (const esp_err_t ret = backend_->write_outputs(mask, &confirmed); ret != ESP_OK) {
+        return ret;
     }
 
-    const uint8_t d0 = static_cast<uint8_t>(val);
+    const int64_t elapsed_us = esp_timer_get_time() - start_us;
+    record_latency(elapsed_us);
+    ESP_LOGD(TAG, "Outputs written in %lld us", elapsed_us);
 
-    // Quick check for OK (just verify 'O' and 'K' are present)
-    ptr = next;
-    while (ptr < end_ptr && (*ptr == ',' || *ptr <= ' ')) ptr++;
-    if (ptr >= end_ptr - 1 || ptr[0] != 'O' || ptr[1] != 'K') {
-        ESP_LOGW(TAG, "Missing OK confirmation");
-        return ESP_FAIL;
-    }
+    apply_relay_state(confirmed);
+    return ESP_OK;
+}
 
+void RelayController::apply_relay_state(const RelayMask &mask) {
     // Update state with single bitfield operation
-    relay_state_bitfield_ = (d1 << 8) | d0;
+    relay_state_bitfield_ = mask;
 
     // Fast currently selected relay calculation using hardware instructions
-    currently_selected_relay_ = relay_state_bitfield_ ? __builtin_ffs(relay_state_bitfield_) : 0;
-
-    // Update relay states with minimal operations
-    uint16_t mask = 1;
-    for (int i = 1; i <= NUM_RELAYS; ++i, mask <<= 1) {
-        relay_states_[i] = (relay_state_bitfield_ & mask) != 0;
-    }
+    currently_selected_relay_ = ActiveRelayBoard::first_set(relay_state_bitfield_);
 
-    ESP_LOGV(TAG, "Parsed relay states: D1=%d, D0=%d, selected=%d",
-             d1, d0, currently_selected_relay_);
-    return ESP_OK;
+    ESP_LOGV(TAG, "Relay states: %s, selected=%d", relay_state_bitfield_.to_string().c_str(),
+             currently_selected_relay_);
 }
 
-
 esp_err_t RelayController::verify_relay_state(int expected_relay) {
     // Add small delay to allow relay to settle
     vTaskDelay(pdMS_TO_TICKS(20));
     const int VERIFY_ATTEMPTS = 2;
-    const int VERIFY_TIMEOUT = 250;
 
     for (int i = 0; i < VERIFY_ATTEMPTS; i++) {
-        // Flush any pending responses before sending new query
-        char flush_buffer[128];
-        while (tcp_client->receive_message(flush_buffer, sizeof(flush_buffer), 300) == ESP_OK) {
-            ESP_LOGV(TAG, "Flushed pending response: %s", flush_buffer);
-        }
-
-        esp_err_t ret = send_command("RELAY-STATE-255", "OK", VERIFY_TIMEOUT);
-        if (ret == ESP_OK) {
+        if (update_all_relay_states() == ESP_OK) {
             if (currently_selected_relay_ == expected_relay) {
                 ESP_LOGD(TAG, "Verified relay state: %d", currently_selected_relay_);
                 return ESP_OK;
@@ -555,82 +553,111 @@ esp_err_t RelayController::verify_relay_state(int expected_relay) {
     return ESP_FAIL;
 }
 
-esp_err_t RelayController::send_command(const std::string &command,
-                                      const std::string &expected_response,
-                                      int timeout_ms,
-                                      int max_retries) {
-    static constexpr size_t RESPONSE_BUFFER_SIZE = 256;
-    static char response[RESPONSE_BUFFER_SIZE];
-    static constexpr char NEWLINE = '\n';
-    static constexpr auto SET_ALL_CMD = "RELAY-SET_ALL";
-    static constexpr auto STATE_CMD = "RELAY-STATE-255";
-    static constexpr auto OK_RESPONSE = ",OK";
-    
-    // Optimize timeout for SET_ALL commands
-    if (strstr(command.c_str(), SET_ALL_CMD) != nullptr) {
-        timeout_ms = std::max(timeout_ms, 1000);
+void RelayLatencyStats::record(const uint32_t sample_us) {
+    count++;
+    min_us = std::min(min_us, sample_us);
+    max_us = std::max(max_us, sample_us);
+    const double delta = sample_us - mean_us;
+    mean_us += delta / count;
+    m2 += delta * (sample_us - mean_us);
+}
+
+double RelayLatencyStats::jitter_us() const {
+    return count > 1 ? std::sqrt(m2 / (count - 1)) : 0.0;
+}
+
+void RelayController::record_latency(const int64_t elapsed_us) {
+    static constexpr uint32_t LOG_EVERY = 50;
+
+    latency_stats_.record(static_cast<uint32_t>(elapsed_us));
+    if (latency_stats_.count % LOG_EVERY == 0) {
+        ESP_LOGI(TAG, "%s command latency: n=%lu min=%lu avg=%.0f max=%lu jitter=%.0f us",
+                 backend_->name(),
+                 static_cast<unsigned long>(latency_stats_.count), static_cast<unsigned long>(latency_stats_.min_us),
+                 latency_stats_.mean_us, static_cast<unsigned long>(latency_stats_.max_us), latency_stats_.jitter_us());
+        backend_->log_stats();
     }
-    
-    const TickType_t start_time = xTaskGetTickCount();
-    std::lock_guard lock(command_mutex_);
-    
-    ESP_LOGD(TAG, "Starting command: %s", command.c_str());
-    last_command_ = command;  // Consider if this is really needed
+}
 
-    // Check connection once before sending
-    esp_err_t status = tcp_client->ensure_connected();
-    if (status != ESP_OK) {
-        ESP_LOGW(TAG, "Connection check failed: %s", esp_err_to_name(status));
-        return status;
+esp_err_t RelayController::start_rtt_probe(const int slot, const uint16_t samples) {
+    if (slot < 0 || slot >= RTT_PROBE_SLOTS || samples == 0 || samples > RTT_PROBE_MAX_SAMPLES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (backend_ == nullptr) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Prepare command buffer with newline
-    char cmd_buffer[128];
-    const size_t cmd_len = std::min(command.length(), sizeof(cmd_buffer) - 2);
-    memcpy(cmd_buffer, command.c_str(), cmd_len);
-    cmd_buffer[cmd_len] = NEWLINE;
-    cmd_buffer[cmd_len + 1] = '\0';
+    std::lock_guard lock(probe_mutex_);
+    if (probe_active_.load()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    probes_[slot] = RelayRttProbe{};
+    probes_[slot].running = true;
+    probe_slot_ = slot;
+    probe_target_ = samples;
+    probe_next_us_ = 0;
+    probe_active_.store(true);
+    ESP_LOGI(TAG, "Probing %s relay link round trip, %u samples", backend_->name(), samples);
+    return ESP_OK;
+}
 
-    // Send command
-    status = tcp_client->send_message(cmd_buffer);
-    if (status != ESP_OK) {
-        ESP_LOGW(TAG, "Send failed: %s", esp_err_to_name(status));
-        return status;
+RelayRttProbe RelayController::get_rtt_probe(const int slot) const {
+    if (slot < 0 || slot >= RTT_PROBE_SLOTS) {
+        return {};
     }
+    std::lock_guard lock(probe_mutex_);
+    return probes_[slot];
+}
 
-    // Receive response
-    status = tcp_client->receive_message(response, RESPONSE_BUFFER_SIZE, timeout_ms);
-    const TickType_t end_time = xTaskGetTickCount();
-    
-    if (status != ESP_OK) {
-        ESP_LOGW(TAG, "Receive failed: %s", esp_err_to_name(status));
-        return status;
-    }
-
-    ESP_LOGD(TAG, "Command completed in %lu ms", pdTICKS_TO_MS(end_time - start_time));
-    ESP_LOGV(TAG, "Raw response: '%s'", response);
-
-    // Process response based on command type
-    if (const char *cmd_str = command.c_str(); strstr(cmd_str, SET_ALL_CMD) != nullptr) {
-        // For SET_ALL, we just need OK in the response
-        if (strstr(response, OK_RESPONSE) != nullptr) {
-            ESP_LOGD(TAG, "SET_ALL command confirmed");
-            // Try to parse state but don't fail if we can't
-            parse_relay_state_response(response);
-            return ESP_OK;
-        }
-        ESP_LOGW(TAG, "SET_ALL command did not receive OK confirmation");
-        return ESP_FAIL;
+void RelayController::resume_link() {
+    // Requested first, so tcp_task sees it on the pass that finds the link no longer suspended
+    relink_requested_ = true;
+    link_suspended_ = false;
+}
+
+void RelayController::probe_step() {
+    const int64_t now_us = esp_timer_get_time();
+    if (now_us < probe_next_us_) {
+        return;
     }
-    else if (strstr(cmd_str, STATE_CMD) != nullptr) {
-        // For state queries, just parse the state
-        return parse_relay_state_response(response);
+    probe_next_us_ = now_us + RTT_PROBE_INTERVAL_MS * 1000;
+
+    // Same command as a state read after a band change, without adopting the result
+    RelayMask mask;
+    esp_err_t ret;
+    int64_t elapsed_us;
+    {
+        std::lock_guard lock(command_mutex_);
+        const int64_t start_us = esp_timer_get_time();
+        ret = backend_->read_outputs(&mask);
+        elapsed_us = esp_timer_get_time() - start_us;
     }
-    else if (!expected_response.empty()) {
-        // For other commands, check for expected response
-        return (strstr(response, expected_response.c_str()) != nullptr) ? ESP_OK : ESP_FAIL;
+    if (ret == ESP_ERR_TIMEOUT) {
+        backend_->recover();
     }
 
-    ESP_LOGW(TAG, "Unexpected response");
-    return ESP_FAIL;
+    std::lock_guard lock(probe_mutex_);
+    RelayRttProbe &probe = probes_[probe_slot_];
+    if (ret == ESP_OK) {
+        probe_samples_[probe.samples++] = static_cast<uint32_t>(elapsed_us);
+    } else {
+        probe.failures++;
+    }
+    if (probe.samples + probe.failures < probe_target_) {
+        return;
+    }
+
+    // Nearest-rank percentiles
+    const uint16_t n = probe.samples;
+    if (n > 0) {
+        std::sort(probe_samples_.begin(), probe_samples_.begin() + n);
+        probe.p50_us = probe_samples_[(n * 50 + 99) / 100 - 1];
+        probe.p99_us = probe_samples_[(n * 99 + 99) / 100 - 1];
+        probe.max_us = probe_samples_[n - 1];
+    }
+    probe.running = false;
+    probe_active_.store(false);
+    ESP_LOGI(TAG, "%s relay round trip: n=%u failed=%u p50=%lu p99=%lu max=%lu us", backend_->name(), n,
+             probe.failures, static_cast<unsigned long>(probe.p50_us), static_cast<unsigned long>(probe.p99_us),
+             static_cast<unsigned long>(probe.max_us));
 }
@@ -2,12 +2,24 @@
 #define RELAY_CONTROLLER_H
 
 #include "esp_err.h"
-#include "tcp_client.h"
+#include "relay_backend.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "static_task.h"
+#include <array>
 #include <cstdint>
 #include <map>
 #include <chrono>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <string>
+
+// Transport used to reach the relay board (antenna_switch_config_t::relay_transport)
+#define RELAY_TRANSPORT_TCP 0
+#define RELAY_TRANSPORT_UDP 1
+#define RELAY_TRANSPORT_RS485 2
 
 struct RelayChangeRequest {
     int relay_id;
@@ -25,11 +37,43 @@ struct RelayChangeRequest {
     }
 };
 
+// Round-trip latency of relay commands, used to compare transports on target
+struct RelayLatencyStats {
+    uint32_t count{0};
+    uint32_t min_us{UINT32_MAX};
+    uint32_t max_us{0};
+    double mean_us{0};
+    double m2{0}; // Welford running sum of squared deviations
+
+    void record(uint32_t sample_us);
+
+    // Standard deviation of the round-trip time
+    double jitter_us() const;
+};
+
+// Relay link round trips timed by RelayController::start_rtt_probe()
+struct RelayRttProbe {
+    bool running{false};
+    uint16_t samples{0};
+    uint16_t failures{0};
+    uint32_t p50_us{0};
+    uint32_t p99_us{0};
+    uint32_t max_us{0};
+};
+
 class RelayController {
 public:
-    static constexpr int NUM_RELAYS = 16;
+    static constexpr int NUM_RELAYS = ActiveRelayBoard::NUM_OUTPUTS;
     static constexpr int COOLDOWN_PERIOD_MS = 50;
-    static constexpr size_t MAX_RESPONSE_PARTS = 5;
+    // RelayChangeRequest::relay_id for a whole-board mask posted with request_outputs()
+    static constexpr int OUTPUT_MASK_REQUEST = -1;
+    // Bands remembered by get_last_selected_relay_for_band(), at least MAX_BANDS
+    static constexpr int MAX_TRACKED_BANDS = 16;
+    // Probe results kept side by side, e.g. one per network profile
+    static constexpr int RTT_PROBE_SLOTS = 4;
+    static constexpr uint16_t RTT_PROBE_MAX_SAMPLES = 200;
+    // Longer than a DTIM period, so probes meet the modem asleep as real band changes do
+    static constexpr int RTT_PROBE_INTERVAL_MS = 250;
 
     RelayController();
 
@@ -55,6 +99,22 @@ public:
 
     esp_err_t turn_off_all_relays_except(int relay_to_keep_on);
 
+    // Post the exact set of outputs for tcp_task to write in one command, without
+    // de-duplication. Returns a sequence number; the outputs are applied once
+    // get_applied_seq() reaches it.
+    uint32_t request_outputs(const RelayMask &outputs, int band_number);
+
+    uint32_t get_applied_seq() const { return applied_seq_.load(); }
+
+    // Requests posted that tcp_task has yet to apply
+    uint32_t get_request_backlog() const { return request_seq_.load() - applied_seq_.load(); }
+
+    // Whether any output is on or about to be switched on
+    bool has_outputs_on() const;
+
+    // Set bit in group each time tcp_task catches up with the latest request
+    void set_completion_event(EventGroupHandle_t group, EventBits_t bit);
+
     int get_last_selected_relay_for_band(int band_number) const;
 
     bool is_correct_relay_set(int band_number) const;
@@ -67,46 +127,94 @@ public:
 
     std::string get_tcp_host() const;
 
+    // RELAY_TRANSPORT_TCP, RELAY_TRANSPORT_UDP or RELAY_TRANSPORT_RS485; takes effect on init()
+    void set_transport(uint8_t transport);
+
+    uint8_t get_transport() const { return transport_; }
+
+    // Modbus slave address and bus speed for RELAY_TRANSPORT_RS485 (0 = default); takes effect on init()
+    void set_modbus_settings(uint8_t address, int baud_rate);
+
+    // TCP keepalive for the relay link; takes effect on init()
+    void set_keepalive(int idle_s, int interval_s, int count);
+
+    const RelayLatencyStats &get_latency_stats() const { return latency_stats_; }
+
+    // Time samples state reads on tcp_task into slot, between relay changes.
+    // ESP_ERR_INVALID_STATE while another probe is running.
+    esp_err_t start_rtt_probe(int slot, uint16_t samples);
+
+    RelayRttProbe get_rtt_probe(int slot) const;
+
+    // While the network is down tcp_task stops retrying the link and holds requests;
+    // resume_link() reconnects straight away instead of after the backend's backoff
+    void suspend_link() { link_suspended_ = true; }
+
+    void resume_link();
+
     uint16_t get_tcp_port() const;
 
     static void tcp_task(void *pvParameters);
 
 private:
-    static constexpr auto CMD_TERMINATOR = "OK";
-    static constexpr auto CMD_DELIMITER = ",";
-    static constexpr size_t NUM_DATA_BYTES = 2; // For 16 outputs (D1,D0), this may differ  w/ other models
-
-    std::array<std::string_view, MAX_RESPONSE_PARTS> response_parts_;
-
     void log_network_diagnostics() const;
 
-    std::unique_ptr<TCPClient> tcp_client;
-    std::map<int, bool> relay_states_;
-    std::map<int, int> last_selected_relay_for_band_;
+    std::unique_ptr<RelayBackend> backend_;
+    uint8_t transport_;
+    uint8_t modbus_address_;
+    int rs485_baud_rate_;
+    RelayLatencyStats latency_stats_;
+    // Fixed size so switching bands never allocates; 0 = none yet
+    std::array<int, MAX_TRACKED_BANDS> last_selected_relay_for_band_{};
     int currently_selected_relay_;
     std::chrono::steady_clock::time_point last_band_change_time_;
     std::string tcp_host_;
     uint16_t tcp_port_;
-    std::string last_command_;
-    std::mutex command_mutex_;
+    mutable std::mutex command_mutex_;
 
     bool should_delay() const;
 
+    void remember_relay_for_band(int band_number, int relay_id);
+
     esp_err_t execute_relay_change(int relay_id, int band_number);
 
+    esp_err_t execute_output_change(const RelayMask &outputs, int band_number);
+
     esp_err_t verify_relay_state(int expected_relay);
 
-    esp_err_t send_command(const std::string &command,
-                           const std::string &expected_response,
-                           int timeout_ms = 500,
-                           int max_retries = 2);
+    // Write every output in one backend call and adopt the state the board confirms
+    esp_err_t write_outputs(const RelayMask &mask);
+
+    void apply_relay_state(const RelayMask &mask);
+
+    void record_latency(int64_t elapsed_us);
+
+    // Take the next probe sample once it is due; tcp_task only
+    void probe_step();
 
-    esp_err_t parse_relay_state_response(const std::string &response);
+    int keepalive_idle_s_;
+    int keepalive_interval_s_;
+    int keepalive_count_;
+    mutable std::mutex probe_mutex_;
+    std::array<RelayRttProbe, RTT_PROBE_SLOTS> probes_;
+    std::array<uint32_t, RTT_PROBE_MAX_SAMPLES> probe_samples_{};
+    std::atomic<bool> probe_active_{false};
+    std::atomic<bool> link_suspended_{false};
+    std::atomic<bool> relink_requested_{false};
+    int probe_slot_{0};
+    uint16_t probe_target_{0};
+    int64_t probe_next_us_{0};
 
-    uint16_t relay_state_bitfield_;
+    RelayMask relay_state_bitfield_;
+    StaticTask<4096> tcp_task_;
     TaskHandle_t tcp_task_handle_;
     std::atomic<RelayChangeRequest> latest_request_;
     int last_band_number_;
+    std::atomic<uint64_t> requested_outputs_; // Mask for an OUTPUT_MASK_REQUEST
+    std::atomic<uint32_t> request_seq_;
+    std::atomic<uint32_t> applied_seq_;
+    EventGroupHandle_t completion_group_;
+    EventBits_t completion_bit_;
 };
 
 #endif // RELAY_CONTROLLER_H
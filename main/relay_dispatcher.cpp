@@ -0,0 +1,245 @@
+#include "relay_dispatcher.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "task_layout.h"
+#include "alloc_tracker.h"
+#include "freertos/task.h"
+#include <algorithm>
+
+static auto TAG = "RELAY_DISPATCHER";
+
+int RelayBoardRegistry::add_board(std::unique_ptr<RelayController> controller) {
+    if (!controller || boards_.size() >= MAX_RELAY_BOARDS) {
+        return -1;
+    }
+    boards_.push_back(std::move(controller));
+    return static_cast<int>(boards_.size()) - 1;
+}
+
+bool RelayBoardRegistry::locate(const int logical_output, Location *location) const {
+    if (logical_output < 1 || logical_output > total_outputs()) {
+        return false;
+    }
+    location->board = (logical_output - 1) / RelayController::NUM_RELAYS;
+    location->channel = (logical_output - 1) % RelayController::NUM_RELAYS + 1;
+    return true;
+}
+
+RelayMask RelayBoardRegistry::board_outputs(const LogicalOutputMask &outputs, const size_t board) {
+    RelayMask mask;
+    const size_t first = board * RelayController::NUM_RELAYS;
+    for (size_t i = 0; i < RelayController::NUM_RELAYS && first + i < outputs.size(); i++) {
+        mask[i] = outputs[first + i];
+    }
+    return mask;
+}
+
+LogicalOutputMask RelayBoardRegistry::mask_from_bytes(const uint8_t *bytes) {
+    LogicalOutputMask outputs;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        outputs[i] = bytes[i / 8] & (1 << (i % 8));
+    }
+    return outputs;
+}
+
+void RelayBoardRegistry::mask_to_bytes(const LogicalOutputMask &outputs, uint8_t *bytes) {
+    for (size_t i = 0; i < OUTPUT_MASK_BYTES; i++) {
+        bytes[i] = 0;
+    }
+    for (size_t i = 0; i < outputs.size(); i++) {
+        if (outputs[i]) {
+            bytes[i / 8] |= 1 << (i % 8);
+        }
+    }
+}
+
+RelayDispatcher::RelayDispatcher(RelayBoardRegistry &registry)
+    : registry_(registry), events_(nullptr), task_handle_(nullptr), settled_(true) {
+}
+
+RelayDispatcher::~RelayDispatcher() {
+    if (task_handle_ != nullptr) {
+        vTaskDelete(task_handle_);
+    }
+    if (events_ != nullptr) {
+        vEventGroupDelete(events_);
+    }
+}
+
+esp_err_t RelayDispatcher::start() {
+    if (task_handle_ != nullptr) {
+        return ESP_OK;
+    }
+
+#if CONFIG_ANTENNA_SWITCH_STATIC_ALLOCATION
+    events_ = xEventGroupCreateStatic(&events_buffer_);
+#else
+    events_ = xEventGroupCreate();
+#endif
+    if (events_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create event group");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < registry_.size(); i++) {
+        registry_.board(i)->set_completion_event(events_, BIT(i));
+    }
+    // The mutex is allocated on its first lock; keep that off the CAT tasks
+    {
+        std::lock_guard lock(mutex_);
+    }
+
+    if (task_.create(dispatch_task, "relay_dispatch", this, TASK_PRIORITY_DISPATCH, TASK_CORE_REALTIME,
+                     &task_handle_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create dispatcher task");
+        task_handle_ = nullptr;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Dispatching to %u relay board(s), %d outputs",
+             static_cast<unsigned>(registry_.size()), registry_.total_outputs());
+    return ESP_OK;
+}
+
+esp_err_t RelayDispatcher::select_output(const int logical_output, const int band_number) {
+    RelayBoardRegistry::Location target{};
+    if (!registry_.locate(logical_output, &target)) {
+        ESP_LOGE(TAG, "Invalid logical output: %d", logical_output);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGD(TAG, "Output %d -> board %d channel %d", logical_output, target.board, target.channel);
+    return select_outputs(LogicalOutputMask().set(logical_output - 1), band_number);
+}
+
+void RelayDispatcher::invalidate_selection() {
+    std::lock_guard lock(mutex_);
+    invalidated_ = true;
+}
+
+esp_err_t RelayDispatcher::select_outputs(const LogicalOutputMask &outputs, const int band_number) {
+    for (size_t i = registry_.total_outputs(); i < outputs.size(); i++) {
+        if (outputs[i]) {
+            ESP_LOGE(TAG, "Invalid logical output: %u", static_cast<unsigned>(i + 1));
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        // CAT polling repeats the same selection; boards already have it or are working on it
+        if (!invalidated_ && pending_.id != 0 && pending_.outputs == outputs && pending_.band_number == band_number) {
+            return ESP_OK;
+        }
+        invalidated_ = false;
+
+        const int64_t now_us = esp_timer_get_time();
+        if (!settled_.load()) {
+            stats_.superseded++;
+        }
+
+        Pending next{};
+        next.id = pending_.id + 1;
+        next.outputs = outputs;
+        next.band_number = band_number;
+        next.start_us = now_us;
+
+        // Post to every affected board before waiting on any of them, so they switch in parallel
+        for (size_t i = 0; i < registry_.size(); i++) {
+            RelayController *board = registry_.board(i);
+            const RelayMask board_mask = RelayBoardRegistry::board_outputs(outputs, i);
+            if (board_mask.none() && !board->has_outputs_on()) {
+                continue;
+            }
+            next.wanted_seq[i] = board->request_outputs(board_mask, band_number);
+            next.boards |= BIT(i);
+        }
+
+        pending_ = next;
+        stats_.dispatched++;
+        stats_.last_dispatch_us = now_us;
+        settled_.store(false);
+    }
+
+    if (events_ != nullptr) {
+        xEventGroupSetBits(events_, NEW_SELECTION_BIT);
+    }
+    return ESP_OK;
+}
+
+RelayDispatcher::Stats RelayDispatcher::get_stats() const {
+    std::lock_guard lock(mutex_);
+    return stats_;
+}
+
+void RelayDispatcher::dispatch_task(void *pvParameters) {
+    auto *dispatcher = static_cast<RelayDispatcher *>(pvParameters);
+    AllocTracker::watch_current_task();
+    while (true) {
+        xEventGroupWaitBits(dispatcher->events_, NEW_SELECTION_BIT, pdTRUE, pdFALSE, portMAX_DELAY);
+        dispatcher->track_completion();
+    }
+}
+
+void RelayDispatcher::track_completion() {
+    int64_t last_confirm_us = 0;
+    int slowest_board = -1;
+
+    while (true) {
+        Pending pending;
+        {
+            std::lock_guard lock(mutex_);
+            pending = pending_;
+        }
+
+        // Drop boards that have caught up; their bits may have been set before we started waiting
+        EventBits_t waiting = 0;
+        for (size_t i = 0; i < registry_.size(); i++) {
+            if (!(pending.boards & BIT(i))) {
+                continue;
+            }
+            if (static_cast<int32_t>(registry_.board(i)->get_applied_seq() - pending.wanted_seq[i]) >= 0) {
+                continue;
+            }
+            waiting |= BIT(i);
+        }
+
+        const int64_t now_us = esp_timer_get_time();
+        {
+            std::lock_guard lock(mutex_);
+            if (pending_.id != pending.id) {
+                // A newer selection replaced this one; track that instead
+                last_confirm_us = 0;
+                slowest_board = -1;
+                continue;
+            }
+
+            if (waiting == 0) {
+                stats_.completed++;
+                stats_.last_us = (last_confirm_us ? last_confirm_us : now_us) - pending.start_us;
+                stats_.max_us = std::max(stats_.max_us, stats_.last_us);
+                stats_.last_slowest_board = slowest_board;
+                settled_.store(true);
+                ESP_LOGI(TAG, "Band %d outputs confirmed by all boards in %lld us (slowest board %d)",
+                         pending.band_number, stats_.last_us, slowest_board);
+                return;
+            }
+
+            if (now_us - pending.start_us >= COMPLETION_TIMEOUT_MS * 1000LL) {
+                // Boards keep retrying on their own tasks; stop waiting so the next selection is tracked
+                stats_.timeouts++;
+                ESP_LOGW(TAG, "Band %d outputs not confirmed after %d ms, waiting on boards 0x%lx",
+                         pending.band_number, COMPLETION_TIMEOUT_MS, static_cast<unsigned long>(waiting));
+                return;
+            }
+        }
+
+        const int64_t remaining_ms = COMPLETION_TIMEOUT_MS - (now_us - pending.start_us) / 1000;
+        const EventBits_t bits = xEventGroupWaitBits(events_, waiting | NEW_SELECTION_BIT, pdTRUE, pdFALSE,
+                                                     pdMS_TO_TICKS(remaining_ms));
+        if (const EventBits_t confirmed = bits & waiting; confirmed) {
+            last_confirm_us = esp_timer_get_time();
+            slowest_board = __builtin_ctz(confirmed);
+        }
+    }
+}
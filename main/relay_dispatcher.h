@@ -0,0 +1,123 @@
+#pragma once
+
+#include "relay_controller.h"
+#include "static_task.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#define MAX_RELAY_BOARDS 4
+#define MAX_LOGICAL_OUTPUTS (MAX_RELAY_BOARDS * RELAY_BOARD_OUTPUTS)
+// Bytes in a stored logical output mask; byte 0 holds outputs 1-8
+#define OUTPUT_MASK_BYTES (MAX_LOGICAL_OUTPUTS / 8)
+
+// Bit 0 = logical output 1
+using LogicalOutputMask = std::bitset<MAX_LOGICAL_OUTPUTS>;
+
+// Relay boards in use; logical output L lives on board (L-1) / NUM_RELAYS,
+// channel (L-1) % NUM_RELAYS + 1. Board 0 is the primary (configured tcp_host).
+class RelayBoardRegistry {
+public:
+    struct Location {
+        int board;
+        int channel;
+    };
+
+    // Returns the new board index, or -1 if the registry is full
+    int add_board(std::unique_ptr<RelayController> controller);
+
+    size_t size() const { return boards_.size(); }
+
+    RelayController *board(const size_t index) const {
+        return index < boards_.size() ? boards_[index].get() : nullptr;
+    }
+
+    int total_outputs() const { return static_cast<int>(boards_.size()) * RelayController::NUM_RELAYS; }
+
+    // Returns false if the output is outside the registered boards
+    bool locate(int logical_output, Location *location) const;
+
+    static int logical_output(const int board, const int channel) {
+        return board * RelayController::NUM_RELAYS + channel;
+    }
+
+    // The part of outputs that lives on board
+    static RelayMask board_outputs(const LogicalOutputMask &outputs, size_t board);
+
+    static LogicalOutputMask mask_from_bytes(const uint8_t *bytes);
+
+    static void mask_to_bytes(const LogicalOutputMask &outputs, uint8_t *bytes);
+
+private:
+    std::vector<std::unique_ptr<RelayController> > boards_;
+};
+
+// Fans a selection out to every affected board at once and reports it
+// complete only when all of them have confirmed. Each board's tcp_task does
+// its own I/O, so the switch takes as long as the slowest board.
+class RelayDispatcher {
+public:
+    struct Stats {
+        uint32_t dispatched;
+        uint32_t completed;
+        uint32_t superseded; // Replaced by a newer selection before completing
+        uint32_t timeouts;
+        int64_t last_dispatch_us; // When the latest selection was posted to the boards
+        int64_t last_us; // Dispatch to last confirmation
+        int64_t max_us;
+        int last_slowest_board;
+    };
+
+    explicit RelayDispatcher(RelayBoardRegistry &registry);
+
+    ~RelayDispatcher();
+
+    esp_err_t start();
+
+    // Switch logical_output on and everything else off, across all boards
+    esp_err_t select_output(int logical_output, int band_number);
+
+    // Switch exactly outputs on, across all boards; each board gets a single SET_ALL
+    esp_err_t select_outputs(const LogicalOutputMask &outputs, int band_number);
+
+    // Relays were switched outside the dispatcher; send the next selection even if it repeats the last
+    void invalidate_selection();
+
+    // True once every board has confirmed the latest selection
+    bool is_settled() const { return settled_.load(); }
+
+    Stats get_stats() const;
+
+private:
+    static constexpr int COMPLETION_TIMEOUT_MS = 3000;
+    static constexpr EventBits_t NEW_SELECTION_BIT = BIT(MAX_RELAY_BOARDS);
+
+    struct Pending {
+        uint32_t id;
+        LogicalOutputMask outputs;
+        int band_number;
+        int64_t start_us;
+        EventBits_t boards;
+        std::array<uint32_t, MAX_RELAY_BOARDS> wanted_seq;
+    };
+
+    RelayBoardRegistry &registry_;
+    StaticTask<3072> task_;
+    EventGroupHandle_t events_;
+#if CONFIG_ANTENNA_SWITCH_STATIC_ALLOCATION
+    StaticEventGroup_t events_buffer_;
+#endif
+    TaskHandle_t task_handle_;
+    mutable std::mutex mutex_;
+    Pending pending_{};
+    bool invalidated_{false};
+    std::atomic<bool> settled_;
+    Stats stats_{};
+
+    static void dispatch_task(void *pvParameters);
+
+    void track_completion();
+};
@@ -0,0 +1,322 @@
+#include "rigctl_server.h"
+#include "cat_parser.h"
+#include "antenna_switch.h"
+#include "frequency_arbiter.h"
+#include "network_frequency_source.h"
+#include "config_manager.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lwip/sockets.h"
+#include "task_layout.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static auto TAG = "RIGCTL_SERVER";
+
+// Largest reply is \dump_state
+#define RIGCTL_REPLY_MAX 512
+
+// Hamlib NET rigctl error codes
+static constexpr int RIG_ENIMPL = -4;
+static constexpr int RIG_ENAVAIL = -11;
+
+// Capabilities in dump_state protocol 0, as expected by Hamlib's NET rigctl backend (model 2):
+// one RX and one TX range covering HF-UHF, generic steps and filters, no functions or levels
+static constexpr char DUMP_STATE[] =
+        "0\n"
+        "2\n"
+        "2\n"
+        "150000.000000 1500000000.000000 0x1ff -1 -1 0x10000003 0x3\n"
+        "0 0 0 0 0 0 0\n"
+        "150000.000000 1500000000.000000 0x1ff 5000 100000 0x10000003 0x3\n"
+        "0 0 0 0 0 0 0\n"
+        "0x1ff 1\n"
+        "0x1ff 0\n"
+        "0 0\n"
+        "0x1e 2400\n"
+        "0x2 500\n"
+        "0x1 8000\n"
+        "0x1 2400\n"
+        "0x20 15000\n"
+        "0x20 8000\n"
+        "0x40 230000\n"
+        "0 0\n"
+        "9990\n"
+        "9990\n"
+        "10000\n"
+        "0\n"
+        "10\n"
+        "10 20 30\n"
+        "0x0\n"
+        "0x0\n"
+        "0x0\n"
+        "0x0\n"
+        "0x0\n"
+        "0x0\n";
+
+RigctlServer &RigctlServer::instance() {
+    static RigctlServer server;
+    return server;
+}
+
+esp_err_t RigctlServer::start() {
+    if (running_.load()) {
+        return ESP_OK;
+    }
+    const auto &config = ConfigManager::instance().get_config();
+    if (config.rigctl_server_port == 0) {
+        ESP_LOGD(TAG, "rigctl server disabled");
+        return ESP_OK;
+    }
+    port_ = config.rigctl_server_port;
+    num_radios_ = std::clamp<int>(config.num_radios, 1, MAX_RADIOS);
+
+    for (int r = 0; r < MAX_RADIOS; r++) {
+        listeners_[r] = r < num_radios_ ? open_listener(port_ + r) : -1;
+    }
+    if (listeners_[0] < 0) {
+        return ESP_FAIL;
+    }
+    for (Client &client: clients_) {
+        client.sock = -1;
+    }
+
+    running_.store(true);
+    if (task_.create(task_trampoline, "rigctl_server", this, TASK_PRIORITY_NETWORK_SERVICES, TASK_CORE_NETWORK) !=
+        pdPASS) {
+        running_.store(false);
+        ESP_LOGE(TAG, "Failed to create rigctl server task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+const char *RigctlServer::hamlib_mode(const char *mode) {
+    // CatParser uses the decoders' names; Hamlib has its own for the sideband variants
+    static constexpr struct {
+        const char *cat;
+        const char *hamlib;
+    } MODES[] = {
+        {"CW-U", "CW"}, {"CW-L", "CWR"}, {"CWR", "CWR"}, {"DIG-U", "PKTUSB"}, {"DIG-L", "PKTLSB"},
+        {"DIG-FM", "PKTFM"}, {"RTTY-L", "RTTY"}, {"RTTY-U", "RTTYR"}, {"FM-N", "FM"}, {"AM-N", "AM"},
+        {"DIGI", "PKTUSB"}, {"FT8", "PKTUSB"}, {"FT4", "PKTUSB"}, {"PSK", "PKTUSB"},
+    };
+    if (mode == nullptr || mode[0] == '\0' || strcmp(mode, "UNKNOWN") == 0) {
+        return "USB";
+    }
+    for (const auto &[cat, hamlib]: MODES) {
+        if (strcmp(mode, cat) == 0) {
+            return hamlib;
+        }
+    }
+    // USB, LSB, AM, FM, WFM, CW and RTTY are spelled the same
+    return mode;
+}
+
+static int passband(const char *mode) {
+    if (strncmp(mode, "CW", 2) == 0 || strncmp(mode, "RTTY", 4) == 0) {
+        return 500;
+    }
+    if (strcmp(mode, "AM") == 0) {
+        return 6000;
+    }
+    if (strcmp(mode, "FM") == 0 || strcmp(mode, "PKTFM") == 0) {
+        return 15000;
+    }
+    return 2400;
+}
+
+bool RigctlServer::handle_command(const int radio, std::string_view line, char *out, const size_t out_size,
+                                  size_t *out_len) {
+    *out_len = 0;
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+        line.remove_suffix(1);
+    }
+    if (line.empty()) {
+        return true;
+    }
+
+    const CatParser &parser = CatParser::radio(radio);
+    // From the source the arbiter follows, so clients see the radio that switches the antennas
+    uint32_t frequency = parser.get_frequency();
+    bool transmitting = parser.is_transmitting();
+    const char *radio_mode = parser.get_mode();
+    if (antenna_switch_frequency_source(radio) == FREQ_SOURCE_NETWORK) {
+        const NetworkFrequencySource::RadioState network = NetworkFrequencySource::instance().get_radio_state(radio);
+        frequency = network.frequency;
+        transmitting = network.transmitting;
+        radio_mode = network.mode;
+    }
+    int len;
+    if (line == "f" || line == "\\get_freq") {
+        len = snprintf(out, out_size, "%lu\n", static_cast<unsigned long>(frequency));
+    } else if (line == "m" || line == "\\get_mode") {
+        const char *mode = hamlib_mode(radio_mode);
+        len = snprintf(out, out_size, "%s\n%d\n", mode, passband(mode));
+    } else if (line == "t" || line == "\\get_ptt") {
+        len = snprintf(out, out_size, "%d\n", transmitting ? 1 : 0);
+    } else if (line == "v" || line == "\\get_vfo") {
+        len = snprintf(out, out_size, "VFOA\n");
+    } else if (line == "s" || line == "\\get_split_vfo") {
+        len = snprintf(out, out_size, parser.is_split_on() ? "1\nVFOB\n" : "0\nVFOA\n");
+    } else if (line == "\\chk_vfo") {
+        len = snprintf(out, out_size, "0\n");
+    } else if (line == "\\get_powerstat") {
+        len = snprintf(out, out_size, "1\n");
+    } else if (line == "\\dump_state") {
+        len = snprintf(out, out_size, "%s", DUMP_STATE);
+    } else if (line == "q" || line == "Q" || line == "\\quit") {
+        return false;
+    } else if ((line[0] >= 'A' && line[0] <= 'Z') || line.substr(0, 5) == "\\set_") {
+        // Set commands: the radio is only listened to, never controlled from here
+        len = snprintf(out, out_size, "RPRT %d\n", RIG_ENAVAIL);
+    } else {
+        len = snprintf(out, out_size, "RPRT %d\n", RIG_ENIMPL);
+    }
+    *out_len = std::min(static_cast<size_t>(std::max(len, 0)), out_size - 1);
+    return true;
+}
+
+int RigctlServer::open_listener(const uint16_t port) const {
+    const int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        return -1;
+    }
+    constexpr int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(sock, 2) < 0) {
+        ESP_LOGE(TAG, "Unable to listen on port %u: errno %d", port, errno);
+        ::close(sock);
+        return -1;
+    }
+    ESP_LOGI(TAG, "rigctl server listening on port %u", port);
+    return sock;
+}
+
+void RigctlServer::accept_client(const int listener, const int radio) {
+    const int sock = accept(listener, nullptr, nullptr);
+    if (sock < 0) {
+        return;
+    }
+    Client *slot = nullptr;
+    for (Client &client: clients_) {
+        if (client.sock < 0) {
+            slot = &client;
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        stats_.rejected++;
+        ESP_LOGW(TAG, "All %d rigctl client slots busy, rejecting connection", RIGCTL_MAX_CLIENTS);
+        ::close(sock);
+        return;
+    }
+
+    // Replies are sent without blocking; a client that stops reading is dropped, not waited for
+    const int flags = fcntl(sock, F_GETFL, 0);
+    fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    constexpr int no_delay = 1;
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+    slot->sock = sock;
+    slot->radio = radio;
+    slot->length = 0;
+    stats_.accepted++;
+    client_count_++;
+    ESP_LOGD(TAG, "rigctl client connected for radio %d", radio + 1);
+}
+
+bool RigctlServer::serve_client(Client &client) {
+    const int received = recv(client.sock, client.line + client.length, sizeof(client.line) - client.length, 0);
+    if (received <= 0) {
+        return false;
+    }
+    client.length += received;
+
+    size_t start = 0;
+    for (size_t i = start; i < client.length; i++) {
+        if (client.line[i] != '\n') {
+            continue;
+        }
+        char reply[RIGCTL_REPLY_MAX];
+        size_t reply_len;
+        const bool keep = handle_command(client.radio, std::string_view(client.line + start, i - start), reply,
+                                         sizeof(reply), &reply_len);
+        start = i + 1;
+        if (!keep) {
+            return false;
+        }
+        stats_.commands++;
+        if (reply_len > 0 && send(client.sock, reply, reply_len, MSG_DONTWAIT) != static_cast<int>(reply_len)) {
+            stats_.dropped++;
+            return false;
+        }
+    }
+
+    // Keep the unfinished line; one that fills the buffer isn't a rigctl command
+    memmove(client.line, client.line + start, client.length - start);
+    client.length -= start;
+    if (client.length == sizeof(client.line)) {
+        stats_.dropped++;
+        return false;
+    }
+    return true;
+}
+
+void RigctlServer::drop_client(Client &client) {
+    ::close(client.sock);
+    client.sock = -1;
+    client.length = 0;
+    client_count_--;
+}
+
+void RigctlServer::task() {
+    while (running_.load()) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        int max_fd = -1;
+        for (int r = 0; r < num_radios_; r++) {
+            if (listeners_[r] >= 0) {
+                FD_SET(listeners_[r], &readfds);
+                max_fd = std::max(max_fd, listeners_[r]);
+            }
+        }
+        for (const Client &client: clients_) {
+            if (client.sock >= 0) {
+                FD_SET(client.sock, &readfds);
+                max_fd = std::max(max_fd, client.sock);
+            }
+        }
+
+        // Everything is event driven; the timeout only lets shutdown be noticed
+        timeval tv{};
+        tv.tv_sec = 1;
+        if (select(max_fd + 1, &readfds, nullptr, nullptr, &tv) <= 0) {
+            continue;
+        }
+
+        for (int r = 0; r < num_radios_; r++) {
+            if (listeners_[r] >= 0 && FD_ISSET(listeners_[r], &readfds)) {
+                accept_client(listeners_[r], r);
+            }
+        }
+        for (Client &client: clients_) {
+            if (client.sock >= 0 && FD_ISSET(client.sock, &readfds) && !serve_client(client)) {
+                drop_client(client);
+            }
+        }
+    }
+    vTaskDelete(nullptr);
+}
+
+void RigctlServer::task_trampoline(void *arg) {
+    static_cast<RigctlServer *>(arg)->task();
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "esp_err.h"
+#include "static_task.h"
+#include "antenna_switch.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Ten loggers and panadapters polling at once, across both radios
+#define RIGCTL_MAX_CLIENTS 10
+#define RIGCTL_LINE_MAX 64
+
+// Serves the decoder's cached radio state over the Hamlib NET rigctl protocol,
+// so loggers, panadapters and rotator software can read the frequency without
+// touching the radio's serial port. Radio N is on rigctl_server_port + N - 1.
+// One task multiplexes every client with select(); each client has a fixed
+// line buffer and is dropped if it overruns it or stops reading replies.
+//
+// Read-only: get commands are answered from CatParser, set commands get RPRT -11.
+class RigctlServer {
+public:
+    struct Stats {
+        uint32_t accepted;
+        uint32_t rejected; // Turned away because every client slot was busy
+        uint32_t commands;
+        uint32_t dropped; // Overran the line buffer or stopped reading
+    };
+
+    static RigctlServer &instance();
+
+    // Start listening if rigctl_server_port is set
+    esp_err_t start();
+
+    bool is_running() const { return running_.load(); }
+
+    int client_count() const { return client_count_.load(); }
+
+    Stats get_stats() const { return stats_; }
+
+    // Reply to one command line for radio in out (*out_len bytes, may be 0); false to close the connection
+    static bool handle_command(int radio, std::string_view line, char *out, size_t out_size, size_t *out_len);
+
+    // Hamlib mode name for a CatParser mode
+    static const char *hamlib_mode(const char *mode);
+
+private:
+    struct Client {
+        int sock;
+        int radio;
+        size_t length;
+        char line[RIGCTL_LINE_MAX];
+    };
+
+    RigctlServer() = default;
+
+    void task();
+
+    static void task_trampoline(void *arg);
+
+    int open_listener(uint16_t port) const;
+
+    void accept_client(int listener, int radio);
+
+    // Read what's available and answer every complete line; false if the client must go
+    bool serve_client(Client &client);
+
+    void drop_client(Client &client);
+
+    StaticTask<4096> task_;
+    std::atomic<bool> running_{false};
+    std::atomic<int> client_count_{0};
+    uint16_t port_{0};
+    int num_radios_{1};
+    int listeners_[MAX_RADIOS]{};
+    Client clients_[RIGCTL_MAX_CLIENTS]{};
+    Stats stats_{};
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <cstddef>
+
+// A task whose stack and control block live in this object when
+// CONFIG_ANTENNA_SWITCH_STATIC_ALLOCATION is set, so starting it takes nothing
+// from the heap; otherwise the same as xTaskCreatePinnedToCore. The object
+// must outlive the task.
+template<size_t STACK_SIZE>
+class StaticTask {
+public:
+    BaseType_t create(TaskFunction_t function, const char *name, void *arg, const UBaseType_t priority,
+                      const BaseType_t core, TaskHandle_t *handle = nullptr) {
+#if CONFIG_ANTENNA_SWITCH_STATIC_ALLOCATION
+        TaskHandle_t task = xTaskCreateStaticPinnedToCore(function, name, STACK_SIZE, arg, priority, stack_, &tcb_,
+                                                          core);
+        if (handle != nullptr) {
+            *handle = task;
+        }
+        return task != nullptr ? pdPASS : pdFAIL;
+#else
+        return xTaskCreatePinnedToCore(function, name, STACK_SIZE, arg, priority, handle, core);
+#endif
+    }
+
+private:
+#if CONFIG_ANTENNA_SWITCH_STATIC_ALLOCATION
+    // Stack depth is in bytes on ESP-IDF, and StackType_t is a byte
+    alignas(16) StackType_t stack_[STACK_SIZE];
+    StaticTask_t tcb_;
+#endif
+};
@@ -2,12 +2,21 @@
 
 #include <antenna_switch.h>
 #include <cat_parser.h>
+#include <network_frequency_source.h>
+#include <rigctl_server.h>
+#include <jitter_benchmark.h>
+#include <perf_monitor.h>
+#include <boot_timeline.h>
+#include <network_profile.h>
 #include <esp_event.h>
 #include <esp_netif.h>
 #include <esp_netif_types.h>
 #include <nvs.h>
 #include <nvs_flash.h>
 #include <wifi_manager.hpp>
+#include <config_manager.h>
+#include <connectivity_manager.h>
+#include <webserver.h>
 
 #include "esp_check.h"
 #include "esp_err.h"
@@ -15,16 +24,44 @@
 
 static auto TAG = "SYSTEM_INIT";
 
-static bool is_valid_ip() {
-    esp_netif_ip_info_t ip_info;
+// Every socket that can be open at once: httpd's clients, listener and control socket; rigctl's
+// clients, a listener per radio and one being turned away; the UDP and TCP frequency sources; and
+// a primary and standby link per relay board
+static_assert(WEBSERVER_MAX_OPEN_SOCKETS + 2 + RIGCTL_MAX_CLIENTS + MAX_RADIOS + 1 + 2 + MAX_RELAY_BOARDS * 2 <=
+              CONFIG_LWIP_MAX_SOCKETS, "CONFIG_LWIP_MAX_SOCKETS is too small for the network services");
+// The connected TCP sockets among them: httpd and rigctl clients, the rigctld client and the relay links.
+// Closed connections hold their PCB through TIME_WAIT, so leave room for reconnects on top
+static_assert(WEBSERVER_MAX_OPEN_SOCKETS + RIGCTL_MAX_CLIENTS + 1 + 1 + MAX_RELAY_BOARDS * 2 + 8 <=
+              CONFIG_LWIP_MAX_ACTIVE_TCP, "CONFIG_LWIP_MAX_ACTIVE_TCP is too small for the network services");
 
-    if (esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-        esp_netif_get_ip_info(netif, &ip_info) != ESP_OK) {
-        return false;
+// Relay boards reached over the network, registered before dispatch starts and
+// brought up once there is an IP address; owned by antenna_switch
+static RelayController *network_boards[MAX_RELAY_BOARDS];
+static int num_network_boards = 0;
+
+// Relay link keepalive of the configured network profile
+static void apply_keepalive(RelayController &board, const antenna_switch_config_t &config) {
+    const NetworkProfileSettings &profile = NetworkProfile::settings(config.network_profile);
+    board.set_keepalive(profile.keepalive_idle_s, profile.keepalive_interval_s, profile.keepalive_count);
+}
+
+// Boards after the primary share its network transport; RS485 is a single bus, so they fall back to TCP
+static void add_extra_relay_boards(const antenna_switch_config_t &config) {
+    const uint8_t transport =
+            config.relay_transport == RELAY_TRANSPORT_UDP ? RELAY_TRANSPORT_UDP : RELAY_TRANSPORT_TCP;
+
+    for (int i = 0; i < config.num_extra_boards && i < MAX_RELAY_BOARDS - 1; i++) {
+        auto board = std::make_unique<RelayController>();
+        board->set_transport(transport);
+        board->set_tcp_host(config.extra_board_hosts[i]);
+        board->set_tcp_port(config.extra_board_ports[i]);
+        apply_keepalive(*board, config);
+
+        RelayController *registered = board.get();
+        if (antenna_switch_add_relay_board(std::move(board)) == ESP_OK) {
+            network_boards[num_network_boards++] = registered;
+        }
     }
-    
-    // Check if we have a non-zero IP address
-    return ip_info.ip.addr != 0;
 }
 
 esp_err_t SystemInitializer::init_nvs() {
@@ -40,8 +77,7 @@ esp_err_t SystemInitializer::init_nvs() {
 esp_err_t SystemInitializer::init_task_watchdog() {
     // First try to delete any existing watchdog
     esp_task_wdt_deinit();
-    vTaskDelay(pdMS_TO_TICKS(100));  // Add delay after deinit
-    
+
     constexpr esp_task_wdt_config_t twdt_config = {
         .timeout_ms = 30000,      // Increase timeout to 30 seconds
         .idle_core_mask = (1 << 0), // Watch core 0
@@ -53,9 +89,7 @@ esp_err_t SystemInitializer::init_task_watchdog() {
         ESP_LOGE(TAG, "Failed to initialize watchdog: %s", esp_err_to_name(ret));
         return ret;
     }
-    
-    vTaskDelay(pdMS_TO_TICKS(100));  // Add delay after init
-    
+
     // Subscribe the main task to the watchdog
     ret = esp_task_wdt_add(xTaskGetCurrentTaskHandle());
     if (ret != ESP_OK) {
@@ -67,21 +101,29 @@ esp_err_t SystemInitializer::init_task_watchdog() {
 }
 
 esp_err_t SystemInitializer::initialize_basic() {
+    BootTimeline::init();
+
     // Initialize NVS first
     ESP_RETURN_ON_ERROR(init_nvs(), TAG, "Failed to initialize NVS");
-    vTaskDelay(pdMS_TO_TICKS(100));  // Add delay after NVS init
+    BootTimeline::mark(BootStage::NVS_READY);
+
+    // Wi-Fi reads its static address from here
+    ESP_RETURN_ON_ERROR(antenna_switch_init(), TAG, "Failed to initialize antenna switch");
+    BootTimeline::mark(BootStage::CONFIG_LOADED);
 
     // Initialize event loop before WiFi
     ESP_RETURN_ON_ERROR(esp_event_loop_create_default(), TAG, "Failed to create event loop");
-    vTaskDelay(pdMS_TO_TICKS(100));  // Add delay after event loop creation
 
-    // Initialize WiFi with more robust error handling
+    // Before Wi-Fi, so it sees every event; the web server comes up whenever there is an address
+    ESP_RETURN_ON_ERROR(ConnectivityManager::instance().start(), TAG, "Failed to start connectivity manager");
+    ConnectivityManager::instance().add_dependent("web server", webserver_start, [] { webserver_stop(); });
+
+    // Starts connecting in the background; initialize_network() waits for the address
     esp_err_t ret = WifiManager::instance().init();
     if (ret != ESP_OK && ret != ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGE(TAG, "Failed to initialize WiFi manager: %s", esp_err_to_name(ret));
         return ret;
     }
-    vTaskDelay(pdMS_TO_TICKS(100));  // Add delay after WiFi init
 
     // Initialize watchdog last
     ESP_RETURN_ON_ERROR(init_task_watchdog(), TAG, "Failed to initialize watchdog");
@@ -90,10 +132,7 @@ esp_err_t SystemInitializer::initialize_basic() {
 }
 
 esp_err_t SystemInitializer::initialize_full(RelayController** relay_controller_out) {
-    // Initialize antenna switch configuration
-    ESP_RETURN_ON_ERROR(antenna_switch_init(), TAG, "Failed to initialize antenna switch");
-
-    // Get the configuration
+    // Loaded by initialize_basic
     antenna_switch_config_t config;
     ESP_RETURN_ON_ERROR(antenna_switch_get_config(&config), TAG,
                         "Failed to get antenna switch configuration");
@@ -101,63 +140,132 @@ esp_err_t SystemInitializer::initialize_full(RelayController** relay_controller_
     // Create relay controller
     auto relay_controller = std::make_unique<RelayController>();
     
-    // Configure TCP settings if host is specified
-    if (strlen(config.tcp_host) > 0) {
-        relay_controller->set_tcp_host(config.tcp_host);
+    relay_controller->set_transport(config.relay_transport);
+    relay_controller->set_modbus_settings(config.modbus_address, config.rs485_baud_rate);
+    apply_keepalive(*relay_controller, config);
+
+    if (config.relay_transport == RELAY_TRANSPORT_RS485) {
+        // Wired bus to the board: no need to wait for the network
+        if (const esp_err_t ret = relay_controller->init(); ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to initialize relay controller: %s. Continuing without RS485 link",
+                     esp_err_to_name(ret));
+        }
+    } else if (strlen(config.tcp_host) > 0 || WifiManager::instance().softap_enabled()) {
+        // Connects once there is an IP address; selections made before then are held.
+        // On the SoftAP the board's lease replaces the host when it joins.
+        relay_controller->set_tcp_host(config.tcp_host[0] != '\0' ? config.tcp_host : SOFTAP_BOARD_DEFAULT_IP);
         relay_controller->set_tcp_port(config.tcp_port);
-        
-        ESP_LOGI(TAG, "Waiting for valid IP address...");
-        
-        // Wait up to 30 seconds for valid IP
-        constexpr int MAX_IP_WAIT_MS = 30000;
-        int waited_ms = 0;
-        
-        while (!is_valid_ip() && waited_ms < MAX_IP_WAIT_MS) {
-
-            constexpr int IP_CHECK_INTERVAL_MS = 500;
-
-            vTaskDelay(pdMS_TO_TICKS(IP_CHECK_INTERVAL_MS));
-            waited_ms += IP_CHECK_INTERVAL_MS;
-            
-            if (waited_ms % 1000 == 0) {
-                ESP_LOGI(TAG, "Waiting for IP address... %d/%d ms", 
-                         waited_ms, MAX_IP_WAIT_MS);
+        network_boards[num_network_boards++] = relay_controller.get();
+        // Reconnects only when the host or port is edited, including to follow the board's SoftAP lease
+        ConfigManager::instance().add_observer(CONFIG_FIELD_RELAY_LINK,
+                                               [board = relay_controller.get()](const antenna_switch_config_t &saved) {
+            if (saved.tcp_host[0] != '\0') {
+                board->update_tcp_settings(saved.tcp_host, saved.tcp_port);
             }
+        });
+    } else {
+        ESP_LOGW(TAG, "TCP host not configured. Continuing without TCP connection");
+    }
+
+    // Set the relay controller in antenna switch
+    *relay_controller_out = relay_controller.get();
+    antenna_switch_set_relay_controller(std::move(relay_controller));
+
+    add_extra_relay_boards(config);
+    if (const esp_err_t ret = antenna_switch_start_relay_dispatch(); ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start relay dispatch: %s", esp_err_to_name(ret));
+    } else {
+        BootTimeline::mark(BootStage::DISPATCH_STARTED);
+    }
+
+    // Decoding starts while Wi-Fi is still associating, so the band is known by the time the boards answer
+    ESP_RETURN_ON_ERROR(cat_parser_init(), TAG, "Failed to initialize CAT parser");
+    if (config.num_radios > 1) {
+        if (config.relay_transport == RELAY_TRANSPORT_RS485) {
+            // Both need UART1
+            ESP_LOGW(TAG, "Second radio is not available with the RS485 relay link");
+        } else if (const esp_err_t ret = CatParser::radio(1).init(); ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to initialize CAT parser for radio 2: %s", esp_err_to_name(ret));
+        }
+    }
+    BootTimeline::mark(BootStage::CAT_STARTED);
+    // Protocol and baud rate edits are picked up by the running UART tasks, without a restart
+    ConfigManager::instance().add_observer(CONFIG_FIELD_SERIAL, [](const antenna_switch_config_t &saved) {
+        if (const esp_err_t ret = cat_parser_update_config(saved); ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to update CAT parser configuration: %s", esp_err_to_name(ret));
         }
+    });
 
-        if (!is_valid_ip()) {
-            ESP_LOGW(TAG, "Timeout waiting for valid IP address. Continuing without TCP connection");
-        } else {
-            // Give network stack additional time to stabilize
-            vTaskDelay(pdMS_TO_TICKS(2000));
+    // Samples into a ring for /debug/perf and the "perf" console command
+    if (const esp_err_t ret = PerfMonitor::instance().start(); ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "Failed to start performance monitor: %s", esp_err_to_name(ret));
+    }
 
+    // Only built in with CONFIG_ANTENNA_SWITCH_JITTER_BENCHMARK; waits for the CAT link itself
+    if (const esp_err_t ret = JitterBenchmark::instance().start(); ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "Failed to start jitter benchmark: %s", esp_err_to_name(ret));
+    }
+    return ESP_OK;
+}
 
-            // Log network information for debugging
-            esp_netif_ip_info_t ip_info;
+esp_err_t SystemInitializer::initialize_network(const uint32_t timeout_ms) {
+    constexpr uint32_t WAIT_STEP_MS = 1000;
+    auto &connectivity = ConnectivityManager::instance();
 
-            if (esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-                esp_netif_get_ip_info(netif, &ip_info) == ESP_OK) {
-                ESP_LOGI(TAG, "Device IP: " IPSTR ", TCP Host: %s",
-                         IP2STR(&ip_info.ip), config.tcp_host);
-                ESP_LOGI(TAG, "WiFi connected, initializing TCP connection to %s:%d",
-                         config.tcp_host, config.tcp_port);
+    // Brought up by the connectivity task in this order once there is an address, on the
+    // station or the SoftAP, and taken down in reverse when both are gone
+    connectivity.add_dependent("relay link", [] {
+        // Connectivity task only
+        static bool initialized = false;
+        if (initialized) {
+            for (int i = 0; i < num_network_boards; i++) {
+                network_boards[i]->resume_link();
             }
-
-            if (const esp_err_t ret = relay_controller->init(); ret != ESP_OK) {
-                ESP_LOGW(TAG, "Failed to initialize relay controller: %s. Continuing without TCP connection", 
+            return ESP_OK;
+        }
+        char ip_addr[16];
+        if (WifiManager::instance().get_ip_info(ip_addr, sizeof(ip_addr)) == ESP_OK) {
+            ESP_LOGI(TAG, "Device IP: %s, connecting %d relay board(s)", ip_addr, num_network_boards);
+        }
+        for (int i = 0; i < num_network_boards; i++) {
+            // Connects in the background on the board's task
+            if (const esp_err_t ret = network_boards[i]->init(); ret != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to initialize relay board %d: %s. Continuing without it", i,
                          esp_err_to_name(ret));
-                // Don't return error - continue with initialization
             }
         }
-    } else {
-        ESP_LOGW(TAG, "TCP host not configured. Continuing without TCP connection");
-    }
-
-    // Initialize CAT parser after relay controller is ready
-    ESP_RETURN_ON_ERROR(cat_parser_init(), TAG, "Failed to initialize CAT parser");
+        initialized = true;
+        return ESP_OK;
+    }, [] {
+        for (int i = 0; i < num_network_boards; i++) {
+            network_boards[i]->suspend_link();
+        }
+    });
+    // Their sockets are bound to any address and work again once the network is back, so they are never stopped
+    connectivity.add_dependent("network services", [] {
+        // Loggers on the network can stand in for, or add to, the CAT cable
+        if (const esp_err_t ret = NetworkFrequencySource::instance().start(); ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to start network frequency sources: %s", esp_err_to_name(ret));
+        }
+        // Other software on the network reads the radios through us instead of their CAT ports
+        if (const esp_err_t ret = RigctlServer::instance().start(); ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to start rigctl server: %s", esp_err_to_name(ret));
+        }
+        BootTimeline::mark(BootStage::NETWORK_SERVICES_STARTED);
+        return ESP_OK;
+    }, nullptr);
 
-    // Set the relay controller in antenna switch
-    *relay_controller_out = relay_controller.get();
-    antenna_switch_set_relay_controller(std::move(relay_controller));
+    ESP_LOGI(TAG, "Waiting for IP address...");
+    // In steps, to keep the watchdog fed
+    for (uint32_t waited_ms = 0; BootTimeline::wait(BootStage::NETWORK_SERVICES_STARTED, WAIT_STEP_MS) != ESP_OK;) {
+        esp_task_wdt_reset();
+        waited_ms += WAIT_STEP_MS;
+        if (waited_ms >= timeout_ms) {
+            ESP_LOGW(TAG, "No IP address within %lu ms", static_cast<unsigned long>(timeout_ms));
+            return ESP_ERR_TIMEOUT;
+        }
+        ESP_LOGI(TAG, "Waiting for IP address... %lu/%lu ms", static_cast<unsigned long>(waited_ms),
+                 static_cast<unsigned long>(timeout_ms));
+    }
     return ESP_OK;
 }
@@ -5,8 +5,13 @@
 
 class SystemInitializer {
 public:
+    // NVS, configuration, event loop and watchdog; Wi-Fi connects in the background
     static esp_err_t initialize_basic();
+    // Everything that works without the network: relay dispatch and CAT decoding
     static esp_err_t initialize_full(RelayController** relay_controller_out);
+    // Brings up network relay boards and services once there is an IP address, waiting up to
+    // timeout_ms for it; on ESP_ERR_TIMEOUT they still start whenever the network comes up
+    static esp_err_t initialize_network(uint32_t timeout_ms);
 
 private:
     static esp_err_t init_nvs();
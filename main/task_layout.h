@@ -0,0 +1,26 @@
+#pragma once
+
+#include "sdkconfig.h"
+
+// Where the long-running tasks run, see Kconfig.projbuild. CAT decoding and the
+// relay dispatcher share one core; relay links, network services and the web
+// server share the other with Wi-Fi and lwIP.
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_CORE_REALTIME 0
+#define TASK_CORE_NETWORK 0
+#else
+#define TASK_CORE_REALTIME CONFIG_ANTENNA_SWITCH_REALTIME_CORE
+#define TASK_CORE_NETWORK (1 - CONFIG_ANTENNA_SWITCH_REALTIME_CORE)
+#endif
+
+#define TASK_PRIORITY_CAT CONFIG_ANTENNA_SWITCH_CAT_PRIORITY
+// Forwards PC bytes the radio is waiting for; never queued behind a decode
+#define TASK_PRIORITY_PC_BRIDGE (CONFIG_ANTENNA_SWITCH_CAT_PRIORITY + 1)
+#define TASK_PRIORITY_DISPATCH CONFIG_ANTENNA_SWITCH_DISPATCH_PRIORITY
+#define TASK_PRIORITY_RELAY_LINK CONFIG_ANTENNA_SWITCH_RELAY_LINK_PRIORITY
+#define TASK_PRIORITY_NETWORK_SERVICES CONFIG_ANTENNA_SWITCH_NETWORK_SERVICES_PRIORITY
+// Above the services it starts, so a link change is acted on before they notice it
+#define TASK_PRIORITY_CONNECTIVITY (CONFIG_ANTENNA_SWITCH_NETWORK_SERVICES_PRIORITY + 1)
+#define TASK_PRIORITY_HTTPD CONFIG_ANTENNA_SWITCH_HTTPD_PRIORITY
+// Just above idle, so sampling never delays real work
+#define TASK_PRIORITY_PERF_MONITOR 1
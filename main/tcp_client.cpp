@@ -5,13 +5,16 @@
 #include <arpa/inet.h>
 #include "esp_task_wdt.h"
 #include "esp_timer.h"
+#include "esp_random.h"
 #include <array>
 
 static auto TAG = "TCP_CLIENT";
 
-TCPClient::TCPClient() : sock(-1), port(0), dest_addr(), is_connected(false),
+TCPClient::TCPClient() : port(0), dest_addr(),
                          connect_timeout_sec_(5), keepalive_idle_(5),
-                         keepalive_interval_(3), keepalive_count_(3), last_reconnect_attempt_(0) {
+                         keepalive_interval_(3), keepalive_count_(3),
+                         primary_(0), standby_enabled_(true), failover_count_(0),
+                         pending_port_(0), reconnect_requested_(false) {
 }
 
 TCPClient::~TCPClient() {
@@ -19,51 +22,81 @@ TCPClient::~TCPClient() {
 }
 
 int TCPClient::get_sock() const {
-    return sock;
+    return links_[primary_].sock;
 }
 
-esp_err_t TCPClient::init(const char *host, const uint16_t port) {
-    if (sock >= 0) {
-        close();
-    }
+static int64_t now_ms() {
+    return esp_timer_get_time() / 1000;
+}
 
-    this->host = host;
-    this->port = port;
+const char *TCPClient::link_state_name(const LinkState state) {
+    switch (state) {
+        case LinkState::IDLE:
+            return "idle";
+        case LinkState::CONNECTING:
+            return "connecting";
+        case LinkState::VERIFYING:
+            return "verifying";
+        case LinkState::READY:
+            return "ready";
+        case LinkState::BACKOFF:
+            return "backoff";
+    }
+    return "unknown";
+}
 
-    // Add initial connection retry with backoff
-    constexpr int MAX_INIT_RETRIES = 3;
+void TCPClient::set_state(Link &link, const LinkState state) {
+    if (link.state.load() != state) {
+        ESP_LOGD(TAG, "Link %d: %s -> %s", link.sock, link_state_name(link.state.load()), link_state_name(state));
+        link.state.store(state);
+    }
+}
 
-    for (int retry = 0; retry < MAX_INIT_RETRIES; retry++) {
-        if (retry > 0) {
-            constexpr int INITIAL_RETRY_DELAY_MS = 200;
-            ESP_LOGW(TAG, "Retrying connection attempt %d/%d after delay", retry + 1, MAX_INIT_RETRIES);
-            vTaskDelay(pdMS_TO_TICKS(INITIAL_RETRY_DELAY_MS * (1 << retry)));
-        }
+esp_err_t TCPClient::init(const char *host, const uint16_t port) {
+    close();
 
-        if (const esp_err_t ret = connect_to_server(); ret == ESP_OK) {
-            // Successfully connected
-            return ESP_OK;
-        }
+    this->host = host;
+    this->port = port;
 
-        if (errno == ECONNRESET) {
-            ESP_LOGW(TAG, "Connection reset by peer, will retry");
-            continue;
+    // Both links start connecting here; poll() drives them to completion
+    for (size_t i = 0; i < links_.size(); i++) {
+        if (i == primary_ || standby_enabled_) {
+            links_[i].backoff_attempt = 0;
+            if (start_connect(links_[i]) != ESP_OK) {
+                ESP_LOGW(TAG, "Initial connect to %s:%d failed, retrying in background", host, port);
+            }
         }
+    }
+    return ESP_OK;
+}
 
-        // For other errors, close socket and retry
-        close();
+void TCPClient::request_reconnect(const std::string &host, const uint16_t port) {
+    {
+        std::lock_guard lock(pending_mutex_);
+        pending_host_ = host;
+        pending_port_ = port;
     }
+    reconnect_requested_.store(true);
+}
 
-    ESP_LOGE(TAG, "Failed to establish connection after %d attempts", MAX_INIT_RETRIES);
-    return ESP_FAIL;
+void TCPClient::request_reconnect() {
+    reconnect_requested_.store(true);
 }
 
-esp_err_t TCPClient::connect_to_server() {
-    sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
-    if (sock < 0) {
+void TCPClient::set_standby_enabled(const bool enabled) {
+    standby_enabled_ = enabled;
+}
+
+esp_err_t TCPClient::start_connect(Link &link) {
+    close_socket(link);
+
+    link.sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
+    if (link.sock < 0) {
         ESP_LOGE(TAG, "Unable to create socket: errno %d", errno);
+        enter_backoff(link);
         return ESP_FAIL;
     }
+    const int sock = link.sock;
 
     // Set socket options first (ESP-IDF pattern)
     constexpr int flag = 1;
@@ -71,28 +104,24 @@ esp_err_t TCPClient::connect_to_server() {
         ESP_LOGW(TAG, "Failed to set TCP_NODELAY: errno %d", errno);
     }
 
-    // Configure keepalive with ESP-IDF recommended values
+    // Configure keepalive from set_timeouts(); this is also what detects a dead standby
     constexpr int keepalive = 1;
-    constexpr int keepidle = 5; // Start probing after 5 seconds of idle
-    constexpr int keepintvl = 3; // Probe interval of 3 seconds
-    constexpr int keepcnt = 3; // Drop connection after 3 failed probes
-
     if (setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive)) < 0) {
         ESP_LOGW(TAG, "Failed to set SO_KEEPALIVE: errno %d", errno);
     }
-    if (setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepidle, sizeof(keepidle)) < 0) {
+    if (setsockopt(sock, IPPROTO_TCP, TCP_KEEPIDLE, &keepalive_idle_, sizeof(keepalive_idle_)) < 0) {
         ESP_LOGW(TAG, "Failed to set TCP_KEEPIDLE: errno %d", errno);
     }
-    if (setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepintvl, sizeof(keepintvl)) < 0) {
+    if (setsockopt(sock, IPPROTO_TCP, TCP_KEEPINTVL, &keepalive_interval_, sizeof(keepalive_interval_)) < 0) {
         ESP_LOGW(TAG, "Failed to set TCP_KEEPINTVL: errno %d", errno);
     }
-    if (setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(keepcnt)) < 0) {
+    if (setsockopt(sock, IPPROTO_TCP, TCP_KEEPCNT, &keepalive_count_, sizeof(keepalive_count_)) < 0) {
         ESP_LOGW(TAG, "Failed to set TCP_KEEPCNT: errno %d", errno);
     }
 
-    // Set initial timeouts for connection
+    // Timeouts for the blocking send/receive used once the link is ready
     timeval timeout;
-    timeout.tv_sec = 5;
+    timeout.tv_sec = connect_timeout_sec_;
     timeout.tv_usec = 0;
     if (setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
         ESP_LOGW(TAG, "Failed to set SO_RCVTIMEO: errno %d", errno);
@@ -105,96 +134,306 @@ esp_err_t TCPClient::connect_to_server() {
     dest_addr.sin_family = AF_INET;
     dest_addr.sin_port = htons(port);
 
-    // Non-blocking connection with timeout (ESP-IDF pattern)
+    // The socket stays non-blocking until verification completes
     const int flags = fcntl(sock, F_GETFL, 0);
     fcntl(sock, F_SETFL, flags | O_NONBLOCK);
 
-    int res = connect(sock, reinterpret_cast<struct sockaddr *>(&dest_addr), sizeof(dest_addr));
-    if (res == 0) {
-        is_connected = true;
-        fcntl(sock, F_SETFL, flags); // Set back to blocking
+    if (connect(sock, reinterpret_cast<struct sockaddr *>(&dest_addr), sizeof(dest_addr)) == 0) {
         ESP_LOGI(TAG, "Connected immediately to %s:%d", host.c_str(), port);
-        return verify_connection();
+        return start_verify(link);
     }
 
     if (errno != EINPROGRESS) {
         ESP_LOGE(TAG, "Socket connect failed: errno %d", errno);
-        close();
+        enter_backoff(link);
         return ESP_FAIL;
     }
 
-    // Wait for connection with timeout
-    fd_set write_fds;
-    FD_ZERO(&write_fds);
-    FD_SET(sock, &write_fds);
-
-    res = select(sock + 1, nullptr, &write_fds, nullptr, &timeout);
-    if (res <= 0) {
-        ESP_LOGE(TAG, "Connection %s", res == 0 ? "timed out" : "select failed");
-        close();
-        return res == 0 ? ESP_ERR_TIMEOUT : ESP_FAIL;
-    }
+    link.deadline_ms = now_ms() + connect_timeout_sec_ * 1000;
+    set_state(link, LinkState::CONNECTING);
+    return ESP_OK;
+}
 
-    // Verify connection success
-    int error;
+esp_err_t TCPClient::finish_connect(Link &link) {
+    int error = 0;
     socklen_t len = sizeof(error);
-    if (getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+    if (getsockopt(link.sock, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
         ESP_LOGE(TAG, "Connection failed: errno %d", error ? error : errno);
-        close();
+        enter_backoff(link);
         return ESP_FAIL;
     }
 
-    // Set back to blocking mode
-    fcntl(sock, F_SETFL, flags);
-
     ESP_LOGI(TAG, "Successfully connected to %s:%d", host.c_str(), port);
-    is_connected = true;
+    return start_verify(link);
+}
+
+esp_err_t TCPClient::start_verify(Link &link) {
+    const auto verify_cmd = "RELAY-STATE-255";
+    if (const int written = send(link.sock, verify_cmd, strlen(verify_cmd), 0); written < 0) {
+        ESP_LOGW(TAG, "Verification send failed: errno %d", errno);
+        enter_backoff(link);
+        return ESP_FAIL;
+    }
 
-    return verify_connection();
+    link.verify_len = 0;
+    link.verify_resp[0] = '\0';
+    link.deadline_ms = now_ms() + VERIFY_TIMEOUT_MS;
+    set_state(link, LinkState::VERIFYING);
+    return ESP_OK;
 }
 
-esp_err_t TCPClient::ensure_connected() {
-    if (!is_connected || !check_connection_status()) {
-        const TickType_t now = xTaskGetTickCount();
-        if ((now - last_reconnect_attempt_) < pdMS_TO_TICKS(RECONNECT_COOLDOWN_MS)) {
-            return ESP_ERR_INVALID_STATE;
+esp_err_t TCPClient::continue_verify(Link &link) {
+    const int len = recv(link.sock, link.verify_resp + link.verify_len,
+                         sizeof(link.verify_resp) - link.verify_len - 1, 0);
+    if (len < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return ESP_OK;
+        }
+        ESP_LOGW(TAG, "Verification receive failed: errno %d", errno);
+        enter_backoff(link);
+        return ESP_FAIL;
+    }
+    if (len == 0) {
+        ESP_LOGW(TAG, "Connection closed during verification");
+        enter_backoff(link);
+        return ESP_FAIL;
+    }
+
+    link.verify_len += len;
+    link.verify_resp[link.verify_len] = '\0';
+
+    if (strstr(link.verify_resp, "OK") == nullptr) {
+        if (link.verify_len >= sizeof(link.verify_resp) - 1) {
+            ESP_LOGW(TAG, "Invalid verification response");
+            enter_backoff(link);
+            return ESP_FAIL;
         }
+        return ESP_OK; // Wait for the rest of the response
+    }
+
+    // Back to blocking mode for command exchange
+    const int flags = fcntl(link.sock, F_GETFL, 0);
+    fcntl(link.sock, F_SETFL, flags & ~O_NONBLOCK);
+
+    link.is_connected = true;
+    link.was_ready = true;
+    link.backoff_attempt = 0;
+    link.next_check_ms = now_ms() + STANDBY_CHECK_MS;
+    set_state(link, LinkState::READY);
+    ESP_LOGI(TAG, "Connection verified successfully (%s)", &link == &primary() ? "primary" : "standby");
+    return ESP_OK;
+}
+
+void TCPClient::enter_backoff(Link &link) {
+    close_socket(link);
+
+    // Equal jitter: half the capped exponential delay is fixed, the other half random
+    const int shift = std::min(link.backoff_attempt, 5);
+    const int cap_ms = std::min(BACKOFF_BASE_MS << shift, BACKOFF_MAX_MS);
+    const int delay_ms = cap_ms / 2 + static_cast<int>(esp_random() % (cap_ms / 2 + 1));
+    link.backoff_attempt++;
+
+    link.deadline_ms = now_ms() + delay_ms;
+    set_state(link, LinkState::BACKOFF);
+    ESP_LOGW(TAG, "Link to %s:%d down, retry %d in %d ms", host.c_str(), port, link.backoff_attempt, delay_ms);
+}
 
-        ESP_LOGW(TAG, "Connection lost, attempting to reconnect...");
-        close();
-        last_reconnect_attempt_ = now;
+void TCPClient::drain(const Link &link) {
+    char scratch[64];
+    while (recv(link.sock, scratch, sizeof(scratch), MSG_DONTWAIT) > 0) {
+    }
+}
+
+void TCPClient::check_standby(Link &link) {
+    const int64_t now = now_ms();
+    if (now < link.next_check_ms) {
+        return;
+    }
+    link.next_check_ms = now + STANDBY_CHECK_MS;
+
+    // Lightweight liveness check: pending socket error or orderly close by the board.
+    // Dead peers without a FIN are caught by TCP keepalive and surface as SO_ERROR.
+    int error = 0;
+    socklen_t len = sizeof(error);
+    char peek;
+    const int res = recv(link.sock, &peek, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (getsockopt(link.sock, SOL_SOCKET, SO_ERROR, &error, &len) != 0 || error != 0 || res == 0 ||
+        (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        ESP_LOGW(TAG, "Standby connection lost, rebuilding");
+        link.backoff_attempt = 0;
+        enter_backoff(link);
+        return;
+    }
 
-        constexpr int MAX_RETRIES = 3;
-        for (int i = 0; i < MAX_RETRIES; i++) {
-            if (i > 0) {
-                vTaskDelay(pdMS_TO_TICKS(1000 * (1 << i))); // Exponential backoff
+    if (res > 0) {
+        // Nothing is sent on the standby, so anything received is stale
+        drain(link);
+    }
+}
+
+bool TCPClient::failover() {
+    if (!standby_enabled_ || standby().state.load() != LinkState::READY || !standby().is_connected) {
+        return false;
+    }
+
+    Link &old = primary();
+    primary_ ^= 1;
+    drain(primary());
+
+    // A primary still coming up just swaps roles and carries on connecting as the standby
+    if (!old.was_ready) {
+        ESP_LOGI(TAG, "Standby connection verified first, using it as primary");
+        return true;
+    }
+
+    old.was_ready = false;
+    failover_count_++;
+    if (old.state.load() == LinkState::READY) {
+        // Rebuild the failed connection in the background as the new standby
+        old.backoff_attempt = 0;
+        enter_backoff(old);
+    }
+
+    ESP_LOGW(TAG, "Failed over to standby connection (%lu failovers)", static_cast<unsigned long>(failover_count_));
+    return true;
+}
+
+void TCPClient::poll_link(Link &link, const int timeout_ms) {
+    const LinkState state = link.state.load();
+    switch (state) {
+        case LinkState::IDLE:
+            break;
+
+        case LinkState::READY:
+            if (&link != &primary()) {
+                check_standby(link);
             }
+            break;
 
-            const esp_err_t ret = connect_to_server();
-            if (ret == ESP_OK) {
-                ESP_LOGI(TAG, "Reconnection successful on attempt %d", i + 1);
-                return ESP_OK;
+        case LinkState::BACKOFF:
+            if (now_ms() >= link.deadline_ms) {
+                start_connect(link);
+            }
+            break;
+
+        case LinkState::CONNECTING:
+        case LinkState::VERIFYING: {
+            const int64_t remaining_ms = link.deadline_ms - now_ms();
+            if (remaining_ms <= 0) {
+                ESP_LOGW(TAG, "Link %s timed out", link_state_name(state));
+                enter_backoff(link);
+                break;
             }
 
-            ESP_LOGW(TAG, "Reconnection attempt %d/%d failed: %s",
-                     i + 1, MAX_RETRIES, esp_err_to_name(ret));
+            const int wait_ms = static_cast<int>(std::min<int64_t>(remaining_ms, timeout_ms));
+            timeval tv{};
+            tv.tv_sec = wait_ms / 1000;
+            tv.tv_usec = (wait_ms % 1000) * 1000;
+
+            fd_set fds;
+            FD_ZERO(&fds);
+            FD_SET(link.sock, &fds);
+
+            const bool connecting = state == LinkState::CONNECTING;
+            const int res = select(link.sock + 1, connecting ? nullptr : &fds, connecting ? &fds : nullptr,
+                                   nullptr, &tv);
+            if (res < 0) {
+                ESP_LOGE(TAG, "Select error: %d (%s)", errno, strerror(errno));
+                enter_backoff(link);
+            } else if (res > 0) {
+                if (connecting) {
+                    finish_connect(link);
+                } else {
+                    continue_verify(link);
+                }
+            }
+            break;
         }
-        return ESP_FAIL;
     }
-    return ESP_OK;
+}
+
+TCPClient::LinkState TCPClient::poll(const int timeout_ms) {
+    if (reconnect_requested_.exchange(false)) {
+        {
+            std::lock_guard lock(pending_mutex_);
+            if (!pending_host_.empty()) {
+                host = pending_host_;
+                port = pending_port_;
+                pending_host_.clear();
+            }
+        }
+        if (!host.empty()) {
+            ESP_LOGI(TAG, "Reconnecting to %s:%d", host.c_str(), port);
+            for (size_t i = 0; i < links_.size(); i++) {
+                close_socket(links_[i]);
+                links_[i].was_ready = false;
+                set_state(links_[i], LinkState::IDLE);
+                if (i == primary_ || standby_enabled_) {
+                    links_[i].backoff_attempt = 0;
+                    start_connect(links_[i]);
+                }
+            }
+        }
+    }
+
+    // A send/receive error on the active link: swap to the standby in one step
+    if (Link &active = primary(); active.state.load() == LinkState::READY && !active.is_connected) {
+        if (!failover()) {
+            active.backoff_attempt = 0;
+            enter_backoff(active);
+        }
+    } else if (active.state.load() != LinkState::READY) {
+        failover(); // Promote the standby if it came up first, or the primary is still down
+    }
+
+    if (!standby_enabled_ && standby().state.load() != LinkState::IDLE) {
+        close_socket(standby());
+        set_state(standby(), LinkState::IDLE);
+    } else if (standby_enabled_ && standby().state.load() == LinkState::IDLE &&
+               primary().state.load() != LinkState::IDLE) {
+        standby().backoff_attempt = 0;
+        start_connect(standby());
+    }
+
+    // Only links with a connection attempt in flight wait on readiness; split the wait if both do
+    auto waiting = [](const Link &link) {
+        const LinkState state = link.state.load();
+        return state == LinkState::CONNECTING || state == LinkState::VERIFYING;
+    };
+    const int wait_ms = waiting(primary()) && waiting(standby()) ? timeout_ms / 2 : timeout_ms;
+    poll_link(primary(), wait_ms);
+    poll_link(standby(), wait_ms);
+
+    return primary().state.load();
+}
+
+esp_err_t TCPClient::ensure_connected() {
+    const LinkState state = primary().state.load();
+    if (state == LinkState::READY && check_connection_status()) {
+        return ESP_OK;
+    }
+
+    if (state == LinkState::IDLE) {
+        // Explicitly closed; have poll() bring it back up
+        reconnect_requested_.store(true);
+    }
+
+    ESP_LOGD(TAG, "Link not ready (%s)", link_state_name(state));
+    return ESP_ERR_INVALID_STATE;
 }
 
 bool TCPClient::check_connection_status() {
-    if (!is_connected || sock < 0) {
+    Link &link = primary();
+    if (!link.is_connected || link.sock < 0) {
         return false;
     }
 
     int error = 0;
     socklen_t len = sizeof(error);
 
-    if (const int retval = getsockopt(sock, SOL_SOCKET, SO_ERROR, &error, &len); retval != 0 || error != 0) {
+    if (const int retval = getsockopt(link.sock, SOL_SOCKET, SO_ERROR, &error, &len); retval != 0 || error != 0) {
         ESP_LOGW(TAG, "Connection check failed: %d (%s)", error, strerror(error));
-        is_connected = false;
+        link.is_connected = false;
         return false;
     }
 
@@ -204,12 +443,9 @@ bool TCPClient::check_connection_status() {
 esp_err_t TCPClient::send_message(const std::string &message) {
     std::lock_guard lock(send_mutex_);
 
-    if (!is_connected) {
-        ESP_LOGW(TAG, "Not connected, attempting reconnect...");
-        if (const esp_err_t err = ensure_connected(); err != ESP_OK) {
-            return err;
-        }
-        vTaskDelay(pdMS_TO_TICKS(100));
+    if (!primary().is_connected) {
+        ESP_LOGW(TAG, "Not connected (%s), dropping send", link_state_name(get_link_state()));
+        return ESP_ERR_INVALID_STATE;
     }
 
     size_t total_sent = 0;
@@ -217,7 +453,7 @@ esp_err_t TCPClient::send_message(const std::string &message) {
     constexpr int MAX_RETRIES = 2;
 
     while (total_sent < message.length() && retry_count < MAX_RETRIES) {
-        const int written = send(sock, message.c_str() + total_sent,
+        const int written = send(primary().sock, message.c_str() + total_sent,
                                  message.length() - total_sent, 0);
         if (written < 0) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -227,7 +463,8 @@ esp_err_t TCPClient::send_message(const std::string &message) {
                 continue;
             }
             ESP_LOGE(TAG, "Send error: errno %d", errno);
-            is_connected = false;
+            // Roles only change in poll(), which swaps in the standby before the caller retries
+            primary().is_connected = false;
             return ESP_FAIL;
         }
 
@@ -258,6 +495,8 @@ esp_err_t TCPClient::receive_message(char *message, const size_t message_size, c
     ESP_LOGV(TAG, "Starting receive with %d ms timeout", timeout_ms);
 
     size_t total_received = 0;
+    Link &link = primary();
+    const int sock = link.sock;
 
     while (true) {
         const int64_t now = esp_timer_get_time() / 1000;
@@ -292,12 +531,13 @@ esp_err_t TCPClient::receive_message(char *message, const size_t message_size, c
 
             if (len < 0) {
                 ESP_LOGE(TAG, "Receive error: %d (%s)", errno, strerror(errno));
+                link.is_connected = false;
                 return ESP_FAIL;
             }
 
             if (len == 0) {
                 ESP_LOGW(TAG, "Connection closed by peer");
-                is_connected = false;
+                link.is_connected = false;
                 return ESP_FAIL;
             }
 
@@ -327,12 +567,20 @@ esp_err_t TCPClient::receive_message(char *message, const size_t message_size, c
 }
 
 
+void TCPClient::close_socket(Link &link) {
+    if (link.sock != -1) {
+        ::close(link.sock);
+        link.sock = -1;
+    }
+    link.is_connected = false;
+}
+
 void TCPClient::close() {
-    if (sock != -1) {
-        ::close(sock);
-        sock = -1;
+    for (auto &link: links_) {
+        close_socket(link);
+        link.was_ready = false;
+        set_state(link, LinkState::IDLE);
     }
-    is_connected = false;
 }
 
 void TCPClient::set_timeouts(const int connect_timeout_sec,
@@ -344,46 +592,3 @@ void TCPClient::set_timeouts(const int connect_timeout_sec,
     keepalive_interval_ = keepalive_interval;
     keepalive_count_ = keepalive_count;
 }
-
-esp_err_t TCPClient::verify_connection() {
-    if (!is_connected) {
-        return ESP_FAIL;
-    }
-
-    // Set shorter timeout for verification
-    timeval verify_timeout;
-    verify_timeout.tv_sec = 2; // 2 second timeout
-    verify_timeout.tv_usec = 0;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &verify_timeout, sizeof(verify_timeout));
-    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &verify_timeout, sizeof(verify_timeout));
-
-    // Send verification command
-    const auto verify_cmd = "RELAY-STATE-255";
-    if (const int written = send(sock, verify_cmd, strlen(verify_cmd), 0); written < 0) {
-        ESP_LOGW(TAG, "Verification send failed: errno %d", errno);
-        close();
-        return ESP_FAIL;
-    }
-
-    // Wait a bit before receiving
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    // Receive and verify response
-    char verify_resp[128];
-    const int len = recv(sock, verify_resp, sizeof(verify_resp) - 1, 0);
-    if (len < 0) {
-        ESP_LOGW(TAG, "Verification receive failed: errno %d", errno);
-        close();
-        return ESP_FAIL;
-    }
-
-    verify_resp[len] = '\0';
-    if (strstr(verify_resp, "OK") == nullptr) {
-        ESP_LOGW(TAG, "Invalid verification response");
-        close();
-        return ESP_FAIL;
-    }
-
-    ESP_LOGI(TAG, "Connection verified successfully");
-    return ESP_OK;
-}
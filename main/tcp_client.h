@@ -1,20 +1,44 @@
 #pragma once
 
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
 #include <string>
 #include <lwip/sockets.h>
+#include <array>
 #include <atomic>
+#include <mutex>
 
 class TCPClient {
 public:
+    // Link state machine: IDLE -> CONNECTING -> VERIFYING -> READY, with
+    // BACKOFF between failed attempts. Only poll() moves between states.
+    enum class LinkState : uint8_t {
+        IDLE,
+        CONNECTING,
+        VERIFYING,
+        READY,
+        BACKOFF
+    };
+
     TCPClient();
 
     ~TCPClient();
 
-    // Initialize connection to server
+    // Set the endpoint and start connecting in the background (never blocks)
     esp_err_t init(const char *host, uint16_t port);
 
-    // Send a message to the server
+    // Ask the owning task to drop the link and reconnect to a new endpoint
+    void request_reconnect(const std::string &host, uint16_t port);
+
+    // Ask the owning task to drop the link and reconnect to the endpoint it has, or the one pending
+    void request_reconnect();
+
+    // Advance the link state machines, waiting at most timeout_ms for socket readiness.
+    // Must be called from the task that owns the link.
+    LinkState poll(int timeout_ms);
+
+    // Send a message over the active link. A send error marks the link broken and
+    // fails; the next poll() moves to the standby and the caller resends there.
     esp_err_t send_message(const std::string &message);
 
     // Receive a message from the server
@@ -23,42 +47,103 @@ public:
     // Close the connection
     void close();
 
-    // Check if connected and reconnect if necessary
+    // Returns ESP_OK when the link is ready, otherwise fails fast and lets poll() reconnect
     esp_err_t ensure_connected();
 
     // Check current connection status
     bool check_connection_status();
 
-    // Get socket descriptor
+    // Get socket descriptor of the active link
     int get_sock() const;
 
+    LinkState get_link_state() const { return links_[primary_].state.load(); }
+
+    LinkState get_standby_state() const { return links_[primary_ ^ 1].state.load(); }
+
+    static const char *link_state_name(LinkState state);
+
+    // Response to the RELAY-STATE-255 probe sent while verifying the active connection
+    const char *get_verify_response() const { return links_[primary_].verify_resp; }
+
+    // Keep a second verified connection open for instant failover
+    void set_standby_enabled(bool enabled);
+
+    uint32_t get_failover_count() const { return failover_count_; }
+
     // Configure connection timeouts
     void set_timeouts(int connect_timeout_sec = 5,
                       int keepalive_idle = 5,
                       int keepalive_interval = 3,
                       int keepalive_count = 3);
 
-    esp_err_t verify_connection();
-
 private:
-    int sock;
+    // One TCP connection to the relay board and its state machine
+    struct Link {
+        int sock{-1};
+        bool is_connected{false};
+        std::atomic<LinkState> state{LinkState::IDLE};
+        bool was_ready{false}; // Verified since the last endpoint change; losing it as primary is a failover
+        int64_t deadline_ms{0}; // Connect/verify timeout or end of backoff
+        int64_t next_check_ms{0}; // Standby liveness check
+        int backoff_attempt{0};
+        char verify_resp[128]{};
+        size_t verify_len{0};
+    };
+
     std::string host;
     uint16_t port;
     sockaddr_in dest_addr;
-    bool is_connected;
     int connect_timeout_sec_;
     int keepalive_idle_;
     int keepalive_interval_;
     int keepalive_count_;
 
-    // Synchronization and timing
+    std::array<Link, 2> links_;
+    std::atomic<uint8_t> primary_; // Index of the link carrying commands; the other is the standby
+    bool standby_enabled_;
+    uint32_t failover_count_;
+
+    // Endpoint change posted by another task, applied by poll()
+    std::mutex pending_mutex_;
+    std::string pending_host_;
+    uint16_t pending_port_;
+    std::atomic<bool> reconnect_requested_;
+
+    // Synchronization
     std::mutex send_mutex_;
-    TickType_t last_reconnect_attempt_;
     // Constants
-    static constexpr int RECONNECT_COOLDOWN_MS = 5000;
+    static constexpr int VERIFY_TIMEOUT_MS = 2000;
+    static constexpr int BACKOFF_BASE_MS = 250;
+    static constexpr int BACKOFF_MAX_MS = 8000;
+    static constexpr int STANDBY_CHECK_MS = 1000;
     static constexpr int DEFAULT_TIMEOUT_MS = 1000;
 
     std::string send_buffer_; // Reusable send buffer
 
-    esp_err_t connect_to_server();
+    Link &primary() { return links_[primary_]; }
+
+    Link &standby() { return links_[primary_ ^ 1]; }
+
+    // Hand the primary role to a READY standby
+    bool failover();
+
+    void poll_link(Link &link, int timeout_ms);
+
+    void check_standby(Link &link);
+
+    esp_err_t start_connect(Link &link);
+
+    esp_err_t finish_connect(Link &link);
+
+    esp_err_t start_verify(Link &link);
+
+    esp_err_t continue_verify(Link &link);
+
+    void enter_backoff(Link &link);
+
+    static void drain(const Link &link);
+
+    static void close_socket(Link &link);
+
+    static void set_state(Link &link, LinkState state);
 };
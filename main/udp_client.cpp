@@ -4,6 +4,8 @@
 #include "lwip/sockets.h"
 #include "lwip/sys.h"
 #include <arpa/inet.h>
+#include "esp_timer.h"
+#include <algorithm>
 
 static const char *TAG = "UDP_CLIENT";
 
@@ -105,6 +107,179 @@ esp_err_t UDPClient::receive_message(char* message, size_t message_size, int tim
     return ESP_OK;
 }
 
+int UDPClient::current_rto_ms(const int timeout_ms) const {
+    if (stats_.srtt_us == 0) {
+        return std::min(INITIAL_RTO_MS, timeout_ms);
+    }
+    // RFC 6298: SRTT + max(G, 4 * RTTVAR), rounded up. Without the granularity term a steady
+    // link drives RTTVAR to nothing and the timeout below the round trip, so every request
+    // would be sent twice
+    const uint32_t rto_us = stats_.srtt_us + std::max<uint32_t>(CLOCK_GRANULARITY_US, 4 * stats_.rttvar_us);
+    const int rto_ms = static_cast<int>((rto_us + 999) / 1000);
+    return std::clamp(rto_ms, MIN_RTO_MS, std::max(timeout_ms, MIN_RTO_MS));
+}
+
+void UDPClient::update_rtt(const uint32_t sample_us) {
+    // RFC 6298 smoothing (alpha 1/8, beta 1/4)
+    if (stats_.srtt_us == 0) {
+        stats_.srtt_us = sample_us;
+        stats_.rttvar_us = sample_us / 2;
+        return;
+    }
+    const uint32_t err = sample_us > stats_.srtt_us ? sample_us - stats_.srtt_us : stats_.srtt_us - sample_us;
+    stats_.rttvar_us = (3 * stats_.rttvar_us + err) / 4;
+    stats_.srtt_us = (7 * stats_.srtt_us + sample_us) / 8;
+}
+
+// The board answers "<command>,<outputs>,OK". Requiring the comma keeps the reply to
+// SET_ALL-255,0,16 from matching SET_ALL-255,0,1.
+static bool is_reply_to(const char *reply, const char *command, const size_t command_len) {
+    const char *echo = strstr(reply, command);
+    return echo != nullptr && echo[command_len] == ',' && strstr(echo + command_len, "OK") != nullptr;
+}
+
+int UDPClient::drain_stale(const char *command) {
+    char rx_buffer[128];
+    int dropped = 0;
+    int len;
+    while ((len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, MSG_DONTWAIT, nullptr, nullptr)) > 0) {
+        rx_buffer[len] = '\0';
+        if (owed_replies_ > 0 && is_reply_to(rx_buffer, owed_command_, strlen(owed_command_))) {
+            owed_replies_--;
+        }
+        dropped++;
+    }
+    if (dropped > 0) {
+        ESP_LOGV(TAG, "Dropped %d stale datagrams before %s", dropped, command);
+    }
+    return dropped;
+}
+
+void UDPClient::expect_late_replies(const char *command, const int count, const int64_t until_us) {
+    if (count <= 0) {
+        return;
+    }
+    if (strlen(command) >= sizeof(owed_command_)) {
+        return; // Longer than any KC868 command
+    }
+    // Any still owed are for this command too, or request() would have forgotten them
+    strcpy(owed_command_, command);
+    owed_replies_ += count;
+    owed_until_us_ = std::max(owed_until_us_, until_us);
+}
+
+esp_err_t UDPClient::request(const char *command, char *response, const size_t response_size,
+                             const int timeout_ms, const int max_retries) {
+    if (sock < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!command || !response || response_size <= 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint32_t seq = ++seq_;
+    stats_.requests++;
+
+    // Late replies for another command never match this one, and none come after the timeout
+    if (esp_timer_get_time() >= owed_until_us_ || strcmp(command, owed_command_) != 0) {
+        owed_replies_ = 0;
+    }
+    // Replies still queued from retransmissions of earlier requests must not match this one
+    stats_.stale_dropped += drain_stale(command);
+
+    const size_t command_len = strlen(command);
+    int rto_ms = current_rto_ms(timeout_ms);
+    char rx_buffer[128];
+    int64_t last_sent_us = 0;
+
+    for (int attempt = 0; attempt <= max_retries; attempt++) {
+        if (attempt > 0) {
+            stats_.retransmits++;
+            rto_ms = std::min(rto_ms * 2, timeout_ms);
+            ESP_LOGD(TAG, "Retransmitting #%lu (attempt %d, rto %d ms): %s",
+                     static_cast<unsigned long>(seq), attempt + 1, rto_ms, command);
+        }
+
+        const int64_t sent_us = esp_timer_get_time();
+        last_sent_us = sent_us;
+        if (sendto(sock, command, command_len, 0, reinterpret_cast<sockaddr *>(&dest_addr), sizeof(dest_addr)) < 0) {
+            ESP_LOGE(TAG, "Error occurred during sending: errno %d (%s)", errno, strerror(errno));
+            stats_.failures++;
+            return ESP_FAIL;
+        }
+
+        const int64_t deadline_us = sent_us + static_cast<int64_t>(rto_ms) * 1000;
+        int64_t now_us = sent_us;
+        while (now_us < deadline_us) {
+            const int64_t wait_us = deadline_us - now_us;
+            timeval tv{};
+            tv.tv_sec = static_cast<time_t>(wait_us / 1000000);
+            tv.tv_usec = static_cast<suseconds_t>(wait_us % 1000000);
+
+            fd_set readfds;
+            FD_ZERO(&readfds);
+            FD_SET(sock, &readfds);
+
+            const int activity = select(sock + 1, &readfds, nullptr, nullptr, &tv);
+            if (activity < 0) {
+                ESP_LOGE(TAG, "Select error: errno %d (%s)", errno, strerror(errno));
+                stats_.failures++;
+                return ESP_ERR_INVALID_STATE;
+            }
+            if (activity == 0) {
+                break;
+            }
+
+            sockaddr_in source_addr{};
+            socklen_t socklen = sizeof(source_addr);
+            const int len = recvfrom(sock, rx_buffer, sizeof(rx_buffer) - 1, 0,
+                                     reinterpret_cast<sockaddr *>(&source_addr), &socklen);
+            now_us = esp_timer_get_time();
+            if (len <= 0) {
+                continue;
+            }
+            rx_buffer[len] = '\0';
+
+            // Match on source and on the echoed command; anything else is a stale or foreign reply
+            if (source_addr.sin_addr.s_addr != dest_addr.sin_addr.s_addr ||
+                !is_reply_to(rx_buffer, command, command_len)) {
+                stats_.stale_dropped++;
+                ESP_LOGV(TAG, "Ignoring unmatched datagram for #%lu: %s", static_cast<unsigned long>(seq), rx_buffer);
+                continue;
+            }
+
+            // Indistinguishable from a late reply to the previous, retransmitted command, so
+            // it counts as one; at worst this costs a retransmission, never a stale answer
+            if (owed_replies_ > 0 && now_us < owed_until_us_) {
+                owed_replies_--;
+                stats_.stale_dropped++;
+                ESP_LOGV(TAG, "Taking reply for #%lu as a late duplicate, %d more owed",
+                         static_cast<unsigned long>(seq), owed_replies_);
+                continue;
+            }
+
+            // Karn's rule: only unambiguous (first transmission) replies update the RTT estimate
+            if (attempt == 0) {
+                update_rtt(static_cast<uint32_t>(now_us - sent_us));
+            }
+
+            // Every other transmission may still be answered
+            expect_late_replies(command, attempt, last_sent_us + static_cast<int64_t>(timeout_ms) * 1000);
+
+            strncpy(response, rx_buffer, response_size - 1);
+            response[response_size - 1] = '\0';
+            ESP_LOGV(TAG, "Request #%lu completed in %lld us: %s",
+                     static_cast<unsigned long>(seq), now_us - sent_us, response);
+            return ESP_OK;
+        }
+    }
+
+    expect_late_replies(command, max_retries + 1, last_sent_us + static_cast<int64_t>(timeout_ms) * 1000);
+    stats_.failures++;
+    ESP_LOGW(TAG, "No reply to #%lu after %d attempts: %s", static_cast<unsigned long>(seq), max_retries + 1, command);
+    return ESP_ERR_TIMEOUT;
+}
+
 void UDPClient::close() {
     if (sock != -1) {
         ::close(sock);
@@ -17,6 +17,24 @@ public:
 
     esp_err_t receive_message(char *message, size_t message_size, int timeout_ms) const;
 
+    // Send a command and wait for the matching reply, retransmitting on timeout.
+    // The KC868 protocol has no sequence field, so replies are matched on text alone:
+    // one matches when it echoes the whole command, then the outputs and "OK". Late
+    // replies to a retransmitted command look the same, see owed_replies_.
+    esp_err_t request(const char *command, char *response, size_t response_size,
+                      int timeout_ms, int max_retries = 2);
+
+    struct Stats {
+        uint32_t requests;
+        uint32_t retransmits;
+        uint32_t stale_dropped; // Late duplicates and replies to earlier requests
+        uint32_t failures;
+        uint32_t srtt_us; // Smoothed round-trip time
+        uint32_t rttvar_us; // Round-trip time variation
+    };
+
+    const Stats &get_stats() const { return stats_; }
+
     int get_sock();
     void close();
 
@@ -24,4 +42,26 @@ private:
     int sock;
     struct sockaddr_in dest_addr{};
 
+    uint32_t seq_{0}; // Numbers requests in the logs; nothing on the wire carries it
+    Stats stats_{};
+
+    // Replies still due for extra transmissions of the last command. Until they are in
+    // or that command's timeout has passed, as many matching replies to the same command
+    // are taken for them: a stale STATE or SET_ALL reply must not answer a new request.
+    char owed_command_[64]{};
+    int owed_replies_{0};
+    int64_t owed_until_us_{0};
+
+    static constexpr int MIN_RTO_MS = 20;
+    static constexpr int INITIAL_RTO_MS = 100;
+    static constexpr uint32_t CLOCK_GRANULARITY_US = 1000;
+
+    int current_rto_ms(int timeout_ms) const;
+
+    void update_rtt(uint32_t sample_us);
+
+    int drain_stale(const char *command);
+
+    void expect_late_replies(const char *command, int count, int64_t until_us);
+
 };
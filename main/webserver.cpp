@@ -22,6 +22,16 @@
 // Headers with C interfaces
 #include "antenna_switch.h"
 #include "cat_parser.h"
+#include "network_frequency_source.h"
+#include "rigctl_server.h"
+#include "jitter_benchmark.h"
+#include "alloc_tracker.h"
+#include "perf_monitor.h"
+#include "boot_timeline.h"
+#include "network_profile.h"
+#include "connectivity_manager.h"
+#include "frequency_arbiter.h"
+#include "task_layout.h"
 
 static auto TAG = "WEBSERVER";
 
@@ -79,7 +89,11 @@ static esp_err_t config_get_handler(httpd_req_t *req) {
         ESP_LOGD(TAG, "Resetting number of bands to %d", config.num_bands);
 
         // Save the corrected configuration to NVS
-        if (const esp_err_t save_ret = antenna_switch_set_config(&config); save_ret != ESP_OK) {
+        if (const esp_err_t save_ret = ConfigManager::instance().modify([](antenna_switch_config_t &current) {
+            if (current.num_bands <= 0 || current.num_bands > MAX_BANDS) {
+                current.num_bands = 1;
+            }
+        }); save_ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to save corrected configuration: %s", esp_err_to_name(save_ret));
             httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save corrected configuration");
             return ESP_FAIL;
@@ -140,6 +154,20 @@ static int find_active_port(const uint32_t current_freq, const antenna_switch_co
     return active_antenna;
 }
 
+// [1, 9, 12] -> output mask bytes; false if an entry isn't a valid logical output
+static bool parse_output_list(const cJSON *list, uint8_t *bytes) {
+    LogicalOutputMask outputs;
+    const cJSON *item = nullptr;
+    cJSON_ArrayForEach(item, list) {
+        if (!cJSON_IsNumber(item) || item->valueint < 1 || item->valueint > MAX_LOGICAL_OUTPUTS) {
+            return false;
+        }
+        outputs.set(item->valueint - 1);
+    }
+    RelayBoardRegistry::mask_to_bytes(outputs, bytes);
+    return true;
+}
+
 static esp_err_t status_get_handler(httpd_req_t *req) {
     // Get current frequency from CAT parser
     const uint32_t current_freq = cat_parser_get_frequency();
@@ -159,6 +187,115 @@ static esp_err_t status_get_handler(httpd_req_t *req) {
     cJSON_AddNumberToObject(root, "frequency", current_freq);
     cJSON_AddStringToObject(root, "antenna", active_antenna ? 
         ("Antenna " + std::to_string(active_antenna)).c_str() : "None");
+    // False while any relay board has yet to confirm the latest band change
+    cJSON_AddBoolToObject(root, "settled", antenna_switch_outputs_settled());
+
+    cJSON_AddNumberToObject(root, "manual_hold_ms", static_cast<double>(antenna_switch_manual_hold_remaining_ms()));
+
+    // Per radio: frequency and the outputs the arbiter granted it
+    cJSON *radios = cJSON_AddArrayToObject(root, "radios");
+    for (int r = 0; r < std::max<int>(config.num_radios, 1) && r < MAX_RADIOS; r++) {
+        cJSON *radio = cJSON_CreateObject();
+        // CAT and network state are kept apart; show the one the arbiter follows
+        const int source = antenna_switch_frequency_source(r);
+        if (source == FREQ_SOURCE_NETWORK) {
+            const NetworkFrequencySource::RadioState network =
+                    NetworkFrequencySource::instance().get_radio_state(r);
+            cJSON_AddNumberToObject(radio, "frequency", network.frequency);
+            cJSON_AddBoolToObject(radio, "transmitting", network.transmitting);
+        } else {
+            cJSON_AddNumberToObject(radio, "frequency", CatParser::radio(r).get_frequency());
+            cJSON_AddBoolToObject(radio, "transmitting", CatParser::radio(r).is_transmitting());
+        }
+        cJSON_AddStringToObject(radio, "protocol", cat_protocol_name(CatParser::radio(r).get_protocol()));
+        cJSON_AddNumberToObject(radio, "baud_rate", CatParser::radio(r).get_baud_rate());
+        cJSON_AddBoolToObject(radio, "locked", CatParser::radio(r).is_link_locked());
+        cJSON_AddStringToObject(radio, "frequency_source", FrequencyArbiter::source_name(source));
+        cJSON_AddNumberToObject(radio, "polls_sent", CatParser::radio(r).get_polls_sent());
+        cJSON_AddNumberToObject(radio, "poll_interval_ms", CatParser::radio(r).get_poll_interval_ms());
+        const CatRxStats rx = CatParser::radio(r).get_rx_stats();
+        cJSON *rx_stats = cJSON_AddObjectToObject(radio, "rx");
+        cJSON_AddNumberToObject(rx_stats, "bytes", rx.bytes);
+        cJSON_AddNumberToObject(rx_stats, "frames", rx.frames);
+        cJSON_AddNumberToObject(rx_stats, "overflows", rx.overflows);
+        cJSON_AddNumberToObject(rx_stats, "pattern_overflows", rx.pattern_overflows);
+        cJSON_AddNumberToObject(rx_stats, "line_errors", rx.line_errors);
+        if (const CatParser &parser = CatParser::radio(r); parser.is_pc_bridged()) {
+            cJSON *bridge = cJSON_AddObjectToObject(radio, "pc_bridge");
+            cJSON_AddNumberToObject(bridge, "bytes_to_radio", parser.get_mux().bytes_to_radio());
+            cJSON_AddNumberToObject(bridge, "bytes_to_pc", parser.get_mux().bytes_to_pc());
+            cJSON_AddNumberToObject(bridge, "replies_dropped", parser.get_mux().replies_dropped());
+        }
+        cJSON *outputs = cJSON_AddArrayToObject(radio, "outputs");
+        const LogicalOutputMask granted = antenna_switch_radio_outputs(r);
+        for (size_t i = 0; i < granted.size(); i++) {
+            if (granted[i]) {
+                cJSON_AddItemToArray(outputs, cJSON_CreateNumber(static_cast<double>(i + 1)));
+            }
+        }
+        cJSON_AddItemToArray(radios, radio);
+    }
+
+    if (const NetworkFrequencySource &source = NetworkFrequencySource::instance(); source.is_running()) {
+        const NetworkFrequencySource::Stats stats = source.get_stats();
+        cJSON *network = cJSON_AddObjectToObject(root, "network_sources");
+        cJSON_AddNumberToObject(network, "datagrams", stats.datagrams);
+        cJSON_AddNumberToObject(network, "radio_infos", stats.radio_infos);
+        cJSON_AddNumberToObject(network, "malformed", stats.malformed);
+        cJSON_AddNumberToObject(network, "rigctld_polls", stats.rigctld_polls);
+        cJSON_AddNumberToObject(network, "rigctld_errors", stats.rigctld_errors);
+    }
+    if (const RigctlServer &server = RigctlServer::instance(); server.is_running()) {
+        const RigctlServer::Stats stats = server.get_stats();
+        cJSON *rigctl = cJSON_AddObjectToObject(root, "rigctl_server");
+        cJSON_AddNumberToObject(rigctl, "clients", server.client_count());
+        cJSON_AddNumberToObject(rigctl, "accepted", stats.accepted);
+        cJSON_AddNumberToObject(rigctl, "rejected", stats.rejected);
+        cJSON_AddNumberToObject(rigctl, "commands", stats.commands);
+        cJSON_AddNumberToObject(rigctl, "dropped", stats.dropped);
+    }
+    {
+        const WifiManager::ConnectStats stats = WifiManager::instance().get_connect_stats();
+        cJSON *wifi = cJSON_AddObjectToObject(root, "wifi");
+        cJSON_AddNumberToObject(wifi, "connects", stats.connects);
+        cJSON_AddNumberToObject(wifi, "fast_connects", stats.fast_connects);
+        cJSON_AddNumberToObject(wifi, "full_scans", stats.full_scans);
+        cJSON_AddNumberToObject(wifi, "last_assoc_ms", static_cast<double>(stats.last_assoc_us / 1000));
+        cJSON_AddNumberToObject(wifi, "last_dhcp_ms", static_cast<double>(stats.last_dhcp_us / 1000));
+        cJSON_AddNumberToObject(wifi, "channel", stats.channel);
+        cJSON_AddBoolToObject(wifi, "static_ip", stats.static_ip);
+        cJSON_AddStringToObject(wifi, "profile", NetworkProfile::name(WifiManager::instance().get_network_profile()));
+
+        const ConnectivityManager::Stats connectivity = ConnectivityManager::instance().get_stats();
+        cJSON_AddNumberToObject(wifi, "reconnects", connectivity.reconnects);
+        cJSON_AddNumberToObject(wifi, "last_backoff_ms", connectivity.last_backoff_ms);
+        cJSON_AddNumberToObject(wifi, "events", connectivity.events);
+        cJSON_AddNumberToObject(wifi, "events_dropped", connectivity.dropped);
+    }
+    if (WifiManager::instance().softap_enabled()) {
+        const WifiManager::SoftApStatus softap_status = WifiManager::instance().get_softap_status();
+        cJSON *softap = cJSON_AddObjectToObject(root, "softap");
+        cJSON_AddBoolToObject(softap, "running", softap_status.running);
+        cJSON_AddNumberToObject(softap, "stations", softap_status.stations);
+        cJSON_AddStringToObject(softap, "relay_board_ip", softap_status.board_ip);
+    }
+    if (AllocTracker::enabled()) {
+        const AllocTracker::Report report = AllocTracker::get_report();
+        cJSON *allocations = cJSON_AddObjectToObject(root, "hot_path_allocations");
+        cJSON_AddNumberToObject(allocations, "count", report.allocations);
+        cJSON_AddNumberToObject(allocations, "last_size", report.last_size);
+        cJSON_AddStringToObject(allocations, "last_task", report.last_task != nullptr ? report.last_task : "");
+    }
+    if (const JitterBenchmark &benchmark = JitterBenchmark::instance(); benchmark.is_done()) {
+        const JitterBenchmark::Result result = benchmark.get_result();
+        cJSON *jitter = cJSON_AddObjectToObject(root, "jitter_benchmark");
+        cJSON_AddNumberToObject(jitter, "samples", result.samples);
+        cJSON_AddNumberToObject(jitter, "missed", result.missed);
+        cJSON_AddNumberToObject(jitter, "renders", result.renders);
+        cJSON_AddNumberToObject(jitter, "min_us", static_cast<double>(result.min_us));
+        cJSON_AddNumberToObject(jitter, "avg_us", static_cast<double>(result.avg_us));
+        cJSON_AddNumberToObject(jitter, "max_us", static_cast<double>(result.max_us));
+    }
 
     char *json_string = cJSON_Print(root);
     httpd_resp_set_type(req, "application/json");
@@ -176,6 +313,190 @@ static constexpr httpd_uri_t status = {
         .user_ctx  = nullptr
 };
 
+static esp_err_t debug_perf_get_handler(httpd_req_t *req) {
+    // Too large for the server task's stack
+    const auto snapshot = std::make_unique<PerfMonitor::Snapshot>();
+    if (!PerfMonitor::instance().get_snapshot(snapshot.get())) {
+        // Sampling is off without FreeRTOS run-time stats, and takes one interval to start
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "No performance sample yet");
+        return ESP_FAIL;
+    }
+    const PerfMonitor::Sample &latest = snapshot->history[snapshot->history_count - 1];
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "interval_ms", PERF_SAMPLE_INTERVAL_MS);
+
+    cJSON *tasks = cJSON_AddArrayToObject(root, "tasks");
+    for (size_t i = 0; i < snapshot->task_count; i++) {
+        const PerfMonitor::TaskInfo &info = snapshot->tasks[i];
+        cJSON *task = cJSON_CreateObject();
+        cJSON_AddStringToObject(task, "name", info.name);
+        cJSON_AddNumberToObject(task, "core", info.core);
+        cJSON_AddNumberToObject(task, "priority", info.priority);
+        cJSON_AddNumberToObject(task, "cpu_permille", info.cpu_permille);
+        cJSON_AddNumberToObject(task, "stack_free", info.stack_free);
+        cJSON_AddItemToArray(tasks, task);
+    }
+
+    cJSON *heap = cJSON_AddObjectToObject(root, "heap");
+    cJSON_AddNumberToObject(heap, "free", latest.heap_free);
+    cJSON_AddNumberToObject(heap, "min_free", latest.heap_min_free);
+    cJSON_AddNumberToObject(heap, "largest_block", latest.heap_largest_block);
+    // Share of the free heap not usable for one allocation
+    cJSON_AddNumberToObject(heap, "fragmentation_pct",
+                            latest.heap_free > 0 ? 100 - latest.heap_largest_block * 100 / latest.heap_free : 0);
+
+    cJSON *history = cJSON_AddArrayToObject(root, "history");
+    for (size_t i = 0; i < snapshot->history_count; i++) {
+        const PerfMonitor::Sample &sample = snapshot->history[i];
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(entry, "age_ms", static_cast<double>((latest.time_us - sample.time_us) / 1000));
+        cJSON *cores = cJSON_AddArrayToObject(entry, "core_load_permille");
+        for (const uint16_t load: sample.core_load_permille) {
+            cJSON_AddItemToArray(cores, cJSON_CreateNumber(load));
+        }
+        cJSON_AddNumberToObject(entry, "heap_free", sample.heap_free);
+        cJSON_AddNumberToObject(entry, "heap_largest_block", sample.heap_largest_block);
+        cJSON *cat = cJSON_AddArrayToObject(entry, "cat_queues");
+        for (int r = 0; r < MAX_RADIOS; r++) {
+            cJSON *queue = cJSON_CreateObject();
+            cJSON_AddNumberToObject(queue, "buffered", sample.cat_buffered[r]);
+            cJSON_AddNumberToObject(queue, "events", sample.cat_events[r]);
+            cJSON_AddItemToArray(cat, queue);
+        }
+        cJSON_AddNumberToObject(entry, "relay_backlog", sample.relay_backlog);
+        cJSON_AddStringToObject(entry, "busiest_task", sample.busiest_task);
+        cJSON_AddNumberToObject(entry, "busiest_permille", sample.busiest_permille);
+        cJSON_AddStringToObject(entry, "tightest_task", sample.tightest_task);
+        cJSON_AddNumberToObject(entry, "tightest_stack_free", sample.tightest_stack_free);
+        cJSON_AddItemToArray(history, entry);
+    }
+
+    char *json_string = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+
+    free(json_string);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+static constexpr httpd_uri_t debug_perf = {
+        .uri       = "/debug/perf",
+        .method    = HTTP_GET,
+        .handler   = debug_perf_get_handler,
+        .user_ctx  = nullptr
+};
+
+static esp_err_t debug_boot_get_handler(httpd_req_t *req) {
+    cJSON *root = cJSON_CreateObject();
+    // Milliseconds from boot to each stage reached so far, in stage order
+    cJSON *stages = cJSON_AddObjectToObject(root, "stages_ms");
+    for (int i = 0; i < static_cast<int>(BootStage::COUNT); i++) {
+        const auto stage = static_cast<BootStage>(i);
+        if (const int64_t time_us = BootTimeline::time_us(stage); time_us >= 0) {
+            cJSON_AddNumberToObject(stages, BootTimeline::name(stage), static_cast<double>(time_us) / 1000.0);
+        }
+    }
+
+    char *json_string = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+
+    free(json_string);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+static constexpr httpd_uri_t debug_boot = {
+        .uri       = "/debug/boot",
+        .method    = HTTP_GET,
+        .handler   = debug_boot_get_handler,
+        .user_ctx  = nullptr
+};
+
+static_assert(NETWORK_PROFILE_COUNT <= RelayController::RTT_PROBE_SLOTS, "One probe slot per network profile");
+
+static esp_err_t debug_rtt_get_handler(httpd_req_t *req) {
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "profile", NetworkProfile::name(WifiManager::instance().get_network_profile()));
+    // Latest probe under each network profile, to pick one on measured latency
+    cJSON *profiles = cJSON_AddObjectToObject(root, "profiles");
+    for (int p = 0; p < NETWORK_PROFILE_COUNT; p++) {
+        RelayRttProbe probe;
+        if (antenna_switch_get_rtt_probe(p, &probe) != ESP_OK || (!probe.running && probe.samples == 0 &&
+                                                                  probe.failures == 0)) {
+            continue;
+        }
+        cJSON *result = cJSON_AddObjectToObject(profiles, NetworkProfile::name(p));
+        cJSON_AddBoolToObject(result, "running", probe.running);
+        cJSON_AddNumberToObject(result, "samples", probe.samples);
+        cJSON_AddNumberToObject(result, "failures", probe.failures);
+        cJSON_AddNumberToObject(result, "p50_us", probe.p50_us);
+        cJSON_AddNumberToObject(result, "p99_us", probe.p99_us);
+        cJSON_AddNumberToObject(result, "max_us", probe.max_us);
+    }
+
+    char *json_string = cJSON_Print(root);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+
+    free(json_string);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+// Starts a probe under the current network profile: POST /debug/rtt?samples=N
+static esp_err_t debug_rtt_post_handler(httpd_req_t *req) {
+    constexpr unsigned long DEFAULT_SAMPLES = 100;
+    unsigned long samples = DEFAULT_SAMPLES;
+    char query[32];
+    char value[8];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "samples", value, sizeof(value)) == ESP_OK) {
+        samples = strtoul(value, nullptr, 10);
+    }
+    if (samples == 0 || samples > RelayController::RTT_PROBE_MAX_SAMPLES) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid sample count");
+        return ESP_FAIL;
+    }
+
+    const uint8_t profile = WifiManager::instance().get_network_profile();
+    if (const esp_err_t ret = antenna_switch_start_rtt_probe(profile, samples); ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start relay round trip probe: %s", esp_err_to_name(ret));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No relay board, or a probe is already running");
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "profile", NetworkProfile::name(profile));
+    cJSON_AddNumberToObject(root, "samples", samples);
+    cJSON_AddNumberToObject(root, "interval_ms", RelayController::RTT_PROBE_INTERVAL_MS);
+
+    char *json_string = cJSON_Print(root);
+    httpd_resp_set_status(req, "202 Accepted");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+
+    free(json_string);
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+static constexpr httpd_uri_t debug_rtt_get = {
+        .uri       = "/debug/rtt",
+        .method    = HTTP_GET,
+        .handler   = debug_rtt_get_handler,
+        .user_ctx  = nullptr
+};
+
+static constexpr httpd_uri_t debug_rtt_post = {
+        .uri       = "/debug/rtt",
+        .method    = HTTP_POST,
+        .handler   = debug_rtt_post_handler,
+        .user_ctx  = nullptr
+};
+
 static constexpr httpd_uri_t root = {
         .uri       = "/",
         .method    = HTTP_GET,
@@ -192,6 +513,10 @@ static constexpr httpd_uri_t config_get = {
 
 static esp_err_t config_post_handler(httpd_req_t *req) {
     antenna_switch_config_t new_config = {};
+    // Fields the form leaves out keep these values; saved only if nothing else saved in between
+    antenna_switch_config_t current;
+    uint32_t current_version;
+    ConfigManager::instance().copy_config(&current, &current_version);
 
     // Get content length and validate
     const size_t content_len = req->content_len;
@@ -248,6 +573,263 @@ static esp_err_t config_post_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
 
+    // Relay transport is optional; keep the current one if the client doesn't send it
+    if (cJSON const *relay_transport = cJSON_GetObjectItem(root, "relay_transport"); cJSON_IsNumber(relay_transport)) {
+        if (relay_transport->valueint < RELAY_TRANSPORT_TCP || relay_transport->valueint > RELAY_TRANSPORT_RS485) {
+            ESP_LOGE(TAG, "Invalid relay transport: %d", relay_transport->valueint);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid relay transport");
+            cJSON_Delete(root);
+            free(content);
+            return ESP_FAIL;
+        }
+        new_config.relay_transport = relay_transport->valueint;
+    } else {
+        new_config.relay_transport = current.relay_transport;
+    }
+
+    // Modbus settings are optional too; 0 keeps the defaults
+    if (cJSON const *modbus_address = cJSON_GetObjectItem(root, "modbus_address"); cJSON_IsNumber(modbus_address)) {
+        if (modbus_address->valueint < 1 || modbus_address->valueint > 247) {
+            ESP_LOGE(TAG, "Invalid Modbus address: %d", modbus_address->valueint);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid Modbus address");
+            cJSON_Delete(root);
+            free(content);
+            return ESP_FAIL;
+        }
+        new_config.modbus_address = modbus_address->valueint;
+    } else {
+        new_config.modbus_address = current.modbus_address;
+    }
+
+    if (cJSON const *rs485_baud = cJSON_GetObjectItem(root, "rs485_baud_rate"); cJSON_IsNumber(rs485_baud)) {
+        if (rs485_baud->valueint <= 0) {
+            ESP_LOGE(TAG, "Invalid RS485 baud rate: %d", rs485_baud->valueint);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid RS485 baud rate");
+            cJSON_Delete(root);
+            free(content);
+            return ESP_FAIL;
+        }
+        new_config.rs485_baud_rate = rs485_baud->valueint;
+    } else {
+        new_config.rs485_baud_rate = current.rs485_baud_rate;
+    }
+
+    // SO2R settings are optional; a missing field keeps the current value
+    const auto &current_radios = current;
+    new_config.num_radios = current_radios.num_radios;
+    new_config.priority_radio = current_radios.priority_radio;
+    new_config.cat2_baud_rate = current_radios.cat2_baud_rate;
+    const cJSON *num_radios = cJSON_GetObjectItem(root, "num_radios");
+    const cJSON *priority_radio = cJSON_GetObjectItem(root, "priority_radio");
+    const cJSON *cat2_baud = cJSON_GetObjectItem(root, "cat2_baud_rate");
+    if ((cJSON_IsNumber(num_radios) && (num_radios->valueint < 1 || num_radios->valueint > MAX_RADIOS)) ||
+        (cJSON_IsNumber(priority_radio) && (priority_radio->valueint < 0 || priority_radio->valueint >= MAX_RADIOS)) ||
+        (cJSON_IsNumber(cat2_baud) && cat2_baud->valueint < 0)) {
+        ESP_LOGE(TAG, "Invalid radio settings");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid radio settings");
+        cJSON_Delete(root);
+        free(content);
+        return ESP_FAIL;
+    }
+    if (cJSON_IsNumber(num_radios)) {
+        new_config.num_radios = num_radios->valueint;
+    }
+    if (cJSON_IsNumber(priority_radio)) {
+        new_config.priority_radio = priority_radio->valueint;
+    }
+    if (cJSON_IsNumber(cat2_baud)) {
+        new_config.cat2_baud_rate = cat2_baud->valueint;
+    }
+
+    // Baud rate / protocol detection is on unless the client turns it off
+    if (const cJSON *auto_detect = cJSON_GetObjectItem(root, "cat_auto_detect"); cJSON_IsBool(auto_detect)) {
+        new_config.cat_fixed_link = !cJSON_IsTrue(auto_detect);
+    } else {
+        new_config.cat_fixed_link = current_radios.cat_fixed_link;
+    }
+
+    // Polling is off unless asked for: a PC sharing the line may not expect it
+    if (const cJSON *polling = cJSON_GetObjectItem(root, "cat_polling"); cJSON_IsBool(polling)) {
+        new_config.cat_polling = cJSON_IsTrue(polling);
+    } else {
+        new_config.cat_polling = current_radios.cat_polling;
+    }
+    if (const cJSON *bridge = cJSON_GetObjectItem(root, "cat_pc_bridge"); cJSON_IsBool(bridge)) {
+        new_config.cat_pc_bridge = cJSON_IsTrue(bridge);
+    } else {
+        new_config.cat_pc_bridge = current_radios.cat_pc_bridge;
+    }
+
+    // Network frequency sources; a port of 0 or an empty host turns them off
+    const cJSON *n1mm_port = cJSON_GetObjectItem(root, "n1mm_udp_port");
+    const cJSON *rigctld_port = cJSON_GetObjectItem(root, "rigctld_port");
+    const cJSON *server_port = cJSON_GetObjectItem(root, "rigctl_server_port");
+    if ((cJSON_IsNumber(n1mm_port) && (n1mm_port->valueint < 0 || n1mm_port->valueint > 65535)) ||
+        (cJSON_IsNumber(rigctld_port) && (rigctld_port->valueint < 0 || rigctld_port->valueint > 65535)) ||
+        (cJSON_IsNumber(server_port) && (server_port->valueint < 0 || server_port->valueint > 65535 - MAX_RADIOS))) {
+        ESP_LOGE(TAG, "Invalid network source port");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid network source port");
+        cJSON_Delete(root);
+        free(content);
+        return ESP_FAIL;
+    }
+    // Frequency source arbitration
+    const cJSON *priority = cJSON_GetObjectItem(root, "frequency_priority");
+    const cJSON *fresh = cJSON_GetObjectItem(root, "source_fresh_s");
+    const cJSON *hold = cJSON_GetObjectItem(root, "manual_hold_s");
+    if ((cJSON_IsNumber(priority) && priority->valueint != FREQ_PRIORITY_CAT_FIRST &&
+         priority->valueint != FREQ_PRIORITY_NETWORK_FIRST) ||
+        (cJSON_IsNumber(fresh) && (fresh->valueint < 0 || fresh->valueint > UINT16_MAX)) ||
+        (cJSON_IsNumber(hold) && (hold->valueint < 0 || hold->valueint > UINT16_MAX))) {
+        ESP_LOGE(TAG, "Invalid frequency source settings");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid frequency source settings");
+        cJSON_Delete(root);
+        free(content);
+        return ESP_FAIL;
+    }
+    new_config.frequency_priority = cJSON_IsNumber(priority) ? priority->valueint : current_radios.frequency_priority;
+    new_config.source_fresh_s = cJSON_IsNumber(fresh) ? fresh->valueint : current_radios.source_fresh_s;
+    new_config.manual_hold_s = cJSON_IsNumber(hold) ? hold->valueint : current_radios.manual_hold_s;
+
+    new_config.n1mm_udp_port = cJSON_IsNumber(n1mm_port) ? n1mm_port->valueint : current_radios.n1mm_udp_port;
+    new_config.rigctld_port = cJSON_IsNumber(rigctld_port) ? rigctld_port->valueint : current_radios.rigctld_port;
+    new_config.rigctl_server_port = cJSON_IsNumber(server_port)
+                                        ? server_port->valueint
+                                        : current_radios.rigctl_server_port;
+    memcpy(new_config.rigctld_host, current_radios.rigctld_host, sizeof(new_config.rigctld_host));
+    if (const cJSON *rigctld_host = cJSON_GetObjectItem(root, "rigctld_host"); cJSON_IsString(rigctld_host)) {
+        strncpy(new_config.rigctld_host, rigctld_host->valuestring, sizeof(new_config.rigctld_host) - 1);
+        new_config.rigctld_host[sizeof(new_config.rigctld_host) - 1] = '\0';
+    }
+
+    // Static station address; an empty address means DHCP. Applies after restart
+    struct {
+        const char *name;
+        char *field;
+        const char *current;
+    } static_ip_fields[] = {
+        {"static_ip", new_config.static_ip, current_radios.static_ip},
+        {"static_netmask", new_config.static_netmask, current_radios.static_netmask},
+        {"static_gateway", new_config.static_gateway, current_radios.static_gateway},
+        {"static_dns", new_config.static_dns, current_radios.static_dns},
+    };
+    for (const auto &[name, field, current]: static_ip_fields) {
+        const cJSON *value = cJSON_GetObjectItem(root, name);
+        const char *text = cJSON_IsString(value) ? value->valuestring : current;
+        esp_ip4_addr_t addr;
+        if (strlen(text) >= sizeof(new_config.static_ip) ||
+            (text[0] != '\0' && esp_netif_str_to_ip4(text, &addr) != ESP_OK)) {
+            ESP_LOGE(TAG, "Invalid %s", name);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid static IP settings");
+            cJSON_Delete(root);
+            free(content);
+            return ESP_FAIL;
+        }
+        strncpy(field, text, sizeof(new_config.static_ip) - 1);
+        field[sizeof(new_config.static_ip) - 1] = '\0';
+    }
+    if (new_config.static_ip[0] != '\0' &&
+        (new_config.static_netmask[0] == '\0' || new_config.static_gateway[0] == '\0')) {
+        ESP_LOGE(TAG, "Static IP needs a netmask and gateway");
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Static IP needs a netmask and gateway");
+        cJSON_Delete(root);
+        free(content);
+        return ESP_FAIL;
+    }
+
+    // SoftAP for the relay board; applies after restart
+    new_config.softap_mode = current_radios.softap_mode;
+    new_config.softap_channel = current_radios.softap_channel;
+    memcpy(new_config.softap_ssid, current_radios.softap_ssid, sizeof(new_config.softap_ssid));
+    memcpy(new_config.softap_password, current_radios.softap_password, sizeof(new_config.softap_password));
+    memcpy(new_config.relay_board_mac, current_radios.relay_board_mac, sizeof(new_config.relay_board_mac));
+    {
+        const cJSON *softap_mode = cJSON_GetObjectItem(root, "softap_mode");
+        const cJSON *softap_ssid = cJSON_GetObjectItem(root, "softap_ssid");
+        const cJSON *softap_password = cJSON_GetObjectItem(root, "softap_password");
+        const cJSON *softap_channel = cJSON_GetObjectItem(root, "softap_channel");
+        const cJSON *board_mac = cJSON_GetObjectItem(root, "relay_board_mac");
+        const char *error = nullptr;
+        if (cJSON_IsNumber(softap_mode)) {
+            if (softap_mode->valueint < SOFTAP_MODE_OFF || softap_mode->valueint > SOFTAP_MODE_ONLY) {
+                error = "Invalid SoftAP mode";
+            } else {
+                new_config.softap_mode = softap_mode->valueint;
+            }
+        }
+        if (cJSON_IsString(softap_ssid)) {
+            if (strlen(softap_ssid->valuestring) > 32) {
+                error = "SoftAP name longer than 32 characters";
+            } else {
+                strncpy(new_config.softap_ssid, softap_ssid->valuestring, sizeof(new_config.softap_ssid) - 1);
+            }
+        }
+        if (cJSON_IsString(softap_password)) {
+            strncpy(new_config.softap_password, softap_password->valuestring, sizeof(new_config.softap_password) - 1);
+        }
+        if (cJSON_IsNumber(softap_channel)) {
+            if (softap_channel->valueint < 0 || softap_channel->valueint > 13) {
+                error = "Invalid SoftAP channel";
+            } else {
+                new_config.softap_channel = softap_channel->valueint;
+            }
+        }
+        // Empty forgets the board, so the next station to join is taken for it
+        if (cJSON_IsString(board_mac)) {
+            unsigned int mac[6];
+            if (board_mac->valuestring[0] == '\0') {
+                memset(new_config.relay_board_mac, 0, sizeof(new_config.relay_board_mac));
+            } else if (sscanf(board_mac->valuestring, "%2x:%2x:%2x:%2x:%2x:%2x", &mac[0], &mac[1], &mac[2], &mac[3],
+                              &mac[4], &mac[5]) == 6) {
+                for (int i = 0; i < 6; i++) {
+                    new_config.relay_board_mac[i] = mac[i];
+                }
+            } else {
+                error = "Invalid relay board MAC address";
+            }
+        }
+        const size_t password_len = strnlen(new_config.softap_password, sizeof(new_config.softap_password));
+        if (error == nullptr && new_config.softap_mode != SOFTAP_MODE_OFF && (password_len < 8 || password_len > 63)) {
+            error = "SoftAP password must be 8 to 63 characters";
+        }
+        if (error != nullptr) {
+            ESP_LOGE(TAG, "%s", error);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+            cJSON_Delete(root);
+            free(content);
+            return ESP_FAIL;
+        }
+    }
+
+    // Network profile is optional; keep the current one if the client doesn't send it
+    new_config.network_profile = current_radios.network_profile;
+    if (const cJSON *network_profile = cJSON_GetObjectItem(root, "network_profile"); cJSON_IsNumber(network_profile)) {
+        if (network_profile->valueint < 0 || network_profile->valueint >= NETWORK_PROFILE_COUNT) {
+            ESP_LOGE(TAG, "Invalid network profile: %d", network_profile->valueint);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid network profile");
+            cJSON_Delete(root);
+            free(content);
+            return ESP_FAIL;
+        }
+        new_config.network_profile = network_profile->valueint;
+    }
+
+    // CAT protocol per radio, e.g. [0, 1] for a Kenwood and an Icom
+    memcpy(new_config.cat_protocols, current_radios.cat_protocols, sizeof(new_config.cat_protocols));
+    if (const cJSON *protocols = cJSON_GetObjectItem(root, "cat_protocols"); cJSON_IsArray(protocols)) {
+        for (int r = 0; r < cJSON_GetArraySize(protocols) && r < MAX_RADIOS; r++) {
+            const cJSON *protocol = cJSON_GetArrayItem(protocols, r);
+            if (!cJSON_IsNumber(protocol) || protocol->valueint < 0 || protocol->valueint >= CAT_PROTOCOL_COUNT) {
+                ESP_LOGE(TAG, "Invalid CAT protocol for radio %d", r + 1);
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid CAT protocol");
+                cJSON_Delete(root);
+                free(content);
+                return ESP_FAIL;
+            }
+            new_config.cat_protocols[r] = protocol->valueint;
+        }
+    }
+
     // Parse UART configuration
     if (const cJSON *uart_baud = cJSON_GetObjectItem(root, "uart_baud_rate"); cJSON_IsNumber(uart_baud)) {
         if (uart_baud->valueint > 0) {
@@ -332,6 +914,79 @@ static esp_err_t config_post_handler(httpd_req_t *req) {
     }
     new_config.num_antenna_ports = num_antenna_ports;
 
+    // Extra relay boards are optional: [{"host": "...", "port": n}, ...]
+    if (const cJSON *extra_boards = cJSON_GetObjectItem(root, "extra_boards"); cJSON_IsArray(extra_boards)) {
+        const int num_extra = cJSON_GetArraySize(extra_boards);
+        if (num_extra > MAX_RELAY_BOARDS - 1) {
+            ESP_LOGE(TAG, "Too many extra relay boards: %d", num_extra);
+            cJSON_Delete(root);
+            free(content);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Too many extra relay boards");
+            return ESP_FAIL;
+        }
+        for (int i = 0; i < num_extra; i++) {
+            const cJSON *board = cJSON_GetArrayItem(extra_boards, i);
+            const cJSON *host = cJSON_GetObjectItem(board, "host");
+            const cJSON *port = cJSON_GetObjectItem(board, "port");
+            if (!cJSON_IsString(host) || !cJSON_IsNumber(port) || port->valueint <= 0 || port->valueint > 65535) {
+                ESP_LOGE(TAG, "Invalid extra relay board %d", i);
+                cJSON_Delete(root);
+                free(content);
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid extra relay board");
+                return ESP_FAIL;
+            }
+            strncpy(new_config.extra_board_hosts[i], host->valuestring, sizeof(new_config.extra_board_hosts[i]) - 1);
+            new_config.extra_board_ports[i] = port->valueint;
+        }
+        new_config.num_extra_boards = num_extra;
+    } else {
+        new_config.num_extra_boards = current.num_extra_boards;
+        memcpy(new_config.extra_board_hosts, current.extra_board_hosts, sizeof(new_config.extra_board_hosts));
+        memcpy(new_config.extra_board_ports, current.extra_board_ports, sizeof(new_config.extra_board_ports));
+    }
+
+    // Antenna port wiring is optional too: [{"board": b, "channel": c}, ...] indexed by port
+    if (const cJSON *port_map = cJSON_GetObjectItem(root, "port_map"); cJSON_IsArray(port_map)) {
+        const int num_mapped = cJSON_GetArraySize(port_map);
+        for (int j = 0; j < num_mapped && j < MAX_ANTENNA_PORTS; j++) {
+            const cJSON *entry = cJSON_GetArrayItem(port_map, j);
+            const cJSON *board = cJSON_GetObjectItem(entry, "board");
+            const cJSON *channel = cJSON_GetObjectItem(entry, "channel");
+            if (!cJSON_IsNumber(board) || board->valueint < 0 || board->valueint > new_config.num_extra_boards ||
+                !cJSON_IsNumber(channel) || channel->valueint < 0 || channel->valueint > RelayController::NUM_RELAYS) {
+                ESP_LOGE(TAG, "Invalid port mapping for port %d", j + 1);
+                cJSON_Delete(root);
+                free(content);
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid port mapping");
+                return ESP_FAIL;
+            }
+            new_config.port_board[j] = board->valueint;
+            new_config.port_channel[j] = channel->valueint;
+        }
+    } else {
+        memcpy(new_config.port_board, current.port_board, sizeof(new_config.port_board));
+        memcpy(new_config.port_channel, current.port_channel, sizeof(new_config.port_channel));
+    }
+
+    // Mutually exclusive outputs are optional: [[1, 2, 3, 4], [9, 10], ...]
+    if (const cJSON *groups = cJSON_GetObjectItem(root, "exclusion_groups"); cJSON_IsArray(groups)) {
+        const int num_groups = cJSON_GetArraySize(groups);
+        bool valid = num_groups <= MAX_EXCLUSION_GROUPS;
+        for (int g = 0; valid && g < num_groups; g++) {
+            const cJSON *group = cJSON_GetArrayItem(groups, g);
+            valid = cJSON_IsArray(group) && parse_output_list(group, new_config.exclusion_groups[g]);
+        }
+        if (!valid) {
+            ESP_LOGE(TAG, "Invalid exclusion groups");
+            cJSON_Delete(root);
+            free(content);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid exclusion groups");
+            return ESP_FAIL;
+        }
+    } else {
+        memcpy(new_config.exclusion_groups, current.exclusion_groups, sizeof(new_config.exclusion_groups));
+    }
+
     if (const cJSON *bands = cJSON_GetObjectItem(root, "bands"); cJSON_IsArray(bands)) {
         const int num_bands1 = cJSON_GetArraySize(bands);
         new_config.num_bands = num_bands1;
@@ -354,24 +1009,48 @@ static esp_err_t config_post_handler(httpd_req_t *req) {
                         new_config.bands[i].antenna_ports[j] = cJSON_IsTrue(port);
                     }
                 }
+
+                // Optional list of logical outputs to switch on together for this band
+                if (const cJSON *outputs = cJSON_GetObjectItem(band, "outputs"); cJSON_IsArray(outputs)) {
+                    if (!parse_output_list(outputs, new_config.band_outputs[i])) {
+                        ESP_LOGE(TAG, "Invalid outputs for band %d", i);
+                        cJSON_Delete(root);
+                        free(content);
+                        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid band outputs");
+                        return ESP_FAIL;
+                    }
+                } else {
+                    memcpy(new_config.band_outputs[i], current.band_outputs[i], sizeof(new_config.band_outputs[i]));
+                }
+
+                if (antenna_switch_check_outputs(new_config,
+                                                 RelayBoardRegistry::mask_from_bytes(new_config.band_outputs[i])) !=
+                    ESP_OK) {
+                    cJSON_Delete(root);
+                    free(content);
+                    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Band outputs break an exclusion group");
+                    return ESP_FAIL;
+                }
             }
         }
     }
     
     cJSON_Delete(root);
 
-    esp_err_t err = antenna_switch_set_config(&new_config);
-    if (err != ESP_OK) {
+    // Observers apply what changed: CAT settings, the relay link host and port, the band index.
+    // A save since the form's fields were read (CAT detection, the SoftAP lease) would be undone; refuse instead
+    if (const esp_err_t ret = ConfigManager::instance().update_config(new_config, current_version);
+        ret == ESP_ERR_INVALID_STATE) {
+        free(content);
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "Configuration changed while saving, reload and try again");
+        return ESP_FAIL;
+    } else if (ret != ESP_OK) {
+        free(content);
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set configuration");
         return ESP_FAIL;
     }
 
-    // Update CAT parser configuration
-    err = cat_parser_update_config();
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to update CAT parser configuration: %s", esp_err_to_name(err));
-    }
-
     // Use chunked sending for the success response
     httpd_resp_set_hdr(req, "Transfer-Encoding", "chunked");
     const auto success_msg = "<h2>Configuration Updated</h2>"
@@ -386,17 +1065,10 @@ static esp_err_t config_post_handler(httpd_req_t *req) {
 }
 
 static esp_err_t toggle_auto_mode_handler(httpd_req_t *req) {
-    antenna_switch_config_t config;
-    esp_err_t ret = antenna_switch_get_config(&config);
-    if (ret != ESP_OK) {
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to get configuration");
-        return ESP_FAIL;
-    }
-
-    config.auto_mode = !config.auto_mode;
-
-    ret = antenna_switch_set_config(&config);
-    if (ret != ESP_OK) {
+    // Flipped under the config lock, so two clicks in a row toggle twice
+    if (const esp_err_t ret = ConfigManager::instance().modify([](antenna_switch_config_t &config) {
+        config.auto_mode = !config.auto_mode;
+    }); ret != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set configuration");
         return ESP_FAIL;
     }
@@ -461,6 +1133,42 @@ static esp_err_t restart_handler(httpd_req_t *req) {
     return ESP_OK;
 }
 
+// {"relay": n, "state": true}; pauses automatic switching for manual_hold_s
+static esp_err_t relay_post_handler(httpd_req_t *req) {
+    char content[64];
+    const int received = httpd_req_recv(req, content, std::min(req->content_len, sizeof(content) - 1));
+    if (received <= 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Failed to receive data");
+        return ESP_FAIL;
+    }
+    content[received] = '\0';
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+    const cJSON *relay = cJSON_GetObjectItem(root, "relay");
+    const cJSON *state = cJSON_GetObjectItem(root, "state");
+    if (!cJSON_IsNumber(relay) || !cJSON_IsBool(state)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Expected relay and state");
+        return ESP_FAIL;
+    }
+    const esp_err_t ret = antenna_switch_set_relay(relay->valueint, cJSON_IsTrue(state));
+    cJSON_Delete(root);
+    if (ret == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid relay");
+        return ESP_FAIL;
+    }
+    if (ret != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set relay");
+        return ESP_FAIL;
+    }
+    httpd_resp_sendstr(req, "OK");
+    return ESP_OK;
+}
+
 static esp_err_t reset_wifi_handler(httpd_req_t *req) {
     ESP_LOGD(TAG, "Handling WiFi reset request");
 
@@ -484,6 +1192,13 @@ static constexpr httpd_uri_t toggle_auto_mode = {
         .user_ctx  = nullptr
 };
 
+static constexpr httpd_uri_t relay_post = {
+        .uri       = "/relay",
+        .method    = HTTP_POST,
+        .handler   = relay_post_handler,
+        .user_ctx  = nullptr
+};
+
 static constexpr httpd_uri_t reset_config = {
         .uri       = "/reset-config",
         .method    = HTTP_POST,
@@ -515,11 +1230,15 @@ static constexpr httpd_uri_t config_post = {
 esp_err_t webserver_init() {
     config = HTTPD_DEFAULT_CONFIG();
     config.stack_size = 8192; //KB //32768;
-    config.max_uri_handlers = 12;
+    config.max_uri_handlers = 14;
     config.max_resp_headers = 8;
+    config.max_open_sockets = WEBSERVER_MAX_OPEN_SOCKETS;
     config.lru_purge_enable = true;  // Enable LRU purging for large requests
     config.recv_wait_timeout = 10;
     config.uri_match_fn = httpd_uri_match_wildcard;
+    // Rendering pages must never compete with CAT decoding for a core
+    config.core_id = TASK_CORE_NETWORK;
+    config.task_priority = TASK_PRIORITY_HTTPD;
 
     char ip_addr[16];
     esp_err_t ret = WifiManager::instance().get_ip_info(ip_addr, sizeof(ip_addr));
@@ -560,12 +1279,42 @@ esp_err_t webserver_init() {
         goto error_handler;
     }
 
+    ret = httpd_register_uri_handler(server, &debug_perf);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register debug perf URI handler: %s", esp_err_to_name(ret));
+        goto error_handler;
+    }
+
+    ret = httpd_register_uri_handler(server, &debug_boot);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register debug boot URI handler: %s", esp_err_to_name(ret));
+        goto error_handler;
+    }
+
+    ret = httpd_register_uri_handler(server, &debug_rtt_get);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register debug rtt GET URI handler: %s", esp_err_to_name(ret));
+        goto error_handler;
+    }
+
+    ret = httpd_register_uri_handler(server, &debug_rtt_post);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register debug rtt POST URI handler: %s", esp_err_to_name(ret));
+        goto error_handler;
+    }
+
     ret = httpd_register_uri_handler(server, &toggle_auto_mode);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register toggle auto mode URI handler: %s", esp_err_to_name(ret));
         goto error_handler;
     }
 
+    ret = httpd_register_uri_handler(server, &relay_post);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register relay URI handler: %s", esp_err_to_name(ret));
+        goto error_handler;
+    }
+
     ret = httpd_register_uri_handler(server, &reset_config);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to register reset config URI handler: %s", esp_err_to_name(ret));
@@ -602,6 +1351,7 @@ esp_err_t webserver_start() {
             ESP_LOGE(TAG, "Failed to initialize webserver: %s", esp_err_to_name(ret));
             return ret;
         }
+        BootTimeline::mark(BootStage::WEBSERVER_STARTED);
     }
     return ESP_OK;
 }
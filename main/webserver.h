@@ -3,6 +3,9 @@
 
 #include "esp_err.h"
 
+// Browser connections; httpd holds a listening and a control socket on top
+#define WEBSERVER_MAX_OPEN_SOCKETS 7
+
 esp_err_t webserver_init();
 
 esp_err_t webserver_start();
@@ -1,15 +1,17 @@
 #include "wifi_manager.hpp"
 #include "lwip/ip4_addr.h"
-#include "webserver.h"
+#include "connectivity_manager.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include "freertos/event_groups.h"
 #include "esp_timer.h"
 #include "esp_smartconfig.h"
-#include "webserver.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "boot_timeline.h"
+#include "config_manager.h"
 
 #include <cstring>
 #include <esp_task_wdt.h>
@@ -28,6 +30,8 @@
 
 static auto TAG = "WIFI_MANAGER";
 
+#define WIFI_LINK_CACHE_KEY "wifi_link"
+
 WifiManager &WifiManager::instance() {
     static WifiManager instance;
     return instance;
@@ -108,48 +112,349 @@ esp_err_t WifiManager::load_credentials(char *ssid, size_t ssid_size, char *pass
     return err;
 }
 
+esp_err_t WifiManager::save_link_cache(const LinkCache &cache) {
+    nvs_handle_t my_handle;
+
+    esp_err_t err = nvs_open("storage", NVS_READWRITE, &my_handle);
+    if (err != ESP_OK) return err;
+
+    err = nvs_set_blob(my_handle, WIFI_LINK_CACHE_KEY, &cache, sizeof(cache));
+    if (err == ESP_OK) {
+        err = nvs_commit(my_handle);
+    }
+    nvs_close(my_handle);
+    return err;
+}
+
+esp_err_t WifiManager::load_link_cache(LinkCache *cache) {
+    nvs_handle_t my_handle;
+
+    esp_err_t err = nvs_open("storage", NVS_READONLY, &my_handle);
+    if (err != ESP_OK) return err;
+
+    size_t size = sizeof(*cache);
+    err = nvs_get_blob(my_handle, WIFI_LINK_CACHE_KEY, cache, &size);
+    nvs_close(my_handle);
+    if (err == ESP_OK && (size != sizeof(*cache) || cache->channel == 0)) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    return err;
+}
+
+void WifiManager::set_target(const bool targeted) {
+    wifi_config_t wifi_config = {};
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) != ESP_OK) {
+        return;
+    }
+    if (targeted) {
+        // Straight to the AP used last time: a probe on one channel instead of a scan of all of them
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, m_link_cache.bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = m_link_cache.channel;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+    } else {
+        wifi_config.sta.bssid_set = false;
+        wifi_config.sta.channel = 0;
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+        wifi_config.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    }
+    wifi_config.sta.listen_interval = NetworkProfile::settings(m_profile).listen_interval;
+    // Join APs that offer or require management frame protection (WPA3) on the first attempt
+    wifi_config.sta.pmf_cfg.capable = true;
+    wifi_config.sta.pmf_cfg.required = false;
+    if (const esp_err_t ret = esp_wifi_set_config(WIFI_IF_STA, &wifi_config); ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to update WiFi scan settings: %s", esp_err_to_name(ret));
+        return;
+    }
+    m_targeted = targeted;
+    m_targeted_failures = 0;
+}
+
+esp_err_t WifiManager::set_network_profile(const uint8_t profile) {
+    const NetworkProfileSettings &settings = NetworkProfile::settings(profile);
+    ESP_RETURN_ON_ERROR(esp_wifi_set_ps(settings.power_save), TAG, "Failed to set power save mode");
+    ESP_RETURN_ON_ERROR(esp_wifi_set_max_tx_power(settings.max_tx_power), TAG, "Failed to set TX power");
+    m_profile = profile < NETWORK_PROFILE_COUNT ? profile : NETWORK_PROFILE_BALANCED;
+    m_profile_applied = true;
+    ESP_LOGI(TAG, "Network profile %s: power save %d, listen interval %u, max TX power %.2f dBm", settings.name,
+             settings.power_save, settings.listen_interval, settings.max_tx_power / 4.0);
+    return ESP_OK;
+}
+
+void WifiManager::start_connect() {
+    m_connect_start_us = esp_timer_get_time();
+    if (const esp_err_t ret = esp_wifi_connect(); ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to start WiFi connection: %s", esp_err_to_name(ret));
+    }
+}
+
+bool WifiManager::apply_static_ip() {
+    const auto &config = ConfigManager::instance().get_config();
+    if (config.static_ip[0] == '\0') {
+        return false;
+    }
+
+    esp_netif_ip_info_t ip_info = {};
+    if (esp_netif_str_to_ip4(config.static_ip, &ip_info.ip) != ESP_OK ||
+        esp_netif_str_to_ip4(config.static_netmask, &ip_info.netmask) != ESP_OK ||
+        esp_netif_str_to_ip4(config.static_gateway, &ip_info.gw) != ESP_OK) {
+        ESP_LOGE(TAG, "Invalid static IP settings, using DHCP");
+        return false;
+    }
+
+    // DHCP was started on association by the default handler; the address set here replaces it
+    esp_netif_dhcpc_stop(m_sta_netif);
+    if (const esp_err_t ret = esp_netif_set_ip_info(m_sta_netif, &ip_info); ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set static IP: %s, using DHCP", esp_err_to_name(ret));
+        esp_netif_dhcpc_start(m_sta_netif);
+        return false;
+    }
+
+    esp_netif_dns_info_t dns = {};
+    dns.ip.type = ESP_IPADDR_TYPE_V4;
+    // Without a DNS server of its own the gateway usually forwards
+    if (config.static_dns[0] == '\0' || esp_netif_str_to_ip4(config.static_dns, &dns.ip.u_addr.ip4) != ESP_OK) {
+        dns.ip.u_addr.ip4 = ip_info.gw;
+    }
+    esp_netif_set_dns_info(m_sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    return true;
+}
+
+esp_err_t WifiManager::configure_softap(const antenna_switch_config_t &config) {
+    wifi_config_t wifi_config = {};
+    auto &ap = wifi_config.ap;
+    if (config.softap_ssid[0] != '\0') {
+        strncpy(reinterpret_cast<char *>(ap.ssid), config.softap_ssid, sizeof(ap.ssid));
+    } else {
+        uint8_t mac[6];
+        ESP_RETURN_ON_ERROR(esp_wifi_get_mac(WIFI_IF_AP, mac), TAG, "Failed to read AP MAC address");
+        snprintf(reinterpret_cast<char *>(ap.ssid), sizeof(ap.ssid), "AntennaSwitch-%02X%02X", mac[4], mac[5]);
+    }
+    ap.ssid_len = strnlen(reinterpret_cast<const char *>(ap.ssid), sizeof(ap.ssid));
+    strncpy(reinterpret_cast<char *>(ap.password), config.softap_password, sizeof(ap.password) - 1);
+    ap.channel = config.softap_channel != 0 ? config.softap_channel : SOFTAP_DEFAULT_CHANNEL;
+    ap.authmode = WIFI_AUTH_WPA2_PSK;
+    ap.max_connection = SOFTAP_MAX_STATIONS;
+    ap.pmf_cfg.required = false;
+    ESP_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_AP, &wifi_config), TAG, "Failed to set AP configuration");
+
+    // Pool from the first address up, so a board joining first always gets SOFTAP_BOARD_DEFAULT_IP
+    dhcps_lease_t pool = {};
+    pool.enable = true;
+    pool.start_ip.addr = ESP_IP4TOADDR(192, 168, 4, 2);
+    pool.end_ip.addr = ESP_IP4TOADDR(192, 168, 4, 1 + SOFTAP_MAX_STATIONS);
+    uint32_t lease_minutes = SOFTAP_LEASE_MINUTES;
+    // Options can only change while the server is stopped; it starts with the AP
+    esp_netif_dhcps_stop(m_ap_netif);
+    ESP_RETURN_ON_ERROR(esp_netif_dhcps_option(m_ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_REQUESTED_IP_ADDRESS,
+                                               &pool, sizeof(pool)), TAG, "Failed to set DHCP pool");
+    ESP_RETURN_ON_ERROR(esp_netif_dhcps_option(m_ap_netif, ESP_NETIF_OP_SET, ESP_NETIF_IP_ADDRESS_LEASE_TIME,
+                                               &lease_minutes, sizeof(lease_minutes)), TAG,
+                        "Failed to set DHCP lease time");
+    ESP_RETURN_ON_ERROR(esp_netif_dhcps_start(m_ap_netif), TAG, "Failed to start DHCP server");
+
+    ESP_LOGI(TAG, "SoftAP %s on channel %d", reinterpret_cast<const char *>(ap.ssid), ap.channel);
+    return ESP_OK;
+}
+
+void WifiManager::on_station_ip(const uint8_t *mac, const esp_ip4_addr_t ip_addr) {
+    char ip[16];
+    snprintf(ip, sizeof(ip), IPSTR, IP2STR(&ip_addr));
+
+    // Checked and saved in one step, so a web save at the same time can't undo the MAC or host
+    bool is_board = false;
+    const esp_err_t ret = ConfigManager::instance().modify([&](antenna_switch_config_t &config) {
+        static constexpr uint8_t NO_MAC[6] = {};
+        const bool first_join = memcmp(config.relay_board_mac, NO_MAC, sizeof(NO_MAC)) == 0;
+        is_board = first_join || memcmp(config.relay_board_mac, mac, sizeof(config.relay_board_mac)) == 0;
+        if (!is_board) {
+            return;
+        }
+        // Remember the board, so a phone joining later can't take its place
+        memcpy(config.relay_board_mac, mac, sizeof(config.relay_board_mac));
+        strncpy(config.tcp_host, ip, sizeof(config.tcp_host) - 1);
+        config.tcp_host[sizeof(config.tcp_host) - 1] = '\0';
+    });
+    if (!is_board) {
+        ESP_LOGI(TAG, "SoftAP station " MACSTR " got " IPSTR, MAC2STR(mac), IP2STR(&ip_addr));
+        return;
+    }
+
+    strncpy(m_board_ip, ip, sizeof(m_board_ip) - 1);
+    ESP_LOGI(TAG, "Relay board " MACSTR " got %s on the SoftAP", MAC2STR(mac), ip);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to point the relay link at %s: %s", ip, esp_err_to_name(ret));
+    }
+}
+
+void WifiManager::on_associated(const uint8_t *bssid, const uint8_t channel) {
+    // Remember the AP for the next connection
+    if (memcmp(m_link_cache.bssid, bssid, sizeof(m_link_cache.bssid)) != 0 || m_link_cache.channel != channel) {
+        memcpy(m_link_cache.bssid, bssid, sizeof(m_link_cache.bssid));
+        m_link_cache.channel = channel;
+        if (const esp_err_t ret = save_link_cache(m_link_cache); ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to save AP for fast reconnect: %s", esp_err_to_name(ret));
+        }
+    }
+    m_link_cache_fresh = !m_targeted;
+    m_targeted_failures = 0;
+
+    // GOT_IP follows straight away instead of after DHCP
+    m_stats.static_ip = apply_static_ip();
+}
+
+void WifiManager::on_disconnected(const uint8_t reason) {
+    if (m_targeted) {
+        // The AP moved channel or is gone: find it, or another AP of the network, the slow way
+        if (reason == WIFI_REASON_NO_AP_FOUND || ++m_targeted_failures >= MAX_TARGETED_FAILURES) {
+            ESP_LOGW(TAG, "Cached AP not reachable (reason %d), scanning all channels", reason);
+            set_target(false);
+            m_stats.full_scans++;
+        }
+    } else if (m_link_cache_fresh) {
+        // Joined by a full scan since the last fallback: go back to the AP we just had
+        set_target(true);
+        m_link_cache_fresh = false;
+    }
+}
+
+void WifiManager::on_got_ip() {
+    // Stop SmartConfig if it's running
+    esp_smartconfig_stop();
+
+    // Only set this flag if we actually used SmartConfig
+    if (!m_using_saved_credentials) {
+        m_using_saved_credentials = true;
+    }
+}
+
+void WifiManager::apply_smartconfig_credentials() {
+    wifi_config_t wifi_config = m_smartconfig_config;
+
+    // Save the credentials and verify
+    const esp_err_t save_err = save_wifi_config(reinterpret_cast<const char *>(wifi_config.sta.ssid),
+                                                reinterpret_cast<const char *>(wifi_config.sta.password));
+    if (save_err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save WiFi credentials: %s", esp_err_to_name(save_err));
+    } else {
+        // Verify saved credentials
+        char verify_ssid[33] = {};
+        if (char verify_pass[65] = {}; load_wifi_config(verify_ssid, sizeof(verify_ssid), verify_pass,
+                                                         sizeof(verify_pass)) == ESP_OK) {
+            if (strcmp(verify_ssid, reinterpret_cast<char *>(wifi_config.sta.ssid)) == 0) {
+                ESP_LOGI(TAG, "WiFi credentials saved and verified successfully");
+            }
+        }
+    }
+
+    // New network: the cached AP belongs to the old one
+    m_targeted = false;
+    m_link_cache_fresh = false;
+    wifi_config.sta.pmf_cfg.capable = true;
+
+    ESP_ERROR_CHECK(esp_wifi_disconnect());
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    start_connect();
+}
+
+WifiManager::SoftApStatus WifiManager::get_softap_status() const {
+    SoftApStatus status = {};
+    status.running = m_softap_running;
+    status.stations = m_softap_stations;
+    strncpy(status.board_ip, m_board_ip, sizeof(status.board_ip) - 1);
+    return status;
+}
+
+WifiManager::ConnectStats WifiManager::get_connect_stats() const {
+    return m_stats;
+}
+
 void WifiManager::event_handler(void *arg, const esp_event_base_t event_base,
                                 const int32_t event_id, void *event_data) {
+    // Flags, counters and event bits only; anything that can block goes to ConnectivityManager
     auto &instance = WifiManager::instance();
+    auto &connectivity = ConnectivityManager::instance();
+    ConnectivityEvent event = {};
 
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        BootTimeline::mark(BootStage::WIFI_STARTED);
         // Only start SmartConfig if we're not using saved credentials
-        if (!instance.m_using_saved_credentials) {
+        if (instance.is_in_smartconfig_mode()) {
             xTaskCreate(&WifiManager::smartconfig_task, "smartconfig_task", 4096, nullptr, 3, nullptr);
         }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        const auto *disconnected = static_cast<wifi_event_sta_disconnected_t *>(event_data);
         instance.m_using_saved_credentials = false;
         instance.m_wifi_connected = false;
         instance.m_ip_obtained = false;
-        esp_wifi_connect();
         xEventGroupClearBits(instance.m_wifi_event_group, WIFI_CONNECTED_BIT);
         xEventGroupSetBits(instance.m_wifi_event_group, WIFI_FAIL_BIT);
+
+        event.type = ConnectivityEvent::Type::STA_DISCONNECTED;
+        event.reason = disconnected->reason;
+        connectivity.post(event);
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        const auto *connected = static_cast<wifi_event_sta_connected_t *>(event_data);
         instance.m_wifi_connected = true;
+        instance.m_associated_us = esp_timer_get_time();
+        instance.m_stats.last_assoc_us = instance.m_associated_us - instance.m_connect_start_us;
+        instance.m_stats.channel = connected->channel;
+        BootTimeline::mark(BootStage::WIFI_ASSOCIATED);
+
+        event.type = ConnectivityEvent::Type::STA_CONNECTED;
+        event.channel = connected->channel;
+        memcpy(event.mac, connected->bssid, sizeof(event.mac));
+        connectivity.post(event);
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         instance.m_ip_obtained = true;
         instance.m_wifi_connected = true; // Make sure this is set
         xEventGroupClearBits(instance.m_wifi_event_group, WIFI_FAIL_BIT);
         xEventGroupSetBits(instance.m_wifi_event_group, WIFI_CONNECTED_BIT);
 
-        ESP_LOGI(TAG, "WiFi Connected");
-
-        // Stop SmartConfig if it's running
-        esp_smartconfig_stop();
-
-        // Only set this flag if we actually used SmartConfig
-        if (!instance.m_using_saved_credentials) {
-            instance.m_using_saved_credentials = true;
+        const int64_t now = esp_timer_get_time();
+        instance.m_stats.last_dhcp_us = now - instance.m_associated_us;
+        instance.m_stats.connects++;
+        if (instance.m_targeted) {
+            instance.m_stats.fast_connects++;
         }
-
-        // Add a small delay to ensure connection status propagates
-        vTaskDelay(pdMS_TO_TICKS(100));
-
-        if (const esp_err_t ret = webserver_start(); ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to start webserver: %s", esp_err_to_name(ret));
-        } else {
-            ESP_LOGI(TAG, "Webserver started successfully");
+        ESP_LOGI(TAG, "WiFi Connected in %lld ms (association %lld ms, %s %lld ms, channel %d%s)",
+                 (now - instance.m_connect_start_us) / 1000, instance.m_stats.last_assoc_us / 1000,
+                 instance.m_stats.static_ip ? "static IP" : "DHCP", instance.m_stats.last_dhcp_us / 1000,
+                 instance.m_stats.channel, instance.m_targeted ? ", cached AP" : "");
+        BootTimeline::mark(BootStage::IP_ACQUIRED);
+
+        event.type = ConnectivityEvent::Type::GOT_IP;
+        connectivity.post(event);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+        instance.m_ip_obtained = false;
+        event.type = ConnectivityEvent::Type::LOST_IP;
+        connectivity.post(event);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_START) {
+        instance.m_softap_running = true;
+        BootTimeline::mark(BootStage::SOFTAP_STARTED);
+        // The web server and relay link come up on the SoftAP even if the house network never does
+        event.type = ConnectivityEvent::Type::AP_START;
+        connectivity.post(event);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STOP) {
+        instance.m_softap_running = false;
+        event.type = ConnectivityEvent::Type::AP_STOP;
+        connectivity.post(event);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
+        const auto *joined = static_cast<wifi_event_ap_staconnected_t *>(event_data);
+        instance.m_softap_stations++;
+        ESP_LOGI(TAG, "Station " MACSTR " joined the SoftAP", MAC2STR(joined->mac));
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
+        const auto *left = static_cast<wifi_event_ap_stadisconnected_t *>(event_data);
+        if (instance.m_softap_stations > 0) {
+            instance.m_softap_stations--;
         }
+        ESP_LOGI(TAG, "Station " MACSTR " left the SoftAP (reason %d)", MAC2STR(left->mac), left->reason);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_AP_STAIPASSIGNED) {
+        const auto *assigned = static_cast<ip_event_ap_staipassigned_t *>(event_data);
+        event.type = ConnectivityEvent::Type::STATION_IP;
+        memcpy(event.mac, assigned->mac, sizeof(event.mac));
+        event.ip = assigned->ip;
+        connectivity.post(event);
     } else if (event_base == SC_EVENT && event_id == SC_EVENT_SCAN_DONE) {
         ESP_LOGI(TAG, "Scan done");
     } else if (event_base == SC_EVENT && event_id == SC_EVENT_FOUND_CHANNEL) {
@@ -158,30 +463,13 @@ void WifiManager::event_handler(void *arg, const esp_event_base_t event_base,
         ESP_LOGI(TAG, "Got SSID and password");
 
         const auto *evt = static_cast<smartconfig_event_got_ssid_pswd_t *>(event_data);
+        instance.m_smartconfig_config = {};
+        memcpy(instance.m_smartconfig_config.sta.ssid, evt->ssid, sizeof(instance.m_smartconfig_config.sta.ssid));
+        memcpy(instance.m_smartconfig_config.sta.password, evt->password,
+               sizeof(instance.m_smartconfig_config.sta.password));
 
-        wifi_config_t wifi_config = {};
-        memcpy(wifi_config.sta.ssid, evt->ssid, sizeof(wifi_config.sta.ssid));
-        memcpy(wifi_config.sta.password, evt->password, sizeof(wifi_config.sta.password));
-
-        // Save the credentials and verify
-        const esp_err_t save_err = instance.save_wifi_config(reinterpret_cast<const char *>(wifi_config.sta.ssid),
-                                                             reinterpret_cast<const char *>(wifi_config.sta.password));
-        if (save_err != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to save WiFi credentials: %s", esp_err_to_name(save_err));
-        } else {
-            // Verify saved credentials
-            char verify_ssid[33] = {};
-            if (char verify_pass[65] = {}; instance.load_wifi_config(verify_ssid, sizeof(verify_ssid), verify_pass,
-                                                                      sizeof(verify_pass)) == ESP_OK) {
-                if (strcmp(verify_ssid, reinterpret_cast<char *>(wifi_config.sta.ssid)) == 0) {
-                    ESP_LOGI(TAG, "WiFi credentials saved and verified successfully");
-                }
-            }
-        }
-
-        ESP_ERROR_CHECK(esp_wifi_disconnect());
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-        ESP_ERROR_CHECK(esp_wifi_connect());
+        event.type = ConnectivityEvent::Type::SMARTCONFIG_CREDENTIALS;
+        connectivity.post(event);
     } else if (event_base == SC_EVENT && event_id == SC_EVENT_SEND_ACK_DONE) {
         xEventGroupSetBits(instance.m_wifi_event_group, ESPTOUCH_DONE_BIT);
     }
@@ -248,7 +536,14 @@ void WifiManager::smartconfig_task(void *parm) {
 }
 
 esp_err_t WifiManager::init() {
-    ESP_LOGI(TAG, "Initializing WiFi manager in STA mode");
+    const auto &config = ConfigManager::instance().get_config();
+    m_softap_mode = config.softap_mode <= SOFTAP_MODE_ONLY ? config.softap_mode : SOFTAP_MODE_OFF;
+    if (softap_enabled() && strlen(config.softap_password) < 8) {
+        ESP_LOGE(TAG, "SoftAP needs a WPA2 password of at least 8 characters, not starting it");
+        m_softap_mode = SOFTAP_MODE_OFF;
+    }
+    ESP_LOGI(TAG, "Initializing WiFi manager in %s mode",
+             m_softap_mode == SOFTAP_MODE_ONLY ? "AP" : softap_enabled() ? "AP+STA" : "STA");
 
     // Delete any existing event group first
     if (m_wifi_event_group) {
@@ -269,9 +564,6 @@ esp_err_t WifiManager::init() {
         ESP_LOGE(TAG, "TCP/IP adapter initialization failed: %s", esp_err_to_name(ret));
         return ret;
     }
-    
-    // Add delay after TCP/IP init
-    vTaskDelay(pdMS_TO_TICKS(100));
 
     // Create the default event loop if it doesn't exist
     ret = esp_event_loop_create_default();
@@ -280,9 +572,6 @@ esp_err_t WifiManager::init() {
         return ret;
     }
 
-    // Add delay after event loop creation
-    vTaskDelay(pdMS_TO_TICKS(100));
-
     // Create default WiFi sta
     m_sta_netif = esp_netif_create_default_wifi_sta();
     if (!m_sta_netif) {
@@ -290,9 +579,6 @@ esp_err_t WifiManager::init() {
         return ESP_FAIL;
     }
 
-    // Add delay after netif creation
-    vTaskDelay(pdMS_TO_TICKS(100));
-
     // Initialize WiFi with default config
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     // Increase buffer numbers for stability
@@ -305,9 +591,6 @@ esp_err_t WifiManager::init() {
         return ret;
     }
 
-    // Add delay after WiFi init
-    vTaskDelay(pdMS_TO_TICKS(100));
-
     // Set WiFi storage to flash
     ret = esp_wifi_set_storage(WIFI_STORAGE_FLASH);
     if (ret != ESP_OK) {
@@ -316,12 +599,26 @@ esp_err_t WifiManager::init() {
     }
 
     // Set mode to station
-    ret = esp_wifi_set_mode(WIFI_MODE_STA);
+    if (softap_enabled()) {
+        m_ap_netif = esp_netif_create_default_wifi_ap();
+        if (!m_ap_netif) {
+            ESP_LOGE(TAG, "Failed to create WiFi AP interface");
+            return ESP_FAIL;
+        }
+    }
+
+    ret = esp_wifi_set_mode(m_softap_mode == SOFTAP_MODE_ONLY ? WIFI_MODE_AP
+                            : softap_enabled()                ? WIFI_MODE_APSTA
+                                                              : WIFI_MODE_STA);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to set WiFi mode: %s", esp_err_to_name(ret));
         return ret;
     }
 
+    if (softap_enabled()) {
+        ESP_RETURN_ON_ERROR(configure_softap(config), TAG, "Failed to configure SoftAP");
+    }
+
     // Register event handlers with error checking
     ret = esp_event_handler_instance_register(WIFI_EVENT, ESP_EVENT_ANY_ID,
                                             &event_handler, nullptr, nullptr);
@@ -337,6 +634,20 @@ esp_err_t WifiManager::init() {
         return ret;
     }
 
+    ret = esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_LOST_IP,
+                                            &event_handler, nullptr, nullptr);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register IP lost event handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ret = esp_event_handler_instance_register(IP_EVENT, IP_EVENT_AP_STAIPASSIGNED,
+                                            &event_handler, nullptr, nullptr);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to register SoftAP IP event handler: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
     ret = esp_event_handler_instance_register(SC_EVENT, ESP_EVENT_ANY_ID,
                                             &event_handler, nullptr, nullptr);
     if (ret != ESP_OK) {
@@ -344,9 +655,6 @@ esp_err_t WifiManager::init() {
         return ret;
     }
 
-    // Add delay before starting WiFi
-    vTaskDelay(pdMS_TO_TICKS(100));
-
     // Start WiFi
     ret = esp_wifi_start();
     if (ret != ESP_OK) {
@@ -354,17 +662,29 @@ esp_err_t WifiManager::init() {
         return ret;
     }
 
-    // Add delay after starting WiFi
-    vTaskDelay(pdMS_TO_TICKS(200));
+    // Follows the configured profile, here and whenever the configuration is saved
+    ConfigManager::instance().add_observer(CONFIG_FIELD_NETWORK_PROFILE, [this](const antenna_switch_config_t &saved) {
+        if (!m_profile_applied || saved.network_profile != m_profile) {
+            set_network_profile(saved.network_profile);
+        }
+    });
 
     #ifdef FORCE_SMARTCONFIG
         ESP_LOGI(TAG, "Forcing SmartConfig mode...");
         return start_smartconfig();
     #else
+        if (m_softap_mode == SOFTAP_MODE_ONLY) {
+            return ESP_OK;
+        }
+
         // Try connecting with saved credentials
         ret = try_connect_with_saved_credentials();
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Could not connect with saved credentials: %s", esp_err_to_name(ret));
+            if (softap_enabled()) {
+                ESP_LOGI(TAG, "Continuing with the SoftAP only");
+                return ESP_OK;
+            }
             ESP_LOGI(TAG, "Starting SmartConfig...");
             return start_smartconfig();
         }
@@ -420,6 +740,20 @@ esp_err_t WifiManager::connect_sta(const char *ssid, const char *password) {
 
     ESP_RETURN_ON_ERROR(esp_wifi_set_config(WIFI_IF_STA, &wifi_config),
                         TAG, "Failed to set WiFi configuration");
+
+    // The cached AP is only valid for the network it was found on
+    char saved_ssid[33] = {};
+    char saved_password[65] = {};
+    const bool same_network = load_credentials(saved_ssid, sizeof(saved_ssid), saved_password,
+                                               sizeof(saved_password)) == ESP_OK && strcmp(saved_ssid, ssid) == 0;
+    const bool cached = same_network && load_link_cache(&m_link_cache) == ESP_OK;
+    set_target(cached);
+    if (cached) {
+        ESP_LOGI(TAG, "Connecting to cached AP " MACSTR " on channel %d", MAC2STR(m_link_cache.bssid),
+                 m_link_cache.channel);
+    }
+
+    m_connect_start_us = esp_timer_get_time();
     return esp_wifi_connect();
 }
 
@@ -491,6 +825,12 @@ esp_err_t WifiManager::clear_credentials() {
         return err;
     }
 
+    err = nvs_erase_key(my_handle, WIFI_LINK_CACHE_KEY);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        nvs_close(my_handle);
+        return err;
+    }
+
     // Commit changes
     err = nvs_commit(my_handle);
     nvs_close(my_handle);
@@ -4,26 +4,69 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "esp_netif.h"
+#include "esp_wifi.h"
+#include "network_profile.h"
+#include "antenna_switch.h"
+#include <cstdint>
 
 
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT     BIT1
 #define SMARTCONFIG_DONE_BIT BIT2
 
+// Access point for a direct link to the relay board (antenna_switch_config_t::softap_mode)
+#define SOFTAP_MODE_OFF 0
+#define SOFTAP_MODE_WITH_STA 1 // Alongside the house network, on its channel
+#define SOFTAP_MODE_ONLY 2 // No house network
+// First DHCP address on the SoftAP (default subnet 192.168.4.0/24), where the board lands when it joins first
+#define SOFTAP_BOARD_DEFAULT_IP "192.168.4.2"
+
 class WifiManager {
+    // Runs the slow half of the event handling
+    friend class ConnectivityManager;
+
 public:
+    // How long the last connection took to come up
+    struct ConnectStats {
+        uint32_t connects; // Connections that reached an IP address
+        uint32_t fast_connects; // Of which to the cached AP without a full scan
+        uint32_t full_scans; // Times the cached AP wasn't found and every channel was scanned
+        int64_t last_assoc_us; // esp_wifi_connect() to association
+        int64_t last_dhcp_us; // Association to IP address (static or DHCP)
+        uint8_t channel;
+        bool static_ip;
+    };
+
+    struct SoftApStatus {
+        bool running;
+        uint8_t stations;
+        char board_ip[16]; // Empty until the relay board has a lease
+    };
+
     static WifiManager& instance();
     
     // Core functionality
     esp_err_t init();
     bool is_connected() const { return m_wifi_connected; }
-    bool is_in_smartconfig_mode() const { return !m_using_saved_credentials; }
+    // SmartConfig needs the radio to itself, so never with the SoftAP
+    bool is_in_smartconfig_mode() const { return !m_using_saved_credentials && !softap_enabled(); }
     esp_err_t get_ip_info(char* ip_addr, size_t ip_addr_size);
     esp_err_t get_mac_address(char* mac_addr, size_t mac_addr_size);
     esp_err_t wait_for_connection(uint32_t timeout_ms);
     esp_err_t connect_sta(const char* ssid, const char* password);
     esp_err_t disconnect();
     esp_err_t clear_credentials();
+
+    ConnectStats get_connect_stats() const;
+
+    // Apply a NETWORK_PROFILE_*: power save and TX power now, the listen interval from the next association
+    esp_err_t set_network_profile(uint8_t profile);
+
+    uint8_t get_network_profile() const { return m_profile; }
+
+    bool softap_enabled() const { return m_softap_mode != SOFTAP_MODE_OFF; }
+
+    SoftApStatus get_softap_status() const;
     
 
     esp_err_t start_smartconfig(); // Public for recovery mode
@@ -49,6 +92,44 @@ private:
     static void event_handler(void* arg, esp_event_base_t event_base, 
                             int32_t event_id, void* event_data);
     esp_err_t try_connect_with_saved_credentials();
+
+    // Connect with the current config, timing it from here
+    void start_connect();
+
+    // Pin the connection to the cached BSSID and channel, or scan every channel
+    void set_target(bool targeted);
+
+    // Stops DHCP and sets the configured address, if any; on association
+    bool apply_static_ip();
+
+    // Access point and DHCP server for the relay board; after the mode is set
+    esp_err_t configure_softap(const antenna_switch_config_t &config);
+
+    // The event handler only records what happened and posts it to ConnectivityManager,
+    // whose task calls these, so NVS writes and reconfiguration never block the event loop
+
+    // Remember the AP for the next connection and set the static IP, if any
+    void on_associated(const uint8_t *bssid, uint8_t channel);
+
+    // Decide whether the next attempt goes to the cached AP or scans
+    void on_disconnected(uint8_t reason);
+
+    void on_got_ip();
+
+    // Save and connect to what SmartConfig received into m_smartconfig_config
+    void apply_smartconfig_credentials();
+
+    // Follow the relay board's lease with tcp_host
+    void on_station_ip(const uint8_t *mac, esp_ip4_addr_t ip);
+
+    // Last AP joined, so the next connection can skip the scan
+    struct LinkCache {
+        uint8_t bssid[6];
+        uint8_t channel; // 0 = none
+    };
+
+    esp_err_t save_link_cache(const LinkCache &cache);
+    esp_err_t load_link_cache(LinkCache *cache);
     static void smartconfig_task(void* parm);
     
     // Credential management
@@ -62,6 +143,26 @@ private:
     bool m_wifi_connected{false};
     bool m_ip_obtained{false};
     bool m_using_saved_credentials{false};
+    bool m_targeted{false}; // Connecting to the cached BSSID and channel only
+    int m_targeted_failures{0};
+    bool m_link_cache_fresh{false}; // Updated by a connection made with a full scan
+    LinkCache m_link_cache{};
+    int64_t m_connect_start_us{0};
+    int64_t m_associated_us{0};
+    ConnectStats m_stats{};
+    uint8_t m_profile{NETWORK_PROFILE_BALANCED};
+    bool m_profile_applied{false};
+    esp_netif_t* m_ap_netif{nullptr};
+    uint8_t m_softap_mode{SOFTAP_MODE_OFF};
+    bool m_softap_running{false};
+    uint8_t m_softap_stations{0};
+    char m_board_ip[16]{};
+    wifi_config_t m_smartconfig_config{}; // Written by the event handler before it posts
+    static constexpr int MAX_TARGETED_FAILURES = 2;
+    static constexpr uint8_t SOFTAP_DEFAULT_CHANNEL = 6;
+    static constexpr uint8_t SOFTAP_MAX_STATIONS = 4;
+    // Leases outlast any session, so the board keeps its address while the decoder runs
+    static constexpr uint32_t SOFTAP_LEASE_MINUTES = 24 * 60;
     static constexpr uint32_t WIFI_CONNECT_TIMEOUT_MS = 10000;  // 10 seconds
     static constexpr uint32_t SMARTCONFIG_TIMEOUT_MS = 120000;  // 2 minutes
     static constexpr uint32_t ESPTOUCH_DONE_BIT = BIT2;
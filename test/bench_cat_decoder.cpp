@@ -0,0 +1,163 @@
+// Decoder throughput on the host, per dialect: the same feed() calls uart_task
+// makes, over a stream of the frames a radio sends in auto-information mode plus
+// some it doesn't understand. Numbers are for comparing changes to the decoders,
+// not ESP32 timings; the ratio to the line rate shows how much headroom is left.
+//
+//   bench_cat_decoder [--quick] [--megabytes N]
+
+#include "cat_decoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Same chunk size as CAT_RX_CHUNK, which uart_task reads the UART in
+static constexpr size_t RX_CHUNK = 256;
+// Fastest CAT line rate the firmware detects, in bytes per second (10 bits per character)
+static constexpr double LINE_BYTES_PER_SECOND = 115200 / 10.0;
+
+struct Result {
+    double seconds;
+    size_t bytes;
+    uint64_t updates;
+    uint64_t checksum; // Keeps the decoded values alive
+};
+
+static void append(std::vector<uint8_t> *stream, const std::string &text) {
+    stream->insert(stream->end(), text.begin(), text.end());
+}
+
+static std::string digits(const uint32_t value, const int width) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%0*lu", width, static_cast<unsigned long>(value));
+    return buffer;
+}
+
+static std::vector<uint8_t> kenwood_stream(const size_t size) {
+    std::vector<uint8_t> stream;
+    for (uint32_t i = 0; stream.size() < size; i++) {
+        const uint32_t frequency = 14000000 + i * 10 % 350000;
+        append(&stream, "FA" + digits(frequency, 11) + ";");
+        if (i % 4 == 0) {
+            // P1 frequency, P2 step, P3 RIT offset, P4-P7, then TX/RX at 26 and mode at 27
+            append(&stream, "IF" + digits(frequency, 11) + "0000+0000000000" + (i % 8 ? "02" : "12") +
+                            "0000000;");
+        }
+        if (i % 16 == 0) {
+            append(&stream, "FB00007074000;AG0100;SM00005;");
+        }
+    }
+    return stream;
+}
+
+static std::vector<uint8_t> yaesu_stream(const size_t size) {
+    std::vector<uint8_t> stream;
+    for (uint32_t i = 0; stream.size() < size; i++) {
+        const uint32_t frequency = 7000000 + i * 10 % 300000;
+        append(&stream, "FA" + digits(frequency, 9) + ";");
+        if (i % 4 == 0) {
+            // P1 memory channel, P2 frequency, P3 clarifier, P4-P5, then mode at 19
+            append(&stream, "IF001" + digits(frequency, 9) + "+000000C0000;");
+        }
+        if (i % 8 == 0) {
+            append(&stream, i % 16 ? "TX0;MD02;" : "TX1;MD0C;");
+        }
+        if (i % 16 == 0) {
+            append(&stream, "SM0005;RM1050;");
+        }
+    }
+    return stream;
+}
+
+static std::vector<uint8_t> civ_stream(const size_t size) {
+    std::vector<uint8_t> stream;
+    const auto frame = [&](const uint8_t to, const uint8_t command, const uint8_t *data, const size_t len) {
+        const uint8_t head[] = {0xFE, 0xFE, to, 0x94, command};
+        stream.insert(stream.end(), head, head + sizeof(head));
+        stream.insert(stream.end(), data, data + len);
+        stream.push_back(0xFD);
+    };
+    for (uint32_t i = 0; stream.size() < size; i++) {
+        // Little-endian BCD, two digits per byte
+        uint8_t bcd[5];
+        uint32_t frequency = 21000000 + i * 10 % 450000;
+        for (uint8_t &b: bcd) {
+            b = static_cast<uint8_t>(frequency % 10 | (frequency / 10 % 10) << 4);
+            frequency /= 100;
+        }
+        frame(0x00, 0x00, bcd, sizeof(bcd)); // Transceive broadcast
+        if (i % 4 == 0) {
+            frame(0xE0, 0x03, bcd, sizeof(bcd)); // Reply to a poll
+        }
+        if (i % 8 == 0) {
+            const uint8_t mode[] = {0x01, 0x01};
+            const uint8_t tx[] = {0x00, static_cast<uint8_t>(i % 16 == 0)};
+            frame(0x00, 0x01, mode, sizeof(mode));
+            frame(0xE0, 0x1C, tx, sizeof(tx));
+        }
+        if (i % 16 == 0) {
+            const uint8_t meter[] = {0x02, 0x00, 0x42};
+            frame(0xE0, 0x15, meter, sizeof(meter));
+        }
+    }
+    return stream;
+}
+
+template<typename Decoder>
+static Result run(const std::vector<uint8_t> &stream, const size_t total_bytes) {
+    Decoder decoder;
+    Result result{};
+    const auto sink = [&](const CatUpdate &update) {
+        result.updates++;
+        result.checksum += update.frequency + (update.transmitting > 0) + (update.mode != nullptr);
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    while (result.bytes < total_bytes) {
+        for (size_t offset = 0; offset < stream.size(); offset += RX_CHUNK) {
+            const size_t len = std::min(RX_CHUNK, stream.size() - offset);
+            decoder.feed(stream.data() + offset, len, sink);
+        }
+        result.bytes += stream.size();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+static bool report(const char *name, const Result &result) {
+    const double bytes_per_second = result.bytes / result.seconds;
+    printf("%-8s %8.1f MB/s %6.2f ns/byte %8.2f M updates/s %9.0fx line rate (checksum %llu)\n", name,
+           bytes_per_second / 1e6, result.seconds * 1e9 / result.bytes, result.updates / result.seconds / 1e6,
+           bytes_per_second / LINE_BYTES_PER_SECOND, static_cast<unsigned long long>(result.checksum));
+    if (result.updates == 0) {
+        printf("%s: nothing decoded\n", name);
+        return false;
+    }
+    return true;
+}
+
+int main(const int argc, char **argv) {
+    size_t megabytes = 256;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            megabytes = 8;
+        } else if (strcmp(argv[i], "--megabytes") == 0 && i + 1 < argc) {
+            megabytes = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--megabytes N]\n", argv[0]);
+            return 2;
+        }
+    }
+    const size_t total_bytes = megabytes * 1000000;
+    // Small enough to stay in cache, like the UART buffer
+    constexpr size_t STREAM_SIZE = 64 * 1024;
+
+    printf("Feeding %zu MB per dialect in %zu-byte chunks\n", megabytes, RX_CHUNK);
+    bool ok = report("Kenwood", run<KenwoodDecoder>(kenwood_stream(STREAM_SIZE), total_bytes));
+    ok &= report("Yaesu", run<YaesuDecoder>(yaesu_stream(STREAM_SIZE), total_bytes));
+    ok &= report("CI-V", run<CivDecoder>(civ_stream(STREAM_SIZE), total_bytes));
+    return ok ? 0 : 1;
+}
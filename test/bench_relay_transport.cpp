@@ -0,0 +1,147 @@
+// Relay command latency and jitter per network transport: the real TcpRelayBackend
+// and UdpRelayBackend driving a simulated KC868 on loopback, one SET_ALL per band
+// change as RelayController sends them. Loopback takes Wi-Fi out of the picture,
+// so what's left is the cost of each client and protocol path; the lossy UDP run
+// shows what a retransmission does to the tail. Jitter is the standard deviation,
+// as RelayLatencyStats reports it on the target.
+//
+//   bench_relay_transport [--quick] [--samples N] [--board-delay-us N] [--drop-every N]
+
+#include "kc868_backend.h"
+#include "kc868_board_sim.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+static constexpr auto BOARD_HOST = "127.0.0.1";
+static constexpr int CONNECT_TIMEOUT_MS = 3000;
+static constexpr int WARMUP_COMMANDS = 20;
+
+struct Result {
+    std::vector<uint32_t> samples_us;
+    uint32_t failures;
+    uint32_t mismatches; // Confirmed or board state differs from what was asked for
+};
+
+static bool wait_ready(RelayBackend &backend) {
+    const int64_t deadline_us = esp_timer_get_time() + CONNECT_TIMEOUT_MS * 1000LL;
+    while (esp_timer_get_time() < deadline_us) {
+        if (backend.poll(20) == RelayLinkState::READY) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static Result run(RelayBackend &backend, const Kc868BoardSim &board, const size_t samples) {
+    Result result{};
+    result.samples_us.reserve(samples);
+    for (size_t i = 0; i < WARMUP_COMMANDS + samples; i++) {
+        // A different output each time, as a band change would
+        const RelayMask mask = ActiveRelayBoard::single(static_cast<int>(i % ActiveRelayBoard::NUM_OUTPUTS) + 1);
+        RelayMask confirmed;
+        const int64_t start_us = esp_timer_get_time();
+        const esp_err_t err = backend.write_outputs(mask, &confirmed);
+        const int64_t elapsed_us = esp_timer_get_time() - start_us;
+        if (i < WARMUP_COMMANDS) {
+            continue;
+        }
+        if (err != ESP_OK) {
+            result.failures++;
+            continue;
+        }
+        if (confirmed != mask || board.outputs() != mask.to_ulong()) {
+            result.mismatches++;
+        }
+        result.samples_us.push_back(static_cast<uint32_t>(elapsed_us));
+    }
+    return result;
+}
+
+static bool report(const char *name, Result result) {
+    std::vector<uint32_t> &samples = result.samples_us;
+    if (samples.empty()) {
+        printf("%-14s no successful commands (%lu failed)\n", name, static_cast<unsigned long>(result.failures));
+        return false;
+    }
+    std::sort(samples.begin(), samples.end());
+    const auto percentile = [&](const double p) { return samples[static_cast<size_t>((samples.size() - 1) * p)]; };
+    double mean = 0;
+    for (const uint32_t sample: samples) {
+        mean += sample;
+    }
+    mean /= samples.size();
+    double m2 = 0;
+    for (const uint32_t sample: samples) {
+        m2 += (sample - mean) * (sample - mean);
+    }
+    const double jitter = samples.size() > 1 ? std::sqrt(m2 / (samples.size() - 1)) : 0.0;
+
+    printf("%-14s %7zu %8lu %8lu %8lu %8.0f %8.0f %8lu\n", name, samples.size(),
+           static_cast<unsigned long>(percentile(0.5)), static_cast<unsigned long>(percentile(0.99)),
+           static_cast<unsigned long>(samples.back()), mean, jitter, static_cast<unsigned long>(result.failures));
+    if (result.mismatches != 0) {
+        printf("%s: %lu command(s) left the board in the wrong state\n", name,
+               static_cast<unsigned long>(result.mismatches));
+        return false;
+    }
+    return result.failures == 0;
+}
+
+static bool bench(const char *name, std::unique_ptr<RelayBackend> backend, const Kc868BoardSim &board,
+                  const size_t samples) {
+    if (backend->start() != ESP_OK || !wait_ready(*backend)) {
+        printf("%-14s board not reachable\n", name);
+        return false;
+    }
+    const bool ok = report(name, run(*backend, board, samples));
+    backend->log_stats();
+    return ok;
+}
+
+int main(const int argc, char **argv) {
+    size_t samples = 5000;
+    uint32_t board_delay_us = 0;
+    uint32_t drop_every = 50;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            samples = 200;
+        } else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            samples = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--board-delay-us") == 0 && i + 1 < argc) {
+            board_delay_us = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--drop-every") == 0 && i + 1 < argc) {
+            drop_every = strtoul(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--samples N] [--board-delay-us N] [--drop-every N]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    Kc868BoardSim board;
+    if (!board.start()) {
+        fprintf(stderr, "No loopback sockets available\n");
+        return 77; // Skipped
+    }
+    board.set_reply_delay_us(board_delay_us);
+
+    printf("%zu SET_ALL commands per transport, board replies after %lu us; latencies in us\n", samples,
+           static_cast<unsigned long>(board_delay_us));
+    printf("%-14s %7s %8s %8s %8s %8s %8s %8s\n", "transport", "samples", "p50", "p99", "max", "mean", "jitter",
+           "failed");
+    bool ok = bench("TCP", std::make_unique<TcpRelayBackend>(BOARD_HOST, board.tcp_port()), board, samples);
+    ok &= bench("UDP", std::make_unique<UdpRelayBackend>(BOARD_HOST, board.udp_port()), board, samples);
+    if (drop_every != 0) {
+        char name[16];
+        snprintf(name, sizeof(name), "UDP 1/%lu lost", static_cast<unsigned long>(drop_every));
+        board.drop_udp_every(drop_every);
+        ok &= bench(name, std::make_unique<UdpRelayBackend>(BOARD_HOST, board.udp_port()), board, samples);
+        printf("%lu datagram(s) dropped by the board\n", static_cast<unsigned long>(board.udp_dropped()));
+    }
+    return ok ? 0 : 1;
+}
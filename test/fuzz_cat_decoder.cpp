@@ -0,0 +1,204 @@
+// Arbitrary bytes through every CAT decoder. Besides not crashing, the decoders
+// must give the same updates however the stream is split into reads, and every
+// update must be one the firmware can use.
+//
+// With -DANTENNA_SWITCH_LIBFUZZER=ON (clang) this is a libFuzzer target. Otherwise
+// main() below replays the seed corpus and then mutations of it:
+//
+//   fuzz_cat_decoder [--iterations N] [--seed S] <corpus file or directory>...
+
+#include "cat_decoder.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+struct Recorded {
+    uint32_t frequency;
+    int8_t transmitting;
+    const char *mode;
+
+    bool operator==(const Recorded &other) const {
+        return frequency == other.frequency && transmitting == other.transmitting && mode == other.mode;
+    }
+};
+
+struct Outcome {
+    std::vector<Recorded> updates;
+    uint8_t rig_address{0};
+
+    bool operator==(const Outcome &other) const {
+        return updates == other.updates && rig_address == other.rig_address;
+    }
+};
+
+[[noreturn]] void fail(const char *decoder, const char *what) {
+    fprintf(stderr, "%s decoder: %s\n", decoder, what);
+    abort();
+}
+
+void check_update(const char *decoder, const CatUpdate &update) {
+    if (update.frequency == 0 && update.transmitting < 0 && update.mode == nullptr) {
+        fail(decoder, "update without any field");
+    }
+    if (update.transmitting < -1 || update.transmitting > 1) {
+        fail(decoder, "transmitting out of range");
+    }
+    // Modes are static strings shown as they are on the web page
+    if (update.mode != nullptr && (update.mode[0] == '\0' || strnlen(update.mode, 16) == 16)) {
+        fail(decoder, "mode is not a short string");
+    }
+}
+
+// Feed data in reads whose lengths come from split, as the UART may hand it over
+template<typename Decoder>
+Outcome decode(const char *name, const uint8_t *data, const size_t size, const uint8_t split) {
+    Decoder decoder;
+    Outcome outcome;
+    const auto sink = [&](const CatUpdate &update) {
+        check_update(name, update);
+        outcome.updates.push_back({update.frequency, update.transmitting, update.mode});
+    };
+    size_t offset = 0;
+    for (size_t i = 0; offset < size; i++) {
+        const size_t len = split == 0 ? size : std::min<size_t>(1 + (split * (i + 1)) % 23, size - offset);
+        decoder.feed(data + offset, len, sink);
+        offset += len;
+    }
+    if constexpr (std::is_same_v<Decoder, CivDecoder>) {
+        outcome.rig_address = decoder.rig_address();
+    }
+    return outcome;
+}
+
+template<typename Decoder>
+size_t check_decoder(const char *name, const uint8_t *data, const size_t size) {
+    const Outcome whole = decode<Decoder>(name, data, size, 0);
+    const uint8_t split = size > 0 ? data[0] | 1 : 1;
+    if (!(decode<Decoder>(name, data, size, split) == whole)) {
+        fail(name, "result depends on how the input is split into reads");
+    }
+    return whole.updates.size();
+}
+
+size_t run_one(const uint8_t *data, const size_t size) {
+    return check_decoder<KenwoodDecoder>("Kenwood", data, size) + check_decoder<YaesuDecoder>("Yaesu", data, size) +
+           check_decoder<CivDecoder>("CI-V", data, size);
+}
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, const size_t size) {
+    run_one(data, size);
+    return 0;
+}
+
+#if CAT_FUZZ_STANDALONE
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+
+namespace {
+// Bytes that make up frames, so mutations reach the parsers rather than only the framing
+constexpr uint8_t INTERESTING[] = {';', 0xFE, 0xFD, 0xFC, 0x00, 0xE0, 0x03, 0x1C, '0', '1', '9', 'F', 'A', 'I', 'T'};
+
+std::vector<uint8_t> read_file(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+std::vector<uint8_t> mutate(const std::vector<std::vector<uint8_t> > &corpus, std::mt19937 &rng) {
+    std::vector<uint8_t> input = corpus.empty() ? std::vector<uint8_t>() : corpus[rng() % corpus.size()];
+    const int mutations = 1 + rng() % 8;
+    for (int m = 0; m < mutations; m++) {
+        const size_t pos = input.empty() ? 0 : rng() % input.size();
+        switch (rng() % 6) {
+            case 0: // Flip a bit
+                if (!input.empty()) {
+                    input[pos] ^= 1 << rng() % 8;
+                }
+                break;
+            case 1: // Overwrite with a framing byte
+                if (!input.empty()) {
+                    input[pos] = INTERESTING[rng() % sizeof(INTERESTING)];
+                }
+                break;
+            case 2: // Insert random bytes
+                for (int n = rng() % 4 + 1; n > 0; n--) {
+                    input.insert(input.begin() + pos, static_cast<uint8_t>(rng()));
+                }
+                break;
+            case 3: // Drop a run
+                if (!input.empty()) {
+                    input.erase(input.begin() + pos,
+                                input.begin() + std::min(input.size(), pos + 1 + rng() % 16));
+                }
+                break;
+            case 4: // Splice in part of another entry
+                if (!corpus.empty()) {
+                    const auto &other = corpus[rng() % corpus.size()];
+                    const size_t start = other.empty() ? 0 : rng() % other.size();
+                    input.insert(input.begin() + pos, other.begin() + start,
+                                 other.begin() + std::min(other.size(), start + rng() % 32));
+                }
+                break;
+            default: // Repeat a run, for long frames and buffer limits
+                if (!input.empty()) {
+                    const std::vector<uint8_t> run(input.begin() + pos,
+                                                   input.begin() + std::min(input.size(), pos + 1 + rng() % 32));
+                    for (int n = rng() % 8; n > 0; n--) {
+                        input.insert(input.begin() + pos, run.begin(), run.end());
+                    }
+                }
+                break;
+        }
+    }
+    return input;
+}
+} // namespace
+
+int main(const int argc, char **argv) {
+    unsigned long iterations = 100000;
+    unsigned long seed = 1;
+    std::vector<std::vector<uint8_t> > corpus;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (std::filesystem::is_directory(argv[i])) {
+            for (const auto &entry: std::filesystem::recursive_directory_iterator(argv[i])) {
+                if (entry.is_regular_file()) {
+                    corpus.push_back(read_file(entry.path()));
+                }
+            }
+        } else if (std::filesystem::is_regular_file(argv[i])) {
+            corpus.push_back(read_file(argv[i]));
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--seed S] <corpus file or directory>...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    size_t seed_updates = 0;
+    for (const auto &input: corpus) {
+        seed_updates += run_one(input.data(), input.size());
+    }
+    if (!corpus.empty() && seed_updates == 0) {
+        fprintf(stderr, "Seed corpus decodes to nothing; the seeds no longer match the decoders\n");
+        return 1;
+    }
+
+    std::mt19937 rng(seed);
+    size_t updates = 0;
+    for (unsigned long i = 0; i < iterations; i++) {
+        const std::vector<uint8_t> input = mutate(corpus, rng);
+        updates += run_one(input.data(), input.size());
+    }
+    printf("%zu seeds (%zu updates), %lu mutated inputs (%zu updates), seed %lu: no failures\n", corpus.size(),
+           seed_updates, iterations, updates, seed);
+    return 0;
+}
+#endif
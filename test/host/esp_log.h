@@ -0,0 +1,38 @@
+#pragma once
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE
+} esp_log_level_t;
+
+// Formats on the stack and writes straight to stderr, so logging never allocates.
+// Shows warnings and errors unless ESP_LOG_LEVEL (0-5) is set in the environment.
+// Per-tag levels aren't kept; ESP_LOG_LEVEL applies to every tag
+void esp_log_level_set(const char *tag, esp_log_level_t level);
+
+void host_log(esp_log_level_t level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+// As on the target, levels above the build's maximum are compiled out with their arguments
+#ifndef LOG_LOCAL_LEVEL
+#define LOG_LOCAL_LEVEL CONFIG_LOG_MAXIMUM_LEVEL
+#endif
+
+#define ESP_LOG_LEVEL_LOCAL(level, tag, format, ...)                                                                   \
+    do {                                                                                                               \
+        if (LOG_LOCAL_LEVEL >= (level)) {                                                                              \
+            host_log(level, tag, format, ##__VA_ARGS__);                                                               \
+        }                                                                                                              \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_ERROR, tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_WARN, tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_INFO, tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_DEBUG, tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_LEVEL_LOCAL(ESP_LOG_VERBOSE, tag, format, ##__VA_ARGS__)
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "esp_err.h"
+#include <cstdint>
+
+typedef struct HostNetif esp_netif_t;
+
+typedef struct {
+    uint32_t addr;
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+// There are no interfaces on the host; lookups find nothing
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *if_key);
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info);
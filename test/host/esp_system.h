@@ -0,0 +1,4 @@
+#pragma once
+
+// Ends the test process; nothing on the host restarts it
+[[noreturn]] void esp_restart();
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// No watchdog on the host: every task counts as subscribed and resets succeed
+esp_err_t esp_task_wdt_add(TaskHandle_t task);
+
+esp_err_t esp_task_wdt_reset();
+
+esp_err_t esp_task_wdt_status(TaskHandle_t task);
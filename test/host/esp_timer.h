@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+// Microseconds from a monotonic clock
+int64_t esp_timer_get_time();
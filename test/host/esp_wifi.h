@@ -0,0 +1,17 @@
+#pragma once
+
+#include "esp_err.h"
+#include <cstdint>
+
+// Types only: enough for headers that mention Wi-Fi to compile, nothing to call
+typedef const char *esp_event_base_t;
+
+typedef enum {
+    WIFI_PS_NONE,
+    WIFI_PS_MIN_MODEM,
+    WIFI_PS_MAX_MODEM,
+} wifi_ps_type_t;
+
+typedef union {
+    uint8_t raw[128];
+} wifi_config_t;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "sdkconfig.h"
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdFAIL 0
+#define pdPASS 1
+#define portMAX_DELAY UINT32_MAX
+#define configTICK_RATE_HZ CONFIG_FREERTOS_HZ
+#define configMAX_TASK_NAME_LEN CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(static_cast<uint64_t>(ms) * configTICK_RATE_HZ / 1000))
+#define BIT(n) (1UL << (n))
+#define BIT0 BIT(0)
+#define BIT1 BIT(1)
+#define BIT2 BIT(2)
+#define BIT3 BIT(3)
+
+typedef struct HostQueue *QueueHandle_t;
+
+// Tasks are threads and event groups a mutex and condition variable, see freertos_host.cpp
+typedef uint8_t StackType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct HostTask *TaskHandle_t;
+typedef uint32_t EventBits_t;
+typedef struct HostEventGroup *EventGroupHandle_t;
+
+// Room for the host objects, which are constructed in place
+typedef struct {
+    alignas(16) unsigned char storage[128];
+} StaticTask_t;
+
+typedef struct {
+    alignas(16) unsigned char storage[192];
+} StaticEventGroup_t;
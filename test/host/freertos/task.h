@@ -0,0 +1,26 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include <cstdint>
+
+// Core and priority are accepted and ignored; the host scheduler decides
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth,
+                                           void *arg, UBaseType_t priority, StackType_t *stack, StaticTask_t *tcb,
+                                           BaseType_t core);
+
+// Only a task deleting itself stops; others run on until the process exits
+void vTaskDelete(TaskHandle_t task);
+
+void vTaskDelay(TickType_t ticks);
+
+void vTaskYield();
+
+#define taskYIELD() vTaskYield()
+
+// Threads not started through xTaskCreate* get a handle of their own too
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+char *pcTaskGetName(TaskHandle_t task);
@@ -0,0 +1,205 @@
+// FreeRTOS tasks and event groups on std::thread. Creating a task allocates (the
+// thread itself), as xTaskCreate does on the target; nothing a running task
+// calls here touches the heap.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_task_wdt.h"
+#include "esp_timer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <thread>
+
+struct HostTask {
+    char name[configMAX_TASK_NAME_LEN];
+    bool owned; // Allocated by xTaskCreatePinnedToCore rather than placed in a StaticTask_t
+};
+
+struct HostEventGroup {
+    std::mutex mutex;
+    std::condition_variable changed;
+    EventBits_t bits{0};
+    bool owned{false};
+};
+
+static_assert(sizeof(HostTask) <= sizeof(StaticTask_t), "StaticTask_t too small");
+static_assert(sizeof(HostEventGroup) <= sizeof(StaticEventGroup_t), "StaticEventGroup_t too small");
+
+static thread_local HostTask *current_task;
+// Handle for threads the tests start themselves, and the main thread
+static thread_local HostTask thread_task = {"main", false};
+
+static std::chrono::microseconds ticks_to_us(const TickType_t ticks) {
+    return std::chrono::microseconds(ticks * 1000000LL / configTICK_RATE_HZ);
+}
+
+static void start_thread(HostTask *task, const TaskFunction_t function, void *arg) {
+    std::thread([task, function, arg] {
+        current_task = task;
+        pthread_setname_np(pthread_self(), task->name);
+        function(arg);
+    }).detach();
+}
+
+static HostTask *init_task(void *storage, const char *name, const bool owned) {
+    auto *task = new(storage) HostTask{};
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    task->owned = owned;
+    return task;
+}
+
+BaseType_t xTaskCreatePinnedToCore(const TaskFunction_t function, const char *name, uint32_t, void *arg,
+                                   UBaseType_t, TaskHandle_t *handle, BaseType_t) {
+    HostTask *task = init_task(::operator new(sizeof(HostTask)), name, true);
+    if (handle != nullptr) {
+        *handle = task;
+    }
+    start_thread(task, function, arg);
+    return pdPASS;
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(const TaskFunction_t function, const char *name, uint32_t, void *arg,
+                                           UBaseType_t, StackType_t *, StaticTask_t *tcb, BaseType_t) {
+    if (tcb == nullptr) {
+        return nullptr;
+    }
+    HostTask *task = init_task(tcb->storage, name, false);
+    start_thread(task, function, arg);
+    return task;
+}
+
+void vTaskDelete(const TaskHandle_t task) {
+    if (task == nullptr || task == xTaskGetCurrentTaskHandle()) {
+        pthread_exit(nullptr);
+    }
+}
+
+void vTaskDelay(const TickType_t ticks) {
+    std::this_thread::sleep_for(ticks_to_us(ticks));
+}
+
+void vTaskYield() {
+    std::this_thread::yield();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current_task != nullptr ? current_task : &thread_task;
+}
+
+char *pcTaskGetName(const TaskHandle_t task) {
+    return (task != nullptr ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+// Event groups
+
+EventGroupHandle_t xEventGroupCreate() {
+    auto *group = new HostEventGroup();
+    group->owned = true;
+    return group;
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buffer) {
+    return buffer != nullptr ? new(buffer->storage) HostEventGroup() : nullptr;
+}
+
+void vEventGroupDelete(const EventGroupHandle_t group) {
+    if (group->owned) {
+        delete group;
+    } else {
+        group->~HostEventGroup();
+    }
+}
+
+EventBits_t xEventGroupSetBits(const EventGroupHandle_t group, const EventBits_t bits) {
+    std::lock_guard lock(group->mutex);
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(const EventGroupHandle_t group, const EventBits_t bits) {
+    std::lock_guard lock(group->mutex);
+    const EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(const EventGroupHandle_t group) {
+    std::lock_guard lock(group->mutex);
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(const EventGroupHandle_t group, const EventBits_t bits,
+                                const BaseType_t clear_on_exit, const BaseType_t wait_for_all,
+                                const TickType_t ticks_to_wait) {
+    std::unique_lock lock(group->mutex);
+    const auto satisfied = [&] {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    if (ticks_to_wait == portMAX_DELAY) {
+        group->changed.wait(lock, satisfied);
+    } else {
+        group->changed.wait_for(lock, ticks_to_us(ticks_to_wait), satisfied);
+    }
+    // Bits as they were before clearing, like FreeRTOS
+    const EventBits_t result = group->bits;
+    if (clear_on_exit && satisfied()) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+// Queues
+
+BaseType_t xQueueReceive(QueueHandle_t, void *, const TickType_t ticks_to_wait) {
+    vTaskDelay(ticks_to_wait == portMAX_DELAY ? pdMS_TO_TICKS(1000) : ticks_to_wait);
+    return pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t) {
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t) {
+    return 0;
+}
+
+// Services the relay code calls
+
+esp_err_t esp_task_wdt_add(TaskHandle_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_reset() {
+    return ESP_OK;
+}
+
+esp_err_t esp_task_wdt_status(TaskHandle_t) {
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_get_handle_from_ifkey(const char *) {
+    return nullptr;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *, esp_netif_ip_info_t *) {
+    return ESP_ERR_INVALID_ARG;
+}
+
+uint32_t esp_random() {
+    // splitmix64: allocation-free and good enough for backoff jitter
+    static std::atomic<uint64_t> state{static_cast<uint64_t>(esp_timer_get_time())};
+    uint64_t z = state.fetch_add(0x9E3779B97F4A7C15ULL) + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<uint32_t>(z ^ (z >> 31));
+}
@@ -0,0 +1,278 @@
+// Host implementations of the ESP-IDF calls the code under test makes. Only as
+// much as the tests need; anything timing related uses the monotonic clock.
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/uart.h"
+#include "nvs.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+const char *esp_err_to_name(const esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+static esp_log_level_t log_level() {
+    static const esp_log_level_t level = [] {
+        const char *env = getenv("ESP_LOG_LEVEL");
+        return env != nullptr ? static_cast<esp_log_level_t>(atoi(env)) : ESP_LOG_WARN;
+    }();
+    return level;
+}
+
+void esp_log_level_set(const char *, esp_log_level_t) {
+}
+
+void host_log(const esp_log_level_t level, const char *tag, const char *format, ...) {
+    if (level > log_level()) {
+        return;
+    }
+    static constexpr char LETTERS[] = "NEWIDV";
+    char line[256];
+    int len = snprintf(line, sizeof(line), "%c (%lld) %s: ", LETTERS[level],
+                       static_cast<long long>(esp_timer_get_time() / 1000), tag);
+    va_list args;
+    va_start(args, format);
+    len += vsnprintf(line + len, sizeof(line) - len, format, args);
+    va_end(args);
+    if (len >= static_cast<int>(sizeof(line))) {
+        len = sizeof(line) - 1;
+    }
+    line[len++] = '\n';
+    // One write per line keeps lines from different threads whole
+    (void) !write(STDERR_FILENO, line, len);
+}
+
+int64_t esp_timer_get_time() {
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+void esp_rom_delay_us(const uint32_t us) {
+    // Busy-waits on the chip too; sleeping would overshoot short turnarounds
+    const int64_t until = esp_timer_get_time() + us;
+    while (esp_timer_get_time() < until) {
+    }
+}
+
+void esp_restart() {
+    fprintf(stderr, "esp_restart() called\n");
+    abort();
+}
+
+// NVS
+
+static std::mutex nvs_mutex;
+static std::vector<std::string> nvs_namespaces;
+static std::map<std::string, std::vector<uint8_t> > nvs_blobs; // "namespace/key"
+
+static std::string nvs_path(const nvs_handle_t handle, const char *key) {
+    return nvs_namespaces.at(handle) + "/" + key;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t, nvs_handle_t *handle) {
+    std::lock_guard lock(nvs_mutex);
+    nvs_namespaces.emplace_back(name);
+    *handle = static_cast<nvs_handle_t>(nvs_namespaces.size() - 1);
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(const nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    std::lock_guard lock(nvs_mutex);
+    const auto blob = nvs_blobs.find(nvs_path(handle, key));
+    if (blob == nvs_blobs.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out_value != nullptr) {
+        if (*length < blob->second.size()) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        std::copy(blob->second.begin(), blob->second.end(), static_cast<uint8_t *>(out_value));
+    }
+    *length = blob->second.size();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(const nvs_handle_t handle, const char *key, const void *value, const size_t length) {
+    std::lock_guard lock(nvs_mutex);
+    const auto *bytes = static_cast<const uint8_t *>(value);
+    nvs_blobs[nvs_path(handle, key)].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {
+}
+
+// UART
+
+static std::atomic<int> uart_fds[UART_NUM_MAX] = {-1, -1, -1};
+static std::atomic<bool> uart_installed[UART_NUM_MAX];
+
+static int uart_fd(const uart_port_t port) {
+    return port >= 0 && port < UART_NUM_MAX && uart_installed[port].load() ? uart_fds[port].load() : -1;
+}
+
+void host_uart_attach(const uart_port_t port, const int fd) {
+    uart_fds[port].store(fd);
+}
+
+esp_err_t uart_driver_install(const uart_port_t port, int, int, int, QueueHandle_t *queue, int) {
+    if (port < 0 || port >= UART_NUM_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (uart_fds[port].load() < 0) {
+        return ESP_ERR_INVALID_STATE; // Nothing attached
+    }
+    if (queue != nullptr) {
+        *queue = nullptr; // No events on the host
+    }
+    uart_installed[port].store(true);
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(const uart_port_t port) {
+    uart_installed[port].store(false);
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(const uart_port_t port, const uart_config_t *) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_set_pin(const uart_port_t port, int, int, int, int) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_set_mode(const uart_port_t port, uart_mode_t) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_set_rx_timeout(const uart_port_t port, uint8_t) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+int uart_write_bytes(const uart_port_t port, const void *data, const size_t size) {
+    const int fd = uart_fd(port);
+    if (fd < 0) {
+        return -1;
+    }
+    size_t written = 0;
+    while (written < size) {
+        const ssize_t n = write(fd, static_cast<const uint8_t *>(data) + written, size - written);
+        if (n < 0 && errno != EINTR) {
+            return -1;
+        }
+        written += n > 0 ? n : 0;
+    }
+    return static_cast<int>(written);
+}
+
+int uart_read_bytes(const uart_port_t port, void *buffer, const uint32_t length, const TickType_t ticks_to_wait) {
+    const int fd = uart_fd(port);
+    if (fd < 0) {
+        return -1;
+    }
+    const int64_t deadline_us = ticks_to_wait == portMAX_DELAY
+                                    ? INT64_MAX
+                                    : esp_timer_get_time() + ticks_to_wait * 1000000LL / configTICK_RATE_HZ;
+    uint32_t got = 0;
+    while (got < length) {
+        const int64_t remaining_us = deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0) {
+            break;
+        }
+        pollfd pfd{fd, POLLIN, 0};
+        const int ready = poll(&pfd, 1, static_cast<int>(std::min<int64_t>(remaining_us / 1000 + 1, 1000)));
+        if (ready < 0 && errno != EINTR) {
+            return -1;
+        }
+        if (ready > 0) {
+            const ssize_t n = read(fd, static_cast<uint8_t *>(buffer) + got, length - got);
+            if (n < 0 && errno != EINTR && errno != EAGAIN) {
+                return -1;
+            }
+            got += n > 0 ? n : 0;
+        }
+    }
+    return static_cast<int>(got);
+}
+
+esp_err_t uart_wait_tx_done(const uart_port_t port, TickType_t) {
+    // Writes reach the other end of the descriptor before write() returns
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_flush_input(const uart_port_t port) {
+    const int fd = uart_fd(port);
+    if (fd < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t discard[64];
+    for (pollfd pfd{fd, POLLIN, 0}; poll(&pfd, 1, 0) > 0 && read(fd, discard, sizeof(discard)) > 0;) {
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_get_buffered_data_len(const uart_port_t port, size_t *size) {
+    const int fd = uart_fd(port);
+    int available = 0;
+    if (fd < 0 || ioctl(fd, FIONREAD, &available) != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *size = static_cast<size_t>(available);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(const uart_port_t port, uint32_t) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(const uart_port_t port, char, uint8_t, int, int, int) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_disable_pattern_det_intr(const uart_port_t port) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uart_pattern_queue_reset(const uart_port_t port, int) {
+    return uart_fd(port) >= 0 ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+int uart_pattern_pop_pos(uart_port_t) {
+    return -1;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+// lwIP's BSD socket API is the POSIX one under the same names. The C library
+// headers are those lwIP's ESP-IDF port pulls in, which the firmware relies on.
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
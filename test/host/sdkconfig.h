@@ -0,0 +1,17 @@
+#pragma once
+
+// Kconfig values for host builds: the defaults from main/Kconfig.projbuild, with the
+// no-heap-after-boot mode and allocation tracking on so tests can rely on them
+#define CONFIG_FREERTOS_HZ 1000
+#define CONFIG_FREERTOS_MAX_TASK_NAME_LEN 16
+#define CONFIG_LOG_MAXIMUM_LEVEL 3
+#define CONFIG_ANTENNA_SWITCH_REALTIME_CORE 1
+#define CONFIG_ANTENNA_SWITCH_CAT_PRIORITY 10
+#define CONFIG_ANTENNA_SWITCH_DISPATCH_PRIORITY 9
+#define CONFIG_ANTENNA_SWITCH_RELAY_LINK_PRIORITY 7
+#define CONFIG_ANTENNA_SWITCH_NETWORK_SERVICES_PRIORITY 4
+#define CONFIG_ANTENNA_SWITCH_HTTPD_PRIORITY 3
+#define CONFIG_ANTENNA_SWITCH_STATIC_ALLOCATION 1
+#define CONFIG_ANTENNA_SWITCH_ALLOC_TRACKER 1
+#define CONFIG_LWIP_MAX_SOCKETS 40
+#define CONFIG_LWIP_MAX_ACTIVE_TCP 40
@@ -0,0 +1,216 @@
+#include "kc868_board_sim.h"
+#include <arpa/inet.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr auto SET_ALL_CMD = "RELAY-SET_ALL-255";
+static constexpr auto STATE_CMD = "RELAY-STATE-255";
+static constexpr size_t NUM_DATA_BYTES = Kc868BoardSim::NUM_OUTPUTS / 8;
+
+Kc868BoardSim::~Kc868BoardSim() {
+    stop_.store(true);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    for (const Connection &connection: connections_) {
+        if (connection.fd >= 0) {
+            close(connection.fd);
+        }
+    }
+    for (const int fd: {listen_fd_, udp_fd_}) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+// Binds to an ephemeral loopback port and returns it, 0 on failure
+static uint16_t bind_loopback(const int fd) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) != 0) {
+        return 0;
+    }
+    return ntohs(addr.sin_port);
+}
+
+bool Kc868BoardSim::start() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    udp_fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (listen_fd_ < 0 || udp_fd_ < 0) {
+        return false;
+    }
+    tcp_port_ = bind_loopback(listen_fd_);
+    udp_port_ = bind_loopback(udp_fd_);
+    if (tcp_port_ == 0 || udp_port_ == 0 || listen(listen_fd_, MAX_CONNECTIONS) != 0) {
+        return false;
+    }
+    thread_ = std::thread(&Kc868BoardSim::run, this);
+    return true;
+}
+
+void Kc868BoardSim::run() {
+    while (!stop_.load()) {
+        pollfd fds[2 + MAX_CONNECTIONS];
+        fds[0] = {listen_fd_, POLLIN, 0};
+        fds[1] = {udp_fd_, POLLIN, 0};
+        for (int i = 0; i < MAX_CONNECTIONS; i++) {
+            fds[2 + i] = {connections_[i].fd, POLLIN, 0}; // Negative fds are skipped
+        }
+        if (poll(fds, std::size(fds), 20) <= 0) {
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            const int fd = accept(listen_fd_, nullptr, nullptr);
+            Connection *slot = nullptr;
+            for (Connection &connection: connections_) {
+                if (connection.fd < 0) {
+                    slot = &connection;
+                    break;
+                }
+            }
+            if (slot == nullptr) {
+                close(fd); // Out of connections, as the board would refuse
+            } else if (fd >= 0) {
+                // Replies go out whole and at once, as the board's lwIP stack sends them
+                constexpr int flag = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+                slot->fd = fd;
+                slot->have = 0;
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char datagram[BUFFER_SIZE];
+            sockaddr_in source{};
+            socklen_t source_len = sizeof(source);
+            const ssize_t len = recvfrom(udp_fd_, datagram, sizeof(datagram), 0,
+                                         reinterpret_cast<sockaddr *>(&source), &source_len);
+            const uint32_t every = udp_drop_every_.load();
+            if (len > 0 && every != 0 && ++udp_datagrams_ % every == 0) {
+                udp_dropped_++;
+            } else if (len > 0) {
+                char reply[BUFFER_SIZE];
+                if (const size_t reply_len = handle_command(datagram, len, reply, sizeof(reply)); reply_len > 0) {
+                    sendto(udp_fd_, reply, reply_len, 0, reinterpret_cast<sockaddr *>(&source), source_len);
+                }
+            }
+        }
+
+        for (int i = 0; i < MAX_CONNECTIONS; i++) {
+            Connection &connection = connections_[i];
+            if (!(fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            const ssize_t len = recv(connection.fd, connection.buffer + connection.have,
+                                     sizeof(connection.buffer) - connection.have, 0);
+            if (len <= 0) {
+                close(connection.fd);
+                connection.fd = -1;
+                continue;
+            }
+            connection.have += len;
+            const size_t used = handle_stream(connection.fd, connection.buffer, connection.have);
+            memmove(connection.buffer, connection.buffer + used, connection.have - used);
+            connection.have -= used;
+            if (connection.have == sizeof(connection.buffer)) {
+                connection.have = 0; // No command is this long
+            }
+        }
+    }
+}
+
+size_t Kc868BoardSim::handle_stream(const int fd, const char *buffer, const size_t have) {
+    size_t used = 0;
+    while (used < have) {
+        const char *start = buffer + used;
+        const size_t left = have - used;
+        if (*start == '\r' || *start == '\n') {
+            used++;
+            continue;
+        }
+
+        size_t length;
+        size_t consumed;
+        if (const auto *newline = static_cast<const char *>(memchr(start, '\n', left))) {
+            length = newline - start;
+            consumed = length + 1;
+        } else if (left >= strlen(STATE_CMD) && strncmp(start, STATE_CMD, strlen(STATE_CMD)) == 0) {
+            // TCPClient's verification probe comes without a newline
+            length = strlen(STATE_CMD);
+            consumed = length;
+        } else {
+            break; // Wait for the rest
+        }
+
+        char reply[BUFFER_SIZE];
+        if (const size_t reply_len = handle_command(start, length, reply, sizeof(reply)); reply_len > 0) {
+            // One write per reply, so a reader never sees half of one
+            (void) !send(fd, reply, reply_len, MSG_NOSIGNAL);
+        }
+        used += consumed;
+    }
+    return used;
+}
+
+size_t Kc868BoardSim::handle_command(const char *command, size_t length, char *reply, const size_t reply_size) {
+    while (length > 0 && (command[length - 1] == '\r' || command[length - 1] == '\n')) {
+        length--;
+    }
+    char text[BUFFER_SIZE];
+    if (length >= sizeof(text)) {
+        return 0;
+    }
+    memcpy(text, command, length);
+    text[length] = '\0';
+
+    const char *name;
+    if (strncmp(text, SET_ALL_CMD, strlen(SET_ALL_CMD)) == 0) {
+        // ",dN,...,d0", most significant byte first
+        uint32_t outputs = 0;
+        const char *p = text + strlen(SET_ALL_CMD);
+        for (size_t i = 0; i < NUM_DATA_BYTES; i++) {
+            char *end;
+            const unsigned long value = *p == ',' ? strtoul(p + 1, &end, 10) : 256;
+            if (value > 255 || end == p + 1) {
+                return 0;
+            }
+            outputs = outputs << 8 | value;
+            p = end;
+        }
+        if (*p != '\0') {
+            return 0;
+        }
+        outputs_.store(static_cast<uint16_t>(outputs));
+        name = SET_ALL_CMD;
+    } else if (strcmp(text, STATE_CMD) == 0) {
+        name = STATE_CMD;
+    } else {
+        return 0;
+    }
+    commands_++;
+
+    if (const uint32_t delay_us = reply_delay_us_.load(); delay_us > 0) {
+        usleep(delay_us);
+    }
+
+    // Both commands are answered with the command itself, the outputs and OK
+    int len = snprintf(reply, reply_size, "%s", name);
+    const uint16_t outputs = outputs_.load();
+    for (size_t i = NUM_DATA_BYTES; i-- > 0;) {
+        len += snprintf(reply + len, reply_size - len, ",%u", static_cast<unsigned>(outputs >> (i * 8) & 0xff));
+    }
+    len += snprintf(reply + len, reply_size - len, ",OK");
+    return static_cast<size_t>(len);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+// The KC868-A16's network side on loopback: a TCP listener (several connections,
+// as TCPClient keeps a standby) and a UDP port, both speaking the text protocol.
+// "RELAY-SET_ALL-255,d1,d0" sets the outputs and "RELAY-STATE-255" reads them;
+// either is answered with the command, the output bytes and ",OK", as the board does.
+// TCP commands may end in a newline or not; the verification probe has none.
+class Kc868BoardSim {
+public:
+    static constexpr size_t NUM_OUTPUTS = 16;
+
+    Kc868BoardSim() = default;
+
+    ~Kc868BoardSim();
+
+    // Binds both ports on 127.0.0.1 and starts answering; false if sockets are unavailable
+    bool start();
+
+    uint16_t tcp_port() const { return tcp_port_; }
+
+    uint16_t udp_port() const { return udp_port_; }
+
+    uint16_t outputs() const { return outputs_.load(); }
+
+    uint32_t commands() const { return commands_.load(); }
+
+    uint32_t udp_dropped() const { return udp_dropped_.load(); }
+
+    // Time the board takes to act on a command before replying
+    void set_reply_delay_us(const uint32_t delay_us) { reply_delay_us_.store(delay_us); }
+
+    // Ignore every nth UDP datagram, 0 for none, so retransmission shows up in the numbers
+    void drop_udp_every(const uint32_t n) { udp_drop_every_.store(n); }
+
+private:
+    static constexpr int MAX_CONNECTIONS = 4;
+    static constexpr size_t BUFFER_SIZE = 128;
+
+    struct Connection {
+        int fd{-1};
+        char buffer[BUFFER_SIZE];
+        size_t have{0};
+    };
+
+    void run();
+
+    // Handles every complete command at the front of buffer; returns the bytes consumed
+    size_t handle_stream(int fd, const char *buffer, size_t have);
+
+    // Builds the reply for one command into reply; 0 if it isn't one the board knows
+    size_t handle_command(const char *command, size_t length, char *reply, size_t reply_size);
+
+    int listen_fd_{-1};
+    int udp_fd_{-1};
+    uint16_t tcp_port_{0};
+    uint16_t udp_port_{0};
+    Connection connections_[MAX_CONNECTIONS];
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint16_t> outputs_{0};
+    std::atomic<uint32_t> commands_{0};
+    std::atomic<uint32_t> udp_datagrams_{0};
+    std::atomic<uint32_t> udp_dropped_{0};
+    std::atomic<uint32_t> reply_delay_us_{0};
+    std::atomic<uint32_t> udp_drop_every_{0};
+};
@@ -0,0 +1,193 @@
+#include "modbus_coil_emulator.h"
+#include "modbus_relay_backend.h"
+#include "esp_timer.h"
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+static constexpr uint8_t FC_READ_COILS = 0x01;
+static constexpr uint8_t FC_WRITE_MULTIPLE_COILS = 0x0F;
+static constexpr uint8_t ILLEGAL_FUNCTION = 0x01;
+static constexpr uint8_t ILLEGAL_DATA_ADDRESS = 0x02;
+// A request cut short by this much silence is dropped, as a slave would after t3.5
+static constexpr int FRAME_TIMEOUT_MS = 50;
+
+ModbusCoilEmulator::ModbusCoilEmulator(const uint8_t address) : address_(address) {
+}
+
+ModbusCoilEmulator::~ModbusCoilEmulator() {
+    stop_.store(true);
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (slave_fd_ >= 0) {
+        close(slave_fd_);
+    }
+    if (master_fd_ >= 0) {
+        close(master_fd_);
+    }
+}
+
+bool ModbusCoilEmulator::start() {
+    master_fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd_ < 0 || grantpt(master_fd_) != 0 || unlockpt(master_fd_) != 0) {
+        return false;
+    }
+    slave_fd_ = open(ptsname(master_fd_), O_RDWR | O_NOCTTY);
+    if (slave_fd_ < 0) {
+        return false;
+    }
+    // Binary frames: no line discipline on either side
+    termios tio{};
+    for (const int fd: {master_fd_, slave_fd_}) {
+        tcgetattr(fd, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    thread_ = std::thread(&ModbusCoilEmulator::run, this);
+    return true;
+}
+
+ModbusCoilEmulator::Request ModbusCoilEmulator::last_request() const {
+    std::lock_guard lock(mutex_);
+    return last_request_;
+}
+
+bool ModbusCoilEmulator::take(std::atomic<int> &counter) {
+    for (int value = counter.load(); value > 0;) {
+        if (counter.compare_exchange_weak(value, value - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t ModbusCoilEmulator::frame_length(const uint8_t *frame, const size_t have) {
+    if (have < 2) {
+        return 0;
+    }
+    switch (frame[1]) {
+        case FC_WRITE_MULTIPLE_COILS:
+            // Address, function, start, quantity, byte count, data, CRC
+            return have < 7 ? 0 : 7 + frame[6] + 2;
+        default:
+            // Read coils and everything we don't implement: address, function, 4 bytes, CRC
+            return 8;
+    }
+}
+
+void ModbusCoilEmulator::run() {
+    uint8_t frame[sizeof(Request::frame)];
+    size_t have = 0;
+    int64_t start_us = 0;
+    while (!stop_.load()) {
+        pollfd pfd{master_fd_, POLLIN, 0};
+        if (poll(&pfd, 1, have > 0 ? FRAME_TIMEOUT_MS : 20) <= 0) {
+            have = 0; // Silence ends any partial frame
+            continue;
+        }
+        uint8_t b;
+        if (read(master_fd_, &b, 1) != 1) {
+            continue;
+        }
+        if (have == 0) {
+            start_us = esp_timer_get_time();
+        }
+        frame[have++] = b;
+        if (const size_t want = frame_length(frame, have); want > sizeof(frame)) {
+            have = 0;
+        } else if (want > 0 && have == want) {
+            handle(frame, have, start_us);
+            have = 0;
+        }
+    }
+}
+
+void ModbusCoilEmulator::handle(const uint8_t *frame, const size_t length, const int64_t start_us) {
+    const uint16_t crc = frame[length - 2] | frame[length - 1] << 8;
+    if (ModbusRelayBackend::crc16(frame, length - 2) != crc) {
+        crc_errors_++;
+        return; // Slaves stay silent on a bad CRC
+    }
+    if (frame[0] != address_) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        memcpy(last_request_.frame, frame, length);
+        last_request_.length = length;
+        last_request_.start_us = start_us;
+        last_request_.gap_us = last_reply_us_ < 0 ? -1 : start_us - last_reply_us_;
+    }
+    requests_++;
+
+    if (take(drop_)) {
+        return;
+    }
+
+    uint8_t response[64];
+    size_t response_length;
+    const uint16_t start = frame[2] << 8 | frame[3];
+    const uint16_t quantity = frame[4] << 8 | frame[5];
+    const bool in_range = start + quantity <= NUM_COILS && quantity > 0;
+    const auto exception = [&](const uint8_t code) {
+        response[0] = address_;
+        response[1] = frame[1] | 0x80;
+        response[2] = code;
+        return 3;
+    };
+
+    if (take(exception_count_)) {
+        response_length = exception(exception_code_.load());
+    } else if (frame[1] == FC_READ_COILS) {
+        if (!in_range) {
+            response_length = exception(ILLEGAL_DATA_ADDRESS);
+        } else {
+            const uint8_t bytes = (quantity + 7) / 8;
+            const uint32_t bits = (coils_.load() >> start) & ((1UL << quantity) - 1);
+            response[0] = address_;
+            response[1] = FC_READ_COILS;
+            response[2] = bytes;
+            for (uint8_t i = 0; i < bytes; i++) {
+                response[3 + i] = static_cast<uint8_t>(bits >> (i * 8));
+            }
+            response_length = 3 + bytes;
+        }
+    } else if (frame[1] == FC_WRITE_MULTIPLE_COILS) {
+        if (!in_range || frame[6] != (quantity + 7) / 8) {
+            response_length = exception(ILLEGAL_DATA_ADDRESS);
+        } else {
+            uint32_t bits = 0;
+            for (uint8_t i = 0; i < frame[6]; i++) {
+                bits |= static_cast<uint32_t>(frame[7 + i]) << (i * 8);
+            }
+            const uint32_t field = ((1UL << quantity) - 1) << start;
+            coils_.store(static_cast<uint16_t>((coils_.load() & ~field) | ((bits << start) & field)));
+            // The reply echoes address, function, start and quantity
+            memcpy(response, frame, 6);
+            response_length = 6;
+        }
+    } else {
+        response_length = exception(ILLEGAL_FUNCTION);
+    }
+
+    if (take(wrong_address_count_)) {
+        response[0] = wrong_address_.load();
+    }
+    reply(response, response_length);
+}
+
+void ModbusCoilEmulator::reply(uint8_t *frame, size_t length) {
+    const uint16_t crc = ModbusRelayBackend::crc16(frame, length);
+    frame[length++] = crc & 0xff;
+    frame[length++] = crc >> 8;
+    if (take(corrupt_)) {
+        frame[length - 1] ^= 0x5A;
+    }
+    (void) !write(master_fd_, frame, length);
+    last_reply_us_ = esp_timer_get_time();
+}
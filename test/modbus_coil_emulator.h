@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// A Modbus-RTU slave with NUM_COILS coils on the master side of a pseudo-terminal,
+// standing in for the relay board on the RS485 bus. It answers read coils (0x01)
+// and write multiple coils (0x0F) like the board does, rejects anything else with
+// an illegal function exception, and can be told to misbehave for the next few
+// requests. slave_fd() is the end to hand to the backend through host_uart_attach().
+class ModbusCoilEmulator {
+public:
+    static constexpr size_t NUM_COILS = 16;
+
+    struct Request {
+        uint8_t frame[64];
+        size_t length;
+        int64_t start_us; // First byte seen
+        int64_t gap_us; // Silence since our previous reply ended, -1 for the first request
+    };
+
+    explicit ModbusCoilEmulator(uint8_t address);
+
+    ~ModbusCoilEmulator();
+
+    // Opens the pseudo-terminal and starts answering; false if no pty is available
+    bool start();
+
+    int slave_fd() const { return slave_fd_; }
+
+    uint16_t coils() const { return coils_.load(); }
+
+    void set_coils(const uint16_t coils) { coils_.store(coils); }
+
+    // Requests addressed to us with a valid CRC
+    uint32_t requests() const { return requests_.load(); }
+
+    uint32_t crc_errors() const { return crc_errors_.load(); }
+
+    Request last_request() const;
+
+    // Misbehaviour for the next count requests, checked in this order
+    void drop_replies(const int count) { drop_.store(count); }
+
+    void corrupt_crc(const int count) { corrupt_.store(count); }
+
+    void answer_as(const uint8_t address, const int count) {
+        wrong_address_.store(address);
+        wrong_address_count_.store(count);
+    }
+
+    void raise_exception(const uint8_t code, const int count) {
+        exception_code_.store(code);
+        exception_count_.store(count);
+    }
+
+private:
+    void run();
+
+    // Bytes a request with this header needs, 0 if more header is needed first
+    static size_t frame_length(const uint8_t *frame, size_t have);
+
+    void handle(const uint8_t *frame, size_t length, int64_t start_us);
+
+    void reply(uint8_t *frame, size_t length);
+
+    static bool take(std::atomic<int> &counter);
+
+    uint8_t address_;
+    int master_fd_{-1};
+    int slave_fd_{-1};
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<uint16_t> coils_{0};
+    std::atomic<uint32_t> requests_{0};
+    std::atomic<uint32_t> crc_errors_{0};
+    std::atomic<int> drop_{0};
+    std::atomic<int> corrupt_{0};
+    std::atomic<uint8_t> wrong_address_{0};
+    std::atomic<int> wrong_address_count_{0};
+    std::atomic<uint8_t> exception_code_{0};
+    std::atomic<int> exception_count_{0};
+    int64_t last_reply_us_{-1};
+    mutable std::mutex mutex_;
+    Request last_request_{};
+};
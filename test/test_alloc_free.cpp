@@ -0,0 +1,310 @@
+// The no-heap-after-boot promise, checked on the host: once everything is
+// initialised, CAT decoding, the CAT bridge and poller, frequency and antenna
+// arbitration and relay dispatch must not allocate. Every operator new goes
+// through AllocTracker, which counts it if the calling task is watched. The test
+// watches itself, as the CAT tasks do, and the dispatcher task watches itself;
+// the relay board is the Modbus coil emulator, so each band change really goes
+// out to a board and is confirmed before the next. Frames reach the radio's real
+// CatParser, which is never started: decoded updates go to apply_update as
+// uart_task hands them over, and command strings through process_command.
+
+#include "alloc_tracker.h"
+#include "antenna_switch.h"
+#include "boot_timeline.h"
+#include "cat_decoder.h"
+#include "cat_mux.h"
+#include "cat_parser.h"
+#include "cat_poller.h"
+#include "frequency_arbiter.h"
+#include "modbus_coil_emulator.h"
+#include "modbus_relay_backend.h"
+#include "relay_controller.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+void *operator new(const size_t size) {
+    AllocTracker::on_alloc(size);
+    if (void *ptr = malloc(size != 0 ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](const size_t size) {
+    return operator new(size);
+}
+
+void *operator new(const size_t size, const std::align_val_t alignment) {
+    AllocTracker::on_alloc(size);
+    const size_t align = static_cast<size_t>(alignment);
+    if (void *ptr = aligned_alloc(align, (size + align - 1) / align * align)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](const size_t size, const std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+    free(ptr);
+}
+
+namespace {
+constexpr uint8_t MODBUS_SLAVE = 1;
+constexpr uint8_t CIV_RIG_ADDRESS = 0x94;
+constexpr int SETTLE_TIMEOUT_MS = 2000;
+constexpr int ROUNDS = 20;
+
+int failures = 0;
+
+struct Band {
+    uint32_t start;
+    uint32_t end;
+    int port; // 1-based antenna port, which is also the relay output
+};
+
+// Radio 1 hops between these; radio 2 sits on the last one
+constexpr Band BANDS[] = {
+    {3500000, 3800000, 1},
+    {7000000, 7200000, 2},
+    {14000000, 14350000, 3},
+    {21000000, 21450000, 4},
+};
+constexpr int RADIO2_BAND = 3;
+
+void fail(const char *what) {
+    fprintf(stderr, "%s\n", what);
+    failures++;
+}
+
+// Fixed-size frame builders, so the streams themselves never touch the heap
+size_t kenwood_fa(char *buf, const uint32_t frequency) {
+    return snprintf(buf, 32, "FA%011lu;", static_cast<unsigned long>(frequency));
+}
+
+// Receiving, USB
+size_t kenwood_if(char *buf, const uint32_t frequency) {
+    return snprintf(buf, 48, "IF%011lu0000+0000000000020000000;", static_cast<unsigned long>(frequency));
+}
+
+size_t yaesu_fa(char *buf, const uint32_t frequency) {
+    return snprintf(buf, 32, "FA%09lu;", static_cast<unsigned long>(frequency));
+}
+
+size_t civ_transceive(uint8_t *buf, uint32_t frequency) {
+    size_t n = 0;
+    for (const uint8_t b: {0xFE, 0xFE, 0x00, static_cast<int>(CIV_RIG_ADDRESS), 0x00}) {
+        buf[n++] = b;
+    }
+    // Five BCD bytes, least significant pair first
+    for (int i = 0; i < 5; i++) {
+        buf[n++] = static_cast<uint8_t>(frequency % 10 | (frequency / 10 % 10) << 4);
+        frequency /= 100;
+    }
+    buf[n++] = 0xFD;
+    return n;
+}
+
+antenna_switch_config_t make_config() {
+    antenna_switch_config_t config{};
+    antenna_switch_get_config(&config);
+    config.auto_mode = true;
+    config.num_bands = std::size(BANDS);
+    config.num_antenna_ports = 4;
+    for (size_t i = 0; i < std::size(BANDS); i++) {
+        band_config_t &band = config.bands[i];
+        memset(&band, 0, sizeof(band));
+        snprintf(band.description, sizeof(band.description), "band %u", static_cast<unsigned>(i + 1));
+        band.start_freq = BANDS[i].start;
+        band.end_freq = BANDS[i].end;
+        band.antenna_ports[BANDS[i].port - 1] = true;
+    }
+    config.relay_transport = RELAY_TRANSPORT_RS485;
+    config.modbus_address = MODBUS_SLAVE;
+    config.num_radios = 2;
+    return config;
+}
+
+// Wait for every board to confirm, then compare with what the emulated board holds
+void expect_outputs(const ModbusCoilEmulator &emulator, const uint16_t expected, const char *when) {
+    const int64_t deadline_us = esp_timer_get_time() + SETTLE_TIMEOUT_MS * 1000LL;
+    while ((!antenna_switch_outputs_settled() || emulator.coils() != expected) &&
+           esp_timer_get_time() < deadline_us) {
+        vTaskDelay(pdMS_TO_TICKS(2));
+    }
+    if (emulator.coils() != expected) {
+        fprintf(stderr, "%s: board has outputs 0x%04x, expected 0x%04x\n", when, emulator.coils(), expected);
+        failures++;
+    }
+}
+
+uint16_t port_bit(const int port) {
+    return static_cast<uint16_t>(1U << (port - 1));
+}
+
+// Decode as uart_task does and hand each update to the parser
+template<typename Decoder>
+void feed(Decoder &decoder, const uint8_t *data, const size_t len, CatParser &parser, CatPoller *poller) {
+    const int64_t now_us = esp_timer_get_time();
+    poller->on_activity(now_us);
+    decoder.feed(data, len, [&](const CatUpdate &update) {
+        if (update.frequency != 0) {
+            poller->on_frequency(update.frequency, now_us);
+        }
+        if (parser.apply_update(update) != ESP_OK) {
+            fail("apply_update failed");
+        }
+    });
+}
+
+// One pass over every hot path, switching radio 1 to band
+void run_round(const int band, CatParser &parser, KenwoodDecoder &kenwood, YaesuDecoder &yaesu, CivDecoder &civ,
+               CatMux &mux, CatPoller &poller, const ModbusCoilEmulator &emulator) {
+    const uint32_t frequency = BANDS[band].start + 10000;
+    char text[64];
+    uint8_t frame[32];
+    size_t len;
+
+    // The bridge: a PC command, our poll in a gap, and the radio's replies
+    mux.set_protocol(CAT_PROTOCOL_KENWOOD);
+    const int64_t now_us = esp_timer_get_time();
+    size_t forwarded = 0;
+    const auto forward = [&](const uint8_t *, const size_t n) { forwarded += n; };
+    mux.on_pc_bytes(reinterpret_cast<const uint8_t *>("FA;"), 3, now_us);
+    len = kenwood_fa(text, frequency);
+    mux.route_radio(reinterpret_cast<const uint8_t *>(text), len, now_us, forward);
+    if (mux.can_inject(now_us) && poller.poll_due(now_us)) {
+        len = CatPoller::query(CAT_PROTOCOL_KENWOOD, CIV_RIG_ADDRESS, frame, sizeof(frame));
+        mux.on_poll_sent(now_us);
+    }
+
+    // The same band change in each dialect; only the first one moves the relays
+    len = kenwood_fa(text, frequency);
+    feed(kenwood, reinterpret_cast<const uint8_t *>(text), len, parser, &poller);
+    len = yaesu_fa(text, frequency + 100);
+    feed(yaesu, reinterpret_cast<const uint8_t *>(text), len, parser, &poller);
+    len = civ_transceive(frame, frequency + 200);
+    feed(civ, frame, len, parser, &poller);
+    // Key up and back, which lets the arbiter reconsider held-off radios
+    feed(yaesu, reinterpret_cast<const uint8_t *>("TX1;TX0;"), 8, parser, &poller);
+
+    // The command path: the handler table, string_view parsing and the mode string
+    len = kenwood_fa(text, frequency + 300);
+    kenwood_if(text + len, frequency + 400);
+    if (parser.process_command(text) != ESP_OK || parser.get_frequency() != frequency + 400 ||
+        strcmp(parser.get_mode(), "USB") != 0) {
+        fail("process_command did not apply FA and IF");
+    }
+
+    // Radio 2 from a network source, repeating itself as loggers do
+    antenna_switch_report_frequency(1, FREQ_SOURCE_NETWORK, BANDS[RADIO2_BAND].start + 5000);
+
+    expect_outputs(emulator, port_bit(BANDS[band].port) | port_bit(BANDS[RADIO2_BAND].port), "band change");
+    if (forwarded == 0) {
+        fail("CAT bridge forwarded nothing to the PC");
+    }
+}
+} // namespace
+
+int main() {
+    ModbusCoilEmulator emulator(MODBUS_SLAVE);
+    if (!emulator.start()) {
+        fprintf(stderr, "No pseudo-terminal available\n");
+        return 77; // Skipped
+    }
+    host_uart_attach(RS485_UART_NUM, emulator.slave_fd());
+
+    // Boot, as SystemInitializer does it
+    BootTimeline::init();
+    if (antenna_switch_init() != ESP_OK) {
+        fail("antenna_switch_init failed");
+        return 1;
+    }
+    const antenna_switch_config_t config = make_config();
+    if (antenna_switch_set_config(&config) != ESP_OK) {
+        fail("antenna_switch_set_config failed");
+        return 1;
+    }
+    auto controller = std::make_unique<RelayController>();
+    controller->set_transport(config.relay_transport);
+    controller->set_modbus_settings(config.modbus_address, config.rs485_baud_rate);
+    if (controller->init() != ESP_OK) {
+        fail("RelayController::init failed");
+        return 1;
+    }
+    antenna_switch_set_relay_controller(std::move(controller));
+    if (antenna_switch_start_relay_dispatch() != ESP_OK) {
+        fail("relay dispatch did not start");
+        return 1;
+    }
+
+    // The CAT task's state, set up before its loop like cat_parser's
+    CatParser &parser = CatParser::radio(0);
+    KenwoodDecoder kenwood;
+    YaesuDecoder yaesu;
+    CivDecoder civ;
+    CatMux mux;
+    CatPoller poller;
+
+    // From here on nothing may allocate
+    AllocTracker::watch_current_task();
+    for (int round = 0; round < ROUNDS; round++) {
+        // Radio 2 holds the last band, so radio 1 cycles through the others
+        run_round(round % RADIO2_BAND, parser, kenwood, yaesu, civ, mux, poller, emulator);
+    }
+
+    const AllocTracker::Report report = AllocTracker::get_report();
+    RelayDispatcher::Stats stats{};
+    antenna_switch_dispatch_stats(&stats);
+    if (report.allocations != 0) {
+        fprintf(stderr, "%lu heap allocation(s) after init, the last of %lu bytes on %s\n",
+                static_cast<unsigned long>(report.allocations), static_cast<unsigned long>(report.last_size),
+                report.last_task != nullptr ? report.last_task : "?");
+        failures++;
+    }
+    if (stats.completed < ROUNDS) {
+        fprintf(stderr, "Only %lu of %d band changes confirmed\n", static_cast<unsigned long>(stats.completed),
+                ROUNDS);
+        failures++;
+    }
+
+    // Make sure a zero above means something: an allocation here has to be counted
+    delete new int(0);
+    if (AllocTracker::get_report().allocations != report.allocations + 1) {
+        fail("operator new is not reaching AllocTracker");
+    }
+
+    printf("%d band changes, %lu dispatched, %lu confirmed (max %lld us): %s\n", ROUNDS,
+           static_cast<unsigned long>(stats.dispatched), static_cast<unsigned long>(stats.completed),
+           static_cast<long long>(stats.max_us), failures == 0 ? "no allocations after init" : "FAILED");
+    fflush(stdout);
+    // Relay and dispatcher tasks never return; leave without running destructors under them
+    std::_Exit(failures == 0 ? 0 : 1);
+}
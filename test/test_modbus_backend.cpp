@@ -0,0 +1,158 @@
+// ModbusRelayBackend against a coil emulator on a pseudo-terminal: the frames it
+// builds for 0x0F and 0x01, CRC handling both ways, exception replies, retries,
+// timeouts and the t3.5 silence before each request.
+
+#include "modbus_coil_emulator.h"
+#include "modbus_relay_backend.h"
+#include "driver/uart.h"
+#include "esp_timer.h"
+#include <cstdio>
+#include <cstring>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                           \
+        }                                                                         \
+    } while (0)
+
+static constexpr uint8_t SLAVE = 0x11;
+static constexpr int BAUD_RATE = 9600;
+
+static void test_crc16() {
+    // Reference frame from the Modbus-RTU spec: read 10 holding registers from slave 1
+    const uint8_t frame[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+    CHECK(ModbusRelayBackend::crc16(frame, sizeof(frame)) == 0xCDC5);
+    CHECK(ModbusRelayBackend::crc16(nullptr, 0) == 0xFFFF);
+}
+
+static void test_write_frame(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    const uint32_t before = emulator.requests();
+    RelayMask mask;
+    mask.set(0).set(9).set(15);
+    RelayMask confirmed;
+    CHECK(backend.write_outputs(mask, &confirmed) == ESP_OK);
+    CHECK(confirmed == mask);
+    CHECK(emulator.coils() == mask.to_ullong());
+    CHECK(emulator.requests() == before + 1);
+
+    // Address, 0x0F, start 0, quantity 16, 2 data bytes, coils LSB first, CRC low byte first
+    const ModbusCoilEmulator::Request request = emulator.last_request();
+    const uint8_t expected[] = {SLAVE, 0x0F, 0x00, 0x00, 0x00, 0x10, 0x02, 0x01, 0x82};
+    CHECK(request.length == sizeof(expected) + 2);
+    CHECK(memcmp(request.frame, expected, sizeof(expected)) == 0);
+    const uint16_t crc = ModbusRelayBackend::crc16(expected, sizeof(expected));
+    CHECK(request.frame[sizeof(expected)] == (crc & 0xff) && request.frame[sizeof(expected) + 1] == crc >> 8);
+}
+
+static void test_read_frame(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    emulator.set_coils(0xA5C3);
+    RelayMask mask;
+    CHECK(backend.read_outputs(&mask) == ESP_OK);
+    CHECK(mask.to_ullong() == 0xA5C3);
+
+    const ModbusCoilEmulator::Request request = emulator.last_request();
+    const uint8_t expected[] = {SLAVE, 0x01, 0x00, 0x00, 0x00, 0x10};
+    CHECK(request.length == sizeof(expected) + 2);
+    CHECK(memcmp(request.frame, expected, sizeof(expected)) == 0);
+}
+
+static void test_exception(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    const ModbusRelayBackend::Stats before = backend.get_stats();
+    const uint32_t requests = emulator.requests();
+    emulator.raise_exception(0x04, 1); // Slave device failure
+    RelayMask mask;
+    CHECK(backend.read_outputs(&mask) == ESP_ERR_NOT_SUPPORTED);
+    // A definitive answer: not retried
+    CHECK(emulator.requests() == requests + 1);
+    CHECK(backend.get_stats().exceptions == before.exceptions + 1);
+    CHECK(backend.get_stats().retries == before.retries);
+}
+
+static void test_bad_crc_is_retried(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    const ModbusRelayBackend::Stats before = backend.get_stats();
+    emulator.set_coils(0x0F0F);
+    emulator.corrupt_crc(1);
+    RelayMask mask;
+    CHECK(backend.read_outputs(&mask) == ESP_OK);
+    CHECK(mask.to_ullong() == 0x0F0F);
+    CHECK(backend.get_stats().crc_errors == before.crc_errors + 1);
+    CHECK(backend.get_stats().retries == before.retries + 1);
+}
+
+static void test_timeout_is_retried(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    ModbusRelayBackend::Stats before = backend.get_stats();
+    emulator.drop_replies(2);
+    RelayMask mask;
+    mask.set(3);
+    CHECK(backend.write_outputs(mask, nullptr) == ESP_OK);
+    CHECK(emulator.coils() == mask.to_ullong());
+    CHECK(backend.get_stats().timeouts == before.timeouts + 2);
+    CHECK(backend.get_stats().retries == before.retries + 2);
+
+    // Two retries, then it gives up
+    before = backend.get_stats();
+    const uint32_t requests = emulator.requests();
+    emulator.drop_replies(3);
+    CHECK(backend.read_outputs(&mask) == ESP_ERR_TIMEOUT);
+    CHECK(emulator.requests() == requests + 3);
+    CHECK(backend.get_stats().timeouts == before.timeouts + 3);
+    CHECK(backend.get_stats().requests == before.requests + 1);
+}
+
+static void test_reply_from_other_slave(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    const uint32_t requests = emulator.requests();
+    emulator.answer_as(SLAVE + 1, 3);
+    RelayMask mask;
+    CHECK(backend.read_outputs(&mask) == ESP_ERR_INVALID_RESPONSE);
+    CHECK(emulator.requests() == requests + 3);
+
+    emulator.answer_as(SLAVE + 1, 1);
+    CHECK(backend.read_outputs(&mask) == ESP_OK);
+}
+
+static void test_inter_frame_silence(ModbusRelayBackend &backend, ModbusCoilEmulator &emulator) {
+    // 11-bit characters at 9600 baud: t3.5 is just over 4 ms
+    constexpr int64_t t35_us = (11 * 1000000 / BAUD_RATE * 7 + 1) / 2;
+    RelayMask mask;
+    for (int i = 0; i < 5; i++) {
+        CHECK(backend.read_outputs(&mask) == ESP_OK);
+        const ModbusCoilEmulator::Request request = emulator.last_request();
+        if (request.gap_us >= 0 && request.gap_us < t35_us) {
+            fprintf(stderr, "request %d after %lld us of silence, t3.5 is %lld us\n", i,
+                    static_cast<long long>(request.gap_us), static_cast<long long>(t35_us));
+            failures++;
+        }
+    }
+}
+
+int main() {
+    test_crc16();
+
+    ModbusCoilEmulator emulator(SLAVE);
+    if (!emulator.start()) {
+        fprintf(stderr, "No pseudo-terminal available\n");
+        return 77; // Skipped
+    }
+    host_uart_attach(RS485_UART_NUM, emulator.slave_fd());
+
+    ModbusRelayBackend backend(SLAVE, BAUD_RATE);
+    CHECK(backend.start() == ESP_OK);
+    CHECK(backend.poll(0) == RelayLinkState::READY);
+
+    test_write_frame(backend, emulator);
+    test_read_frame(backend, emulator);
+    test_exception(backend, emulator);
+    test_bad_crc_is_retried(backend, emulator);
+    test_timeout_is_retried(backend, emulator);
+    test_reply_from_other_slave(backend, emulator);
+    test_inter_frame_silence(backend, emulator);
+    CHECK(emulator.crc_errors() == 0);
+
+    backend.log_stats();
+    printf("%s\n", failures == 0 ? "All Modbus backend checks passed" : "Modbus backend checks FAILED");
+    return failures == 0 ? 0 : 1;
+}